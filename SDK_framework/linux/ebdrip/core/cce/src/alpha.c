@@ -26,8 +26,16 @@ void cceMultiplyAlpha(uint32 count,
 {
   uint32 i;
 
-  for (i = 0; i < count; i ++)
-    result[i] = Multiply(src[i], alpha);
+  if (alpha == COLORVALUE_ONE) {
+    for (i = 0; i < count; i ++)
+      result[i] = src[i];
+  } else if (alpha == COLORVALUE_ZERO) {
+    for (i = 0; i < count; i ++)
+      result[i] = COLORVALUE_ZERO;
+  } else {
+    for (i = 0; i < count; i ++)
+      result[i] = Multiply(src[i], alpha);
+  }
 }
 
 /* Divide 'count' color values in 'src' by 'alpha', storing the results in
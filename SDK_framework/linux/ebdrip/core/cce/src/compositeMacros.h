@@ -31,12 +31,15 @@
  * Fixed point divide of a_ by b_ This should not be used for general divide
  * operations - it is only intended to be used when both of the parameters are
  * fixed point representations of a number <= to 1. The result is limited to
- * COLORVALUE_ONE. Divides by zero return zero.
+ * COLORVALUE_ONE. Divides by zero return zero. Dividing by one is very common
+ * (opaque backdrops and sources), so it is tested for explicitly to avoid the
+ * integer division.
  */
 #define Divide(a_, b_)                                               \
   (COLORVALUE)(((a_) | (b_)) == 0 ? 0 :                              \
                ((b_) <= (a_) ? COLORVALUE_ONE :                      \
-                ((uint32)(a_) * COLORVALUE_ONE) / (uint32)(b_)))
+                ((b_) == COLORVALUE_ONE ? (a_) :                     \
+                 ((uint32)(a_) * COLORVALUE_ONE) / (uint32)(b_))))
 
 /**
  * Perform the first two stages of the transparency calculation (the
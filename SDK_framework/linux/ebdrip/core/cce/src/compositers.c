@@ -142,6 +142,22 @@
 
 #include "compositeMacros.h"
 
+/* The compositers are the innermost loops of backdrop compositing. Where
+   the blend simplifies to fixed point multiplies, the loops are kept free of
+   branches and the per-call alpha terms are hoisted, so that the compiler
+   can vectorise them. Opaque sources and backdrops are common enough that
+   the cases where alpha terms reduce to copies are handled explicitly. All
+   of the special cases give exactly the same results as the general case. */
+
+/* Copy 'count' color values from 'src' to 'result'. */
+static void copyColors(uint32 count, const COLORVALUE *src, COLORVALUE *result)
+{
+  uint32 i;
+
+  for (i = 0; i < count; i ++)
+    result[i] = src[i];
+}
+
 /* --Public methods-- */
 
 /* --'Normal' blend mode variants-- */
@@ -151,13 +167,19 @@ void cceNormal(uint32 count,
                const COLORVALUE *bdPremult, COLORVALUE bdAlpha,
                COLORVALUE* result)
 {
-  uint32 i;
+  uint32 i, omSrcAlpha = COLORVALUE_ONE - srcAlpha;
 
   UNUSED_PARAM(COLORVALUE, bdAlpha) ;
 
-  for (i = 0; i < count; i ++) {
-    result[i] = (COLORVALUE)(Multiply(COLORVALUE_ONE - srcAlpha, bdPremult[i]) +
-                             Multiply(src[i], srcAlpha));
+  if (srcAlpha == COLORVALUE_ONE) {
+    copyColors(count, src, result);
+  } else if (srcAlpha == COLORVALUE_ZERO) {
+    copyColors(count, bdPremult, result);
+  } else {
+    for (i = 0; i < count; i ++) {
+      result[i] = (COLORVALUE)(Multiply(omSrcAlpha, bdPremult[i]) +
+                               Multiply(src[i], srcAlpha));
+    }
   }
 }
 
@@ -166,13 +188,17 @@ void cceNormalPreMult(uint32 count,
                       const COLORVALUE *bdPremult, COLORVALUE bdAlpha,
                       COLORVALUE* result)
 {
-  uint32 i;
+  uint32 i, omSrcAlpha = COLORVALUE_ONE - srcAlpha;
 
   UNUSED_PARAM(COLORVALUE, bdAlpha) ;
 
-  for (i = 0; i < count; i ++) {
-    result[i] = (COLORVALUE)(Multiply(COLORVALUE_ONE - srcAlpha, bdPremult[i]) +
-                             srcPremult[i]);
+  if (srcAlpha == COLORVALUE_ONE) {
+    copyColors(count, srcPremult, result);
+  } else {
+    for (i = 0; i < count; i ++) {
+      result[i] = (COLORVALUE)(Multiply(omSrcAlpha, bdPremult[i]) +
+                               srcPremult[i]);
+    }
   }
 }
 
@@ -194,12 +220,22 @@ void cceMultiply(uint32 count,
                  COLORVALUE* result)
 {
   uint32 i;
-
-  for (i = 0; i < count; i ++) {
-    uint32 srcPremult = Multiply(src[i], srcAlpha);
-    result[i] = (COLORVALUE)(Multiply(COLORVALUE_ONE - srcAlpha, bdPremult[i]) +
-                             Multiply(COLORVALUE_ONE - bdAlpha, srcPremult) +
-                             Multiply(srcPremult, bdPremult[i]));
+  uint32 omSrcAlpha = COLORVALUE_ONE - srcAlpha;
+  uint32 omBdAlpha = COLORVALUE_ONE - bdAlpha;
+
+  if (srcAlpha == COLORVALUE_ONE) {
+    /* Source is its own pre-multiplied color. */
+    for (i = 0; i < count; i ++) {
+      result[i] = (COLORVALUE)(Multiply(omBdAlpha, src[i]) +
+                               Multiply(src[i], bdPremult[i]));
+    }
+  } else {
+    for (i = 0; i < count; i ++) {
+      uint32 srcPremult = Multiply(src[i], srcAlpha);
+      result[i] = (COLORVALUE)(Multiply(omSrcAlpha, bdPremult[i]) +
+                               Multiply(omBdAlpha, srcPremult) +
+                               Multiply(srcPremult, bdPremult[i]));
+    }
   }
 }
 
@@ -209,10 +245,12 @@ void cceMultiplyPreMult(uint32 count,
                         COLORVALUE* result)
 {
   uint32 i;
+  uint32 omSrcAlpha = COLORVALUE_ONE - srcAlpha;
+  uint32 omBdAlpha = COLORVALUE_ONE - bdAlpha;
 
   for (i = 0; i < count; i ++) {
-    result[i] = (COLORVALUE)(Multiply(COLORVALUE_ONE - srcAlpha, bdPremult[i]) +
-                             Multiply(COLORVALUE_ONE - bdAlpha, srcPremult[i]) +
+    result[i] = (COLORVALUE)(Multiply(omSrcAlpha, bdPremult[i]) +
+                             Multiply(omBdAlpha, srcPremult[i]) +
                              Multiply(srcPremult[i], bdPremult[i]));
   }
 }
@@ -238,10 +276,14 @@ void cceScreen(uint32 count,
 
   UNUSED_PARAM(COLORVALUE, bdAlpha) ;
 
-  for (i = 0; i < count; i ++) {
-    uint32 srcPremult = Multiply(src[i], srcAlpha);
-    result[i] = (COLORVALUE)(srcPremult + bdPremult[i] -
-                             Multiply(srcPremult, bdPremult[i]));
+  if (srcAlpha == COLORVALUE_ONE) {
+    cceScreenPreMult(count, src, srcAlpha, bdPremult, bdAlpha, result);
+  } else {
+    for (i = 0; i < count; i ++) {
+      uint32 srcPremult = Multiply(src[i], srcAlpha);
+      result[i] = (COLORVALUE)(srcPremult + bdPremult[i] -
+                               Multiply(srcPremult, bdPremult[i]));
+    }
   }
 }
 
@@ -651,10 +693,14 @@ void cceExclusion(uint32 count,
 
   UNUSED_PARAM(COLORVALUE, bdAlpha) ;
 
-  for (i = 0; i < count; i ++) {
-    COLORVALUE srcPremult = Multiply(src[i], srcAlpha);
-    result[i] = (COLORVALUE)(srcPremult + bdPremult[i] -
-                             (2 * Multiply(srcPremult, bdPremult[i])));
+  if (srcAlpha == COLORVALUE_ONE) {
+    cceExclusionPreMult(count, src, srcAlpha, bdPremult, bdAlpha, result);
+  } else {
+    for (i = 0; i < count; i ++) {
+      COLORVALUE srcPremult = Multiply(src[i], srcAlpha);
+      result[i] = (COLORVALUE)(srcPremult + bdPremult[i] -
+                               (2 * Multiply(srcPremult, bdPremult[i])));
+    }
   }
 }
 
@@ -764,9 +810,10 @@ void cceWeightedAverage(uint32 count, const COLORVALUE *src,
       result[i] = Multiply(shape, src[i]);
     }
   } else {
+    uint32 omShape = COLORVALUE_ONE - shape;
+
     for ( i = 0; i < count; ++i ) {
-      result[i] = Multiply(COLORVALUE_ONE - shape, bd[i]) +
-                  Multiply(shape, src[i]);
+      result[i] = Multiply(omShape, bd[i]) + Multiply(shape, src[i]);
     }
   }
 }
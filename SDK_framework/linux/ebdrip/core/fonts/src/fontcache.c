@@ -46,6 +46,10 @@ static int32 last_purge = 0;
 /* Pointer to the cached fonts */
 static FONTCACHE *thefontcache = NULL ;
 
+/* Highest save level of any cached font. Restores to this level or above
+   have nothing to mark, so need not walk the font list. */
+static int32 fontcache_savelevel = -1 ;
+
 /*---------------------------------------------------------------------------*/
 /* Type definitions for font cache structures */
 struct MATRIXCACHE {
@@ -112,6 +116,8 @@ CHARCACHE *fontcache_new_char(FONTinfo *fontInfo, OBJECT *glyphname)
 
     theFontId(*fcptr) = theCurrFid(*fontInfo) ;
     theISaveLevel(fcptr) = context->savelevel ;
+    if ( fontcache_savelevel < context->savelevel )
+      fontcache_savelevel = context->savelevel ;
 
     fcptr->link = NULL ;
     fcptr->next = thefontcache ;
@@ -201,6 +207,8 @@ Bool fontcache_lookup_font(FONTinfo *fontInfo)
 
           theFontId(*fcptr) = theCurrFid(*fontInfo) ;
           theISaveLevel( fcptr ) = context->savelevel ;
+          if ( fontcache_savelevel < context->savelevel )
+            fontcache_savelevel = context->savelevel ;
           theLookupFont( *fontInfo) = fcptr ;
           return TRUE ;
         }
@@ -525,9 +533,15 @@ void fontcache_restore( int32 slevel )
 {
   register FONTCACHE *fcptr ;
 
+  /* Nothing has been cached since the save. */
+  if ( fontcache_savelevel <= slevel )
+    return ;
+
   for ( fcptr = thefontcache ; fcptr ; fcptr = fcptr->next)
     if ( theISaveLevel( fcptr ) > slevel )
       theISaveLevel( fcptr ) = -1 ;
+
+  fontcache_savelevel = slevel ;
 }
 
 
@@ -1251,6 +1265,7 @@ static void init_C_globals_fontcache(void)
   no_purge = 0 ;
   last_purge = 0 ;
   thefontcache = NULL ;
+  fontcache_savelevel = -1 ;
   fontcache_compressing = FALSE ;
 }
 
@@ -218,6 +218,11 @@ struct GS_CHAIN_CACHE_STATE {
    */
   uint32 nChainCaches;
   uint32 nEmptyChainCaches;
+
+  /* The highest saveLevel of any entry in the ChainCache. A restore to this
+   * level or above can't affect any entry, so needn't walk the ChainCaches.
+   */
+  int32 maxSaveLevel;
 };
 
 #define INCREMENT_CACHED_CHAINS \
@@ -574,6 +579,9 @@ Bool cc_addChainCacheEntry(GS_COLORinfo *colorInfo,
       cacheListEntry->info.colorantArray[i] = tmpInfo.colorantArray[i];
   }
 
+  if (cacheListEntry->info.saveLevel > chainCacheState->maxSaveLevel)
+    chainCacheState->maxSaveLevel = cacheListEntry->info.saveLevel;
+
   /* Add new entry to the front of the list */
   cacheListEntry->next = colorInfo->chainCache[colorType]->list;
   colorInfo->chainCache[colorType]->list = cacheListEntry;
@@ -1337,7 +1345,13 @@ Bool cc_invalidateChainCache(GS_COLORinfo *colorInfo, int32 colorType)
  */
 void cc_chainCacheRestore(int32 saveLevel)
 {
-  GS_CHAIN_CACHE *chainCache = frontEndColorState->chainCacheState->gChainCacheHead;
+  GS_CHAIN_CACHE_STATE *chainCacheState = frontEndColorState->chainCacheState;
+  GS_CHAIN_CACHE *chainCache = chainCacheState->gChainCacheHead;
+  int32 maxSaveLevel = 0;
+
+  /* Nothing has been cached since the save */
+  if (chainCacheState->maxSaveLevel <= saveLevel)
+    return;
 
   while (chainCache != NULL) {
     GS_CHAIN_CACHE *nextChainCache = chainCache->next;
@@ -1394,11 +1408,20 @@ void cc_chainCacheRestore(int32 saveLevel)
       else
         prevCacheEntry = cacheListEntry;
 
+      if (prevCacheEntry == cacheListEntry &&
+          cacheListEntry->info.saveLevel > maxSaveLevel)
+        maxSaveLevel = cacheListEntry->info.saveLevel;
+
       cacheListEntry = nextCacheEntry;
     }
 
     chainCache = nextChainCache;
   }
+
+  /* Entries that are valid for all save levels keep their saveLevel, so that
+   * their transform chains are invalidated by every restore below it.
+   */
+  chainCacheState->maxSaveLevel = maxSaveLevel;
 }
 
 /* Purge the ChainCache of all caches containing simple transforms prior to
@@ -13,6 +13,9 @@
 #include "core.h"
 
 #include "often.h"
+#include "mm.h"
+#include "hqmemcpy.h"
+#include "hqmemset.h"
 #include "asyncps.h"
 #include "progupdt.h"
 #include "hpscreen.h"
@@ -25,6 +28,25 @@ static int32 htonepartition(USERVALUE *spotvals ,
                             int32 number ,
                             register USERVALUE pivot );
 
+static Bool tholdcountsort(uint8 *spotvals8 ,
+                           uint16 *spotvals16 ,
+                           int16 *xcoords ,
+                           int16 *ycoords ,
+                           int32 number ,
+                           int32 minval , int32 maxval );
+
+static void tholdquicksort(uint8 *spotvals ,
+                           int16 *xcoords ,
+                           int16 *ycoords ,
+                           int32 number ,
+                           int32 pivot1 , int32 pivot2 );
+
+static void thold16quicksort(uint16 *spotvals ,
+                             int16 *xcoords ,
+                             int16 *ycoords ,
+                             int32 number ,
+                             int32 pivot1 , int32 pivot2 );
+
 static int32 tholdpartition(uint8 *spotvals ,
                             int16 *xcoords ,
                             int16 *ycoords ,
@@ -45,6 +67,11 @@ static int32 thold16partition(uint16 *spotvals ,
 
    Yet another quick sort - this time on the halftone values.
 
+   This does not use the counting sort the threshold sorts use. Spot function
+   values are arbitrary reals, and the order this partitioning leaves equal
+   values in decides which cell of a tie is turned on first, so any other
+   sort would change the dot growth of existing screens.
+
 ---------------------------------------------------------------------------- */
 void qsorthalftones(USERVALUE *spotvals ,
                     CELLS **cells ,
@@ -149,12 +176,115 @@ static int32 htonepartition(USERVALUE *spotvals ,
 }
 
 
+/* ----------------------------------------------------------------------------
+   Counting sort of threshold values, carrying the coordinates with them.
+
+   Threshold values are small integers, so two passes over the array sort
+   it, where partitioning on the value range takes a pass per bit of the
+   values. Equal thresholds come on at the same gray level, so their order
+   does not affect the screen; this sort keeps them in cell order. Returns
+   FALSE if there isn't memory for the copies, in which case the arrays are
+   untouched.
+---------------------------------------------------------------------------- */
+static Bool tholdcountsort(uint8 *spotvals8 ,
+                           uint16 *spotvals16 ,
+                           int16 *xcoords ,
+                           int16 *ycoords ,
+                           int32 number ,
+                           int32 minval , int32 maxval )
+{
+  int32 *counts ;
+  int16 *txcoords , *tycoords ;
+  uint8 *tvals8 = NULL ;
+  uint16 *tvals16 = NULL ;
+  size_t nvalues = ( size_t )( maxval - minval + 1 ) ;
+  size_t size ;
+  int32 i , total ;
+
+  HQASSERT(( spotvals8 == NULL ) != ( spotvals16 == NULL ) ,
+           "Need exactly one of the threshold value arrays" ) ;
+
+  size = nvalues * sizeof( int32 ) +
+         ( size_t )number * ( 2 * sizeof( int16 ) +
+                              ( spotvals8 ? sizeof( uint8 ) : sizeof( uint16 ))) ;
+  counts = mm_alloc( mm_pool_temp , size , MM_ALLOC_CLASS_HALFTONE_VALUES ) ;
+  if ( counts == NULL )
+    return FALSE ;
+
+  txcoords = ( int16 * )( counts + nvalues ) ;
+  tycoords = txcoords + number ;
+  if ( spotvals8 )
+    tvals8 = ( uint8 * )( tycoords + number ) ;
+  else
+    tvals16 = ( uint16 * )( tycoords + number ) ;
+
+  HqMemZero(( uint8 * )counts , ( int32 )( nvalues * sizeof( int32 ))) ;
+  HqMemCpy( txcoords , xcoords , number * sizeof( int16 )) ;
+  HqMemCpy( tycoords , ycoords , number * sizeof( int16 )) ;
+
+  if ( spotvals8 ) {
+    HqMemCpy( tvals8 , spotvals8 , number ) ;
+    for ( i = 0 ; i < number ; ++i ) {
+      HQASSERT( tvals8[ i ] >= minval && tvals8[ i ] <= maxval ,
+                "Threshold value out of range" ) ;
+      ++counts[ tvals8[ i ] - minval ] ;
+    }
+  } else {
+    HqMemCpy( tvals16 , spotvals16 , number * sizeof( uint16 )) ;
+    for ( i = 0 ; i < number ; ++i ) {
+      HQASSERT( tvals16[ i ] >= minval && tvals16[ i ] <= maxval ,
+                "Threshold value out of range" ) ;
+      ++counts[ tvals16[ i ] - minval ] ;
+    }
+  }
+
+  /* Turn the counts into the start index for each value. */
+  for ( total = 0 , i = 0 ; i < ( int32 )nvalues ; ++i ) {
+    int32 count = counts[ i ] ;
+    counts[ i ] = total ;
+    total += count ;
+  }
+  HQASSERT( total == number , "Lost threshold values counting" ) ;
+
+  SwOftenSafe() ;
+
+  for ( i = 0 ; i < number ; ++i ) {
+    int32 value = ( spotvals8 ? tvals8[ i ] : tvals16[ i ] ) ;
+    int32 dest = counts[ value - minval ]++ ;
+
+    if ( spotvals8 )
+      spotvals8[ dest ] = ( uint8 )value ;
+    else
+      spotvals16[ dest ] = ( uint16 )value ;
+    xcoords[ dest ] = txcoords[ i ] ;
+    ycoords[ dest ] = tycoords[ i ] ;
+  }
+
+  mm_free( mm_pool_temp , counts , size ) ;
+  return TRUE ;
+}
+
 /* ---------------------------------------------------------------------------- */
 void qsortthreshold(uint8 *spotvals ,
                     int16 *xcoords ,
                     int16 *ycoords ,
                     int32 number ,
                     int32 pivot1 , int32 pivot2 )
+{
+  HQASSERT( pivot1 < pivot2 , "what a waste of a call" ) ;
+  HQASSERT( number > 1      , "what a waste of a call too" ) ;
+
+  if ( ! tholdcountsort( spotvals , NULL , xcoords , ycoords , number ,
+                         pivot1 , pivot2 ))
+    tholdquicksort( spotvals , xcoords , ycoords , number , pivot1 , pivot2 ) ;
+}
+
+/* ---------------------------------------------------------------------------- */
+static void tholdquicksort(uint8 *spotvals ,
+                           int16 *xcoords ,
+                           int16 *ycoords ,
+                           int32 number ,
+                           int32 pivot1 , int32 pivot2 )
 {
   int32 k ;
   int32 pivot ;
@@ -166,14 +296,14 @@ void qsortthreshold(uint8 *spotvals ,
   k = tholdpartition( spotvals , xcoords , ycoords , number , pivot ) ;
   if ( k > 1 &&
        pivot - 1 - pivot1 > 0 )
-    qsortthreshold( spotvals ,
+    tholdquicksort( spotvals ,
                     xcoords ,
                     ycoords ,
                     k ,
                     pivot1 , pivot - 1 ) ;
   if ( number - k > 1 &&
        pivot2 - pivot > 0 )
-    qsortthreshold( & spotvals[ k ] ,
+    tholdquicksort( & spotvals[ k ] ,
                     & xcoords[ k ] ,
                     & ycoords[ k ] ,
                     number - k ,
@@ -234,6 +364,21 @@ void qsort16threshold(uint16 *spotvals ,
                       int16 *ycoords ,
                       int32 number ,
                       int32 pivot1 , int32 pivot2 )
+{
+  HQASSERT( pivot1 < pivot2 , "what a waste of a call" ) ;
+  HQASSERT( number > 1      , "what a waste of a call too" ) ;
+
+  if ( ! tholdcountsort( NULL , spotvals , xcoords , ycoords , number ,
+                         pivot1 , pivot2 ))
+    thold16quicksort( spotvals , xcoords , ycoords , number , pivot1 , pivot2 ) ;
+}
+
+/* ---------------------------------------------------------------------------- */
+static void thold16quicksort(uint16 *spotvals ,
+                             int16 *xcoords ,
+                             int16 *ycoords ,
+                             int32 number ,
+                             int32 pivot1 , int32 pivot2 )
 {
   int32 k ;
   int32 pivot ;
@@ -245,14 +390,14 @@ void qsort16threshold(uint16 *spotvals ,
   k = thold16partition( spotvals , xcoords , ycoords , number , pivot ) ;
   if ( k > 1 &&
        pivot - 1 - pivot1 > 0 )
-    qsort16threshold( spotvals ,
+    thold16quicksort( spotvals ,
                       xcoords ,
                       ycoords ,
                       k ,
                       pivot1 , pivot - 1 ) ;
   if ( number - k > 1 &&
        pivot2 - pivot > 0 )
-    qsort16threshold( & spotvals[ k ] ,
+    thold16quicksort( & spotvals[ k ] ,
                       & xcoords[ k ] ,
                       & ycoords[ k ] ,
                       number - k ,
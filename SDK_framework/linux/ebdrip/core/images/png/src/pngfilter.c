@@ -27,6 +27,11 @@
 
 #define PNGSTATE_NAME "PNG filter state"
 
+/** Approximate size of the buffer of rows decoded for each fill of a
+    non-interlaced PNG. Decoding several rows per fill amortises the filter
+    and setjmp overhead over more data. */
+#define PNG_BATCH_BYTES (65536u)
+
 /**
  * Private data for PNG image filter.
  */
@@ -47,6 +52,8 @@ typedef struct PNGSTATE {
   uint32 rowbytes_data;
   uint32 rowbytes_alloc;
   uint8* row_pointer; /* for non-interleaved PNGs */
+  uint32 batch_rows; /* rows decoded into row_pointer per fill */
+  uint32 batch_alloc; /* size of row_pointer allocation */
   uint8** row_pointers; /* for interleaved PNGs */
 
   OBJECT_NAME_MEMBER
@@ -688,7 +695,7 @@ static void png_decode_dispose(FILELIST* filter)
 
     /* row_pointer only exists if the image was not interlaced. */
     if (pngstate->row_pointer) {
-      mm_free(mm_pool_temp, pngstate->row_pointer-1, pngstate->rowbytes_alloc);
+      mm_free(mm_pool_temp, pngstate->row_pointer-1, pngstate->batch_alloc);
     }
 
     /* row_pointers only exists if the image was interlaced. */
@@ -728,6 +735,7 @@ static Bool png_decode_buffer(FILELIST* filter, int32* ret_bytes)
      setjmp/longjmp *MUST* be 16 byte aligned. See request 61836. */
   jmp_buf aligned_jmpbuf ;
   PNGSTATE* pngstate;
+  uint32 rows = 1u;
 
   HQASSERT(filter, "filter is null");
 
@@ -752,25 +760,45 @@ static Bool png_decode_buffer(FILELIST* filter, int32* ret_bytes)
   }
 
   if (pngstate->interlace_type == PNG_INTERLACE_NONE) {
-    /* Not a progressive PNG -- read row-by-row. */
+    /* Not a progressive PNG -- read a batch of rows at a time. Rows are
+       packed rowbytes_data apart; the slack libpng may write past the end of
+       a row is overwritten by the next row, and allowed for after the last
+       row in the batch. */
+    uint32 row;
 
     if (! pngstate->row_pointer) {
-      pngstate->row_pointer = mm_alloc(mm_pool_temp, pngstate->rowbytes_alloc,
+      pngstate->batch_rows = PNG_BATCH_BYTES / pngstate->rowbytes_data;
+      if (pngstate->batch_rows == 0)
+        pngstate->batch_rows = 1;
+      if (pngstate->batch_rows > pngstate->height)
+        pngstate->batch_rows = pngstate->height;
+      pngstate->batch_alloc = pngstate->batch_rows * pngstate->rowbytes_data +
+        (pngstate->rowbytes_alloc - pngstate->rowbytes_data);
+
+      pngstate->row_pointer = mm_alloc(mm_pool_temp, pngstate->batch_alloc,
                                        MM_ALLOC_CLASS_PNG_BUFFER);
       if (pngstate->row_pointer == NULL)
         return error_handler(VMERROR);
 
       ++pngstate->row_pointer;
-
-      ROW_SCRIBBLE(pngstate->row_pointer, pngstate->rowbytes_data);
-      ROW_END_SET(pngstate->row_pointer, pngstate->rowbytes_data);
     }
 
-    png_read_row(pngstate->png, pngstate->row_pointer, NULL);
+    rows = pngstate->batch_rows;
+    if (rows > pngstate->height - pngstate->row_index)
+      rows = pngstate->height - pngstate->row_index;
+
+    ROW_SCRIBBLE(pngstate->row_pointer, rows * pngstate->rowbytes_data);
+    ROW_END_SET(pngstate->row_pointer, rows * pngstate->rowbytes_data);
 
-    ROW_END_ASSERT(pngstate->row_pointer, pngstate->rowbytes_data);
+    for (row = 0u; row < rows; ++row) {
+      png_read_row(pngstate->png,
+                   pngstate->row_pointer + row * pngstate->rowbytes_data,
+                   NULL);
+    }
+
+    ROW_END_ASSERT(pngstate->row_pointer, rows * pngstate->rowbytes_data);
     filter->buffer = pngstate->row_pointer;
-    filter->buffersize = (int32)pngstate->rowbytes_alloc;
+    filter->buffersize = (int32)pngstate->batch_alloc;
 
   } else {
     /* A progressive PNG -- read the whole image into a buffer. */
@@ -823,11 +851,11 @@ static Bool png_decode_buffer(FILELIST* filter, int32* ret_bytes)
     filter->buffersize = (int32)pngstate->rowbytes_alloc;
   }
 
-  HQASSERT(pngstate->rowbytes_data <= MAXINT32,
+  HQASSERT(rows * pngstate->rowbytes_data <= MAXINT32,
            "rowbytes_data overflowed int32");
-  *ret_bytes = (int32)pngstate->rowbytes_data;
+  *ret_bytes = (int32)(rows * pngstate->rowbytes_data);
 
-  ++pngstate->row_index;
+  pngstate->row_index += rows;
 
   if (pngstate->row_index == pngstate->height) {
     /* Negation signifies that this is the last buffer. */
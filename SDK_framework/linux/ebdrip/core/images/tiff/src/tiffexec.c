@@ -49,6 +49,7 @@
 
 #include "tiffclsp.h"
 #include "tifffilter.h"
+#include "tifstrip.h"    /* tiff_strip_swstart */
 
 /*
  * Sundry magic numbers
@@ -1314,6 +1315,8 @@ static Bool tiffexec_swstart(struct SWSTART *params)
   tiff_decode_filter(flptr) ;
   filter_standard_add(flptr) ;
 
+  tiff_strip_swstart() ;
+
   /* Create root last so we force cleanup on success. */
   return tiff_init_contexts();
 } /* Function tiffexec_init */
@@ -1327,6 +1330,7 @@ static void tiffexec_finish(void)
   corecontext_t *context = get_core_context_interp();
 
   tiff_finish_contexts();
+  tiff_strip_finish() ;
   context->tiff6params = NULL ;
 }
 
@@ -107,6 +107,7 @@
 #include "tifreadr.h"
 #include "t6params.h"
 #include "tiffclsp.h"
+#include "tifstrip.h"
 
 #if defined(ASSERT_BUILD)
 static int32 debug_tifffilter = 0 ;
@@ -882,6 +883,7 @@ typedef struct {
   uint32 strip_remaining ; /** Bytes left to read in current strip */
   Bool flip16 ;        /**< Flip 16-bit word bytes. */
   uint32 cie_lab_offset; /**< Lab Channel component offset. */
+  tiff_strip_decoder_t *strips ; /**< Strips decoded ahead, if any. */
   OBJECT_NAME_MEMBER
 } tiff_channel_state_t ;
 
@@ -933,6 +935,7 @@ static Bool tiff_channel_init(/*@notnull@*/ /*@in@*/ FILELIST *filter,
   state->strip_remaining = 0 ; /* Bytes left to read (not yet setup a strip) */
   state->flip16 = data->shortswap ;
   state->cie_lab_offset = 0 ;
+  state->strips = NULL ;
 
   NAME_OBJECT(state, TIFF_CHANNEL_NAME);
 
@@ -962,6 +965,8 @@ static void tiff_channel_dispose(/*@notnull@*/ /*@in@*/ FILELIST* filter)
     VERIFY_OBJECT(state, TIFF_CHANNEL_NAME) ;
     UNNAME_OBJECT(state) ;
 
+    tiff_strip_decoder_destroy(&state->strips) ;
+
     mm_free(mm_pool_temp, state, sizeof(tiff_channel_state_t)) ;
     theIFilterPrivate(filter) = NULL ;
   }
@@ -1086,6 +1091,21 @@ static Bool tiff_channel_decode(/*@notnull@*/ /*@in@*/ FILELIST *filter,
   buffer = theIBuffer(filter) ;
   remaining = theIBufferSize(filter) ;
 
+  if ( state->strips != NULL ) {
+    /* Strips are being decompressed by worker tasks; just collect them. */
+    uint32 gotbytes ;
+
+    if ( !tiff_strip_decoder_read(state->strips, buffer, (uint32)remaining,
+                                  &gotbytes) )
+      return FALSE ;
+
+    *ret_bytes = (int32)gotbytes ;
+    do_shifts_and_swaps(data,state,filter);
+    if ( gotbytes < (uint32)remaining )
+      *ret_bytes = -*ret_bytes ;
+    return TRUE ;
+  }
+
   do {
     int32 gotbytes ;
 
@@ -1155,6 +1175,48 @@ static void tiff_channel_filter(/*@notnull@*/ /*@in@*/ FILELIST *flptr)
 }
 
 /****************************************************************************/
+/** Read the raw data for a strip of a channel through its %TIFFselect filter,
+    for the strip decoder. The %TIFFselect filter applies any FillOrder bit
+    reversal. */
+static Bool tiff_select_read_strip(void *read_data, uint32 strip,
+                                   uint8 *buffer, uint32 bytes,
+                                   uint32 *bytes_read)
+{
+  FILELIST *select = read_data ;
+  Hq32x2 pos ;
+
+  HQASSERT(select != NULL &&
+           HqMemCmp(select->clist, select->len, NAME_AND_LENGTH("%TIFFselect")) == 0,
+           "Strip reader is not using %TIFFselect") ;
+  HQASSERT(buffer != NULL, "Nowhere to put strip data") ;
+  HQASSERT(bytes_read != NULL, "Nowhere to put strip length") ;
+
+  *bytes_read = 0 ;
+
+  Hq32x2FromUint32(&pos, strip) ;
+  if ( theIMyResetFile(select)(select) == EOF ||
+       theIMySetFilePos(select)(select, &pos) == EOF )
+    return error_handler(IOERROR) ;
+
+  while ( bytes > 0 ) {
+    uint8 *selbuf ;
+    int32 gotbytes ;
+
+    if ( !GetFileBuff(select, (int32)bytes, &selbuf, &gotbytes) ) {
+      if ( isIIOError(select) )
+        return error_handler(IOERROR) ;
+      break ; /* End of strip data */
+    }
+
+    HqMemCpy(buffer, selbuf, gotbytes) ;
+    buffer += gotbytes ;
+    bytes -= (uint32)gotbytes ;
+    *bytes_read += (uint32)gotbytes ;
+  }
+
+  return TRUE ;
+}
+
 /** Initialise the filter chain for a given channel of a TIFF file, layering
     the %TIFFselect, decompression filters and %TIFFchannel filters on top of
     %TIFFbase. Note that this function relies on knowledge of the %TIFFselect
@@ -1170,6 +1232,7 @@ static Bool tiff_decode_channel_init(/*@notnull@*/ /*@out@*/ FILELIST **channel,
   tiff_select_state_t *select_st ;
   tiff_image_data_t *data ;
   tiff_channel_state_t *channel_state;
+  tiff_strip_decoder_t *strips ;
   Bool bigendian;
 
   HQASSERT(channel != NULL, "No where to put TIFF channel filter chain") ;
@@ -1192,90 +1255,103 @@ static Bool tiff_decode_channel_init(/*@notnull@*/ /*@out@*/ FILELIST **channel,
 
   data = tiff_base_data(tiffbase) ;
 
-  switch ( data->compression ) {
-    uint32 eodcount ;
-  case COMPRESS_CCITT:
-    select_st->update_rows = (data->number_strips > 1) ;
-    if ( !tiff_ccitt_filter(pool, data, data->rows_per_strip,
-                            &select_st->decompress_params) ||
-         !filter_layer(*channel,
-                       NAME_AND_LENGTH("CCITTFaxDecode"),
-                       &select_st->decompress_params, channel) )
-      return FALSE ;
-    break ;
-  case COMPRESS_CCITT_T4:
-    select_st->update_rows = (data->number_strips > 1) ;
-    if ( !tiff_ccitt4_filter(pool, data, data->rows_per_strip,
-                             &select_st->decompress_params) ||
-         !filter_layer(*channel,
-                       NAME_AND_LENGTH("CCITTFaxDecode"),
-                       &select_st->decompress_params, channel) )
-      return FALSE ;
-    break ;
-  case COMPRESS_CCITT_T6:
-    if ( !tiff_ccitt6_filter(pool, data, &select_st->decompress_params) ||
-         !filter_layer(*channel,
-                       NAME_AND_LENGTH("CCITTFaxDecode"),
-                       &select_st->decompress_params, channel) )
-      return FALSE ;
-    break ;
-  case COMPRESS_LZW:
-    if ( get_core_context()->tiff6params->f_strict ) {
-      /* Have LZW decoder look for EOD as per spec */
-      eodcount = 0;
-    } else { /* Read upto but not including the EOD */
-      select_st->update_eodcount = (data->number_strips > 1) ;
-      eodcount = data->bytes_per_row * data->rows_per_strip;
-    }
-    bigendian = !data->shortswap;
-    if ( !tiff_lzw_filter(pool, data, eodcount, bigendian, &select_st->decompress_params) ||
-         !filter_layer(*channel,
-                       NAME_AND_LENGTH("LZWDecode"),
-                       &select_st->decompress_params, channel) )
-      return FALSE ;
-    break ;
-  case COMPRESS_JPEG_OLD:
-  case COMPRESS_JPEG:
-    /* Experimentally, the most widely-used TIFF library doesn't flip bits for
-       JPEG compression. */
-    select_st->flipbits = FALSE ;
-    if ( !tiff_jpeg_filter(pool, data, &select_st->decompress_params,
-                           data->compression == COMPRESS_JPEG_OLD) ||
-         !filter_layer(*channel,
-                       NAME_AND_LENGTH("DCTDecode"),
-                       &select_st->decompress_params, channel) )
-      return FALSE ;
-    break ;
-  case COMPRESS_FLATE:
-  case COMPRESS_FLATE_TIFFLIB:
-    if ( data->predictor != 1 &&
-         !tiff_flate_filter(pool, data, &select_st->decompress_params) )
-      return FALSE ;
+  /* If the strips can be decompressed ahead by worker tasks, the channel
+     filter collects them from the strip decoder, reading raw strip data
+     through %TIFFselect. The Flate predictor always treats 16-bit samples as
+     big-endian. */
+  bigendian = !data->shortswap ;
+  if ( data->compression == COMPRESS_FLATE ||
+       data->compression == COMPRESS_FLATE_TIFFLIB )
+    bigendian = TRUE ;
+  strips = tiff_strip_decoder_create(data, index, bigendian,
+                                     tiff_select_read_strip, *select) ;
+
+  if ( strips == NULL ) {
+    switch ( data->compression ) {
+      uint32 eodcount ;
+    case COMPRESS_CCITT:
+      select_st->update_rows = (data->number_strips > 1) ;
+      if ( !tiff_ccitt_filter(pool, data, data->rows_per_strip,
+                              &select_st->decompress_params) ||
+           !filter_layer(*channel,
+                         NAME_AND_LENGTH("CCITTFaxDecode"),
+                         &select_st->decompress_params, channel) )
+        return FALSE ;
+      break ;
+    case COMPRESS_CCITT_T4:
+      select_st->update_rows = (data->number_strips > 1) ;
+      if ( !tiff_ccitt4_filter(pool, data, data->rows_per_strip,
+                               &select_st->decompress_params) ||
+           !filter_layer(*channel,
+                         NAME_AND_LENGTH("CCITTFaxDecode"),
+                         &select_st->decompress_params, channel) )
+        return FALSE ;
+      break ;
+    case COMPRESS_CCITT_T6:
+      if ( !tiff_ccitt6_filter(pool, data, &select_st->decompress_params) ||
+           !filter_layer(*channel,
+                         NAME_AND_LENGTH("CCITTFaxDecode"),
+                         &select_st->decompress_params, channel) )
+        return FALSE ;
+      break ;
+    case COMPRESS_LZW:
+      if ( get_core_context()->tiff6params->f_strict ) {
+        /* Have LZW decoder look for EOD as per spec */
+        eodcount = 0;
+      } else { /* Read upto but not including the EOD */
+        select_st->update_eodcount = (data->number_strips > 1) ;
+        eodcount = data->bytes_per_row * data->rows_per_strip;
+      }
+      bigendian = !data->shortswap;
+      if ( !tiff_lzw_filter(pool, data, eodcount, bigendian, &select_st->decompress_params) ||
+           !filter_layer(*channel,
+                         NAME_AND_LENGTH("LZWDecode"),
+                         &select_st->decompress_params, channel) )
+        return FALSE ;
+      break ;
+    case COMPRESS_JPEG_OLD:
+    case COMPRESS_JPEG:
+      /* Experimentally, the most widely-used TIFF library doesn't flip bits for
+         JPEG compression. */
+      select_st->flipbits = FALSE ;
+      if ( !tiff_jpeg_filter(pool, data, &select_st->decompress_params,
+                             data->compression == COMPRESS_JPEG_OLD) ||
+           !filter_layer(*channel,
+                         NAME_AND_LENGTH("DCTDecode"),
+                         &select_st->decompress_params, channel) )
+        return FALSE ;
+      break ;
+    case COMPRESS_FLATE:
+    case COMPRESS_FLATE_TIFFLIB:
+      if ( data->predictor != 1 &&
+           !tiff_flate_filter(pool, data, &select_st->decompress_params) )
+        return FALSE ;
 
-    if ( !filter_layer(*channel,
-                       NAME_AND_LENGTH("FlateDecode"),
-                       &select_st->decompress_params, channel) )
-      return FALSE ;
+      if ( !filter_layer(*channel,
+                         NAME_AND_LENGTH("FlateDecode"),
+                         &select_st->decompress_params, channel) )
+        return FALSE ;
 
-    break ;
-  case COMPRESS_Packbits:
-    select_st->update_eodcount_sfd = TRUE;
-    if ( !filter_layer(*channel,
-                       NAME_AND_LENGTH("RunLengthDecode"),
-                       &select_st->decompress_params, channel) )
-      return FALSE ;
-    if (!tiff_subfiledecode_filter(pool,&select_st->decompress_params_sfd))
-      return FALSE ;
-    if ( !filter_layer(*channel,
-                       NAME_AND_LENGTH("SubFileDecode"),
-                       &select_st->decompress_params_sfd, channel) )
-      return FALSE ;
-    break ;
-  default:
-    HQFAIL("Unknown TIFF compression scheme") ;
-    /*@fallthrough@*/
-  case COMPRESS_None:
-    break ;
+      break ;
+    case COMPRESS_Packbits:
+      select_st->update_eodcount_sfd = TRUE;
+      if ( !filter_layer(*channel,
+                         NAME_AND_LENGTH("RunLengthDecode"),
+                         &select_st->decompress_params, channel) )
+        return FALSE ;
+      if (!tiff_subfiledecode_filter(pool,&select_st->decompress_params_sfd))
+        return FALSE ;
+      if ( !filter_layer(*channel,
+                         NAME_AND_LENGTH("SubFileDecode"),
+                         &select_st->decompress_params_sfd, channel) )
+        return FALSE ;
+      break ;
+    default:
+      HQFAIL("Unknown TIFF compression scheme") ;
+      /*@fallthrough@*/
+    case COMPRESS_None:
+      break ;
+    }
   }
 
   /* Put channel filter on top to control strip re-building. */
@@ -1283,13 +1359,16 @@ static Bool tiff_decode_channel_init(/*@notnull@*/ /*@out@*/ FILELIST **channel,
   theIUnderFile(&prototype) = *channel ;
   theIUnderFilterId(&prototype) = theIFilterId(*channel) ;
 
-  if ( !filter_create(&prototype, channel, &noparams, NULL) )
+  if ( !filter_create(&prototype, channel, &noparams, NULL) ) {
+    tiff_strip_decoder_destroy(&strips) ;
     return FALSE ;
+  }
 
   /* Set the channel we want to extract. */
   channel_state = theIFilterPrivate(*channel) ;
   VERIFY_OBJECT(channel_state, TIFF_CHANNEL_NAME) ;
   channel_state->channel = index ;
+  channel_state->strips = strips ;
 
   return TRUE ;
 }
@@ -28,6 +28,7 @@
 #include "ifdreadr.h"
 #include "tifftags.h"
 #include "tifreadr.h"
+#include "tifstrip.h"   /* tiff_strip_decoder_t */
 #include "hqmemcmp.h"   /* HqMemCmp() */
 #include "hqmemcpy.h"   /* HqMemCpy */
 #include "hqmemset.h"
@@ -97,6 +98,10 @@ typedef struct {
                         /* PS string to return decoded strip component data in */
   OBJECT            ostring_flip;
                                   /* PS string to return flipped image data in */
+  tiff_strip_decoder_t* strips;
+                             /* Strip component data decoded ahead, if any */
+  struct tiff_reader_t* p_reader;      /* Reader for the strip decoder callback */
+  uint32            index;               /* Index of this strip component */
 } tiff_component_t;
 
 /** TIFF image data state
@@ -146,6 +151,10 @@ typedef struct {
   uint32            last_strip_eodcount;
                                /* Number of bytes in last strip after decoding */
   OBJECT            odict_sfd;        /* Compressed strip subfiledecode filter */
+  Bool              f_strips;
+                     /* Strip components are decoded ahead by strip decoders */
+  Bool              f_strip_byteflip;
+                          /* Raw strip data read for decoders needs flipping */
 } tiff_file_data_t;
 
 
@@ -412,6 +421,7 @@ Bool tiff_new_reader(
    * tiff_free_reader_elements() works */
   p_reader->read_data.p_strmem = NULL;
   p_reader->read_data.components = NULL;
+  p_reader->read_data.f_strips = FALSE;
 
   p_reader->read_data.p_flipmem = NULL;
   p_reader->read_data.ofile_tiff = p_reader->read_data.flip_source =
@@ -440,10 +450,28 @@ Bool tiff_new_reader(
 } /* Function tiff_new_reader */
 
 
+/** Destroy any strip decoders created in tiff_setup_read. These refer to the
+ * image data, so must go before it does. */
+static void tiff_free_strip_decoders(tiff_reader_t* p_reader)
+{
+  uint32 i;
+
+  if ( p_reader->read_data.f_strips ) {
+    HQASSERT((p_reader->read_data.components != NULL),
+             "tiff_free_strip_decoders: strip decoders without components");
+    for ( i = 0; i < p_reader->read_data.number_components; i++ ) {
+      tiff_strip_decoder_destroy(&p_reader->read_data.components[i].strips);
+    }
+    p_reader->read_data.f_strips = FALSE;
+  }
+}
+
 /** Free elements allocated in tiff_setup_reader*/
 void tiff_free_reader_elements(tiff_reader_t* p_reader)
 {
 
+  tiff_free_strip_decoders(p_reader);
+
   if ( p_reader->read_data.components != NULL ) {
     /* Created buffer for image string - free it off */
     mm_free(p_reader->mm_pool, p_reader->read_data.components,
@@ -1964,6 +1992,8 @@ void tiff_free_image_data(
   HQASSERT((p_data != NULL),
            "tiff_free_image_data: NULL image data pointer");
 
+  tiff_free_strip_decoders(p_reader);
+
   if ( p_data->pp_jpeg_qtable != NULL ) {
     mm_free(p_reader->mm_pool, p_data->pp_jpeg_qtable[0],
             ((p_data->jpeg_qtable_size)*TIFF_JPEGQTABLES_SIZE*sizeof(uint8*)));
@@ -2617,6 +2647,85 @@ Bool tiff_setup_read_data(
   return TRUE ;
 }
 
+/** Read the raw data for a strip component, for the strip decoder. */
+static Bool tiff_read_strip(
+  void*       read_data,    /* I */
+  uint32      strip,        /* I */
+  uint8*      p_buffer,     /* O */
+  uint32      bytes,        /* I */
+  uint32*     bytes_read)   /* O */
+{
+  tiff_component_t* p_component = read_data;
+  tiff_reader_t*    p_reader;
+  uint32            offset;
+
+  HQASSERT((p_component != NULL),
+           "tiff_read_strip: NULL strip component pointer");
+
+  p_reader = p_component->p_reader;
+  offset = ifd_entry_array_index(p_reader->read_data.p_ifdentry_offsets,
+                                 (p_component->index*(p_reader->read_data.number_strips) + strip));
+
+  HQTRACE(tiff_debug,
+          ("tiff_read_strip: strip %u(%u) offset is %u bytecount is %u",
+           strip, p_component->index, offset, bytes));
+
+  if ( !tiff_file_seek(p_reader->p_file, offset) ) {
+    return detail_error_handler(IOERROR, "Unable to seek to start of TIFF image strip.") ;
+  }
+
+  /* Strip byte counts were checked against the file size by
+   * tiff_setup_read_data(), so all the data should be there. */
+  if ( !tiff_file_read(p_reader->p_file, p_buffer, bytes) ) {
+    return detail_error_handler(IOERROR, "Unable to read raw image data.") ;
+  }
+
+  if ( p_reader->read_data.f_strip_byteflip ) {
+    do_byteflip(p_buffer, bytes);
+  }
+
+  *bytes_read = bytes;
+  return TRUE ;
+}
+
+/** Try to decode the strip components ahead of the reader. If strip
+ * decoders cannot be created for all components, none are used and the
+ * strips are decoded through filters as they are read. */
+static void tiff_setup_strip_decoders(
+  tiff_reader_t*      p_reader,   /* I */
+  tiff_image_data_t*  p_data)     /* I */
+{
+  uint32 i;
+  Bool   bigendian;
+
+  /* The Flate predictor always treats 16-bit samples as big-endian. */
+  bigendian = (p_data->compression == COMPRESS_FLATE ||
+               p_data->compression == COMPRESS_FLATE_TIFFLIB ||
+               p_reader->bigendian);
+
+  p_reader->read_data.f_strip_byteflip =
+    (p_data->fill_order == FILLORDER_LSB_TO_MSB);
+
+  for ( i = 0; i < p_reader->read_data.number_components; i++ ) {
+    tiff_component_t* p_component = &(p_reader->read_data.components[i]);
+
+    p_component->p_reader = p_reader;
+    p_component->index = i;
+    p_component->strips = tiff_strip_decoder_create(p_data, i, bigendian,
+                                                    tiff_read_strip,
+                                                    p_component);
+    if ( p_component->strips == NULL ) {
+      while ( i > 0 ) {
+        --i;
+        tiff_strip_decoder_destroy(&p_reader->read_data.components[i].strips);
+      }
+      return;
+    }
+  }
+
+  p_reader->read_data.f_strips = TRUE;
+}
+
 /*
  * tiff_setup_read()
  */
@@ -2674,9 +2783,16 @@ Bool tiff_setup_read(
     theLen(p_reader->read_data.components[i].ostring) = (uint16)p_reader->read_data.string_length;
     oString(p_reader->read_data.components[i].ostring) =
       p_reader->read_data.p_strmem + i*(p_reader->read_data.string_length);
+    p_reader->read_data.components[i].strips = NULL;
   }
 
-  if ( p_data->compression != COMPRESS_None ) {
+  /* Decoding strips ahead replaces the decode and byte flip filters. */
+  tiff_setup_strip_decoders(p_reader, p_data);
+
+  if ( p_reader->read_data.f_strips ) {
+    p_reader->read_data.f_decode = FALSE;
+
+  } else if ( p_data->compression != COMPRESS_None ) {
     /* Layer on top decompression filter */
     switch ( p_data->compression ) {
     case COMPRESS_CCITT:
@@ -2789,7 +2905,8 @@ Bool tiff_setup_read(
     p_reader->read_data.f_decode = FALSE;
   }
 
-  if ( p_data->fill_order == FILLORDER_LSB_TO_MSB ) {
+  if ( !p_reader->read_data.f_strips &&
+       p_data->fill_order == FILLORDER_LSB_TO_MSB ) {
     /* Layer underneath a byte flip filter */
 
     if ( !tiff_subfiledecode_filter( p_reader->mm_pool,
@@ -3037,7 +3154,18 @@ Bool tiff_read_file(tiff_reader_t*  p_reader,
   p_data = &(p_reader->read_data);
 
   if ( p_data->current_strip != p_data->number_strips &&
-       TIFF_STRIP_FINISHED(&p_data->image_strip) ) {
+       TIFF_STRIP_FINISHED(&p_data->image_strip) &&
+       p_data->f_strips ) {
+    /* Strip decoders run through the strips themselves, just keep count */
+    p_data->component = &(p_data->components[0]);
+
+    /* Reset strip and component read counts for normal strip */
+    p_data->image_strip.current_read = 1;
+    p_data->current_component = 1;
+    p_data->current_strip++;
+
+  } else if ( p_data->current_strip != p_data->number_strips &&
+              TIFF_STRIP_FINISHED(&p_data->image_strip) ) {
     /* Finished reading strip (and all components) - start a new one */
 
     if ( p_data->f_decode && p_data->f_need_close ) {
@@ -3186,7 +3314,8 @@ Bool tiff_read_file(tiff_reader_t*  p_reader,
     p_data->current_component++;
 
     /* Reposition underlying TIFF file for next strip component */
-    if ( !tiff_file_seek(p_reader->p_file, p_data->component->offset) ) {
+    if ( !p_data->f_strips &&
+         !tiff_file_seek(p_reader->p_file, p_data->component->offset) ) {
       return detail_error_handler(IOERROR, "Unable to seek to TIFF image strip component data.") ;
     }
   }
@@ -3211,7 +3340,14 @@ Bool tiff_read_file(tiff_reader_t*  p_reader,
   p_component = p_data->component;
   p_buffer = oString(p_component->ostring);
 
-  if ( file_read(p_component->file_read, p_buffer, bytes, NULL) <= 0 )
+  if ( p_data->f_strips ) {
+    uint32 bytes_read;
+
+    if ( !tiff_strip_decoder_read(p_component->strips, p_buffer, bytes, &bytes_read) )
+      return FALSE ;
+    if ( bytes_read < bytes )
+      HqMemZero(p_buffer + bytes_read, bytes - bytes_read);
+  } else if ( file_read(p_component->file_read, p_buffer, bytes, NULL) <= 0 )
     return detail_error_handler(IOERROR, "Unable to read image data.") ;
 
   if (p_reader->shortswap) {
@@ -3229,7 +3365,7 @@ Bool tiff_read_file(tiff_reader_t*  p_reader,
                    !p_data->f_planar) ;
   }
 
-  if ( p_data->f_planar ) {
+  if ( p_data->f_planar && !p_data->f_strips ) {
     /* Keep track of where to read next lot of data from for this component */
     if ( !tiff_file_pos(p_reader->p_file, &(p_component->offset)) ) {
       return detail_error_handler(IOERROR, "Unable to find position in TIFF file.") ;
@@ -0,0 +1,769 @@
+/** \file
+ * \ingroup tiff
+ *
+ * $HopeName: SWv20tiff!src:tifstrip.c(EBDSDK_P.1) $
+ *
+ * Copyright (C) 2014 Global Graphics Software Ltd. All rights reserved.
+ * Global Graphics Software Ltd. Confidential Information.
+ *
+ * \brief
+ * Decoding TIFF strips ahead of the reader in worker tasks.
+ *
+ * The compression methods applied to TIFF are applied to each strip
+ * independently, so there is no need to decompress the strips one after the
+ * other on the interpreter thread. A strip decoder keeps a window of slots,
+ * each holding the raw data for one strip and space for its decoded data.
+ * The raw data is read on the interpreter thread (the underlying file is
+ * not thread safe), and then a task is spawned to decode it. All of a
+ * decoder's tasks are in one group, joined when the decoder is destroyed.
+ * The reader consumes the strips in order. When it reaches a strip whose
+ * task has not started, it decodes the strip itself; if the task is running
+ * it waits for it. The slot is then re-used for the strip one window
+ * further on.
+ *
+ * Only LZW, Flate and PackBits compression, with no predictor or horizontal
+ * differencing of 8- or 16-bit samples, are decoded this way. Other
+ * compression methods are left to the normal filter chains. The decoders
+ * here must produce the same data as the LZWDecode, FlateDecode and
+ * RunLengthDecode filters used for sequential decoding.
+ */
+
+#include "core.h"
+#include "swerrors.h"
+#include "swtrace.h"
+#include "hqmemcpy.h"
+#include "hqmemset.h"
+#include "mm.h"
+#include "mmcompat.h"
+#include "objnamer.h"
+#include "mlock.h"
+#include "taskh.h"
+#include "display.h"    /* DL_STATE */
+#include "corejob.h"    /* corejob_t */
+#include "zlib.h"
+
+#include "tiftypes.h"
+#include "tifftags.h"    /* COMPRESS_* */
+#include "tifstrip.h"
+
+/** Maximum number of strips decoded ahead for a channel. */
+#define TIFF_STRIP_MAX_SLOTS 8
+
+/** Largest decoded or raw strip we will buffer. Images with bigger strips
+    are decoded sequentially. */
+#define TIFF_STRIP_MAX_BYTES (512 * 1024)
+
+/** Limit on the buffer memory for a channel. The number of slots is reduced
+    to fit. */
+#define TIFF_STRIP_MAX_MEMORY (4 * 1024 * 1024)
+
+/* LZW code assignments, with 8-bit units. */
+#define TIFF_LZW_CLEAR     256
+#define TIFF_LZW_EOD       257
+#define TIFF_LZW_FIRSTFREE 258
+#define TIFF_LZW_MAXBITS   12
+#define TIFF_LZW_MAXCODE   4095
+
+#define TIFF_STRIP_DECODER_NAME "TIFF strip decoder"
+
+/** Mutex protecting the state of all strip slots. */
+static multi_mutex_t tiff_strip_mutex ;
+
+/** Signalled when a task finishes decoding a strip. */
+static multi_condvar_t tiff_strip_condvar ;
+
+/** LZW string table. This is only allocated for LZW compressed strips. */
+typedef struct tiff_lzw_table_t {
+  uint16 prefix[TIFF_LZW_MAXCODE + 1] ;
+  uint8 suffix[TIFF_LZW_MAXCODE + 1] ;
+  uint8 stack[TIFF_LZW_MAXCODE + 1] ;
+} tiff_lzw_table_t ;
+
+/** Progress of the strip in a slot. Changes from TIFF_STRIP_READ onwards
+    are made with the strip mutex held. */
+enum {
+  TIFF_STRIP_EMPTY,       /**< No strip started in the slot. */
+  TIFF_STRIP_READ,        /**< Raw data read, nobody decoding it yet. */
+  TIFF_STRIP_DECODING,    /**< Being decoded by a task or the reader. */
+  TIFF_STRIP_DECODED,     /**< Decoded data ready to consume. */
+  TIFF_STRIP_FAILED       /**< A task failed to decode the strip. */
+} ;
+
+/** A strip being decoded, or waiting to be consumed. */
+typedef struct tiff_strip_slot_t {
+  tiff_strip_decoder_t *decoder ; /**< Decoder owning this slot. */
+  int state ;             /**< Progress of the strip in this slot. */
+  uint32 strip ;          /**< Strip held in this slot. */
+  uint8 *raw ;            /**< Raw strip data. */
+  uint32 raw_bytes ;      /**< Amount of raw strip data read. */
+  uint8 *decoded ;        /**< Decoded strip data. */
+  uint32 decoded_bytes ;  /**< Length of decoded strip. */
+  uint32 consumed ;       /**< Decoded bytes already returned. */
+  tiff_lzw_table_t *lzw ; /**< LZW string table. */
+} tiff_strip_slot_t ;
+
+struct tiff_strip_decoder_t {
+  uint32 compression ;     /**< TIFF compression method. */
+  Bool differencing ;      /**< Predictor 2 (horizontal differencing)? */
+  uint32 bits_per_sample ; /**< Sample size for differencing. */
+  uint32 colors ;          /**< Samples per pixel in this channel. */
+  Bool bigendian ;         /**< 16-bit sample order for differencing. */
+  uint32 bytes_per_row ;   /**< Decoded row size. */
+  uint32 rows_per_strip ;  /**< Rows in all but the last strip. */
+  uint32 image_length ;    /**< Total rows in the image. */
+  uint32 number_strips ;   /**< Strips in this channel. */
+  const uint32 *strip_bytes ; /**< Raw sizes of this channel's strips. */
+  tiff_strip_read_fn *read_fn ; /**< Raw strip reader. */
+  void *read_data ;        /**< Opaque data for raw strip reader. */
+  task_group_t *parent ;   /**< Parent group for decode tasks. */
+  task_group_t *group ;    /**< Group of all decode tasks, or NULL. */
+  uint32 raw_size ;        /**< Allocated size of raw buffers. */
+  uint32 decoded_size ;    /**< Allocated size of decoded buffers. */
+  uint32 next_strip ;      /**< Next strip to return data from. */
+  Bool started ;           /**< Has the first window been started? */
+  Bool failed ;            /**< Has a strip failed to read or decode? */
+  uint32 nslots ;          /**< Number of slots in window. */
+  tiff_strip_slot_t slots[TIFF_STRIP_MAX_SLOTS] ;
+
+  OBJECT_NAME_MEMBER
+} ;
+
+/** zlib allocator, matching the FlateDecode filter's. */
+static void *tiff_strip_zalloc(void *opaque, uint32 items, uint32 size)
+{
+  UNUSED_PARAM(void *, opaque) ;
+  return mm_alloc_with_header(mm_pool_temp, (mm_size_t)(items * size),
+                              MM_ALLOC_CLASS_FLATE_ZLIB) ;
+}
+
+static void tiff_strip_zfree(void *opaque, void *mem)
+{
+  UNUSED_PARAM(void *, opaque) ;
+  mm_free_with_header(mm_pool_temp, mem) ;
+}
+
+/** Inflate a zlib-wrapped strip. Running out of input before the end of
+    the stream is not an error, the strip is just short. */
+static Bool tiff_strip_inflate(tiff_strip_slot_t *slot, uint32 outlen,
+                               uint32 *produced)
+{
+  z_stream zs ;
+  int zerr ;
+
+  HqMemZero(&zs, sizeof(zs)) ;
+  zs.zalloc = tiff_strip_zalloc ;
+  zs.zfree = tiff_strip_zfree ;
+  zs.opaque = NULL ;
+
+  if ( (zerr = inflateInit2(&zs, MAX_WBITS)) != Z_OK )
+    return error_handler(zerr == Z_MEM_ERROR ? VMERROR : IOERROR) ;
+
+  zs.next_in = slot->raw ;
+  zs.avail_in = slot->raw_bytes ;
+  zs.next_out = slot->decoded ;
+  zs.avail_out = outlen ;
+
+  do {
+    zerr = inflate(&zs, Z_NO_FLUSH) ;
+  } while ( zerr == Z_OK && zs.avail_in > 0 && zs.avail_out > 0 ) ;
+
+  *produced = outlen - zs.avail_out ;
+  (void)inflateEnd(&zs) ;
+
+  switch ( zerr ) {
+  case Z_OK:
+  case Z_STREAM_END:
+  case Z_BUF_ERROR: /* Output full or input truncated. */
+    return TRUE ;
+  case Z_MEM_ERROR:
+    return error_handler(VMERROR) ;
+  default:
+    return error_handler(IOERROR) ;
+  }
+}
+
+/** Expand a PackBits strip. As with RunLengthDecode, a length byte of 128
+    ends the strip. */
+static Bool tiff_strip_unpackbits(tiff_strip_slot_t *slot, uint32 outlen,
+                                  uint32 *produced)
+{
+  const uint8 *in = slot->raw, *inlimit = slot->raw + slot->raw_bytes ;
+  uint8 *out = slot->decoded, *outlimit = slot->decoded + outlen ;
+
+  while ( in < inlimit && out < outlimit ) {
+    uint32 length = *in++ ;
+
+    if ( length < 128 ) { /* length + 1 literal bytes follow */
+      length += 1 ;
+      if ( length > (uint32)(inlimit - in) )
+        length = CAST_PTRDIFFT_TO_UINT32(inlimit - in) ;
+      if ( length > (uint32)(outlimit - out) )
+        length = CAST_PTRDIFFT_TO_UINT32(outlimit - out) ;
+      HqMemCpy(out, in, length) ;
+      in += length ;
+      out += length ;
+    } else if ( length > 128 ) { /* replicate next byte 257 - length times */
+      if ( in == inlimit )
+        break ;
+      length = 257 - length ;
+      if ( length > (uint32)(outlimit - out) )
+        length = CAST_PTRDIFFT_TO_UINT32(outlimit - out) ;
+      HqMemSet8(out, *in++, length) ;
+      out += length ;
+    } else /* EOD */
+      break ;
+  }
+
+  *produced = CAST_PTRDIFFT_TO_UINT32(out - slot->decoded) ;
+  return TRUE ;
+}
+
+/** Decode a TIFF LZW strip. This follows lzwDecodeBuffer() with the TIFF
+    parameters: high bit first, code width increased one code early, and the
+    code width stuck at 12 bits if the table fills without a clear code. */
+static Bool tiff_strip_unlzw(tiff_strip_slot_t *slot, uint32 outlen,
+                             uint32 *produced)
+{
+  tiff_lzw_table_t *table = slot->lzw ;
+  const uint8 *in = slot->raw, *inlimit = slot->raw + slot->raw_bytes ;
+  uint8 *out = slot->decoded, *outlimit = slot->decoded + outlen ;
+  uint8 *stacktop = table->stack + TIFF_LZW_MAXCODE + 1 ;
+  uint32 bitbuf = 0, nbits = 0, bits = 9, maxcode = (1u << 9) - 1 ;
+  uint32 free_entry = TIFF_LZW_FIRSTFREE, oldcode = 0 ;
+  Bool first = TRUE ;
+  uint8 finchar = 0 ;
+  uint32 i ;
+
+  HQASSERT(table != NULL, "No LZW table for strip") ;
+
+  for ( i = 0 ; i < TIFF_LZW_FIRSTFREE ; ++i ) {
+    table->prefix[i] = 0 ;
+    table->suffix[i] = (uint8)i ;
+  }
+
+  while ( out < outlimit ) {
+    uint32 code, incode ;
+    uint8 *stackp = stacktop ;
+
+    while ( nbits < bits ) {
+      if ( in == inlimit ) /* No EOD, and strip is not complete. */
+        return error_handler(IOERROR) ;
+      bitbuf = (bitbuf << 8) | *in++ ;
+      nbits += 8 ;
+    }
+    nbits -= bits ;
+    code = (bitbuf >> nbits) & ((1u << bits) - 1) ;
+
+    if ( code == TIFF_LZW_EOD )
+      break ;
+
+    if ( code == TIFF_LZW_CLEAR ) {
+      free_entry = TIFF_LZW_FIRSTFREE ;
+      bits = 9 ;
+      maxcode = (1u << 9) - 1 ;
+      first = TRUE ;
+      continue ;
+    }
+
+    if ( first ) {
+      /* The first code after a clear is output, but nothing is added to
+         the table. */
+      *out++ = finchar = (uint8)code ;
+      oldcode = code ;
+      first = FALSE ;
+      continue ;
+    }
+
+    if ( code > free_entry + 1 )
+      return error_handler(IOERROR) ;
+
+    incode = code ;
+    if ( code >= free_entry ) {
+      *--stackp = finchar ;
+      code = oldcode ;
+    }
+
+    while ( code >= TIFF_LZW_FIRSTFREE ) {
+      if ( stackp == table->stack )
+        return error_handler(IOERROR) ;
+      *--stackp = table->suffix[code] ;
+      code = table->prefix[code] ;
+    }
+    if ( stackp == table->stack )
+      return error_handler(IOERROR) ;
+    *--stackp = finchar = table->suffix[code] ;
+
+    if ( free_entry <= TIFF_LZW_MAXCODE ) {
+      table->prefix[free_entry] = (uint16)oldcode ;
+      table->suffix[free_entry] = finchar ;
+      ++free_entry ;
+    }
+
+    if ( free_entry >= maxcode ) {
+      if ( ++bits < TIFF_LZW_MAXBITS ) {
+        maxcode = (1u << bits) - 1 ;
+      } else {
+        bits = TIFF_LZW_MAXBITS ;
+        maxcode = TIFF_LZW_MAXCODE + 1 ;
+      }
+    }
+
+    oldcode = incode ;
+
+    i = CAST_PTRDIFFT_TO_UINT32(stacktop - stackp) ;
+    if ( i > (uint32)(outlimit - out) )
+      i = CAST_PTRDIFFT_TO_UINT32(outlimit - out) ;
+    HqMemCpy(out, stackp, i) ;
+    out += i ;
+  }
+
+  *produced = CAST_PTRDIFFT_TO_UINT32(out - slot->decoded) ;
+  return TRUE ;
+}
+
+/** Undo TIFF predictor 2, horizontal differencing, a row at a time. */
+static void tiff_strip_undifference(tiff_strip_decoder_t *decoder,
+                                    uint8 *buffer, uint32 bytes)
+{
+  uint32 colors = decoder->colors ;
+
+  while ( bytes > 0 ) {
+    uint32 rowbytes = decoder->bytes_per_row, i ;
+
+    if ( rowbytes > bytes )
+      rowbytes = bytes ;
+
+    if ( decoder->bits_per_sample == 8 ) {
+      for ( i = colors ; i < rowbytes ; ++i )
+        buffer[i] = (uint8)(buffer[i] + buffer[i - colors]) ;
+    } else {
+      uint32 step = colors * 2 ;
+
+      HQASSERT(decoder->bits_per_sample == 16, "Unexpected differencing depth") ;
+      for ( i = step ; i + 1 < rowbytes ; i += 2 ) {
+        uint8 *sample = &buffer[i], *left = &buffer[i - step] ;
+        uint16 value ;
+
+        if ( decoder->bigendian ) {
+          value = (uint16)(((sample[0] << 8) | sample[1]) +
+                           ((left[0] << 8) | left[1])) ;
+          sample[0] = (uint8)(value >> 8) ;
+          sample[1] = (uint8)value ;
+        } else {
+          value = (uint16)(((sample[1] << 8) | sample[0]) +
+                           ((left[1] << 8) | left[0])) ;
+          sample[0] = (uint8)value ;
+          sample[1] = (uint8)(value >> 8) ;
+        }
+      }
+    }
+
+    buffer += rowbytes ;
+    bytes -= rowbytes ;
+  }
+}
+
+/** Number of decoded bytes in a strip. */
+static uint32 tiff_strip_size(tiff_strip_decoder_t *decoder, uint32 strip)
+{
+  uint32 rows = decoder->image_length - strip * decoder->rows_per_strip ;
+
+  if ( rows > decoder->rows_per_strip )
+    rows = decoder->rows_per_strip ;
+
+  return rows * decoder->bytes_per_row ;
+}
+
+/** Decode the raw data in a slot. This may be called on any thread. */
+static Bool tiff_strip_decode(tiff_strip_slot_t *slot)
+{
+  tiff_strip_decoder_t *decoder = slot->decoder ;
+  uint32 expected = tiff_strip_size(decoder, slot->strip), produced = 0 ;
+  Bool result ;
+
+  HQASSERT(expected <= decoder->decoded_size, "Strip too big for slot") ;
+
+  switch ( decoder->compression ) {
+  case COMPRESS_LZW:
+    result = tiff_strip_unlzw(slot, expected, &produced) ;
+    break ;
+  case COMPRESS_FLATE:
+  case COMPRESS_FLATE_TIFFLIB:
+    result = tiff_strip_inflate(slot, expected, &produced) ;
+    break ;
+  case COMPRESS_Packbits:
+    result = tiff_strip_unpackbits(slot, expected, &produced) ;
+    break ;
+  default:
+    HQFAIL("Strip decoder created for unsupported compression") ;
+    return error_handler(UNREGISTERED) ;
+  }
+
+  if ( !result )
+    return FALSE ;
+
+  if ( decoder->differencing )
+    tiff_strip_undifference(decoder, slot->decoded, produced) ;
+
+  if ( produced < expected )
+    HqMemZero(slot->decoded + produced, expected - produced) ;
+
+  slot->decoded_bytes = expected ;
+
+  return TRUE ;
+}
+
+/** Task worker function decoding one strip, unless the reader got to it
+    first. */
+static Bool tiff_strip_decode_task(corecontext_t *context, void *args)
+{
+  tiff_strip_slot_t *slot = args ;
+  Bool result ;
+
+  UNUSED_PARAM(corecontext_t *, context) ;
+
+  multi_mutex_lock(&tiff_strip_mutex) ;
+  if ( slot->state != TIFF_STRIP_READ ) {
+    multi_mutex_unlock(&tiff_strip_mutex) ;
+    return TRUE ;
+  }
+  slot->state = TIFF_STRIP_DECODING ;
+  multi_mutex_unlock(&tiff_strip_mutex) ;
+
+  result = tiff_strip_decode(slot) ;
+
+  multi_mutex_lock(&tiff_strip_mutex) ;
+  slot->state = result ? TIFF_STRIP_DECODED : TIFF_STRIP_FAILED ;
+  multi_condvar_broadcast(&tiff_strip_condvar) ;
+  multi_mutex_unlock(&tiff_strip_mutex) ;
+
+  /* A failure cancels the group, so the reader decodes the rest itself. */
+  return result ;
+}
+
+/** Can the decoder carry on without the task that it failed to create?
+    Only a shortage of resources is forgotten; interrupts and timeouts must
+    stop the image. */
+static Bool tiff_strip_task_recoverable(corecontext_t *context)
+{
+  if ( error_latest_context(context->error) != VMERROR )
+    return FALSE ;
+
+  error_clear_context(context->error) ;
+  return TRUE ;
+}
+
+/** Read the raw data for a strip into a slot, and start a task to decode
+    it. If there is no task, the reader decodes the strip when it gets to
+    it. */
+static Bool tiff_strip_start(tiff_strip_decoder_t *decoder,
+                             tiff_strip_slot_t *slot, uint32 strip)
+{
+  corecontext_t *context = get_core_context_interp() ;
+  uint32 raw_bytes = decoder->strip_bytes[strip] ;
+  task_t *task ;
+
+  HQASSERT(IS_INTERPRETER(), "Strips must be read by the interpreter") ;
+  HQASSERT(slot->state == TIFF_STRIP_EMPTY ||
+           slot->state == TIFF_STRIP_DECODED, "Slot is still being decoded") ;
+  HQASSERT(raw_bytes <= decoder->raw_size, "Raw strip too big for slot") ;
+
+  slot->strip = strip ;
+  slot->raw_bytes = slot->decoded_bytes = slot->consumed = 0 ;
+
+  if ( !(*decoder->read_fn)(decoder->read_data, strip, slot->raw, raw_bytes,
+                            &slot->raw_bytes) )
+    return FALSE ;
+
+  HQASSERT(slot->raw_bytes <= raw_bytes, "Read more of strip than asked for") ;
+
+  /* A task left over from this slot's last strip may pick this one up. */
+  multi_mutex_lock(&tiff_strip_mutex) ;
+  slot->state = TIFF_STRIP_READ ;
+  multi_mutex_unlock(&tiff_strip_mutex) ;
+
+  if ( decoder->group != NULL && !task_group_is_cancelled(decoder->group) ) {
+    if ( !task_create(&task, NULL /*specialiser*/, NULL /*spec args*/,
+                      &tiff_strip_decode_task, slot, NULL /*cleanup*/,
+                      decoder->group, SW_TRACE_IMAGE_DECODE) )
+      return tiff_strip_task_recoverable(context) ;
+
+    task_ready(task) ;
+    task_release(&task) ;
+  }
+
+  return TRUE ;
+}
+
+/** Wait for the strip in a slot to be decoded, decoding it on this thread
+    if no task has started on it. */
+static Bool tiff_strip_wait(tiff_strip_decoder_t *decoder,
+                            tiff_strip_slot_t *slot)
+{
+  int state ;
+
+  multi_mutex_lock(&tiff_strip_mutex) ;
+  while ( slot->state == TIFF_STRIP_DECODING )
+    multi_condvar_wait(&tiff_strip_condvar) ;
+  state = slot->state ;
+  if ( state == TIFF_STRIP_READ )
+    slot->state = TIFF_STRIP_DECODING ;
+  multi_mutex_unlock(&tiff_strip_mutex) ;
+
+  switch ( state ) {
+  case TIFF_STRIP_READ:
+    if ( !tiff_strip_decode(slot) )
+      return FALSE ;
+    multi_mutex_lock(&tiff_strip_mutex) ;
+    slot->state = TIFF_STRIP_DECODED ;
+    multi_mutex_unlock(&tiff_strip_mutex) ;
+    return TRUE ;
+  case TIFF_STRIP_DECODED:
+    return TRUE ;
+  default:
+    HQASSERT(state == TIFF_STRIP_FAILED, "Strip slot in unexpected state") ;
+    /* Joining the group brings the task's error back to this thread. */
+    HQASSERT(decoder->group != NULL, "Strip task failed without a group") ;
+    task_group_close(decoder->group) ;
+    if ( task_group_join(decoder->group, get_core_context_interp()->error) )
+      (void)error_handler(IOERROR) ;
+    task_group_release(&decoder->group) ;
+    return FALSE ;
+  }
+}
+
+tiff_strip_decoder_t *tiff_strip_decoder_create(tiff_image_data_t *data,
+                                                uint32 channel,
+                                                Bool bigendian,
+                                                tiff_strip_read_fn *read_fn,
+                                                void *read_data)
+{
+  DL_STATE *page = get_core_context_interp()->page ;
+  tiff_strip_decoder_t *decoder ;
+  uint32 i, nslots, raw_size, decoded_size, colors ;
+  const uint32 *strip_bytes ;
+
+  HQASSERT(data != NULL, "No TIFF image data") ;
+  HQASSERT(read_fn != NULL, "No raw strip reader") ;
+
+  switch ( data->compression ) {
+  case COMPRESS_LZW:
+  case COMPRESS_FLATE:
+  case COMPRESS_FLATE_TIFFLIB:
+  case COMPRESS_Packbits:
+    break ;
+  default:
+    return NULL ;
+  }
+
+  colors = (data->planar_config == PLANAR_CONFIG_CHUNKY)
+    ? data->samples_per_pixel : 1 ;
+
+  if ( data->predictor != 1 &&
+       (data->predictor != 2 || colors == 0 ||
+        (data->bits_per_sample != 8 && data->bits_per_sample != 16)) )
+    return NULL ;
+
+  if ( data->number_strips < 2 || data->bytes_per_row == 0 ||
+       data->rows_per_strip > TIFF_STRIP_MAX_BYTES / data->bytes_per_row ||
+       (channel + 1) * data->number_strips > data->strip_bytecount ||
+       (channel + 1) * data->number_strips > data->strip_count )
+    return NULL ;
+
+  decoded_size = data->bytes_per_row * data->rows_per_strip ;
+  strip_bytes = &data->strip_bytes[channel * data->number_strips] ;
+  raw_size = 1 ;
+  for ( i = 0 ; i < data->number_strips ; ++i ) {
+    if ( strip_bytes[i] > raw_size )
+      raw_size = strip_bytes[i] ;
+  }
+  if ( raw_size > TIFF_STRIP_MAX_BYTES )
+    return NULL ;
+
+  nslots = (uint32)max_simultaneous_tasks() ;
+  if ( nslots > TIFF_STRIP_MAX_SLOTS )
+    nslots = TIFF_STRIP_MAX_SLOTS ;
+  if ( nslots > data->number_strips )
+    nslots = data->number_strips ;
+  while ( nslots > 1 &&
+          nslots * (raw_size + decoded_size) > TIFF_STRIP_MAX_MEMORY )
+    --nslots ;
+
+  /* There is nothing to overlap with only one slot. */
+  if ( nslots < 2 || page == NULL || page->job == NULL ||
+       page->job->task_group == NULL )
+    return NULL ;
+
+  decoder = mm_alloc(mm_pool_temp, sizeof(tiff_strip_decoder_t),
+                     MM_ALLOC_CLASS_TIFF_DECODE) ;
+  if ( decoder == NULL )
+    return NULL ;
+
+  HqMemZero(decoder, sizeof(tiff_strip_decoder_t)) ;
+  NAME_OBJECT(decoder, TIFF_STRIP_DECODER_NAME) ;
+
+  decoder->compression = data->compression ;
+  decoder->differencing = (data->predictor == 2) ;
+  decoder->bits_per_sample = data->bits_per_sample ;
+  decoder->colors = colors ;
+  decoder->bigendian = bigendian ;
+  decoder->bytes_per_row = data->bytes_per_row ;
+  decoder->rows_per_strip = data->rows_per_strip ;
+  decoder->image_length = data->image_length ;
+  decoder->number_strips = data->number_strips ;
+  decoder->strip_bytes = strip_bytes ;
+  decoder->read_fn = read_fn ;
+  decoder->read_data = read_data ;
+  decoder->raw_size = raw_size ;
+  decoder->decoded_size = decoded_size ;
+  decoder->parent = task_group_acquire(page->job->task_group) ;
+  decoder->nslots = nslots ;
+
+  for ( i = 0 ; i < nslots ; ++i ) {
+    tiff_strip_slot_t *slot = &decoder->slots[i] ;
+
+    slot->decoder = decoder ;
+    if ( (slot->raw = mm_alloc(mm_pool_temp, raw_size,
+                               MM_ALLOC_CLASS_TIFF_DECODE)) == NULL ||
+         (slot->decoded = mm_alloc(mm_pool_temp, decoded_size,
+                                   MM_ALLOC_CLASS_TIFF_DECODE)) == NULL ||
+         (data->compression == COMPRESS_LZW &&
+          (slot->lzw = mm_alloc(mm_pool_temp, sizeof(tiff_lzw_table_t),
+                                MM_ALLOC_CLASS_TIFF_DECODE)) == NULL) ) {
+      tiff_strip_decoder_destroy(&decoder) ;
+      return NULL ;
+    }
+  }
+
+  return decoder ;
+}
+
+Bool tiff_strip_decoder_read(tiff_strip_decoder_t *decoder,
+                             uint8 *buffer, uint32 bytes,
+                             uint32 *bytes_read)
+{
+  HQASSERT(buffer != NULL, "Nowhere to put decoded strip data") ;
+  HQASSERT(bytes_read != NULL, "Nowhere to put decoded length") ;
+  VERIFY_OBJECT(decoder, TIFF_STRIP_DECODER_NAME) ;
+
+  *bytes_read = 0 ;
+
+  if ( decoder->failed )
+    return error_handler(IOERROR) ;
+
+  /* Defer reading until data is wanted, the filter may only be opened to
+     find out about the image. */
+  if ( !decoder->started ) {
+    corecontext_t *context = get_core_context_interp() ;
+    uint32 i ;
+
+    decoder->started = TRUE ;
+    if ( task_group_create(&decoder->group, TASK_GROUP_IMAGE,
+                           decoder->parent, NULL) ) {
+      task_group_ready(decoder->group) ;
+    } else if ( !tiff_strip_task_recoverable(context) ) {
+      decoder->failed = TRUE ;
+      return FALSE ;
+    }
+
+    for ( i = 0 ; i < decoder->nslots ; ++i ) {
+      if ( !tiff_strip_start(decoder, &decoder->slots[i], i) ) {
+        decoder->failed = TRUE ;
+        return FALSE ;
+      }
+    }
+  }
+
+  while ( bytes > 0 && decoder->next_strip < decoder->number_strips ) {
+    tiff_strip_slot_t *slot =
+      &decoder->slots[decoder->next_strip % decoder->nslots] ;
+    uint32 count ;
+
+    HQASSERT(slot->strip == decoder->next_strip, "Strip slots out of step") ;
+
+    if ( !tiff_strip_wait(decoder, slot) ) {
+      decoder->failed = TRUE ;
+      return FALSE ;
+    }
+
+    count = slot->decoded_bytes - slot->consumed ;
+    if ( count > bytes )
+      count = bytes ;
+
+    HqMemCpy(buffer, slot->decoded + slot->consumed, count) ;
+    buffer += count ;
+    bytes -= count ;
+    *bytes_read += count ;
+    slot->consumed += count ;
+
+    if ( slot->consumed == slot->decoded_bytes ) {
+      /* Strip finished, re-use the slot for the next strip in line. */
+      uint32 strip = decoder->next_strip + decoder->nslots ;
+
+      ++decoder->next_strip ;
+      if ( strip < decoder->number_strips &&
+           !tiff_strip_start(decoder, slot, strip) ) {
+        decoder->failed = TRUE ;
+        return FALSE ;
+      }
+    }
+  }
+
+  return TRUE ;
+}
+
+void tiff_strip_decoder_destroy(tiff_strip_decoder_t **decoderp)
+{
+  tiff_strip_decoder_t *decoder ;
+  uint32 i ;
+
+  HQASSERT(decoderp != NULL, "Nowhere to find strip decoder") ;
+
+  if ( (decoder = *decoderp) == NULL )
+    return ;
+
+  VERIFY_OBJECT(decoder, TIFF_STRIP_DECODER_NAME) ;
+
+  /* Any tasks still outstanding are for strips nobody wants. */
+  if ( decoder->group != NULL ) {
+    if ( decoder->next_strip < decoder->number_strips )
+      task_group_cancel(decoder->group, INTERRUPT) ;
+    task_group_close(decoder->group) ;
+    (void)task_group_join(decoder->group, NULL) ;
+    task_group_release(&decoder->group) ;
+  }
+
+  for ( i = 0 ; i < decoder->nslots ; ++i ) {
+    tiff_strip_slot_t *slot = &decoder->slots[i] ;
+
+    if ( slot->raw != NULL )
+      mm_free(mm_pool_temp, slot->raw, decoder->raw_size) ;
+    if ( slot->decoded != NULL )
+      mm_free(mm_pool_temp, slot->decoded, decoder->decoded_size) ;
+    if ( slot->lzw != NULL )
+      mm_free(mm_pool_temp, slot->lzw, sizeof(tiff_lzw_table_t)) ;
+  }
+
+  if ( decoder->parent != NULL )
+    task_group_release(&decoder->parent) ;
+
+  UNNAME_OBJECT(decoder) ;
+  mm_free(mm_pool_temp, decoder, sizeof(tiff_strip_decoder_t)) ;
+  *decoderp = NULL ;
+}
+
+void tiff_strip_swstart(void)
+{
+  multi_mutex_init(&tiff_strip_mutex, TIFF_STRIP_LOCK_INDEX, FALSE,
+                   SW_TRACE_TIFF_STRIP_ACQUIRE, SW_TRACE_TIFF_STRIP_HOLD) ;
+  multi_condvar_init(&tiff_strip_condvar, &tiff_strip_mutex,
+                     SW_TRACE_TIFF_STRIP_WAIT) ;
+}
+
+void tiff_strip_finish(void)
+{
+  multi_condvar_finish(&tiff_strip_condvar) ;
+  multi_mutex_finish(&tiff_strip_mutex) ;
+}
+
+/* Log stripped */
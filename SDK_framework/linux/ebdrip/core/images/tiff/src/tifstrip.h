@@ -0,0 +1,104 @@
+/** \file
+ * \ingroup tiff
+ *
+ * $HopeName: SWv20tiff!src:tifstrip.h(EBDSDK_P.1) $
+ *
+ * Copyright (C) 2014 Global Graphics Software Ltd. All rights reserved.
+ * Global Graphics Software Ltd. Confidential Information.
+ *
+ * \brief
+ * Decoding TIFF strips ahead of the reader in worker tasks.
+ */
+
+
+#ifndef __TIFSTRIP_H__
+#define __TIFSTRIP_H__
+
+#include "tifreadr.h"   /* tiff_image_data_t */
+
+/** Opaque type for a channel's strip decoder. */
+typedef struct tiff_strip_decoder_t tiff_strip_decoder_t ;
+
+/** \brief Callback to read the raw, compressed data of one strip.
+
+    \param data        The opaque data given to \c tiff_strip_decoder_create().
+    \param strip       The strip number within the decoder's channel.
+    \param buffer      Where to put the raw strip data. Any bit-order
+                       reversal required by the FillOrder must already have
+                       been applied.
+    \param bytes       The size of the strip from StripByteCounts.
+    \param bytes_read  The number of bytes actually read, which may be less
+                       than \a bytes if the file is truncated.
+
+    \retval TRUE  The strip data was read.
+    \retval FALSE An error occurred reading the strip data, and an error has
+                  been raised.
+
+    The callback is only ever called on the interpreter thread. */
+typedef Bool (tiff_strip_read_fn)(void *data, uint32 strip,
+                                  /*@notnull@*/ /*@out@*/ uint8 *buffer,
+                                  uint32 bytes,
+                                  /*@notnull@*/ /*@out@*/ uint32 *bytes_read) ;
+
+/** \brief Create a decoder for the strips of one channel of a TIFF image.
+
+    \param data       The expanded image details.
+    \param channel    The channel to decode; always zero for chunky data.
+    \param bigendian  Byte order of 16-bit samples for LZW differencing.
+    \param read_fn    Callback to read raw strip data.
+    \param read_data  Opaque data for \a read_fn.
+
+    \returns A new strip decoder, or NULL if the image is not suitable for
+    decoding ahead, or there are not enough resources to do so. In that case
+    the caller should decode the strips itself. No error is raised.
+
+    The decoder reads the raw data for a window of strips, and decodes them
+    in worker tasks while the interpreter consumes earlier strips. */
+/*@null@*/
+tiff_strip_decoder_t *tiff_strip_decoder_create(
+  /*@notnull@*/ /*@in@*/ tiff_image_data_t *data,
+  uint32 channel,
+  Bool bigendian,
+  /*@notnull@*/ tiff_strip_read_fn *read_fn,
+  /*@null@*/ void *read_data) ;
+
+/** \brief Read decoded data for the channel.
+
+    \param decoder     The strip decoder.
+    \param buffer      Where to put the decoded data.
+    \param bytes       The number of bytes wanted.
+    \param bytes_read  The number of bytes returned. This is only less than
+                       \a bytes once the last strip has been read.
+
+    \retval TRUE  Data was read successfully.
+    \retval FALSE A strip could not be read or decoded, and an error has been
+                  raised.
+
+    The strips are returned in order, each one exactly \c bytes_per_row times
+    the number of rows in the strip long. A strip which decodes short is
+    padded with zeros, so later strips stay row aligned. */
+Bool tiff_strip_decoder_read(/*@notnull@*/ /*@in@*/ tiff_strip_decoder_t *decoder,
+                             /*@notnull@*/ /*@out@*/ uint8 *buffer,
+                             uint32 bytes,
+                             /*@notnull@*/ /*@out@*/ uint32 *bytes_read) ;
+
+/** \brief Destroy a strip decoder, waiting for any outstanding decode tasks
+    and discarding their results.
+
+    \param decoder  Where the strip decoder is stored. This is set to NULL on
+                    exit.
+*/
+void tiff_strip_decoder_destroy(/*@notnull@*/ /*@in@*/ /*@out@*/
+                                tiff_strip_decoder_t **decoder) ;
+
+/** \brief Create the lock shared by all strip decoders. Called when the
+    TIFF module starts. */
+void tiff_strip_swstart(void) ;
+
+/** \brief Destroy the lock shared by all strip decoders. */
+void tiff_strip_finish(void) ;
+
+#endif /* !__TIFSTRIP_H__ */
+
+
+/* Log stripped */
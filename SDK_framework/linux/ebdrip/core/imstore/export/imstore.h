@@ -69,6 +69,7 @@ enum /* Bits for flags field of store open */ {
   IMS_DOWNSAMPLED = 0x80,  /**< Has the image been down-sampled */
   IMS_ROWREPEATS_NEAR = 0x100,  /**< Do row repeats on near row matches */
   IMS_ROWREPEATS_2ROWS = 0x200, /**< Max 2 rows for this image */
+  IMS_SHAREABLE = 0x400,   /**< Store may be shared by identical images */
 };
 
 /**
@@ -100,6 +101,23 @@ IM_STORE *im_storeopen(IM_SHARED *im_shared, const ibbox_t *imsbbox,
  */
 Bool im_storeclose(IM_STORE *ims);
 
+/**
+ * Share a closed image store with an identical store on the same page.
+ * \param[in,out] pims    The image store object; replaced by the shared
+ *                        store if a match was found.
+ * \param[in]     imsbbox The image-space bbox of the data the image needs.
+ * \return        Success status
+ *
+ * Stores opened with \c IMS_SHAREABLE hash their data as it is written. When
+ * a store with the same hash, geometry and data is already on the page, the
+ * new store is freed and the existing one is referenced instead, so repeated
+ * images (logos, form backgrounds, n-up copies) hold one copy of their data.
+ * Each image keeps its own expander, so only the stored data need match. A
+ * shared store is not trimmed or recycled, and \c im_storefree only releases
+ * it when the last image referencing it is freed.
+ */
+Bool im_storeshare(IM_STORE **pims, const ibbox_t *imsbbox);
+
 /**
  * Return the image storage nplanes for the give store object
  * \param[in] ims The image store object
@@ -33,6 +33,8 @@
 #include "swerrors.h"           /* VMERROR */
 #include "lowmem.h"             /* low_mem_offer_t */
 #include "dl_image.h"           /* image_dbbox_covering_ibox */
+#include "hqmemcmp.h"           /* HqMemCmp */
+#include "hqmemcpy.h"           /* HqMemCpy */
 
 #include "imb32.h"              /* imb32_init */
 #include "imblist.h"            /* blist_init */
@@ -76,6 +78,19 @@ static inline Bool ims_typeof(IM_STORE *ims, uint32 typ)
   return ((ims->flags & typ) != 0);
 }
 
+static void im_storeunshare(IM_STORE *ims);
+
+/** Initial value of the data hash of a shareable store (FNV-1a basis). */
+#define IM_SHARE_HASH_INIT (2166136261u)
+
+/** Accumulate data written to a shareable store into its FNV-1a hash. */
+static inline uint32 im_sharehash(uint32 hash, const uint8 *buf, int32 nbytes)
+{
+  while ( --nbytes >= 0 )
+    hash = (hash ^ *buf++) * 16777619u;
+  return hash;
+}
+
 /**
  * Start the image store module for this page.
  */
@@ -183,6 +198,8 @@ struct im_store_metrics {
   size_t imbvar_pool_max_size;
   int32 imbvar_pool_max_objects;
   size_t imbvar_pool_max_frag;
+  int32 shared_stores;
+  size_t shared_store_bytes;
 } im_store_metrics;
 
 static Bool im_store_metrics_update(sw_metrics_group *metrics)
@@ -207,6 +224,15 @@ static Bool im_store_metrics_update(sw_metrics_group *metrics)
                     (int32)im_store_metrics.imbvar_pool_max_frag);
   sw_metrics_close_group(&metrics);
   sw_metrics_close_group(&metrics);
+  if ( !sw_metrics_open_group(&metrics, METRIC_NAME_AND_LENGTH("Images")) )
+    return FALSE;
+  SW_METRIC_INTEGER("shared_stores", im_store_metrics.shared_stores);
+  /* Bytes saved over a long run can exceed an integer metric. */
+  SW_METRIC_INTEGER("shared_store_bytes",
+                    im_store_metrics.shared_store_bytes > MAXINT32
+                    ? MAXINT32
+                    : (int32)im_store_metrics.shared_store_bytes);
+  sw_metrics_close_group(&metrics);
   return TRUE;
 }
 
@@ -706,6 +732,9 @@ IM_STORE *im_storeopen(IM_SHARED *im_shared, const ibbox_t *imsbbox,
   ims->extblocks = 0;
   ims->reserves = NULL;
   ims->row_repeats = NULL;
+  ims->refs = 1;
+  ims->hash = IM_SHARE_HASH_INIT;
+  ims->share_next = NULL;
 
   ims->blockWidth = IM_BLOCK_DEFAULT_WIDTH;
   ims->blockHeight = IM_BLOCK_DEFAULT_HEIGHT;
@@ -825,6 +854,11 @@ Bool im_storewrite(IM_STORE *ims, int32 col, int32 row, int32 planei,
   x = ( x << (ims->bpps) ) >> 3;
   offset = wbytes = ((wbytes << ims->bpps) + 7 ) >> 3;
 
+  if ( ims_typeof(ims, IMS_SHAREABLE) )
+    ims->hash = im_sharehash(ims->hash, buf,
+                             planei == IMS_ALLPLANES ? ims->nplanes * wbytes
+                                                     : wbytes);
+
   bx = im_index_bx(ims, x);
   by = im_index_by(ims, y);
   bb = im_bb_get_and_check(ims, bx, by, planei);
@@ -951,6 +985,10 @@ Bool im_storereorder(IM_STORE *ims, const COLORANTINDEX current[],
   HQASSERT(ims->planes, "ims->planes is null");
   HQASSERT(order, "order array is missing");
   HQASSERT(nplanes > 0 && nplanes <= ims->nplanes, "nplanes is invalid");
+  HQASSERT(ims->refs == 1, "Reordering shared image store");
+
+  /* The data no longer matches what was hashed. */
+  im_storeunshare(ims);
 
   /* Create a new planes array to hold the re-ordered list. */
   planes = dl_alloc(ims->im_shared->page->dlpools, nplanes * sizeof(IM_PLANE*),
@@ -1264,6 +1302,177 @@ Bool im_storeclose(IM_STORE *ims)
   return TRUE;
 }
 
+/**
+ * Remove a store from the share table of its page, if it is in there.
+ */
+static void im_storeunshare(IM_STORE *ims)
+{
+  IM_STORE **link;
+
+  if ( !ims_typeof(ims, IMS_SHAREABLE) )
+    return;
+
+  for ( link = &ims->im_shared->share_table[ims->hash & (IM_SHARE_TABLE_SIZE - 1)] ;
+        *link != NULL ; link = &(*link)->share_next ) {
+    if ( *link == ims ) {
+      *link = ims->share_next;
+      ims->share_next = NULL;
+      return;
+    }
+  }
+}
+
+/**
+ * Can two stores be shared by an image needing the given area? The area has
+ * to be present in the existing store, and the data has to be laid out in
+ * the same way. Stores holding preconversion reserves are not shared, as the
+ * reserves are released per image.
+ */
+static Bool im_storecompatible(IM_STORE *ims, IM_STORE *match,
+                               const ibbox_t *imsbbox)
+{
+  int32 i;
+
+  if ( match->hash != ims->hash ||
+       match->openForWriting ||
+       match->reserves != NULL || ims->reserves != NULL ||
+       match->bpp != ims->bpp ||
+       match->nplanes != ims->nplanes ||
+       match->flags != ims->flags ||
+       match->blockWidth != ims->blockWidth ||
+       match->blockHeight != ims->blockHeight ||
+       !bbox_equal(&match->obbox, &ims->obbox) ||
+       !bbox_contains(&match->tbbox, imsbbox) )
+    return FALSE;
+
+  for ( i = 0; i < ims->nplanes; ++i )
+    if ( (match->planes[i] == NULL) != (ims->planes[i] == NULL) )
+      return FALSE;
+
+  return TRUE;
+}
+
+/**
+ * Compare the data of two compatible stores over the given area. Row repeat
+ * flags are compared too, because rendering skips rows on the strength of
+ * them.
+ */
+static Bool im_storesamedata(IM_STORE *ims, IM_STORE *match,
+                             const ibbox_t *imsbbox, Bool *same)
+{
+  corecontext_t *context = get_core_context_interp();
+  uint8 *copy;
+  int32 plane, y, xb, xb1, xb2;
+  Bool result = TRUE;
+
+  *same = FALSE;
+
+  for ( y = imsbbox->y1; y <= imsbbox->y2; ++y )
+    if ( im_is_row_repeat(ims, y) != im_is_row_repeat(match, y) )
+      return TRUE;
+
+  copy = mm_alloc(mm_pool_temp, ims->blockWidth, MM_ALLOC_CLASS_IMAGE_DATA);
+  if ( copy == NULL )
+    return error_handler(VMERROR);
+
+  /* Work in store-relative bytes, so the reads step block by block. */
+  xb1 = ((imsbbox->x1 - ims->obbox.x1) << ims->bpps) >> 3;
+  xb2 = ((imsbbox->x2 - ims->obbox.x1) << ims->bpps) >> 3;
+
+  for ( plane = 0; plane < ims->nplanes && result; ++plane ) {
+    if ( ims->planes[plane] == NULL )
+      continue;
+
+    for ( y = imsbbox->y1; y <= imsbbox->y2 && result; ++y ) {
+      int32 nbytes;
+
+      for ( xb = xb1; xb <= xb2; xb += nbytes ) {
+        int32 x = max(imsbbox->x1, ims->obbox.x1 + ((xb << 3) >> ims->bpps));
+        uint8 *buf;
+        int32 mbytes;
+
+        if ( !im_storeread(ims, x, y, plane, &buf, &nbytes) ) {
+          result = FALSE;
+          break;
+        }
+        if ( nbytes > xb2 - xb + 1 )
+          nbytes = xb2 - xb + 1;
+        HqMemCpy(copy, buf, nbytes);
+        im_storereadrelease(context);
+
+        if ( !im_storeread(match, x, y, plane, &buf, &mbytes) ) {
+          result = FALSE;
+          break;
+        }
+        HQASSERT(mbytes >= nbytes, "Compatible stores have different blocks");
+        mbytes = HqMemCmp(copy, nbytes, buf, nbytes);
+        im_storereadrelease(context);
+
+        if ( mbytes != 0 ) {
+          mm_free(mm_pool_temp, copy, ims->blockWidth);
+          return TRUE;
+        }
+      }
+      SwOftenUnsafe();
+    }
+  }
+
+  mm_free(mm_pool_temp, copy, ims->blockWidth);
+
+  *same = result;
+  return result;
+}
+
+Bool im_storeshare(IM_STORE **pims, const ibbox_t *imsbbox)
+{
+  IM_STORE *ims, *match, **bucket;
+
+  HQASSERT(pims != NULL, "Nowhere to find image store");
+  ims = *pims;
+  HQASSERT(ims != NULL, "No image store to share");
+  HQASSERT(imsbbox != NULL, "No image bbox for shared store");
+  HQASSERT(!ims->openForWriting, "Sharing image store still being written");
+
+  if ( !ims_typeof(ims, IMS_SHAREABLE) )
+    return TRUE;
+
+#if defined(DEBUG_BUILD)
+  if ( (debug_imstore & IMSDBG_NO_SHARE) != 0 )
+    return TRUE;
+#endif
+
+  HQASSERT(ims->refs == 1 && ims->share_next == NULL,
+           "Image store has already been shared");
+
+  bucket = &ims->im_shared->share_table[ims->hash & (IM_SHARE_TABLE_SIZE - 1)];
+  for ( match = *bucket; match != NULL; match = match->share_next ) {
+    if ( im_storecompatible(ims, match, imsbbox) ) {
+      Bool same;
+
+      if ( !im_storesamedata(ims, match, imsbbox, &same) )
+        return FALSE;
+
+      if ( same ) {
+#ifdef METRICS_BUILD
+        im_store_metrics.shared_stores += 1;
+        im_store_metrics.shared_store_bytes +=
+          (size_t)ims->stdblocks * IM_BLOCK_DEFAULT_SIZE + ims->extblocks;
+#endif
+        ++match->refs;
+        im_storefree(ims);
+        *pims = match;
+        reportStore(match, "share", -1, -1);
+        return TRUE;
+      }
+    }
+  }
+
+  ims->share_next = *bucket;
+  *bucket = ims;
+
+  return TRUE;
+}
+
 /**
  * im_planefree is normally called from im_storefree, but may also be
  * called when recombining and when detected that the plane is blank
@@ -1274,6 +1483,7 @@ void im_planefree(IM_STORE *ims, int32 iplane)
 
   HQASSERT(ims != NULL, "im_planeFree: ims null");
   HQASSERT(iplane >= 0, "im_planeFree: iplane < 0");
+  HQASSERT(ims->refs <= 1, "Freeing plane of shared image store");
 
   if ( (plane = ims->planes[iplane]) != NULL ) {
     /* Free the image plane blocks. */
@@ -1296,6 +1506,13 @@ void im_storefree(IM_STORE *ims)
   int32 i;
 
   HQASSERT(ims, "ims NULL in im_storefree");
+  HQASSERT(ims->refs > 0, "Image store already freed");
+
+  /* Other images are still using this shared store. */
+  if ( --ims->refs > 0 )
+    return;
+
+  im_storeunshare(ims);
 
   reportStore(ims, "free", -1, -1);
 
@@ -1537,12 +1754,16 @@ void im_addextent(LISTOBJECT *lobj, int32 sizefactdisplaylist,
   if (band2 >= sizefactdisplaylist)
     band2 = sizefactdisplaylist - 1;
 
+  /* A shared store is finished with after the last band of any of the
+     images using it. */
   blist_add_extent(image->ims, band1, band2);
-  image->ims->band = band2;
+  if ( image->ims->refs == 1 || band2 > image->ims->band )
+    image->ims->band = band2;
 
   if ( image->mask != NULL ) {
     blist_add_extent(image->mask->ims, band1, band2);
-    image->mask->ims->band = band2;
+    if ( image->mask->ims->refs == 1 || band2 > image->mask->ims->band )
+      image->mask->ims->band = band2;
   }
 }
 
@@ -1867,6 +2088,11 @@ Bool im_storemerge(IM_STORE *ims_src, IM_STORE *ims_dst)
   IM_PLANE **planes;
 
   HQASSERT(good_ims(ims_dst, ims_src), "Problem appending to image store");
+  HQASSERT(ims_src->refs == 1 && ims_dst->refs == 1,
+           "Merging shared image store");
+
+  im_storeunshare(ims_src);
+  im_storeunshare(ims_dst);
 
   nplanes = ims_src->nplanes;
   planes  = ims_src->planes;
@@ -2122,6 +2348,10 @@ void im_storetrim(IM_STORE *ims, const ibbox_t *ibbox)
   HQASSERT(bbox_contains(&ims->tbbox, ibbox),
            "Trim bounding box not inside current trim box") ;
 
+  /* The other images sharing the store may need the data outside the box. */
+  if ( ims->refs > 1 )
+    return ;
+
   /* Convert image-space coordinates to store-relative coordinates. */
   x1 = ibbox->x1 - ims->obbox.x1 ;
   x2 = ibbox->x2 - ims->obbox.x1 ;
@@ -2226,6 +2456,10 @@ Bool im_storerecycle(IM_STORE *ims, int32 nplanes, Bool *recycled)
 
   *recycled = FALSE;
 
+  /* Can't overwrite data other images are sharing. */
+  if ( ims->refs > 1 )
+    return TRUE;
+
   old_nplanes = ims->nplanes;
   planes = ims->planes;
 
@@ -2274,6 +2508,9 @@ Bool im_storerecycle(IM_STORE *ims, int32 nplanes, Bool *recycled)
     im_updatePlanes(ims, planes, CAST_SIGNED_TO_INT16(nplanes));
   }
 
+  /* The adjusted data will no longer match what was hashed. */
+  im_storeunshare(ims);
+
   /* Re-open the image store ready for writing (for image adjustment). */
   do_relinkims(ims, IM_ACTION_OPEN_FOR_WRITING, FALSE);
   ims->openForWriting = TRUE;
@@ -41,6 +41,9 @@
 #define IM_BLOCK_MIN      (512)
 #define IM_BLOCK_VAR_MIN    (8) /* for variable sized blocks */
 
+/* Number of hash buckets for shareable stores on a page; a power of two. */
+#define IM_SHARE_TABLE_SIZE (64)
+
 #define IM_ROWS_PER_LUT   (2)
 #define IM_MAX_LUT_SIZE   (IM_ROWS_PER_LUT * IM_BLOCK_DEFAULT_WIDTH)
 
@@ -187,6 +190,9 @@ struct IM_STORE {
                                          a repeat of the previous row. Flag
                                          also set if row isn't identical but
                                          close enough. */
+  int32 refs;              /**< Number of image objects using the store. */
+  uint32 hash;             /**< Hash of the data written (IMS_SHAREABLE). */
+  IM_STORE *share_next;    /**< Next store in the same share table bucket. */
 };
 
 #define NUM_RENDERING_BLISTS(ims) ((int32)(NUM_THREADS() * ims->xblock))
@@ -240,6 +246,9 @@ struct IM_SHARED {
   IM_FILE_CTXT *imfile_ctxt;    /**< Context for paged out image store data. */
 
   IM_STORE_LINK *if_list;      /**< Linked-list of image filter stores */
+
+  IM_STORE *share_table[IM_SHARE_TABLE_SIZE]; /**< Closed shareable stores,
+                                                   hashed by their data. */
 };
 
 Bool im_planenew(IM_STORE *ims, int32 planei);
@@ -268,7 +277,8 @@ enum {
   IMSDBG_BLOCKMEM = 2,
   IMSDBG_REPORT_INCOMPLETE = 4,
   IMSDBG_WARN = 8,
-  IMSDBG_LOWMEM = 16
+  IMSDBG_LOWMEM = 16,
+  IMSDBG_NO_SHARE = 32
 } ;
 #endif
 
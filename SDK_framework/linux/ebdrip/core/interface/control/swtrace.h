@@ -70,6 +70,8 @@ typedef void (RIPFASTCALL SwTraceHandlerFn)(int trace_id,
   macro_(INTERPRET_PCLXL_FONT) /* Time in PCL XL font downloading. */ \
   macro_(INTERPRET_IMAGE)  /* Time spent in image interpretation */ \
   macro_(INTERPRET_JPEG)   /* Time spent in JPEG interpretation */ \
+  macro_(IMAGE_DECODE)     /* Image strip decoding task. */ \
+  macro_(NFILL_BUILD)      /* Large path NFILL conversion task. */ \
   macro_(INTERPRET_TOMSTABLE) /* Interpretation time in Toms Table code */  \
   macro_(FONT_CACHE)       /* Time building font caches. */ \
   macro_(FONT_PFIN)        /* Time spent in PFIN modules. */ \
@@ -196,6 +198,9 @@ typedef void (RIPFASTCALL SwTraceHandlerFn)(int trace_id,
   macro_(IRR_ACQUIRE)         /* Internal Retained Raster mutex acquire. */ \
   macro_(GST_HOLD)            /* GST mutex hold. */ \
   macro_(GST_ACQUIRE)         /* GST mutex acquire. */ \
+  macro_(TIFF_STRIP_HOLD)     /* TIFF strip decoder mutex hold. */ \
+  macro_(TIFF_STRIP_ACQUIRE)  /* TIFF strip decoder mutex acquire. */ \
+  macro_(TIFF_STRIP_WAIT)     /* Condvar wait for TIFF strip decode. */ \
   macro_(RR_PAGE_DEFINE)            /* Retained Raster define event */ \
   macro_(RR_PAGE_READY)             /* Retained Raster ready event */ \
   macro_(RR_PAGE_COMPLETE)          /* Retained Raster complete event */ \
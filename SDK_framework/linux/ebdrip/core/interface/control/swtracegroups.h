@@ -125,7 +125,7 @@ const static sw_tracegroup_t trace_groups[] = {
       SW_TRACE_DL_COMPLETE, SW_TRACE_DL_ERASE, SW_TRACE_RENDER,
       SW_TRACE_COMPOSITE_BAND, SW_TRACE_RENDER_BAND, SW_TRACE_MHT_GATE,
       SW_TRACE_COMPRESS_BAND, SW_TRACE_OUTPUT_BAND, SW_TRACE_READBACK_BAND,
-      SW_TRACE_JOB_COMPLETE,
+      SW_TRACE_JOB_COMPLETE, SW_TRACE_IMAGE_DECODE, SW_TRACE_NFILL_BUILD,
       SW_TRACE_TASK_HELPING, SW_TRACE_TASK_HELPER_WAIT,
       SW_TRACE_RENDER_FRAME_START, SW_TRACE_RENDER_FRAME_DONE,
       SW_TRACE_SHEET_START, SW_TRACE_SHEET_DONE,
@@ -216,7 +216,7 @@ const static sw_tracegroup_t trace_groups[] = {
       SW_TRACE_INPUT_PAGE_ACQUIRE, SW_TRACE_OUTPUT_PAGE_ACQUIRE,
       SW_TRACE_HT_ACQUIRE, SW_TRACE_NFILL_ACQUIRE,
       SW_TRACE_GOURAUD_ACQUIRE, SW_TRACE_RETAINEDRASTER_ACQUIRE,
-      SW_TRACE_IRR_ACQUIRE, SW_TRACE_GST_ACQUIRE,
+      SW_TRACE_IRR_ACQUIRE, SW_TRACE_GST_ACQUIRE, SW_TRACE_TIFF_STRIP_ACQUIRE,
       SW_TRACE_INVALID
     }
   },
@@ -234,6 +234,7 @@ const static sw_tracegroup_t trace_groups[] = {
       SW_TRACE_NFILL_READ_HOLD, SW_TRACE_NFILL_WRITE_HOLD,
       SW_TRACE_GOURAUD_READ_HOLD, SW_TRACE_GOURAUD_WRITE_HOLD,
       SW_TRACE_RETAINEDRASTER_HOLD, SW_TRACE_IRR_HOLD, SW_TRACE_GST_HOLD,
+      SW_TRACE_TIFF_STRIP_HOLD,
       SW_TRACE_INVALID
     }
   },
@@ -243,7 +244,7 @@ const static sw_tracegroup_t trace_groups[] = {
       SW_TRACE_TASK_HELPER_WAIT, SW_TRACE_TASK_MEMORY_WAIT,
       SW_TRACE_TASK_JOIN_WAIT,
       SW_TRACE_IM_LOAD_WAIT, SW_TRACE_IM_GET_WAIT,
-      SW_TRACE_RETAINEDRASTER_WAIT,
+      SW_TRACE_RETAINEDRASTER_WAIT, SW_TRACE_TIFF_STRIP_WAIT,
       SW_TRACE_INVALID
     }
   },
@@ -178,6 +178,7 @@ MM_ALLOC_CLASS(FORMARRAY)       /* swmemory.c form arrays */
 MM_ALLOC_CLASS(RLEFORM)         /* swmemory.c RLE forms */
 MM_ALLOC_CLASS(STACK_FRAME)     /* stacks.c stack frames */
 MM_ALLOC_CLASS(WALKDICT_TEMP)   /* scratch space for walk_dictionary_sorted */
+MM_ALLOC_CLASS(NAMECACHE_TABLE) /* ncache.c name hash table */
 MM_ALLOC_CLASS(CHALFTONE)       /* halftone cache structure */
 MM_ALLOC_CLASS(LISTCHALFTONE)   /* halftone list cache structure */
 MM_ALLOC_CLASS(HALFTONE_CACHE)  /* halftone cache table */
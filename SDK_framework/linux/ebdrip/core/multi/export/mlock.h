@@ -74,6 +74,7 @@ typedef enum {
   REQ_NODE_LOCK_INDEX,
   IRR_LOCK_INDEX,
   GST_LOCK_INDEX,
+  TIFF_STRIP_LOCK_INDEX,
   LOCK_RANK_LIMIT /* Must be last: length of lock table */
 } lock_rank_t;
 
@@ -47,6 +47,8 @@ typedef struct task_group_t task_group_t ;
   macro_(FRAME) \
   macro_(BAND) \
   macro_(TRAP) \
+  macro_(IMAGE) /* Image data decoding tasks (inside job) */ \
+  macro_(NFILL) /* Large path NFILL conversion tasks (inside job) */ \
   macro_(ORPHANS) /* Finalised tasks with references to them. */
 
 #define TASK_GROUP_ENUM(x) TASK_GROUP_ ## x,
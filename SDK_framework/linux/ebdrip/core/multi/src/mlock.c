@@ -157,7 +157,10 @@ struct LOCK_RANK {
   {BIT(MONITOR_LOCK_INDEX) | BIT(LOWMEM_LOCK_INDEX), NOT_CONCURRENT},
   /* GST_LOCK_INDEX */
   {BIT(MONITOR_LOCK_INDEX) | BIT(LOWMEM_LOCK_INDEX) |
-    BIT(GST_LOCK_INDEX), NOT_CONCURRENT}
+    BIT(GST_LOCK_INDEX), NOT_CONCURRENT},
+  /* TIFF_STRIP_LOCK_INDEX */
+  {BIT(MONITOR_LOCK_INDEX) | BIT(LOWMEM_LOCK_INDEX) |
+    BIT(TIFF_STRIP_LOCK_INDEX), NOT_CONCURRENT}
 };
 
 #define VALID_LOCK_RANK(r)  ((r) >= 0 && (r) < LOCK_RANK_LIMIT)
@@ -246,7 +246,7 @@ struct NAMECACHE {
   uint16 len ;                /**< Length of name. */
 
   /*@null@*/ /*@dependent@*/
-  struct NAMECACHE *next ;    /**< Next name cache entry. */
+  struct NAMECACHE *next ;    /**< Next (older) name made at this save level. */
 
   /*@notnull@*/ /*@owned@*/
   uint8 *clist ;              /**< Name storage. */
@@ -265,6 +265,15 @@ struct NAMECACHE {
   /*@null@*/ /*@dependent@*/
   struct OBJECT *dictcpy ;    /**< Saved copy of dictobj. */
 
+  /*@null@*/ /*@dependent@*/
+  struct NAMECACHE *prev ;    /**< Previous (newer) name made at this save level. */
+
+  /*@null@*/ /*@dependent@*/
+  struct NAMECACHE *cachenext ; /**< Next name with a dictionary cache. */
+
+  /*@null@*/ /*@dependent@*/
+  struct NAMECACHE *cacheprev ; /**< Previous name with a dictionary cache. */
+
 #if defined( NAMECACHE_STATS )
   /* Statistics gathering counters - useful when a piece of PS is running
    * slowly and a profile shows it's spending lots of time in fast_extract_hash.
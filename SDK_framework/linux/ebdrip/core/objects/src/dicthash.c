@@ -273,6 +273,7 @@ Bool insert_hash_with_alloc(register OBJECT *based,
         nptr->dictval = ( & theIObject( emptyentry )) ;
         nptr->dictsid = namepurges ;
         namepurges = nptr ;
+        ncache_dictcache_link(nptr) ;
         if ( corecontext->savelevel <= SAVELEVELINC ) {
           if (theISaveLevel(nptr) < corecontext->savelevel )
             nptr->dictcpy = NULL ;
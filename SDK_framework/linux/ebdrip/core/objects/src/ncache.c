@@ -13,6 +13,7 @@
 #include "core.h"
 #include "hqmemcpy.h"
 #include "hqmemcmp.h"
+#include "hqmemset.h"
 #include "mm.h"
 #include "mmcompat.h"
 #include "mps.h" /* mps_res_t */
@@ -21,17 +22,108 @@
 #include "namedef_.h"
 #include "objimpl.h"
 #include "gcscan.h" /* ncache_finalize */
+#include "metrics.h"
+
+
+/* Storage for the name cache.
+
+   The names are kept in an open-addressed hash table with linear probing.
+   Each slot stores the full hash of its name alongside the name pointer, so
+   probing only looks at a name's length and characters when the full hash
+   matches. Removed names leave a tombstone so later probes still find names
+   beyond them.
+
+   When the table gets too full, a new table is allocated and the old one is
+   migrated into it a few slots at a time on each insertion, so there is
+   never a pause to rehash the whole table. While this is happening, lookups
+   search both tables.
+
+   Names are also kept in a list per save level, linked newest first through
+   the next and prev fields. Restore and the GC root scan use these lists to
+   find the names created at or above a save level. The pre-defined names are
+   statically allocated and never removed, so they are not in these lists.
+
+   A restore to a global save level resets the dictionary cache of every
+   name to the copy taken at the global level. Only names given a cache
+   (dictval) since can need this, so they are linked through the cachenext
+   and cacheprev fields, and restore walks that list rather than the table.
+   A name leaves the list once its reset is done for good: when it has no
+   saved copy, dictobj can never be set again unless dictval is cleared. */
+
+/** Initial table size. This must be a power of two, and comfortably larger
+    than the number of pre-defined names. */
+#define NC_INITIAL_SIZE 8192
+
+/** Number of old table slots migrated into the new table per insertion. */
+#define NC_MIGRATE_STEP 16
+
+/** Tombstone for a name removed from a slot. */
+static NAMECACHE nc_tombstone ;
+#define NC_DELETED (&nc_tombstone)
+
+/** A name hash table. The hashes are stored in the same allocation as the
+    slots, after them. */
+typedef struct nc_table_t {
+  NAMECACHE **slots ;   /**< Name pointers; NULL if empty, or NC_DELETED. */
+  uint32 *hashes ;      /**< Full hash of the name in each slot. */
+  uint32 mask ;         /**< Table size minus one. */
+  uint32 filled ;       /**< Number of slots not empty, including tombstones. */
+  uint32 live ;         /**< Number of names in the table. */
+} nc_table_t ;
 
+NAMECACHE *namepurges = NULL ;
 
-/* Storage for the name cache */
-#define NAMECACHETABLESIZE 4096
+static nc_table_t nc_table ;    /* Table names are inserted into. */
+static nc_table_t nc_old ;      /* Table being migrated, if slots not NULL. */
+static uint32 nc_migrated ;     /* Next slot of nc_old to migrate. */
 
-NAMECACHE *namepurges = NULL ;
+/* Names created at each save level, newest first. */
+static NAMECACHE *nc_levels[MAXSAVELEVELS] ;
+
+/* Names whose dictionary cache may need resetting on restore. */
+static NAMECACHE *nc_dictcached ;
 
-static NAMECACHE **thenamecache = NULL ;
 static mps_root_t ncache_root;
 static mps_root_t ncache_weak_root;
 
+#ifdef METRICS_BUILD
+static struct ncache_metrics {
+  int32 lookups ;     /* Number of table searches, saturating. */
+  int32 probes ;      /* Slots examined after the first in searches,
+                         saturating. */
+  int32 max_probe ;   /* Longest search, in slots beyond the first. */
+  int32 resizes ;     /* Number of table resizes started. */
+  int32 max_names ;   /* Most names in the cache. */
+} ncache_metrics ;
+
+static Bool ncache_metrics_update(sw_metrics_group *metrics)
+{
+  if ( !sw_metrics_open_group(&metrics, METRIC_NAME_AND_LENGTH("NameCache")) )
+    return FALSE ;
+  SW_METRIC_INTEGER("lookups", ncache_metrics.lookups) ;
+  SW_METRIC_INTEGER("probes", ncache_metrics.probes) ;
+  SW_METRIC_INTEGER("max_probe", ncache_metrics.max_probe) ;
+  SW_METRIC_INTEGER("resizes", ncache_metrics.resizes) ;
+  SW_METRIC_INTEGER("max_names", ncache_metrics.max_names) ;
+  SW_METRIC_INTEGER("table_size", (int32)(nc_table.mask + 1)) ;
+  sw_metrics_close_group(&metrics) ;
+  return TRUE ;
+}
+
+static void ncache_metrics_reset(int reason)
+{
+  struct ncache_metrics init = { 0 } ;
+  UNUSED_PARAM(int, reason) ;
+  ncache_metrics = init ;
+}
+
+static sw_metrics_callbacks ncache_metrics_hook = {
+  ncache_metrics_update,
+  ncache_metrics_reset,
+  NULL
+} ;
+#endif /* METRICS_BUILD */
+
 static uint32 nc_hash(const uint8 *nm, uint32 ln) ;
 static void nc_insertname( NAMECACHE *nptr ) ;
 
@@ -44,40 +136,287 @@ void init_C_globals_ncache(void)
   int32 i ;
 
   namepurges = NULL ;
-  thenamecache = NULL ;
+  HqMemZero(&nc_table, sizeof(nc_table)) ;
+  HqMemZero(&nc_old, sizeof(nc_old)) ;
+  nc_migrated = 0 ;
+  for ( i = 0 ; i < MAXSAVELEVELS ; ++i )
+    nc_levels[ i ] = NULL ;
+  nc_dictcached = NULL ;
   ncache_root = NULL ;
 
   for ( i = 0 ; i < NAMES_COUNTED; ++i ) {
     system_names[ i ].next = NULL ;
+    system_names[ i ].prev = NULL ;
+    system_names[ i ].cachenext = NULL ;
+    system_names[ i ].cacheprev = NULL ;
     system_names[ i ].sid = 0 ;
     system_names[ i ].dictobj = NULL ;
     system_names[ i ].dictval = NULL ;
     system_names[ i ].dictsid = NULL ;
     system_names[ i ].dictcpy = NULL ;
   }
+
+#ifdef METRICS_BUILD
+  ncache_metrics_reset(SW_METRICS_RESET_BOOT) ;
+  sw_metrics_register(&ncache_metrics_hook) ;
+#endif
 }
 
 #if defined( ASSERT_BUILD )
 int32 ncache_asserts(void)
 {
-  return (thenamecache != NULL) ;
+  return (nc_table.slots != NULL) ;
 }
 #endif
 
+/** Allocate an empty name hash table. No error is raised on failure. */
+static Bool nc_table_alloc(nc_table_t *table, uint32 size)
+{
+  size_t bytes = size * (sizeof(NAMECACHE *) + sizeof(uint32)) ;
+
+  HQASSERT(size > 0 && (size & (size - 1)) == 0,
+           "Name table size must be a power of two") ;
+
+  table->slots = mm_alloc(mm_pool_temp, bytes, MM_ALLOC_CLASS_NAMECACHE_TABLE) ;
+  if ( table->slots == NULL )
+    return FALSE ;
+
+  HqMemZero(table->slots, bytes) ;
+  table->hashes = (uint32 *)(table->slots + size) ;
+  table->mask = size - 1 ;
+  table->filled = table->live = 0 ;
+  return TRUE ;
+}
+
+/** Free a name hash table. */
+static void nc_table_free(nc_table_t *table)
+{
+  if ( table->slots != NULL ) {
+    mm_free(mm_pool_temp, table->slots,
+            (table->mask + 1) * (sizeof(NAMECACHE *) + sizeof(uint32))) ;
+    table->slots = NULL ;
+  }
+}
+
+/** Put a name known not to be in the table into it. The table must have at
+    least one empty slot left. */
+static void nc_table_add(nc_table_t *table, NAMECACHE *nptr, uint32 hash)
+{
+  uint32 i = hash & table->mask ;
+
+  HQASSERT(table->filled < table->mask, "Name table is full") ;
+
+  while ( table->slots[i] != NULL && table->slots[i] != NC_DELETED )
+    i = (i + 1) & table->mask ;
+
+  if ( table->slots[i] == NULL )
+    ++table->filled ;
+  ++table->live ;
+  table->slots[i] = nptr ;
+  table->hashes[i] = hash ;
+}
+
+/** Search a table for a name. */
+static inline NAMECACHE *nc_table_find(const nc_table_t *table,
+                                       const uint8 *nm, uint32 ln,
+                                       uint32 hash)
+{
+  uint32 i = hash & table->mask ;
+  NAMECACHE *ptr ;
+#ifdef METRICS_BUILD
+  int32 probes = 0 ;
+#endif
+
+  while ( (ptr = table->slots[i]) != NULL ) {
+    if ( table->hashes[i] == hash && ptr != NC_DELETED &&
+         ln == theINLen(ptr) &&   /* for optimisation only */
+         HqMemCmp(nm, (int32)ln, theICList(ptr), theINLen(ptr)) == 0 )
+      break ;
+    i = (i + 1) & table->mask ;
+#ifdef METRICS_BUILD
+    ++probes ;
+#endif
+  }
+
+#ifdef METRICS_BUILD
+  /* Long jobs do enough lookups to overflow these, so they stick at the
+     maximum rather than wrap. */
+  if ( ncache_metrics.lookups < MAXINT32 )
+    ++ncache_metrics.lookups ;
+  if ( probes > MAXINT32 - ncache_metrics.probes )
+    ncache_metrics.probes = MAXINT32 ;
+  else
+    ncache_metrics.probes += probes ;
+  if ( probes > ncache_metrics.max_probe )
+    ncache_metrics.max_probe = probes ;
+#endif
+
+  return ptr ;
+}
+
+/** Remove a name from a table, returning FALSE if it isn't there. */
+static Bool nc_table_remove(nc_table_t *table, NAMECACHE *nptr, uint32 hash)
+{
+  uint32 i = hash & table->mask ;
+  NAMECACHE *ptr ;
+
+  while ( (ptr = table->slots[i]) != NULL ) {
+    if ( ptr == nptr ) {
+      table->slots[i] = NC_DELETED ;
+      --table->live ;
+      return TRUE ;
+    }
+    i = (i + 1) & table->mask ;
+  }
+  return FALSE ;
+}
+
+/** Move some of the old table's names into the current table, freeing the
+    old table when it is empty. */
+static void nc_migrate(void)
+{
+  uint32 n ;
+
+  HQASSERT(nc_old.slots != NULL, "No name table to migrate") ;
+
+  for ( n = 0 ; n < NC_MIGRATE_STEP && nc_migrated <= nc_old.mask ;
+        ++n, ++nc_migrated ) {
+    NAMECACHE *ptr = nc_old.slots[nc_migrated] ;
+
+    if ( ptr != NULL && ptr != NC_DELETED ) {
+      nc_table_add(&nc_table, ptr, nc_old.hashes[nc_migrated]) ;
+      /* Leave a tombstone so probes for names not yet migrated continue. */
+      nc_old.slots[nc_migrated] = NC_DELETED ;
+      --nc_old.live ;
+    }
+  }
+
+  if ( nc_migrated > nc_old.mask ) {
+    HQASSERT(nc_old.live == 0, "Names left in migrated table") ;
+    nc_table_free(&nc_old) ;
+  }
+}
+
+/** Make room for another name in the current table. If the table is getting
+    full, start migrating to a new table: twice the size if more than half
+    of the slots hold live names, otherwise the same size to clear out
+    tombstones. The new table is big enough that it will not fill before
+    the migration finishes. */
+static Bool nc_make_room(void)
+{
+  if ( nc_old.slots != NULL )
+    nc_migrate() ;
+  else if ( (nc_table.filled + 1) * 4 > (nc_table.mask + 1) * 3 ) {
+    nc_table_t bigger ;
+    uint32 size = nc_table.mask + 1 ;
+
+    if ( nc_table.live * 2 > size && size * 2 > size )
+      size *= 2 ;
+
+    /* Allocate before touching the tables, in case this provokes a GC that
+       finalizes names. If there is no memory, carry on filling the current
+       table. */
+    if ( nc_table_alloc(&bigger, size) ) {
+      nc_old = nc_table ;
+      nc_table = bigger ;
+      nc_migrated = 0 ;
+#ifdef METRICS_BUILD
+      ++ncache_metrics.resizes ;
+#endif
+      nc_migrate() ;
+    }
+  }
+
+  return nc_table.filled < nc_table.mask ;
+}
+
+/** Add a name to the name table and its save level list. */
+static void nc_addname(NAMECACHE *nptr, uint32 hash)
+{
+  nc_table_add(&nc_table, nptr, hash) ;
+
+#ifdef METRICS_BUILD
+  if ( (int32)(nc_table.live + nc_old.live) > ncache_metrics.max_names )
+    ncache_metrics.max_names = (int32)(nc_table.live + nc_old.live) ;
+#endif
+}
+
+/** Link a VM name into the list for its save level. */
+static void nc_level_link(NAMECACHE *nptr)
+{
+  NAMECACHE **head = &nc_levels[NUMBERSAVES(theISaveLevel(nptr))] ;
+
+  HQASSERT(NUMBERSAVES(theISaveLevel(nptr)) < MAXSAVELEVELS,
+           "Name save level out of range") ;
+
+  nptr->prev = NULL ;
+  nptr->next = *head ;
+  if ( *head != NULL )
+    (*head)->prev = nptr ;
+  *head = nptr ;
+}
+
+/** Unlink a VM name from the list for its save level. */
+static void nc_level_unlink(NAMECACHE *nptr)
+{
+  if ( nptr->prev != NULL )
+    nptr->prev->next = nptr->next ;
+  else {
+    HQASSERT(nc_levels[NUMBERSAVES(theISaveLevel(nptr))] == nptr,
+             "Name not at head of its save level list") ;
+    nc_levels[NUMBERSAVES(theISaveLevel(nptr))] = nptr->next ;
+  }
+  if ( nptr->next != NULL )
+    nptr->next->prev = nptr->prev ;
+  nptr->next = nptr->prev = NULL ;
+}
+
+void ncache_dictcache_link(NAMECACHE *nptr)
+{
+  HQASSERT(nptr != nc_dictcached && nptr->cacheprev == NULL,
+           "Name already has a dictionary cache") ;
+
+  nptr->cacheprev = NULL ;
+  nptr->cachenext = nc_dictcached ;
+  if ( nc_dictcached != NULL )
+    nc_dictcached->cacheprev = nptr ;
+  nc_dictcached = nptr ;
+}
+
+/** Unlink a name from the list of names with dictionary caches, if it is
+    on it. */
+static void nc_dictcache_unlink(NAMECACHE *nptr)
+{
+  if ( nptr->cacheprev != NULL )
+    nptr->cacheprev->cachenext = nptr->cachenext ;
+  else if ( nc_dictcached == nptr )
+    nc_dictcached = nptr->cachenext ;
+  else
+    return ; /* Not on the list. */
+  if ( nptr->cachenext != NULL )
+    nptr->cachenext->cacheprev = nptr->cacheprev ;
+  nptr->cachenext = nptr->cacheprev = NULL ;
+}
+
+/** Remove a name from whichever table it is in. */
+static Bool nc_removename(NAMECACHE *nptr)
+{
+  uint32 hash = nc_hash(theICList(nptr), theINLen(nptr)) ;
+
+  return (nc_table_remove(&nc_table, nptr, hash) ||
+          (nc_old.slots != NULL && nc_table_remove(&nc_old, nptr, hash))) ;
+}
+
 
 Bool ncache_init(void)
 {
   int32 i ;
 
-  HQASSERT(thenamecache == NULL, "Name cache already allocated") ;
+  HQASSERT(nc_table.slots == NULL, "Name cache already allocated") ;
 
-  thenamecache = mm_alloc_static( NAMECACHETABLESIZE * sizeof( NAMECACHE * )) ;
-  if ( thenamecache == NULL )
+  if ( !nc_table_alloc(&nc_table, NC_INITIAL_SIZE) )
     return FALSE ;
 
-  for ( i = 0 ; i < NAMECACHETABLESIZE ; ++i )
-    thenamecache[ i ] = NULL ;
-
   HQASSERT(ncache_asserts(), "Name cache not initialised") ;
 
 /* Insert all of system names into the namecache, dummy names (unassigned
@@ -106,6 +445,8 @@ void ncache_finish( void )
 {
   mps_root_destroy( ncache_weak_root );
   mps_root_destroy( ncache_root );
+  nc_table_free( &nc_old );
+  nc_table_free( &nc_table );
 }
 
 
@@ -114,39 +455,41 @@ void ncache_finish( void )
  * about what's been causing lots and lots of calls to fast_extract_hash.
  */
 #if defined( NAMECACHE_STATS )
-void debugDumpNameCacheHits( void )
+static void debugDumpNameTableHits( const nc_table_t *table )
 {
   NAMECACHE *nc ;
-  int32 i ;
-
-  monitorf( "Name                             :   Hit    :   Hit+   :   Miss   :   Miss+\n" , nc->len , nc->clist ,
-            nc->hit_shallow , nc->hit_deep ,
-            nc->miss_shallow , nc->miss_deep ) ;
+  uint32 i ;
 
-  for ( i = 0 ; i < NAMECACHETABLESIZE ; i++ ) {
-    nc = thenamecache[ i ] ;
+  for ( i = 0 ; table->slots != NULL && i <= table->mask ; i++ ) {
+    nc = table->slots[ i ] ;
 
-    while ( nc ) {
+    if ( nc != NULL && nc != NC_DELETED )
       monitorf( "%-32.*s : %8.d : %8.d : %8.d : %8.d\n" , nc->len , nc->clist ,
                 nc->hit_shallow , nc->hit_deep ,
                 nc->miss_shallow , nc->miss_deep ) ;
-
-      nc = nc->next ;
-    }
   }
 }
+
+void debugDumpNameCacheHits( void )
+{
+  NAMECACHE *nc ;
+
+  monitorf( "Name                             :   Hit    :   Hit+   :   Miss   :   Miss+\n" , nc->len , nc->clist ,
+            nc->hit_shallow , nc->hit_deep ,
+            nc->miss_shallow , nc->miss_deep ) ;
+
+  debugDumpNameTableHits( &nc_table ) ;
+  debugDumpNameTableHits( &nc_old ) ;
+}
 #endif
 
-/** Lookup a name in a particular hash chain of the name cache. */
+/** Lookup a name in the name cache, given its full hash. */
 static inline NAMECACHE *nc_lookupname(const uint8 *nm, uint32 ln, uint32 hashkey)
 {
-  NAMECACHE *ptr = thenamecache[ hashkey ] ;
+  NAMECACHE *ptr = nc_table_find(&nc_table, nm, ln, hashkey) ;
 
-  while (ptr != NULL &&
-         (ln != theINLen(ptr) ||        /* for optimisation only */
-          HqMemCmp(nm, (int32)ln, theICList(ptr), theINLen(ptr)) != 0) ) {
-    ptr = ptr->next ;
-  }
+  if ( ptr == NULL && nc_old.slots != NULL )
+    ptr = nc_table_find(&nc_old, nm, ln, hashkey) ;
 
   return ptr ;
 }
@@ -170,7 +513,10 @@ static void nc_insertname( NAMECACHE *nptr )
   if ( nc_lookupname( theICList( nptr ) , theINLen( nptr ) , hashkey ) != NULL )
     return ;
 
-  nptr->next = thenamecache[ hashkey ] ;
+  if ( !nc_make_room() ) {
+    HQFAIL("No room in name cache for pre-defined names") ;
+    return ;
+  }
 
 #if defined( NAMECACHE_STATS )
   /* These aren't initialized in nametab_.c, so better late than never.
@@ -181,7 +527,7 @@ static void nc_insertname( NAMECACHE *nptr )
   nptr->miss_shallow = 0 ;
 #endif
 
-  thenamecache[ hashkey ] = nptr ;
+  nc_addname( nptr , hashkey ) ;
   /* These names need not be finalized, because they are stored statically. */
 }
 
@@ -203,6 +549,14 @@ static inline NAMECACHE *nc_cachename(const uint8 *nm, uint32 ln)
   ptr = nc_lookupname( nm , ln , hashkey ) ;
 
   if ( ! ptr ) {
+    /* Make room in the table before allocating the name, so a name is never
+       allocated without a slot to put it in. A GC provoked by the allocation
+       can only remove names from the table, so the slot is still free. */
+    if ( !nc_make_room() ) {
+      (void)error_handler(VMERROR);
+      return NULL;
+    }
+
     ptr = (NAMECACHE *)mm_ps_alloc_weak( mm_pool_ps_typed_global,
                                          ln + sizeof( NAMECACHE ));
     if ( ptr == NULL ) {
@@ -214,13 +568,14 @@ static inline NAMECACHE *nc_cachename(const uint8 *nm, uint32 ln)
     HqMemCpy( theICList( ptr ) , nm , ( int32 )ln ) ;
     theINLen( ptr )      = CAST_TO_UINT16(ln) ;
     theISaveLevel( ptr ) = CAST_TO_UINT8(get_core_context_interp()->savelevel) ;
-    ptr->next   = thenamecache[ hashkey ] ;
     theIOpClass( ptr ) = 0 ;
     theINameNumber( ptr ) = -1 ;
 
     ptr->dictobj = NULL ;
     ptr->dictval = NULL ;
     ptr->dictcpy = NULL ;
+    ptr->cachenext = NULL ;
+    ptr->cacheprev = NULL ;
 
 #if defined( NAMECACHE_STATS )
     ptr->hit_deep = 0 ;
@@ -233,7 +588,10 @@ static inline NAMECACHE *nc_cachename(const uint8 *nm, uint32 ln)
     ptr->flags = 0 ;    /* [51291] */
 #endif
 
-    thenamecache[ hashkey ] = ptr ;
+    HQASSERT(nc_table.filled < nc_table.mask,
+             "Name table filled while allocating name") ;
+    nc_addname( ptr , hashkey ) ;
+    nc_level_link( ptr ) ;
   }
   return ( ptr ) ;
 }
@@ -311,7 +669,8 @@ NAMECACHE *lookuplongname(const uint8 *nm, uint32 ln)
   return nc_lookupname( nm , ln , hashkey ) ;
 }
 
-/** This function calculates the name cache hash bucket for the given string. */
+/** This function calculates the name cache hash for the given string. The
+    table index is taken from the low bits. */
 static uint32 nc_hash(const uint8 *nm , uint32 ln )
 {
   uint32 lni ;
@@ -358,7 +717,13 @@ static uint32 nc_hash(const uint8 *nm , uint32 ln )
     lni -= 1 ;
   }
 
-  return ( ln & ( NAMECACHETABLESIZE - 1 )) ;
+  /* Mix the bits, so that the low bits used for the table index depend on
+     all of the characters. */
+  ln ^= ln >> 16 ;
+  ln *= 0x85ebca6bu ;
+  ln ^= ln >> 13 ;
+
+  return ln ;
 }
 
 
@@ -397,36 +762,40 @@ void ncache_restore_prepare(NAMECACHE *name, OBJECT* slot,
 void purge_ncache(int32 slevel)
 {
   int32 i ;
-  NAMECACHE *curr ;
-  NAMECACHE **base ;
+  NAMECACHE *curr, *next ;
 
   HQASSERT(ncache_asserts(), "Name cache not initialised") ;
 
-  base = thenamecache ;
-
-  for ( i = 0 ; i < NAMECACHETABLESIZE ; ++i ) {
-    if (( curr = (*base++)) != NULL ) {
+  /* Remove the names made since the save from the table. They stay in memory
+     until the restore frees them, so just unlink them. */
+  for ( i = NUMBERSAVES(slevel) ; i < MAXSAVELEVELS ; ++i ) {
+    for ( curr = nc_levels[ i ] ; curr != NULL ; curr = next ) {
+      next = curr->next ;
       if ( theISaveLevel( curr ) > slevel ) {
-        do {
-          if ( NULL == ( curr = curr->next ))
-            break ;
-        } while ( theISaveLevel( curr ) > slevel );
-        base[ -1 ] = curr ;
+        if ( !nc_removename( curr ) )
+          HQFAIL( "Couldn't remove restored name from cache" ) ;
+        nc_level_unlink( curr ) ;
+        nc_dictcache_unlink( curr ) ;
       }
-      while ( curr ) {
+    }
+  }
+
+  /* Reset the dictionary cache of the names which have one. */
+  for ( curr = nc_dictcached ; curr != NULL ; curr = next ) {
+    next = curr->cachenext ;
 #ifdef debugac
-        if ( curr->dictcpy && !curr->dictobj )
-          printf("rs: %.*s\n",theINLen(curr),theICList(curr));
+    if ( curr->dictcpy && !curr->dictobj )
+      printf("rs: %.*s\n",theINLen(curr),theICList(curr));
 #endif
-        if ( curr->dictcpy == NC_DICTCACHE_RESET ) {
-          curr->dictobj = NULL ;
-          curr->dictval = NULL ;
-        }
-        else {
-          curr->dictobj = curr->dictcpy ;
-        }
-        curr = curr->next ;
-      }
+    if ( curr->dictcpy == NC_DICTCACHE_RESET ) {
+      curr->dictobj = NULL ;
+      curr->dictval = NULL ;
+      nc_dictcache_unlink( curr ) ;
+    }
+    else {
+      curr->dictobj = curr->dictcpy ;
+      if ( curr->dictcpy == NULL )
+        nc_dictcache_unlink( curr ) ;
     }
   }
 }
@@ -438,30 +807,15 @@ void purge_ncache(int32 slevel)
  */
 void ncache_finalize(NAMECACHE *obj)
 {
-  int found = FALSE;
-  int32 i;
-  register NAMECACHE *curr;
-  register NAMECACHE **prev;
-  NAMECACHE **base;
+  Bool found ;
 
   HQASSERT(ncache_asserts(), "Name cache not initialised");
 
-  for ( i = 0, base = thenamecache ; i < NAMECACHETABLESIZE ; ++i, ++base ) {
-    if ( *base != NULL ) {
-      /* Run down the cache list and unlink the name if it's on it */
-      prev = base;
-      while (( curr = *prev ) != NULL ) {
-        if ( curr == obj ) {
-          *prev = curr->next; found = TRUE;
-          break;
-        } else {
-          prev = &curr->next;
-        }
-      }
-    }
-    if ( found ) break;
-  }
+  found = nc_removename(obj) ;
   HQASSERT( found, "Couldn't unlink finalized name from cache" );
+  if ( found )
+    nc_level_unlink(obj) ;
+  nc_dictcache_unlink(obj) ;
 
   ncache_purge_finalize(obj);
 }
@@ -489,9 +843,9 @@ mps_res_t MPS_CALL ncache_scan(size_t *len_out,
    * because the only way for the referent to die is for the entry
    * to get redefined or the dictionary to die.
    *
-   * The next and dictsid fields are not fixed, because they are
-   * weak references used by restore.  Finalization will update them
-   * if the referent dies.
+   * The next, prev, cachenext, cacheprev and dictsid fields are not fixed,
+   * because they are weak references used by restore.  Finalization will
+   * update them if the referent dies.
    *
    * The length calculation is relying on the name being allocated
    * as a part of the NAMECACHE object. */
@@ -514,19 +868,19 @@ mps_res_t MPS_CALL ncache_top_scan(mps_ss_t ss, void* dummy, size_t level)
 {
   size_t i;
   NAMECACHE *curr ;
-  NAMECACHE **base ;
 
   HQASSERT( ncache_asserts(), "Name cache not initialised" );
   UNUSED_PARAM( void*, dummy );
 
+  /* The system names are not in the save level lists, so this only sees
+     names in VM. */
   MPS_SCAN_BEGIN( ss )
-    for ( i = 0, base = thenamecache; i < NAMECACHETABLESIZE; ++i, ++base ) {
-      curr = *base;
-      while ( curr != NULL && theISaveLevel( curr ) >= (int32)level ) {
-        MPS_RETAIN( &curr, TRUE );
-        /* This simply ignores the system names as they are not in VM (quickly,
-           as the address is usually far from the arena). */
-        curr = curr->next;
+    for ( i = NUMBERSAVES(level) ; i < MAXSAVELEVELS ; ++i ) {
+      for ( curr = nc_levels[ i ] ; curr != NULL ; curr = curr->next ) {
+        if ( theISaveLevel( curr ) >= (int32)level ) {
+          NAMECACHE *retain = curr ;
+          MPS_RETAIN( &retain, TRUE );
+        }
       }
     }
   MPS_SCAN_END( ss );
@@ -18,6 +18,10 @@
 
 extern NAMECACHE *namepurges ;
 
+/** Note that a name has been given a dictionary cache, so the next restore
+    to a global save level resets it. */
+void ncache_dictcache_link(NAMECACHE *nptr) ;
+
 #if defined( ASSERT_BUILD )
 /* Assert functions for interfaces */
 Bool object_asserts(void) ;
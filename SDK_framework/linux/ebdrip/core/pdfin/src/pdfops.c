@@ -306,6 +306,30 @@ static struct pdfop pdfops[] = {
 
 /* ---------------------------------------------------------------------- */
 
+/** Path-heavy content is mostly long runs of m, l, c and re. Once one path
+    construction operator has been executed, carry on adding any following
+    segments straight from the content stream buffer, without pushing their
+    operands on the PDF stack or going round the main operator loop. The run
+    stops at anything else, leaving it to be scanned as normal. On failure,
+    \a lpdfop is set to the operator that failed. */
+
+static Bool pdf_path_run( PDFCONTEXT *pdfc , FILELIST *flptr , PDFOP **lpdfop )
+{
+  int32 op ;
+  SYSTEMVALUE args[ 6 ] ;
+
+  while ( ! mm_memory_is_low && ! dosomeaction &&
+          pdf_scan_path_segment( flptr , & op , args )) {
+    *lpdfop = & pdfops[ op ] ;
+    HQTRACE( trace_pdf_ops , ("op: %s" , (*lpdfop)->name )) ;
+
+    if ( ! pdf_path_segment( pdfc , (*lpdfop)->pdfop , args ))
+      return FALSE ;
+  }
+
+  return TRUE ;
+}
+
 /** Execute the current content stream of the given PDF context. */
 
 int32 pdf_execops( PDFCONTEXT *pdfc , int32 state , int stream_type )
@@ -408,6 +432,10 @@ int32 pdf_execops( PDFCONTEXT *pdfc , int32 state , int stream_type )
         if ( !lpdfop->gc_safe )
           ++gc_safety_level;
         result = (*lpdfop->opcall)( pdfc ); /* Execute the operator */
+        if ( result && rr_flptr == NULL &&
+             lpdfop->retstate == OPSTATE_PATHOBJECT &&
+             theStackSize( *stack ) == EMPTY_STACK )
+          result = pdf_path_run( pdfc , flptr , & lpdfop ) ;
         gc_safety_level = saved_gc_safety_level;
         dl_safe_recursion = saved_dl_safe_recursion ;
 
@@ -137,21 +137,11 @@ int32 pdfop_m( PDFCONTEXT *pdfc )
   return TRUE ;
 }
 
-int32 pdfop_re( PDFCONTEXT *pdfc )
+/* Add a rectangle to the current path, for 're'. */
+static Bool pdf_rectangle( SYSTEMVALUE args[ 4 ] )
 {
-  STACK *stack ;
-  SYSTEMVALUE args[ 4 ] ;
   SYSTEMVALUE twoargs[ 2 ] ;
-  PDF_IMC_PARAMS *imc ;
 
-  PDF_CHECK_MC( pdfc ) ;
-  PDF_GET_IMC( imc ) ;
-  
-  stack = ( & imc->pdfstack ) ;
-  
-  if ( !stack_get_numeric(stack, args, 4) )
-    return FALSE ;
-  
   /* Implement rectangle by basically doing... */
   /* x y m */
   /* x+width y l */
@@ -184,13 +174,54 @@ int32 pdfop_re( PDFCONTEXT *pdfc )
   if ( ! gs_lineto( TRUE, TRUE, twoargs, & ( theIPathInfo( gstateptr ))))
     return FALSE ;
   
-  if ( ! path_close( CLOSEPATH, & ( theIPathInfo( gstateptr ))))
+  return path_close( CLOSEPATH, & ( theIPathInfo( gstateptr ))) ;
+}
+
+int32 pdfop_re( PDFCONTEXT *pdfc )
+{
+  STACK *stack ;
+  SYSTEMVALUE args[ 4 ] ;
+  PDF_IMC_PARAMS *imc ;
+
+  PDF_CHECK_MC( pdfc ) ;
+  PDF_GET_IMC( imc ) ;
+  
+  stack = ( & imc->pdfstack ) ;
+  
+  if ( !stack_get_numeric(stack, args, 4) )
+    return FALSE ;
+  
+  if ( ! pdf_rectangle( args ))
     return FALSE ;
     
   npop( 4 , stack ) ;
   return TRUE ;
 }
 
+/**
+ * Add a path segment for one of m, l, c, re or h, whose operands have been
+ * scanned straight out of the content stream rather than pushed on the PDF
+ * operand stack. \see pdf_scan_path_segment().
+ */
+Bool pdf_path_segment( PDFCONTEXT *pdfc , int32 pdfop , SYSTEMVALUE *args )
+{
+  switch ( pdfop ) {
+  case PDFOP_m:
+    return gs_moveto( TRUE, args, & ( theIPathInfo( gstateptr ))) ;
+  case PDFOP_l:
+    return gs_lineto( TRUE, TRUE, args, & ( theIPathInfo( gstateptr ))) ;
+  case PDFOP_c:
+    return gs_curveto( TRUE, TRUE, args, & ( theIPathInfo( gstateptr ))) ;
+  case PDFOP_re:
+    return pdf_rectangle( args ) ;
+  case PDFOP_h:
+    return pdfop_h( pdfc ) ;
+  }
+
+  HQFAIL( "Not a path segment operator" ) ;
+  return error_handler( UNREGISTERED ) ;
+}
+
 int32 pdfop_v( PDFCONTEXT *pdfc )
 {
   STACK *stack ;
@@ -23,6 +23,8 @@ int32 pdfop_re( PDFCONTEXT *pdfc ) ;
 int32 pdfop_v( PDFCONTEXT *pdfc ) ;
 int32 pdfop_y( PDFCONTEXT *pdfc ) ;
 
+Bool pdf_path_segment( PDFCONTEXT *pdfc , int32 pdfop , SYSTEMVALUE *args ) ;
+
 #endif /* protection for multiple inclusion */
 
 /* end of file pdfpseg.h */
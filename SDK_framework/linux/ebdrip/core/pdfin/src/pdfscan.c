@@ -733,6 +733,252 @@ static Bool pdf_scanextendcache( SCANCONTEXT *sc )
   return TRUE ;
 }
 
+/* ---------------------------------------------------------------------- */
+/* Buffer-level fast paths.
+ *
+ * Content streams are mostly numbers, short operators and names. When a
+ * whole token and its terminator are already in the file's buffer, these
+ * parse it in place rather than a character at a time through Getc. Nothing
+ * is consumed unless a fast path succeeds, so anything unusual (a token split
+ * across buffers, a long number, an escape in a name, a syntax error) just
+ * returns FALSE, and the caller falls back on the Getc-based scanner, which
+ * also raises any errors.
+ */
+
+/** Powers of ten for scaling the fractional part of a number. */
+static const SYSTEMVALUE fdivs[ 11 ] = {
+  0.0 , 0.1 , 0.01 , 0.001 , 0.0001 , 0.00001 , 0.000001 ,
+  0.0000001 , 0.00000001 , 0.000000001 , 0.0000000001
+} ;
+
+/** Return the number of bytes making up the token terminator at \a p,
+ * consuming it the way the Getc-based scanners do: one whitespace character
+ * (counting CR LF as one) is skipped, a delimiter is left for the next token.
+ * Returns -1 if \a p isn't an end marker, or is a CR at the end of the
+ * buffer, where we can't tell if an LF follows.
+ */
+static inline int32 pdf_buffered_terminator(const uint8 *p, const uint8 *limit)
+{
+  HQASSERT( p < limit , "No terminator in buffer" ) ;
+
+  if ( ! IsEndMarkerPDF( *p ))
+    return -1 ;
+  if ( ! IsWhiteSpace( *p ))
+    return 0 ;
+  if ( *p == CR ) {
+    if ( p + 1 == limit )
+      return -1 ;
+    if ( p[ 1 ] == LF )
+      return 2 ;
+  }
+  return 1 ;
+}
+
+/** Parse a number of less than ten digits and its terminator at \a p,
+ * setting \a next to the start of the following token. */
+static Bool pdf_buffered_number( const uint8 *p , const uint8 *limit ,
+                                 OBJECT *pdfobj , const uint8 **next )
+{
+  Bool negative = FALSE ;
+  int32 ivalue = 0 , ndigits = 0 , nleading = -1 , term ;
+
+  if ( p < limit && ( *p == '-' || *p == '+' )) {
+    negative = ( *p == '-' ) ;
+    ++p ;
+  }
+
+  for ( ; p < limit ; ++p ) {
+    int32 ch = *p ;
+
+    if ( isdigit( ch )) {
+      if ( ++ndigits >= 10 )
+        return FALSE ;
+      ivalue = 10 * ivalue + ( ch - '0' ) ;
+    }
+    else if ( ch == '.' && nleading < 0 )
+      nleading = ndigits ;
+    else
+      break ;
+  }
+
+  if ( p == limit || ndigits == 0 ||
+       ( term = pdf_buffered_terminator( p , limit )) < 0 )
+    return FALSE ;
+
+  if ( negative )
+    ivalue = -ivalue ;
+
+  if ( nleading < 0 || nleading == ndigits ) {
+    /* We scanned (m) or (m.). */
+    theTags( *pdfobj ) = OINTEGER | LITERAL ;
+    oInteger( *pdfobj ) = ivalue ;
+  }
+  else {
+    /* We scanned (.n) or (m.n). */
+    theTags( *pdfobj ) = OREAL | LITERAL ;
+    oReal( *pdfobj ) = ( USERVALUE )(( SYSTEMVALUE )ivalue *
+                                     fdivs[ ndigits - nleading ]) ;
+  }
+
+  *next = p + term ;
+  return TRUE ;
+}
+
+/** Parse an operator of up to three characters and its terminator at \a p,
+ * setting \a next to the start of the following token. */
+static Bool pdf_buffered_op( const uint8 *p , const uint8 *limit ,
+                             int32 ch[ 3 ] , const uint8 **next )
+{
+  int32 n , term ;
+
+  if ( p == limit )
+    return FALSE ;
+
+  /* The first character is always taken, as in pdf_scanop. */
+  ch[ 0 ] = *p++ ;
+  ch[ 1 ] = ch[ 2 ] = 0 ;
+  for ( n = 1 ; p < limit && ! IsEndMarkerPDF( *p ) ; ++n , ++p ) {
+    if ( n == 3 )
+      return FALSE ; /* true, false, null, or an error. */
+    ch[ n ] = *p ;
+  }
+
+  if ( p == limit ||
+       ( term = pdf_buffered_terminator( p , limit )) < 0 )
+    return FALSE ;
+
+  *next = p + term ;
+  return TRUE ;
+}
+
+/** Consume the file buffer up to \a next. */
+static inline void pdf_buffered_consume( FILELIST *flptr , const uint8 *next )
+{
+  HQASSERT( next >= theIPtr( flptr ) &&
+            next <= theIPtr( flptr ) + theICount( flptr ) ,
+            "Consuming outside file buffer" ) ;
+  theICount( flptr ) -= ( int32 )( next - theIPtr( flptr )) ;
+  theIPtr( flptr ) = ( uint8 * )next ;
+}
+
+/** Scan a number of less than ten digits from the file buffer. */
+static Bool pdf_scandigits_buffered( FILELIST *flptr , OBJECT *pdfobj )
+{
+  const uint8 *next ;
+
+  if ( ! pdf_buffered_number( theIPtr( flptr ) ,
+                              theIPtr( flptr ) + theICount( flptr ) ,
+                              pdfobj , & next ))
+    return FALSE ;
+
+  pdf_buffered_consume( flptr , next ) ;
+  return TRUE ;
+}
+
+/** Scan a content stream operator of up to three characters from the file
+ * buffer. */
+static Bool pdf_scanop_buffered( FILELIST *flptr , int32 *opnum )
+{
+  const uint8 *next ;
+  int32 ch[ 3 ] ;
+
+  if ( ! pdf_buffered_op( theIPtr( flptr ) ,
+                          theIPtr( flptr ) + theICount( flptr ) ,
+                          ch , & next ))
+    return FALSE ;
+
+  *opnum = pdf_whichop( ch[ 0 ] , ch[ 1 ] , ch[ 2 ] ) ;
+  pdf_buffered_consume( flptr , next ) ;
+  return TRUE ;
+}
+
+/** Find the extent of a name without # escapes in the file buffer, leaving
+ * the name in place for cachename. The caller consumes \a len + \a term bytes
+ * once it has made the name. */
+static Bool pdf_scanname_buffered( FILELIST *flptr , int32 *len , int32 *term )
+{
+  const uint8 *start = theIPtr( flptr ) ;
+  const uint8 *limit = start + theICount( flptr ) ;
+  const uint8 *p ;
+
+  for ( p = start ; p < limit && ! IsEndMarkerPDF( *p ) ; ++p ) {
+    if ( *p == '#' )
+      return FALSE ;
+  }
+
+  if ( p == limit || p - start >= MAXPSNAME ||
+       ( *term = pdf_buffered_terminator( p , limit )) < 0 )
+    return FALSE ;
+
+  *len = ( int32 )( p - start ) ;
+
+  return TRUE ;
+}
+
+/** Scan a complete path construction operation (m, l, c, re or h with
+ * exactly its operands, and nothing else) if it is already in the content
+ * stream buffer. Nothing is consumed if it isn't, or if the next operation is
+ * anything else; the caller should then scan objects normally.
+ *
+ * \param flptr  The content stream.
+ * \param opnum  Set to the operator's pdf_whichop() index.
+ * \param args   Set to the operands, which have the same values as
+ *               stack_get_numeric() would produce.
+ */
+Bool pdf_scan_path_segment( FILELIST *flptr , int32 *opnum , SYSTEMVALUE args[ 6 ] )
+{
+  const uint8 *p = theIPtr( flptr ) ;
+  const uint8 *limit = p + theICount( flptr ) ;
+  int32 nargs = 0 , arity , ch[ 3 ] ;
+
+  HQASSERT( opnum != NULL , "Nowhere for path operator" ) ;
+  HQASSERT( args != NULL , "Nowhere for path operands" ) ;
+
+  for (;;) {
+    OBJECT number = OBJECT_NOTVM_NOTHING ;
+
+    while ( p < limit && IsWhiteSpace( *p ))
+      ++p ;
+    if ( p == limit )
+      return FALSE ;
+    if ( isalpha( *p ))
+      break ;
+    if ( nargs == 6 || ! pdf_buffered_number( p , limit , & number , & p ))
+      return FALSE ;
+    args[ nargs++ ] = ( oType( number ) == OINTEGER
+                        ? ( SYSTEMVALUE )oInteger( number )
+                        : ( SYSTEMVALUE )oReal( number )) ;
+  }
+
+  if ( ! pdf_buffered_op( p , limit , ch , & p ) || ch[ 2 ] != 0 )
+    return FALSE ;
+
+  switch ( ch[ 0 ] ) {
+  case 'm': case 'l':
+    arity = ( ch[ 1 ] == 0 ) ? 2 : -1 ;
+    break ;
+  case 'c':
+    arity = ( ch[ 1 ] == 0 ) ? 6 : -1 ;
+    break ;
+  case 'h':
+    arity = ( ch[ 1 ] == 0 ) ? 0 : -1 ;
+    break ;
+  case 'r':
+    arity = ( ch[ 1 ] == 'e' ) ? 4 : -1 ;
+    break ;
+  default:
+    arity = -1 ;
+    break ;
+  }
+  if ( arity != nargs )
+    return FALSE ;
+
+  *opnum = pdf_whichop( ch[ 0 ] , ch[ 1 ] , ch[ 2 ] ) ;
+  pdf_buffered_consume( flptr , p ) ;
+
+  return TRUE ;
+}
+
 static Bool pdf_scanobject( SCANCONTEXT *sc , FILELIST **flptr, Bool do_fileoffset )
 {
   return pdf_scanobject_internal( sc , flptr, do_fileoffset );
@@ -751,6 +997,10 @@ static Bool pdf_scanobject_internal( SCANCONTEXT *sc , FILELIST **flptr, Bool do
    * means that it had trailing whitespace and/or comments; nothing to
    * complain about
    */
+  while ( theICount( *flptr ) > 0 && IsWhiteSpace( *theIPtr( *flptr ))) {
+    --theICount( *flptr ) ;
+    ++theIPtr( *flptr ) ;
+  }
   do {
     if (( ch = Getc( *flptr )) == EOF )
       return pdf_scannererror( *flptr , FALSE ) ;
@@ -826,6 +1076,7 @@ static Bool pdf_scanop( SCANCONTEXT *sc , FILELIST *flptr )
 
   int32 ch ;
   int32 ch1 , ch2 , ch3 ;
+  int32 opnum ;
   OBJECT pdfobj = OBJECT_NOTVM_NOTHING ;
   STACK *stack ;
 
@@ -834,6 +1085,12 @@ static Bool pdf_scanop( SCANCONTEXT *sc , FILELIST *flptr )
 
   stack = sc->pdfstack ;
 
+  if ( pdf_scanop_buffered( flptr , & opnum )) {
+    theTags( pdfobj ) = OOPERATOR ;
+    oInteger(pdfobj) = opnum ;
+    return push( & pdfobj , stack ) ;
+  }
+
   ch1 = Getc( flptr ) ;
   HQASSERT( ch1 != EOF , "always UnGetc before calling pdf_scanop" ) ;
 
@@ -1118,6 +1375,9 @@ static Bool pdf_scandigits( SCANCONTEXT *sc  , FILELIST *flptr, Bool do_fileoffs
 
   stack = sc->pdfstack ;
 
+  if ( pdf_scandigits_buffered( flptr , & pdfobj ))
+    return push( & pdfobj , stack ) ;
+
   sign = 1 ;
   ch = Getc( flptr ) ;
   HQASSERT( ch != EOF , "always UnGetc before calling pdf_scandigits" ) ;
@@ -1225,8 +1485,6 @@ static Bool pdf_scandigits( SCANCONTEXT *sc  , FILELIST *flptr, Bool do_fileoffs
   else {
     /* We scanned (.n) or (m.n). */
     int32 ntrailing = ntotal - nleading ;
-    SYSTEMVALUE fdivs[ 11 ] = { 0.0 , 0.1 , 0.01 , 0.001 , 0.0001 , 0.00001 , 0.000001 ,
-                                0.0000001 , 0.00000001 , 0.000000001 , 0.0000000001 } ;
     if ( ntotal < 10 ) {
       if ( sign < 0 )
         ileading = -ileading ;
@@ -1256,7 +1514,7 @@ static Bool pdf_scandigits( SCANCONTEXT *sc  , FILELIST *flptr, Bool do_fileoffs
 static Bool pdf_scanname( SCANCONTEXT *sc , FILELIST *flptr )
 {
   int32 ch ;
-  int32 len ;
+  int32 len , term ;
   uint8 *namebuf ;
   NAMECACHE *name ;
   OBJECT pdfobj = OBJECT_NOTVM_NOTHING ;
@@ -1274,47 +1532,53 @@ static Bool pdf_scanname( SCANCONTEXT *sc , FILELIST *flptr )
   stack = sc->pdfstack ;
   namebuf = sc->scanbuf ;
 
-  len = 0 ;
-  while (( ch = Getc( flptr )) != EOF ) {
-    if ( ch == '#' ) {
-      int32 ch1 , ch2 ;
+  if ( pdf_scanname_buffered( flptr , & len , & term )) {
+    name = cachename(( len > 0 ) ? theIPtr( flptr ) : NULL , ( uint32 )len ) ;
+    pdf_buffered_consume( flptr , theIPtr( flptr ) + len + term ) ;
+  }
+  else {
+    len = 0 ;
+    while (( ch = Getc( flptr )) != EOF ) {
+      if ( ch == '#' ) {
+        int32 ch1 , ch2 ;
 
-      if (( ch1 = Getc( flptr )) == EOF )
-        return pdf_scannererror( flptr , TRUE ) ;
-      ch1 = char_to_hex_nibble[ ch1 ] ;
-      if ( ch1 < 0 )
-        return error_handler( SYNTAXERROR ) ;
-      if (( ch2 = Getc( flptr )) == EOF )
-        return pdf_scannererror( flptr , TRUE ) ;
-      ch2 = char_to_hex_nibble[ ch2 ] ;
-      if ( ch2 < 0 )
-        return error_handler( SYNTAXERROR ) ;
-      ch = ( ch1 << 4 ) + ch2 ;
-    }
-    else {
-      if ( IsEndMarkerPDF( ch )) {
-        if ( IsEndOfLine( ch )) {
-          if ( ch == CR &&
-            (( ch = Getc( flptr )) != EOF ) &&
-               ch != LF )
+        if (( ch1 = Getc( flptr )) == EOF )
+          return pdf_scannererror( flptr , TRUE ) ;
+        ch1 = char_to_hex_nibble[ ch1 ] ;
+        if ( ch1 < 0 )
+          return error_handler( SYNTAXERROR ) ;
+        if (( ch2 = Getc( flptr )) == EOF )
+          return pdf_scannererror( flptr , TRUE ) ;
+        ch2 = char_to_hex_nibble[ ch2 ] ;
+        if ( ch2 < 0 )
+          return error_handler( SYNTAXERROR ) ;
+        ch = ( ch1 << 4 ) + ch2 ;
+      }
+      else {
+        if ( IsEndMarkerPDF( ch )) {
+          if ( IsEndOfLine( ch )) {
+            if ( ch == CR &&
+              (( ch = Getc( flptr )) != EOF ) &&
+                 ch != LF )
+              UnGetc( ch , flptr ) ;
+          }
+          else if ( ! IsWhiteSpace( ch ))
             UnGetc( ch , flptr ) ;
+          break ;
         }
-        else if ( ! IsWhiteSpace( ch ))
-          UnGetc( ch , flptr ) ;
-        break ;
+        /* The spec says we should do this, but Acrobat doesn't:
+         * else
+         *   if ( ch < 0x21 || ch > 0x7E )
+         *     return error_handler( UNDEFINED ) ;
+         */
       }
-      /* The spec says we should do this, but Acrobat doesn't:
-       * else
-       *   if ( ch < 0x21 || ch > 0x7E )
-       *     return error_handler( UNDEFINED ) ;
-       */
+
+      CHECK_EXTEND_SCANCACHE( namebuf , len , sc , MAXPSNAME ) ;
+      namebuf[ len++ ] = ( uint8 )ch ;
     }
 
-    CHECK_EXTEND_SCANCACHE( namebuf , len , sc , MAXPSNAME ) ;
-    namebuf[ len++ ] = ( uint8 )ch ;
+    name = cachename(( len > 0 ) ? namebuf : NULL , ( uint32 )len ) ;
   }
-
-  name = cachename(( len > 0 ) ? namebuf : NULL , ( uint32 )len ) ;
   if ( ! name )
     return error_handler( VMERROR ) ;
 
@@ -21,6 +21,7 @@ int32 pdf_xrefstreamobj ( PDFCONTEXT *pdfc, FILELIST *flptr, OBJECT *pdfobj ) ;
 int32 pdf_readobject ( PDFCONTEXT *pdfc, FILELIST *flptr, OBJECT *pdfobj ) ;
 
 int32 pdf_scancontent( PDFCONTEXT *pdfc, FILELIST **flptr, OBJECT *pdfobj ) ;
+Bool pdf_scan_path_segment( FILELIST *flptr, int32 *opnum, SYSTEMVALUE args[ 6 ] ) ;
 
 int32 pdf_readdata( FILELIST *flptr, uint8 *lineptr, uint8 *lineend ) ;
 int32 pdf_readdata_delimited( FILELIST *flptr, uint8 *lineptr, uint8 *lineend ) ;
@@ -58,6 +58,7 @@
 
 #include "routedev.h"
 #include "execops.h"  /* setup_pending_exec */
+#include "jobmetrics.h" /* dl_metrics */
 
 /* Static functions */
 
@@ -72,6 +73,7 @@ static Bool pdfform_group_begin(PDFCONTEXT *pdfc ,
                                 int32 *gid,
                                 uint32 *extractGroupId);
 static Bool pdfform_group_end(Group **group, int32 gid, Bool result) ;
+static Bool pdfform_clipped_out(PDFCONTEXT *pdfc, OBJECT *dict, Bool *clipped) ;
 static Bool pdfform_dispatch( PDFCONTEXT *pdfc ,
                               OBJECT *dict ,
                               OBJECT *source ) ;
@@ -429,6 +431,24 @@ Bool pdf_DoExtractingGroup(PDFCONTEXT *pdfc,
         break;
     }
 
+    /* A form which can't mark anything is skipped here, rather than in
+       gs_execform, so its group and resources aren't set up either. Soft
+       masks and extracted groups are still built, because the caller uses
+       the group. */
+    if ( softmasktype == EmptySoftMask && extractGroupId == NULL ) {
+      Bool clipped ;
+
+      if ( !pdfform_clipped_out(pdfc, dict, &clipped) )
+        return FALSE ;
+
+      if ( clipped ) {
+#ifdef METRICS_BUILD
+        dl_metrics()->forms.clippedOut++ ;
+#endif
+        break ;
+      }
+    }
+
     {
       Bool success = FALSE ;
       Group *group ;
@@ -618,6 +638,45 @@ static Bool pdfform_group_begin(PDFCONTEXT *pdfc,
   return TRUE ;
 }
 
+/** Test if a form XObject lies entirely outside the current clip. This is
+ * the test gs_execform applies, made before the form's group, resources and
+ * local dictionary are set up, so that none of that is done for nothing.
+ */
+static Bool pdfform_clipped_out(PDFCONTEXT *pdfc, OBJECT *dict, Bool *clipped)
+{
+  enum {
+    fc_BBox, fc_Matrix, fc_dummy
+  } ;
+  static NAMETYPEMATCH fc_match[fc_dummy + 1] = {
+    { NAME_BBox,                   3,  { OARRAY, OPACKEDARRAY, OINDIRECT }},
+    { NAME_Matrix | OOPTIONAL,     3,  { OARRAY, OPACKEDARRAY, OINDIRECT }},
+    DUMMY_END_MATCH
+  } ;
+  sbbox_t bbox ;
+  OMATRIX matrix, ctm ;
+
+  *clipped = FALSE ;
+
+  /* HDLT has to see every form. */
+  if ( isHDLTEnabled(*gstateptr) )
+    return TRUE ;
+
+  if ( !pdf_dictmatch(pdfc, dict, fc_match) ||
+       !object_get_bbox(fc_match[fc_BBox].result, &bbox) )
+    return FALSE ;
+
+  if ( fc_match[fc_Matrix].result == NULL )
+    MATRIX_COPY(&matrix, &identity_matrix) ;
+  else if ( !is_matrix(fc_match[fc_Matrix].result, &matrix) )
+    return FALSE ;
+
+  matrix_mult(&matrix, &thegsPageCTM(*gstateptr), &ctm) ;
+
+  *clipped = form_clipped_out(&bbox, &ctm) ;
+
+  return TRUE ;
+}
+
 static Bool pdfform_group_end(Group **group, int32 gid, Bool result)
 {
   /* Close the Group if it was opened. */
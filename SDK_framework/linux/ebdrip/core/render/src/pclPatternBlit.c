@@ -11,6 +11,7 @@
  */
 #include "core.h"
 #include "pclPatternBlit.h"
+#include "hqmemcpy.h"
 
 #include "pclAttribTypes.h"
 #include "pclGstate.h"
@@ -87,6 +88,136 @@ static inline void blit_color_pcl_pattern(blit_color_t *color,
   blit_color_pack(color) ;
 }
 
+/** Number of distinct pattern colors remembered by a PCL pattern blit. */
+#define PCL_PATTERN_MEMO_COLORS 4
+
+/** Maximum number of channels in a color map for which pattern colors are
+    remembered. */
+#define PCL_PATTERN_MEMO_CHANNELS 8
+
+/** Maximum number of bytes of packed and expanded color data remembered
+    for each pattern color. */
+#define PCL_PATTERN_MEMO_BYTES 64
+
+/** The unpacked, quantised and packed results of converting pattern colors
+    for one span or block.
+
+    The pattern is a device space tile shared by all bands, but each run
+    still needs its color unpacked, quantised and packed into the blit
+    color, and a pattern usually has only a few colors. Within one span or
+    block call the rest of the blit color does not change, so converting a
+    pattern color always gives the same result. Remembering the results
+    for the most recent colors means that replicating the pattern across a
+    span or block converts each color only once. */
+typedef struct pcl_pattern_memo_t {
+  Bool usable ;       /**< Is the color map small enough to remember? */
+  uint32 nentries ;   /**< Number of entries in use. */
+  uint32 replace ;    /**< Next entry to replace when full. */
+  uint32 packed_bytes ; /**< Bytes of packed and expanded data to keep. */
+  struct {
+    p_ncolor_t ncolor ;                 /**< The pattern color. */
+    blit_quantise_state_t state ;       /**< Quantised state. */
+    COLORVALUE cv[PCL_PATTERN_MEMO_CHANNELS] ; /**< Unpacked values. */
+    channel_output_t qcv[PCL_PATTERN_MEMO_CHANNELS] ; /**< Quantised values. */
+    /** Packed data, as blit_t to keep it aligned. */
+    blit_t packed[(PCL_PATTERN_MEMO_BYTES + sizeof(blit_t) - 1) /
+                  sizeof(blit_t)] ;
+#ifdef ASSERT_BUILD
+    Bool expanded ;                     /**< Was the packed data expanded? */
+#endif
+  } entry[PCL_PATTERN_MEMO_COLORS] ;
+} pcl_pattern_memo_t ;
+
+static inline void pcl_pattern_memo_init(pcl_pattern_memo_t *memo,
+                                         const blit_color_t *color)
+{
+  const blit_colormap_t *map = color->map ;
+
+  VERIFY_OBJECT(map, BLIT_MAP_NAME) ;
+
+  memo->nentries = memo->replace = 0 ;
+  /* Packing may expand the data to a multiple of the blit width, and
+     blitting relies on the expanded copies. */
+  memo->packed_bytes = (map->packed_bits + 7) >> 3 ;
+  if ( memo->packed_bytes < map->expanded_bytes )
+    memo->packed_bytes = map->expanded_bytes ;
+  memo->usable = (map->nchannels <= PCL_PATTERN_MEMO_CHANNELS &&
+                  memo->packed_bytes <= sizeof(memo->entry[0].packed)) ;
+}
+
+/** Set the blit color to a remembered pattern color, if there is one. */
+static inline Bool pcl_pattern_memo_recall(const pcl_pattern_memo_t *memo,
+                                           blit_color_t *color,
+                                           p_ncolor_t ncolor)
+{
+  uint32 i ;
+
+  for ( i = 0 ; i < memo->nentries ; ++i ) {
+    if ( memo->entry[i].ncolor == ncolor ) {
+      channel_index_t index ;
+
+      for ( index = 0 ; index < color->map->nchannels ; ++index ) {
+        color->unpacked.channel[index].cv = memo->entry[i].cv[index] ;
+        color->quantised.qcv[index] = memo->entry[i].qcv[index] ;
+      }
+      color->quantised.state = memo->entry[i].state ;
+      HqMemCpy(&color->packed.channels.bytes[0], memo->entry[i].packed,
+               memo->packed_bytes) ;
+#ifdef ASSERT_BUILD
+      color->valid = blit_color_unpacked|blit_color_quantised|blit_color_packed ;
+      if ( memo->entry[i].expanded )
+        color->valid |= blit_color_expanded ;
+#endif
+      return TRUE ;
+    }
+  }
+
+  return FALSE ;
+}
+
+/** Remember the conversion of a pattern color that has just been applied to
+    the blit color. */
+static inline void pcl_pattern_memo_save(pcl_pattern_memo_t *memo,
+                                         const blit_color_t *color,
+                                         p_ncolor_t ncolor)
+{
+  uint32 i ;
+  channel_index_t index ;
+
+  if ( !memo->usable )
+    return ;
+
+  if ( memo->nentries < PCL_PATTERN_MEMO_COLORS ) {
+    i = memo->nentries++ ;
+  } else {
+    i = memo->replace ;
+    memo->replace = (i + 1) % PCL_PATTERN_MEMO_COLORS ;
+  }
+
+  memo->entry[i].ncolor = ncolor ;
+  for ( index = 0 ; index < color->map->nchannels ; ++index ) {
+    memo->entry[i].cv[index] = color->unpacked.channel[index].cv ;
+    memo->entry[i].qcv[index] = color->quantised.qcv[index] ;
+  }
+  memo->entry[i].state = color->quantised.state ;
+  HqMemCpy(memo->entry[i].packed, &color->packed.channels.bytes[0],
+           memo->packed_bytes) ;
+#ifdef ASSERT_BUILD
+  memo->entry[i].expanded = ((color->valid & blit_color_expanded) != 0) ;
+#endif
+}
+
+/** Apply a pattern color to the blit color, converting it only if it is not
+    remembered. */
+static inline void pcl_pattern_color(pcl_pattern_memo_t *memo,
+                                     blit_color_t *color, p_ncolor_t ncolor)
+{
+  if ( !pcl_pattern_memo_recall(memo, color, ncolor) ) {
+    blit_color_pcl_pattern(color, ncolor) ;
+    pcl_pattern_memo_save(memo, color, ncolor) ;
+  }
+}
+
 static inline uint32 wrap(uint32 coord, uint32 size)
 {
   uint32 mask = size - 1 ;
@@ -110,6 +241,7 @@ static void bitfillpcl_pattern(render_blit_t *rb, dcoord y, dcoord xs, dcoord xe
   p_ncolor_t transparent ;
   Bool unpack ;
   const surface_t *surface = rb->p_ri->surface ;
+  pcl_pattern_memo_t memo ;
 
   HQASSERT(surface != NULL, "No output surface") ;
   HQASSERT(pattern->preconverted == PCL_PATTERN_PRECONVERT_DEVICE,
@@ -126,11 +258,14 @@ static void bitfillpcl_pattern(render_blit_t *rb, dcoord y, dcoord xs, dcoord xe
   GET_BLIT_DATA(rb->blits, PCL_PATTERN_BLIT_INDEX, blit_data) ;
   transparent = blit_data ;
 
+  if ( unpack )
+    pcl_pattern_memo_init(&memo, rb->color) ;
+
   pclDLPatternIteratorStart(&iterator, pattern, xs, y, w) ;
   for (;;) {
     if (iterator.color.ncolor != transparent) {
       if ( unpack ) {
-        blit_color_pcl_pattern(rb->color, iterator.color.ncolor) ;
+        pcl_pattern_color(&memo, rb->color, iterator.color.ncolor) ;
         /* Reset the blit slice for the base blit, because it may have
            self-modified to use specific functions for the tone value. */
         SET_BLIT_SLICE(rb->blits, BASE_BLIT_INDEX, rb->clipmode,
@@ -161,6 +296,7 @@ static void blkfillpcl_pattern(render_blit_t *rb, dcoord ys, dcoord ye,
   Bool unpack ;
   const surface_t *surface = rb_copy.p_ri->surface ;
   register int32 wupdate = theFormL(*rb_copy.outputform);
+  pcl_pattern_memo_t memo ;
 
   HQASSERT(surface != NULL, "No output surface") ;
   HQASSERT(pattern->preconverted == PCL_PATTERN_PRECONVERT_DEVICE,
@@ -177,6 +313,9 @@ static void blkfillpcl_pattern(render_blit_t *rb, dcoord ys, dcoord ye,
   GET_BLIT_DATA(rb_copy.blits, PCL_PATTERN_BLIT_INDEX, blit_data) ;
   transparent = blit_data ;
 
+  if ( unpack )
+    pcl_pattern_memo_init(&memo, rb_copy.color) ;
+
   do {
     dcoord w = xe - xs + 1;
     dcoord x = xs ;
@@ -187,7 +326,7 @@ static void blkfillpcl_pattern(render_blit_t *rb, dcoord ys, dcoord ye,
     for (;;) {
       if (iterator.color.ncolor != transparent) {
         if ( unpack ) {
-          blit_color_pcl_pattern(rb_copy.color, iterator.color.ncolor) ;
+          pcl_pattern_color(&memo, rb_copy.color, iterator.color.ncolor) ;
           /* Reset the blit slice for the base blit, because it may have
              self-modified to use specific functions for the tone value. */
           SET_BLIT_SLICE(rb_copy.blits, BASE_BLIT_INDEX, rb_copy.clipmode,
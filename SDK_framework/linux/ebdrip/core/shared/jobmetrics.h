@@ -96,6 +96,12 @@ typedef struct dl_metrics_t {
     uint32 groupsStoringShape;
   } groups ;
 
+  /** Forms executed, and those skipped because they were clipped out. */
+  struct {
+    uint32 executed;
+    uint32 clippedOut;
+  } forms ;
+
   struct {
     uint32 patternedObjects;
     /** PCL ROPs used on DL. */
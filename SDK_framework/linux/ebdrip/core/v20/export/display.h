@@ -460,6 +460,7 @@ LISTOBJECT *dlref_lobj(DLREF *dlref);
 void dlref_assign(DLREF *dlref, LISTOBJECT *lobj);
 DLREF *dlref_next(DLREF *dlref);
 void dlref_setnext(DLREF *dlref, DLREF *next);
+uint32 dlref_render_cost(DLREF *dlref, const dbbox_t *bbox);
 
 extern uint8 dl_currentexflags;
 extern uint8 dl_currentdisposition;
@@ -17,6 +17,8 @@
 
 Bool gs_execform( corecontext_t *context, STACK *stack ) ;
 
+Bool form_clipped_out(const sbbox_t *bbox, OMATRIX *ctm) ;
+
 Bool in_execform(void);
 
 void preserve_execform(
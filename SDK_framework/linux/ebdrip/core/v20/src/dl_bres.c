@@ -67,6 +67,9 @@
 #include "rcbtrap.h"
 #include "rcbcntrl.h"
 #include "wclip.h"
+#include "taskh.h"
+#include "swtrace.h"
+#include "corejob.h"
 
 /*
  * Set of functions to modularise access to list of dx,dy deltas stored at
@@ -254,7 +257,9 @@ static uint8 dxylist_used(DXYLIST *dxy)
   return dxy->ndeltas;
 }
 
-static void dxylist_compact(DXYLIST *dxy, mm_pool_t pool)
+static void nbuild_shrink(nfill_builder_t *nbuild, size_t size);
+
+static void dxylist_compact(DXYLIST *dxy, nfill_builder_t *nbuild)
 {
   if ( dxy->ndeltas >= 2 ) {
     uint8 i, bits = 4; /* Assume 4 bits will do */
@@ -282,7 +287,7 @@ static void dxylist_compact(DXYLIST *dxy, mm_pool_t pool)
         dxdy8 = (int8)((dxdy32&0xf)+((dxdy32>>12)&0xf0));
         dp[i] = dxdy8;
       }
-      mm_dl_promise_shrink(pool, 3*dxy->ndeltas);
+      nbuild_shrink(nbuild, 3*dxy->ndeltas);
     }
     else { /* bits == 8 */
       for ( i = 0; i < dxy->ndeltas; i++ ) {
@@ -292,7 +297,7 @@ static void dxylist_compact(DXYLIST *dxy, mm_pool_t pool)
         dxdy16 = (int16)((dxdy32&0xff)+((dxdy32>>8)&0xff00));
         dp[i] = dxdy16;
       }
-      mm_dl_promise_shrink(pool, 2*dxy->ndeltas);
+      nbuild_shrink(nbuild, 2*dxy->ndeltas);
     }
   }
 }
@@ -307,9 +312,12 @@ static void dxylist_compact(DXYLIST *dxy, mm_pool_t pool)
  * ================
  */
 struct nfill_builder_t {
-  mm_pool_t pool;     /**< DL memory pool for threads. */
+  mm_pool_t pool;     /**< DL memory pool for threads, or NULL if building
+                           into a local buffer. */
   uint8 *promise;     /**< promise memory allocation for nfill object */
   size_t size;        /**< Size of promise memory to allocate */
+  uint8 *local_next;  /**< Next free byte of local buffer. */
+  uint8 *local_top;   /**< End of local buffer. */
   /* Fill variables. */
   NFILLOBJECT nfill;  /**< NFILL being built before its copied into DL. */
   Bool xyswapable;    /**< Should X and Y be swappable for this fill? */
@@ -357,6 +365,8 @@ size_t nfill_builder_size(void)
   return sizeof(nfill_builder_t);
 }
 
+static void init_nfill(nfill_builder_t *nbuild, uint32 flags);
+
 /**
  * Begin the creation of an nfill structure.
  * All the nfill state variables during creation are stored in the passed
@@ -373,6 +383,41 @@ void start_nfill(DL_STATE *page, nfill_builder_t *nbuild,
 
   nbuild->pool = dl_choosepool(page->dlpools, MM_ALLOC_CLASS_NFILL);
   nbuild->size = size;
+  init_nfill(nbuild, flags);
+}
+
+/**
+ * Begin the creation of a partial nfill in a local buffer, rather than in
+ * DL promise memory. The threads are left in the buffer for the caller to
+ * copy; running out of buffer space makes the path conversion fail without
+ * raising an error. This is used by worker tasks, which must not allocate
+ * DL memory.
+ * \param[in,out] nbuild  Pointer to structure holding nfill state
+ * \param[in]     buffer  Word-aligned buffer to build the threads in
+ * \param[in]     size    Size of the buffer
+ * \param[in]     flags   NFILL_* flags describing the path
+ */
+static void start_nfill_local(nfill_builder_t *nbuild, uint8 *buffer,
+                              size_t size, uint32 flags)
+{
+  HQASSERT(nbuild, "No NFILL builder");
+  HQASSERT(buffer != NULL && WORD_IS_ALIGNED(uintptr_t, buffer),
+           "Local NFILL buffer missing or unaligned");
+
+  nbuild->pool = NULL;
+  nbuild->size = size;
+  nbuild->local_next = buffer;
+  nbuild->local_top = buffer + size;
+  init_nfill(nbuild, flags);
+}
+
+/**
+ * Reset the thread and segment state of an nfill builder.
+ * \param[in,out] nbuild  Pointer to structure holding nfill state
+ * \param[in]     flags   NFILL_* flags describing the path
+ */
+static void init_nfill(nfill_builder_t *nbuild, uint32 flags)
+{
   nbuild->promise = NULL;
   nbuild->xyswapable = ((flags & NFILL_XYSWAP) != 0) ;
   nbuild->is_char    = ((flags & NFILL_ISCHAR) != 0) ;
@@ -404,11 +449,74 @@ void end_nfill(nfill_builder_t *nbuild)
   /* If something failed along the way, the builder's nfill pointer will not
      have been freed. */
   if ( nbuild->promise ) {
-    mm_dl_promise_free(nbuild->pool);
+    if ( nbuild->pool != NULL )
+      mm_dl_promise_free(nbuild->pool);
     nbuild->promise = NULL;
   }
 }
 
+/**
+ * Obtain the memory for the threads when the first thread is started. For
+ * DL promises, if the requested size cannot be had, halve it until it
+ * succeeds or drops below a minimum threshold.
+ * \param[in,out] nbuild  Pointer to structure holding nfill state
+ * \return                Success status
+ */
+static Bool nbuild_promise(nfill_builder_t *nbuild)
+{
+  if ( nbuild->pool == NULL ) /* Local buffer is already there. */
+    return TRUE;
+
+  while ( mm_dl_promise(nbuild->pool, nbuild->size) != MM_SUCCESS ) {
+    if ( nbuild->size < 4*sizeof(NFILLOBJECT) ) /* arbitrary lower limit */
+      return FALSE;
+    nbuild->size /= 2;
+    error_clear();
+  }
+  return TRUE;
+}
+
+/**
+ * Take the next piece of thread memory, with the same alignment rules as
+ * DL promises.
+ * \param[in,out] nbuild  Pointer to structure holding nfill state
+ * \param[in]     size    Number of bytes required
+ * \return                Memory allocated, or NULL if exhausted
+ */
+static void *nbuild_next(nfill_builder_t *nbuild, size_t size)
+{
+  uint8 *result;
+
+  if ( nbuild->pool != NULL )
+    return mm_dl_promise_next(nbuild->pool, size);
+
+  size = WORD_ALIGN_UP(size_t, size);
+  if ( (size_t)(nbuild->local_top - nbuild->local_next) < size )
+    return NULL;
+  result = nbuild->local_next;
+  nbuild->local_next += size;
+  return result;
+}
+
+/**
+ * Give back the unused end of the most recent piece of thread memory.
+ * \param[in,out] nbuild  Pointer to structure holding nfill state
+ * \param[in]     size    Number of bytes no longer required
+ */
+static void nbuild_shrink(nfill_builder_t *nbuild, size_t size)
+{
+  if ( nbuild->pool != NULL ) {
+    mm_dl_promise_shrink(nbuild->pool, size);
+    return;
+  }
+
+  size = (size_t)WORD_ALIGN_DOWN(size_t, size);
+  HQASSERT(nbuild->promise != NULL &&
+           nbuild->local_next - size >= nbuild->promise,
+           "Shrinking local NFILL buffer too far");
+  nbuild->local_next -= size;
+}
+
 /**
  * Determine the size in bytes occupied by the given NFILL
  * \param[in] nfill NFILL structure to measure
@@ -510,6 +618,24 @@ static void new_segment(nfill_builder_t *nbuild, dcoord sx, dcoord sy)
   nbuild->qon = TRUE;
 }
 
+/**
+ * Continue a subpath which is divided between builders, from the point
+ * where the previous piece of it ended. The next segment starts a new
+ * thread, just as it does when a thread's delta list fills up. Queueing is
+ * left off, since the end of the subpath is not converted by this builder.
+ * \param[in,out]  nbuild   NFILL and state
+ * \param[in]      sx       x ordinate
+ * \param[in]      sy       y ordinate
+ */
+static void resume_segment(nfill_builder_t *nbuild, dcoord sx, dcoord sy)
+{
+  new_segment(nbuild, sx, sy);
+  nbuild->nosegments = 1; /* Drop degenerate segments, as if continuing. */
+  nbuild->newsubpath = FALSE;
+  nbuild->queued = 0;
+  nbuild->qon = FALSE;
+}
+
 /**
  * Reverse the orientation of the given NBRESS thread.
  * If we only use word encoded threads, then they are fixed length and we
@@ -614,7 +740,7 @@ static void finish_nbressthread(nfill_builder_t *nbuild)
    * straight away anyway.
    */
   if ( !(nbuild->is_char) )
-    dxylist_compact(&(nbress->dxy), nbuild->pool);
+    dxylist_compact(&(nbress->dxy), nbuild);
 }
 
 /**
@@ -723,16 +849,9 @@ static Bool add_segment(nfill_builder_t *nbuild, dcoord nx, dcoord ny)
     nbuild->had_degen = (( dx | dy ) == 0 );
 
     if ( nbuild->promise == NULL ) { /* first thread */
-      /*
-       * Allocate the typical size promise we have requested. If this fails
-       * halve it until it succeeds or we drop below a minimum threshold.
-       */
-      while ( mm_dl_promise(nbuild->pool, nbuild->size) != MM_SUCCESS ) {
-        if ( nbuild->size < 4*sizeof(NFILLOBJECT) ) /* arbitrary lower limit */
-          return FALSE;
-        nbuild->size /= 2;
-        error_clear();
-      }
+      /* Allocate the typical size promise we have requested. */
+      if ( !nbuild_promise(nbuild) )
+        return FALSE;
     }
     else /* close off old thread. */
       finish_nbressthread(nbuild);
@@ -741,8 +860,7 @@ static Bool add_segment(nfill_builder_t *nbuild, dcoord nx, dcoord ny)
      * which you cannot declare in C. So its actually declared one int32 long
      * and we have to take that off the initial allocation.
      */
-    tbress = (NBRESS *)mm_dl_promise_next(nbuild->pool, sizeof(NBRESS) -
-                                          sizeof(int32));
+    tbress = (NBRESS *)nbuild_next(nbuild, sizeof(NBRESS) - sizeof(int32));
     if ( nbuild->promise == NULL ) /* Remember start of promise */
       nbuild->promise = (uint8 *)tbress;
     if ( tbress == NULL )
@@ -781,7 +899,7 @@ static Bool add_segment(nfill_builder_t *nbuild, dcoord nx, dcoord ny)
       nbress->nx2 = nx;
       nbress->ny2 = ny;
     } else {
-      if ( !mm_dl_promise_next(nbuild->pool, sizeof(int32)) )
+      if ( !nbuild_next(nbuild, sizeof(int32)) )
         return FALSE;
 
       /* Store (dx,dy) - may need to be reversed later. */
@@ -882,6 +1000,96 @@ static Bool final_segment(nfill_builder_t *nbuild)
   return TRUE;
 }
 
+/**
+ * Flatten one subpath, or a piece of one, converting it into NBRESS chains.
+ * \param[in] nbuild  NFILL plus state information
+ * \param[in] path    Subpath to be converted
+ * \param[in] from    Point the piece starts from, or NULL to start at the
+ *                    subpath's moveto
+ * \param[in] to      First point after the piece, or NULL to run to the end
+ *                    of the subpath
+ * \return            Success status
+ */
+static Bool addsubpath2_nfill(nfill_builder_t *nbuild, PATHLIST *path,
+                              LINELIST *from, LINELIST *to)
+{
+  LINELIST *line = path->subpath, *prev = NULL;
+  dcoord cx, cy;
+  SYSTEMVALUE sc_rnd = SC_PIXEL_ROUND;
+  FPOINT ctrl_pts[4];
+  int32 bezi, ltype;
+  Bool closed = TRUE;
+
+  HQASSERT(line->next != NULL, "Path must have at least a moveto and close");
+  if ( line->next->type != MYCLOSE ) { /* Check here for degenerate. */
+    if ( from != NULL ) {
+      SC_C2D_UNT_I(cx, from->point.x, sc_rnd);
+      SC_C2D_UNT_I(cy, from->point.y, sc_rnd);
+      resume_segment(nbuild, cx, cy);
+      closed = FALSE;
+      prev = from;
+      line = from->next;
+    }
+
+    while ( line != to ) {
+      SwOftenUnsafe();
+
+      ltype = line->type;
+      switch ( ltype ) {
+        case CURVETO:
+          HQASSERT(prev != NULL, "Path cannot start with a curveto");
+          ctrl_pts[0].x = prev->point.x + sc_rnd;
+          ctrl_pts[0].y = prev->point.y + sc_rnd;
+          for ( bezi = 1; bezi <= 3; bezi++ ) {
+            HQASSERT(line->type == CURVETO,
+              "Point in bezier should be a CURVETO");
+            ctrl_pts[bezi].x = line->point.x + sc_rnd;
+            ctrl_pts[bezi].y = line->point.y + sc_rnd;
+            if ( bezi != 3 )
+              line = line->next;
+          }
+          if ( !bezchop(ctrl_pts, bressbez_cb, nbuild, BEZ_POINTS|BEZ_CTRLS) )
+            return FALSE;
+          break;
+
+        case MOVETO:
+        case MYMOVETO:
+          HQASSERT(closed, "Moveto with closing previous path");
+          closed = FALSE;
+          SC_C2D_UNT_I(cx, line->point.x, sc_rnd);
+          SC_C2D_UNT_I(cy, line->point.y, sc_rnd);
+          new_segment(nbuild, cx, cy);
+          if ( to != NULL ) { /* Points queued now would never be replayed. */
+            nbuild->queued = 0;
+            nbuild->qon = FALSE;
+          }
+          break;
+
+        case LINETO:
+        case MYCLOSE:
+        case CLOSEPATH:
+          SC_C2D_UNT_I(cx, line->point.x, sc_rnd);
+          SC_C2D_UNT_I(cy, line->point.y, sc_rnd);
+          if ( !add_segment(nbuild, cx, cy) )
+            return FALSE;
+          if ( ltype != LINETO ) {
+            closed = TRUE;
+            if ( !final_segment(nbuild) )
+              return FALSE;
+          }
+          break;
+
+        default:
+          HQFAIL("Unknown segments type in path");
+          break;
+      }
+      prev = line;
+      line = line->next;
+    }
+  }
+  return TRUE;
+}
+
 /**
  * Flatten supplied path, converting it into a NBRESS chains.
  * \param[in] nbuild  NFILL plus state information
@@ -892,71 +1100,458 @@ Bool addpath2_nfill(nfill_builder_t *nbuild, PATHLIST *path)
 {
   HQASSERT(nbuild, "No NFILL builder");
 
-  while ( path ) {
-    LINELIST *line = path->subpath, *prev = NULL;
-    dcoord cx, cy;
-    SYSTEMVALUE sc_rnd = SC_PIXEL_ROUND;
-    FPOINT ctrl_pts[4];
-    int32 bezi, ltype;
-    Bool closed = TRUE;
-
-    HQASSERT(line->next != NULL, "Path must have at least a moveto and close");
-    if ( line->next->type != MYCLOSE ) { /* Check here for degenerate. */
-      while ( line ) {
-        SwOftenUnsafe();
-
-        ltype = line->type;
-        switch ( ltype ) {
-          case CURVETO:
-            HQASSERT(prev != NULL, "Path cannot start with a curveto");
-            ctrl_pts[0].x = prev->point.x + sc_rnd;
-            ctrl_pts[0].y = prev->point.y + sc_rnd;
-            for ( bezi = 1; bezi <= 3; bezi++ ) {
-              HQASSERT(line->type == CURVETO,
-                "Point in bezier should be a CURVETO");
-              ctrl_pts[bezi].x = line->point.x + sc_rnd;
-              ctrl_pts[bezi].y = line->point.y + sc_rnd;
-              if ( bezi != 3 )
-                line = line->next;
-            }
-            if ( !bezchop(ctrl_pts, bressbez_cb, nbuild, BEZ_POINTS|BEZ_CTRLS) )
-              return FALSE;
-            break;
-
-          case MOVETO:
-          case MYMOVETO:
-            HQASSERT(closed, "Moveto with closing previous path");
-            closed = FALSE;
-            SC_C2D_UNT_I(cx, line->point.x, sc_rnd);
-            SC_C2D_UNT_I(cy, line->point.y, sc_rnd);
-            new_segment(nbuild, cx, cy);
-            break;
-
-          case LINETO:
-          case MYCLOSE:
-          case CLOSEPATH:
-            SC_C2D_UNT_I(cx, line->point.x, sc_rnd);
-            SC_C2D_UNT_I(cy, line->point.y, sc_rnd);
-            if ( !add_segment(nbuild, cx, cy) )
-              return FALSE;
-            if ( ltype != LINETO ) {
-              closed = TRUE;
-              if ( !final_segment(nbuild) )
-                return FALSE;
-            }
-            break;
-
-          default:
-            HQFAIL("Unknown segments type in path");
-            break;
+  for ( ; path != NULL; path = path->next ) {
+    if ( !addsubpath2_nfill(nbuild, path, NULL, NULL) )
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * test to see if the clip flags indicate the NFILL is totally clipped
+ * \param[in]   clippedout   Clip flags
+ * \return                   Is the Nfill totally clipped ?
+ */
+static Bool totally_clipped(uint8 clippedout)
+{
+  int32 clipx = (clippedout & (CLIPPED_UNCLIPPED|CLIPPED_LEFT|CLIPPED_RIGHT));
+  int32 clipy = (clippedout & (CLIPPED_UNCLIPPED|CLIPPED_ABOVE|CLIPPED_BELOW));
+
+  return ( clipx == CLIPPED_LEFT || clipx == CLIPPED_RIGHT ||
+           clipy == CLIPPED_ABOVE || clipy == CLIPPED_BELOW );
+}
+
+/**
+ * Choose the scan conversion rule for an NFILL. If requested, initialise the
+ * scan conversion rule from the ScanConversion pagedev key. The pixel
+ * touching (Adobe rule) scan converter is selected by default otherwise.
+ * \param[in]   nbuild   NFILL record
+ * \return               Scan converter for the NFILL
+ */
+static uint8 nfill_converter(const nfill_builder_t *nbuild)
+{
+  if ( nbuild->is_char )
+    return UserParams.CharScanConversion;
+  else if ( nbuild->is_stroke )
+    return UserParams.StrokeScanConversion;
+  else
+    return gstateptr->thePDEVinfo.scanconversion;
+}
+
+/*
+ * Parallel NFILL construction
+ * ===========================
+ *
+ * The subpaths of a path are converted independently of each other: every
+ * subpath restarts the thread and queueing state of the builder, and the
+ * only state carried across subpaths is the accumulated clipping flags.
+ * Within a subpath, a thread may be broken at any point, as the builder
+ * already does when a thread's delta list fills up; only the queueing of
+ * the first thread's points, which lets the last thread absorb them, spans
+ * the whole subpath. So a large path is divided into runs of roughly equal
+ * weight, breaking large subpaths between path elements with queueing
+ * turned off, and each run is converted into a local buffer by a worker
+ * task. The interpreter then copies the threads into a single NFILL in DL
+ * memory, in the same order the serial builder would have produced them
+ * (latest thread first).
+ *
+ * Strokes do not come through here. The stroker generates its outline a
+ * piece at a time in one scratch buffer, and feeds each piece to a single
+ * builder before re-using the buffer, so there is never a whole outline to
+ * divide. The subpaths of a stroke are independent, but converting them in
+ * parallel would need an outline buffer and stroker state for each task.
+ */
+
+/** Paths with a smaller segment weight than this are converted serially. */
+#define NFILL_PARALLEL_MIN_WEIGHT 16384
+
+/** Minimum segment weight worth giving to a task. */
+#define NFILL_PARALLEL_PART_WEIGHT 4096
+
+/** Maximum number of parts a path is divided into. */
+#define NFILL_PARALLEL_MAX_PARTS 16
+
+/** Segment weight of each curveto point, allowing for flattening. */
+#define NFILL_CURVE_WEIGHT 8
+
+/** A run of path elements converted in one task. */
+typedef struct nfill_part_t {
+  nfill_builder_t nbuild; /**< Builder state for this part. */
+  PATHLIST *path;         /**< First subpath of the part. */
+  LINELIST *from;         /**< Point the part starts from, or NULL if it
+                               starts at the moveto of \c path. */
+  PATHLIST *endpath;      /**< Last subpath of the part. */
+  LINELIST *to;           /**< First point after the part, or NULL if it
+                               runs to the end of \c endpath. */
+  uint32 npieces;         /**< Number of subpaths the part touches. */
+  uint32 weight;          /**< Segment weight of the part. */
+  uint32 flags;           /**< NFILL_* flags for the builder. */
+  uint8 *buffer;          /**< Local buffer the threads are built in. */
+  size_t size;            /**< Size of the local buffer. */
+  Bool done;              /**< Was the part converted successfully? */
+} nfill_part_t;
+
+/**
+ * Estimate the number of flattened segments in a subpath.
+ * \param[in] path   Subpath to measure
+ * \return           Segment weight of the subpath
+ */
+static uint32 subpath_weight(const PATHLIST *path)
+{
+  const LINELIST *line;
+  uint32 weight = 0;
+
+  for ( line = path->subpath; line != NULL; line = line->next )
+    weight += (line->type == CURVETO) ? NFILL_CURVE_WEIGHT : 1;
+
+  return weight;
+}
+
+/**
+ * Find the extent and segment weight of the path element starting at a
+ * point. A curve is three points long; every other element is one point.
+ * \param[in]  line   First point of the element
+ * \param[out] last   Last point of the element
+ * \return            Segment weight of the element
+ */
+static uint32 element_weight(LINELIST *line, LINELIST **last)
+{
+  if ( line->type == CURVETO ) {
+    HQASSERT(line->next != NULL && line->next->next != NULL,
+             "Curve should have three points");
+    *last = line->next->next;
+    return 3 * NFILL_CURVE_WEIGHT;
+  }
+
+  *last = line;
+  return 1;
+}
+
+/**
+ * Convert a part's subpaths into threads in its local buffer. This is
+ * called from worker tasks, so must not touch the DL, raise errors, or
+ * modify the path.
+ * \param[in,out] part   Part to convert
+ * \return               FALSE if the local buffer was too small
+ */
+static Bool nfill_part_build(nfill_part_t *part)
+{
+  nfill_builder_t *nbuild = &part->nbuild;
+  PATHLIST *path;
+
+  start_nfill_local(nbuild, part->buffer, part->size, part->flags);
+  for ( path = part->path; ; path = path->next ) {
+    HQASSERT(path != NULL, "Ran out of subpaths for NFILL part");
+    if ( !addsubpath2_nfill(nbuild, path,
+                            path == part->path ? part->from : NULL,
+                            path == part->endpath ? part->to : NULL) )
+      return FALSE;
+    if ( path == part->endpath )
+      break;
+  }
+
+  HQASSERT(nbuild->queued == 0, "Still have nfill co-ords queued-up");
+  if ( nbuild->nfill.nthreads > 0 )
+    finish_nbressthread(nbuild);
+
+  return TRUE;
+}
+
+/** Task function to convert one part of a large path. */
+static Bool nfill_part_task(corecontext_t *context, void *args)
+{
+  nfill_part_t *part = args;
+
+  UNUSED_PARAM(corecontext_t *, context);
+
+  part->done = nfill_part_build(part);
+  return TRUE;
+}
+
+/**
+ * Allocate the local buffer for a part.
+ * \param[in,out] part   Part to allocate buffer for
+ * \param[in]     size   Size of buffer required
+ * \return               Success status. No error is raised on failure.
+ */
+static Bool nfill_part_alloc(nfill_part_t *part, size_t size)
+{
+  size = WORD_ALIGN_UP(size_t, size);
+  if ( part->buffer != NULL )
+    mm_free(mm_pool_temp, part->buffer, part->size);
+  part->size = size;
+  part->buffer = mm_alloc(mm_pool_temp, size, MM_ALLOC_CLASS_NFILL);
+  return part->buffer != NULL;
+}
+
+/**
+ * Copy the threads of all parts into one NFILL in DL memory.
+ * \param[in]  page      DL page to allocate the NFILL in
+ * \param[in]  parts     Converted parts
+ * \param[in]  nparts    Number of parts
+ * \param[out] nfillptr  Where to return the NFILL, NULL if degenerate
+ * \return               Success status. No error is raised on failure.
+ */
+static Bool nfill_parts_merge(DL_STATE *page, nfill_part_t *parts,
+                              uint32 nparts, NFILLOBJECT **nfillptr)
+{
+  NFILLOBJECT *nfill;
+  NBRESS *nbress;
+  uint8 *base, clippedout = 0;
+  size_t chainsize = 0;
+  int32 nthreads = 0, thd;
+  uint32 i;
+
+  for ( i = 0; i < nparts; ++i ) {
+    HQASSERT(parts[i].done, "Merging NFILL part that was not converted");
+    clippedout |= parts[i].nbuild.nfill.clippedout;
+    nthreads += parts[i].nbuild.nfill.nthreads;
+    for ( nbress = parts[i].nbuild.fnbress; nbress != NULL;
+          nbress = nbress->u1.next )
+      chainsize += sizeof_nbress(nbress);
+  }
+
+  /* Nothing to do if no threads or nfill totally clipped. */
+  if ( nthreads == 0 || totally_clipped(clippedout) )
+    return TRUE;
+
+  nfill = nfill_preallocate(page, chainsize, nthreads, 0,
+                            nfill_converter(&parts[0].nbuild));
+  if ( nfill == NULL )
+    return FALSE;
+
+  /* Later parts' threads come first, as they would have been the most
+     recently built by the serial builder. Only the used part of each thread
+     is copied; the thread may not have been extended to pointer alignment
+     in the local buffer. */
+  base = (uint8 *)nfill->thread[0];
+  thd = 0;
+  for ( i = nparts; i-- > 0; ) {
+    for ( nbress = parts[i].nbuild.fnbress; nbress != NULL;
+          nbress = nbress->u1.next ) {
+      size_t size = sizeof(NBRESS) - sizeof(int32) +
+        (nbress->dxy.ndeltas * nbress->dxy.deltabits >> 2);
+      HqMemCpy(base, nbress, size);
+      nfill->thread[thd] = (NBRESS *)base;
+      if ( thd > 0 )
+        nfill->thread[thd - 1]->u1.next = nfill->thread[thd];
+      ++thd;
+      base += SIZE_ALIGN_UP_P2(size, sizeof(NBRESS *));
+    }
+  }
+  HQASSERT(thd == nthreads, "NFILL thread count changed while merging");
+  HQASSERT(base == (uint8 *)nfill, "NFILL chains didn't match header");
+  nfill->thread[thd - 1]->u1.next = NULL;
+
+  nfill->nthreads   = nthreads;
+  nfill->clippedout = clippedout;
+  nfill->y1clip     = cclip_bbox.y1;
+
+  *nfillptr = nfill;
+  track_dl(sizeof_nfill(nfill), MM_ALLOC_CLASS_NFILL, TRUE);
+
+  return TRUE;
+}
+
+/**
+ * Decide whether a failure setting up parallel conversion can fall back to
+ * serial conversion. Only running out of memory is recoverable; any other
+ * error (e.g. an interrupt) must be propagated.
+ * \param[in] context  Core context of the interpreter
+ * \return             TRUE if the caller should convert serially, FALSE if
+ *                     the signalled error should be propagated.
+ */
+static Bool nfill_parallel_fallback(corecontext_t *context)
+{
+  if ( !error_signalled_context(context->error) )
+    return TRUE;
+  if ( error_latest_context(context->error) != VMERROR )
+    return FALSE;
+  error_clear_context(context->error);
+  return TRUE;
+}
+
+/**
+ * Try to convert a large path into an NFILL by dividing it between worker
+ * tasks.
+ * \param[in]  page      DL page the NFILL is for
+ * \param[in]  path      Path to be converted
+ * \param[in]  flags     Origin and nature of path being processed
+ * \param[out] nfillptr  Pointer to resulting NFILL object
+ * \param[out] result    Success status, if the path was handled
+ * \return               TRUE if the path was handled, FALSE if the caller
+ *                       should convert it serially. No error is signalled
+ *                       if FALSE is returned.
+ */
+static Bool make_nfill_parallel(DL_STATE *page, PATHLIST *path, uint32 flags,
+                                NFILLOBJECT **nfillptr, Bool *result)
+{
+  corecontext_t *context = get_core_context_interp();
+  nfill_part_t *parts, *part;
+  task_group_t *group = NULL;
+  PATHLIST *sub, *lastsub = NULL;
+  uint32 i, nparts, nused, weight = 0, done, limit;
+  Bool handled = FALSE, interrupted = FALSE;
+
+  *result = TRUE;
+
+  if ( !IS_INTERPRETER() || page->job == NULL ||
+       page->job->task_group == NULL || (flags & NFILL_ISCHAR) != 0 )
+    return FALSE;
+
+  for ( sub = path; sub != NULL; sub = sub->next ) {
+    weight += subpath_weight(sub);
+    lastsub = sub;
+  }
+
+  if ( weight < NFILL_PARALLEL_MIN_WEIGHT )
+    return FALSE;
+
+  nparts = (uint32)max_simultaneous_tasks();
+  if ( nparts > NFILL_PARALLEL_MAX_PARTS )
+    nparts = NFILL_PARALLEL_MAX_PARTS;
+  if ( nparts > weight / NFILL_PARALLEL_PART_WEIGHT )
+    nparts = weight / NFILL_PARALLEL_PART_WEIGHT;
+  if ( nparts < 2 )
+    return FALSE;
+
+  parts = mm_alloc(mm_pool_temp, nparts * sizeof(nfill_part_t),
+                   MM_ALLOC_CLASS_NFILL);
+  if ( parts == NULL ) {
+    if ( nfill_parallel_fallback(context) )
+      return FALSE;
+    *result = FALSE;
+    return TRUE;
+  }
+
+  /* Divide the path into runs of roughly equal weight. A part ends after
+     the element that takes it past its share, so a large subpath is divided
+     between parts, but never in the middle of a curve. The last part takes
+     whatever is left. */
+  part = NULL;
+  nused = done = 0;
+  limit = weight / nparts;
+  for ( sub = path; sub != NULL; sub = sub->next ) {
+    LINELIST *line, *last = NULL;
+
+    if ( part != NULL )
+      ++part->npieces;
+
+    for ( line = sub->subpath; line != NULL; line = last->next ) {
+      LINELIST *prev = last;
+      uint32 w = element_weight(line, &last);
+
+      if ( part == NULL ) {
+        part = &parts[nused++];
+        part->path = sub;
+        part->from = prev;
+        part->npieces = 1;
+        part->weight = 0;
+        part->flags = flags;
+        part->buffer = NULL;
+        part->size = 0;
+        part->done = FALSE;
+      }
+
+      part->weight += w;
+      done += w;
+
+      if ( done >= limit && nused < nparts ) {
+        part->endpath = sub;
+        part->to = last->next;
+        part = NULL;
+        limit += weight / nparts;
+      }
+    }
+  }
+  if ( part != NULL ) {
+    part->endpath = lastsub;
+    part->to = NULL;
+  }
+  HQASSERT(nused == nparts, "Path not divided between all parts");
+
+  /* Most segments extend an existing thread by one delta; allow for a few
+     new threads per subpath as well. */
+  for ( i = 0; i < nparts; ++i ) {
+    part = &parts[i];
+
+    if ( !nfill_part_alloc(part, part->weight * sizeof(int32) +
+                           (part->npieces * 4 + 4) * sizeof(NBRESS)) )
+      goto cleanup;
+  }
+
+  /* The interpreter converts the first part itself, while tasks convert
+     the rest. Parts that could not be started as tasks, or that ran out of
+     buffer, are (re-)converted below. */
+  if ( task_group_create(&group, TASK_GROUP_NFILL,
+                         page->job->task_group, NULL) ) {
+    task_group_ready(group);
+    for ( i = 1; i < nparts; ++i ) {
+      task_t *task;
+
+      if ( !task_create(&task, NULL /*specialiser*/, NULL /*spec args*/,
+                        &nfill_part_task, &parts[i], NULL /*cleanup*/,
+                        group, SW_TRACE_NFILL_BUILD) ) {
+        if ( !nfill_parallel_fallback(context) ) {
+          task_group_cancel(group, error_latest_context(context->error));
+          interrupted = TRUE;
         }
-        prev = line;
-        line = line->next;
+        break;
       }
+      task_ready(task);
+      task_release(&task);
     }
-    path = path->next;
+    task_group_close(group);
+  } else if ( !nfill_parallel_fallback(context) ) {
+    interrupted = TRUE;
+    goto cleanup;
   }
-  return TRUE;
+
+  if ( !interrupted )
+    parts[0].done = nfill_part_build(&parts[0]);
+
+  if ( group != NULL ) {
+    /* The task group can only fail if it was cancelled, in which case the
+       error is propagated to the caller. */
+    if ( !task_group_join(group, context->error) )
+      interrupted = TRUE;
+    task_group_release(&group);
+  }
+
+  if ( interrupted )
+    goto cleanup;
+
+  for ( i = 0; i < nparts; ++i ) {
+    part = &parts[i];
+
+    while ( !part->done ) {
+      if ( part->size * 2 < part->size ||
+           !nfill_part_alloc(part, part->size * 2) )
+        goto cleanup;
+      part->done = nfill_part_build(part);
+    }
+  }
+
+  handled = nfill_parts_merge(page, parts, nparts, nfillptr);
+
+cleanup:
+  for ( i = 0; i < nparts; ++i ) {
+    if ( parts[i].buffer != NULL )
+      mm_free(mm_pool_temp, parts[i].buffer, parts[i].size);
+  }
+  mm_free(mm_pool_temp, parts, nparts * sizeof(nfill_part_t));
+
+  if ( interrupted ) {
+    *result = FALSE;
+    return TRUE;
+  }
+
+  if ( !handled && !nfill_parallel_fallback(context) ) {
+    *result = FALSE;
+    return TRUE;
+  }
+
+  return handled;
 }
 
 /**
@@ -976,7 +1571,7 @@ Bool make_nfill(DL_STATE *page, PATHLIST *path, uint32 flags,
                 NFILLOBJECT **nfillptr)
 {
   Bool result = FALSE;
-  Bool wasHuge = FALSE;
+  Bool wasHuge = FALSE, parallel = FALSE;
   size_t promisesize;
   PATHINFO reducedpath;
 
@@ -1023,7 +1618,10 @@ Bool make_nfill(DL_STATE *page, PATHLIST *path, uint32 flags,
    * return success or vmerror if we ran out of retries (or if we
    * reduced memory to get the initial promise and still failed).
    */
-  for ( promisesize = 25 * 1024; !result; promisesize *= 2 ) {
+  if ( make_nfill_parallel(page, path, flags, nfillptr, &result) )
+    parallel = TRUE;
+
+  for ( promisesize = 25 * 1024; !parallel && !result; promisesize *= 2 ) {
     nfill_builder_t nbuild;
 
     start_nfill(page, &nbuild, promisesize, flags);
@@ -1045,21 +1643,10 @@ Bool make_nfill(DL_STATE *page, PATHLIST *path, uint32 flags,
   if (wasHuge)
     path_free_list(reducedpath.firstpath, mm_pool_temp);
 
-  return result ? TRUE : error_handler(VMERROR);
-}
-
-/**
- * test to see if the clip flags indicate the NFILL is totally clipped
- * \param[in]   clippedout   Clip flags
- * \return                   Is the Nfill totally clipped ?
- */
-static Bool totally_clipped(uint8 clippedout)
-{
-  int32 clipx = (clippedout & (CLIPPED_UNCLIPPED|CLIPPED_LEFT|CLIPPED_RIGHT));
-  int32 clipy = (clippedout & (CLIPPED_UNCLIPPED|CLIPPED_ABOVE|CLIPPED_BELOW));
-
-  return ( clipx == CLIPPED_LEFT || clipx == CLIPPED_RIGHT ||
-           clipy == CLIPPED_ABOVE || clipy == CLIPPED_BELOW );
+  /* A failed parallel conversion has already signalled its error. */
+  if ( !result && !parallel )
+    return error_handler(VMERROR);
+  return result;
 }
 
 /**
@@ -1077,6 +1664,7 @@ Bool complete_nfill(nfill_builder_t *nbuild, NFILLOBJECT **nfillptr)
   int32 thd;
 
   HQASSERT(nbuild, "No NFILL builder");
+  HQASSERT(nbuild->pool != NULL, "Cannot complete a local NFILL");
   HQASSERT(nfillptr, "Nowhere to put nfill");
   *nfillptr = NULL;
 
@@ -1114,16 +1702,7 @@ Bool complete_nfill(nfill_builder_t *nbuild, NFILLOBJECT **nfillptr)
   nfill->nexty      = MAXDCOORD; /* Forces initialisation first time round */
   nfill->y1clip     = cclip_bbox.y1;
 
-  /* If requested, initialise the scan conversion rule from the
-   * ScanConversion pagedev key. The pixel touching (Adobe rule) scan
-   * converter is selected by default otherwise.
-   */
-  if ( nbuild->is_char )
-    nfill->converter = UserParams.CharScanConversion;
-  else if ( nbuild->is_stroke )
-    nfill->converter = UserParams.StrokeScanConversion;
-  else
-    nfill->converter = gstateptr->thePDEVinfo.scanconversion;
+  nfill->converter  = nfill_converter(nbuild);
 
   /* Followed by fix up of the threads. */
   for ( thd = 0, nbress = nbuild->fnbress; nbress; nbress = nbress->u1.next )
@@ -1528,6 +1528,15 @@ static Bool dl_image_end(IMAGEARGS *imageargs, IMAGEDATA *imagedata,
       goto ENDIMAGE ;
   }
 
+  /* Repeated images on the page can use a single copy of their data. */
+  if ( (imageobj->ims != NULL &&
+        !im_storeshare(&imageobj->ims, &imageobj->imsbbox)) ||
+       (imageobj->mask != NULL && imageobj->mask->ims != NULL &&
+        !im_storeshare(&imageobj->mask->ims, &imageobj->mask->imsbbox)) ) {
+    result = FALSE;
+    goto ENDIMAGE;
+  }
+
   /* Reinstate previous color to get planes right in lobj */
   dlc_current = dlc_currentcolor(imagedata->page->dlc_context);
   dlc_copy_release(imagedata->page->dlc_context, dlc_current,
@@ -2852,6 +2861,10 @@ static Bool im_createimageobj( int32 colorType,
       imflags |= IMS_ROWREPEATS_NEAR;
     if ( imageargs->downsample.rowrepeats_2rows )
       imflags |= IMS_ROWREPEATS_2ROWS;
+    /* Recombine merges and reorders the planes of preseparated stores, so
+       they can't be shared. */
+    if ( !presep && !rcbn_intercepting() )
+      imflags |= IMS_SHAREABLE;
 
     imageobj->ims = im_storeopen(imagedata->page->im_shared,
                                  &imageobj->imsbbox, planes, bpp, imflags);
@@ -109,5 +109,68 @@ void free_n_dlrefs(DLREF *head, int32 n, mm_pool_t dlpools[N_DL_POOLS])
   dl_free(dlpools, head, sizeof(DLREF) * n, MM_ALLOC_CLASS_DLREF);
 }
 
+/** Cost of any DL object, however little of the band it covers. */
+#define DLREF_COST_OBJECT 64
+
+/** Shift converting band area covered by an image-like object to cost. */
+#define DLREF_COST_AREA_SHIFT 4
+
+/**
+ * Estimate the cost of rendering the DL objects in a chain within a band.
+ *
+ * Every object has a fixed cost. Images, shaded fills, sub-DLs and groups
+ * also cost the area of the band they cover, scaled down, because their
+ * render time is dominated by per-pixel work. A group is counted four times
+ * over, since it may need its own backdrop and compositing. Containers
+ * purged to disk only know how many objects they hold.
+ */
+uint32 dlref_render_cost(DLREF *dlref, const dbbox_t *bbox)
+{
+  uint32 cost = 0 ;
+
+  HQASSERT(bbox != NULL, "No band bbox for DL cost") ;
+
+  for ( ; dlref != NULL ; dlref = dlref->next ) {
+    uint32 objcost = DLREF_COST_OBJECT ;
+
+    if ( !dlref->inMemory ) {
+      objcost *= dlref->nobjs ;
+    } else if ( dlref->dl.lobj != NULL ) {
+      LISTOBJECT *lobj = dlref->dl.lobj ;
+
+      switch ( lobj->opcode ) {
+      case RENDER_image:
+      case RENDER_vignette:
+      case RENDER_gouraud:
+      case RENDER_shfill:
+      case RENDER_shfill_patch:
+      case RENDER_hdl:
+      case RENDER_backdrop:
+      case RENDER_group: {
+        dbbox_t cover ;
+
+        bbox_intersection(&lobj->bbox, bbox, &cover) ;
+        if ( !bbox_is_empty(&cover) ) {
+          uint32 area = (uint32)(cover.x2 - cover.x1 + 1) *
+                        (uint32)(cover.y2 - cover.y1 + 1) ;
+
+          area >>= DLREF_COST_AREA_SHIFT ;
+          if ( lobj->opcode == RENDER_group )
+            area = area > MAXUINT32 / 4 ? MAXUINT32 : area * 4 ;
+          objcost = area > MAXUINT32 - objcost ? MAXUINT32 : objcost + area ;
+        }
+        break ;
+      }
+      }
+    }
+
+    if ( objcost > MAXUINT32 - cost )
+      return MAXUINT32 ;
+    cost += objcost ;
+  }
+
+  return cost ;
+}
+
 /*
 * Log stripped */
@@ -51,6 +51,8 @@
 #include "forms.h"
 #include "vndetect.h"
 #include "dl_store.h"
+#include "pathops.h"                /* bbox_transform */
+#include "jobmetrics.h"             /* dl_metrics() */
 
 
 /* Keep track of the innermost form HDL under construction, and preserve it and
@@ -228,6 +230,27 @@ static Bool form_exec_paintproc( corecontext_t *context ,
   return result ;
 }
 
+/** Test if a form's BBox, transformed to device space by the form CTM, misses
+ * the current clip entirely. The comparison allows a couple of pixels slack,
+ * so that rounding and centre-of-pixel rules can't make us discard a form
+ * which would have touched a pixel on the clip boundary. */
+Bool form_clipped_out(const sbbox_t *bbox, OMATRIX *ctm)
+{
+  sbbox_t devbbox ;
+  const dbbox_t *clip = &thegsPageClip(*gstateptr).bounds ;
+
+  if ( degenerateClipping )
+    return TRUE ;
+
+  if ( bbox->x1 > bbox->x2 || bbox->y1 > bbox->y2 )
+    return FALSE ; /* Leave odd BBoxes to the normal code path. */
+
+  bbox_transform(bbox, &devbbox, ctm) ;
+
+  return (devbbox.x2 < clip->x1 - 2.0 || devbbox.x1 > clip->x2 + 2.0 ||
+          devbbox.y2 < clip->y1 - 2.0 || devbbox.y1 > clip->y2 + 2.0) ;
+}
+
 /* ----------------------------------------------------------------------------
    function:            execform_()                   author:   John Sturdy
    creation date:       1-July-1991        last modification:   ##-###-####
@@ -328,6 +351,27 @@ Bool gs_execform( corecontext_t *context, STACK *stack )
   userparams->RecombineObject = 0;
 #define return USE_goto_cleanup!
 
+  /* The PaintProc may legitimately not be executed at all, since forms can be
+     cached. If the form's bounds are entirely outside the current clip there
+     is nothing it could mark, so don't run it. HDLT has to see every form, so
+     it always gets the PaintProc run. */
+  if ( !isHDLTEnabled(*gstateptr) &&
+       form_clipped_out(&bbox, &ctm) ) {
+#ifdef METRICS_BUILD
+    dl_metrics()->forms.clippedOut++;
+#endif
+    /* A PostScript PaintProc consumes the form dictionary, so do that for
+       it. PDF callers pop their own stack after gs_execform. */
+    if ( stack == &operandstack )
+      pop(stack) ;
+    result = TRUE;
+    goto cleanup;
+  }
+
+#ifdef METRICS_BUILD
+  dl_metrics()->forms.executed++;
+#endif
+
   if ( !form_exec_paintproc( context, theo , formId ,
                              formdictmatch[ form_PaintProc ].result ,
                              & ctm , & bbox , & hdl ) )
@@ -482,6 +482,9 @@ static Bool im_adj_setup_new_imstore(IMAGEOBJECT *imageobj,
   IMAGEDATA *imagedata = &im_adj_data->imagedata ;
   const ibbox_t *bbox ;
 
+  /* The flips and swap are disabled whilst the original data is read. The
+     store may be shared with other images, so im_adj_finish_imstore puts the
+     flags back on it unless it is recycled. */
   im_adj_data->ims_flags = im_storegetflags(imageobj->ims);
   im_storesetflags(imageobj->ims,
                    im_adj_data->ims_flags & ~(IMS_XFLIP|IMS_YFLIP|IMS_XYSWAP));
@@ -495,8 +498,10 @@ static Bool im_adj_setup_new_imstore(IMAGEOBJECT *imageobj,
        bpp == im_storebpp(imageobj->ims) ) {
     Bool recycled;
 
-    if ( !im_storerecycle(imageobj->ims, planes, &recycled) )
+    if ( !im_storerecycle(imageobj->ims, planes, &recycled) ) {
+      im_storesetflags(imageobj->ims, im_adj_data->ims_flags);
       return FALSE;
+    }
 
     if ( recycled ) {
       *image_ims = imageobj->ims ;
@@ -510,8 +515,10 @@ static Bool im_adj_setup_new_imstore(IMAGEOBJECT *imageobj,
 
   /* Create new store for the image color adjusted, recombined, data */
   *image_ims = im_storeopen(imagedata->page->im_shared, bbox, planes, bpp, 0);
-  if ( *image_ims == NULL )
+  if ( *image_ims == NULL ) {
+    im_storesetflags(imageobj->ims, im_adj_data->ims_flags);
     return error_handler( VMERROR ) ;
+  }
 
   return TRUE ;
 }
@@ -523,6 +530,10 @@ static Bool im_adj_finish_imstore(IM_ADJ_DATA *im_adj_data,
 {
   result = result && im_storeclose(image_ims);
 
+  /* Put the original store back as it was, whether or not it was recycled;
+     other images may still be sharing it. */
+  im_storesetflags(imageobj->ims, im_adj_data->ims_flags);
+
   if ( !result ) {
     if ( imageobj->ims != image_ims )
       im_storefree(image_ims);
@@ -495,6 +495,32 @@ static inline void split_16_to_8x2(uint16 val, uint8 *dst, unsigned int stride)
 #endif
 }
 
+/** Pack four 8-bit values into a 32-bit value, so that storing it puts them
+    in memory in argument order. This is the inverse of split_32_to_8x4. */
+static inline uint32 pack_8x4_to_32(uint8 v0, uint8 v1, uint8 v2, uint8 v3)
+{
+#ifdef highbytefirst
+  return ((uint32)v0 << 24) | ((uint32)v1 << 16) | ((uint32)v2 << 8) | v3 ;
+#else
+  return ((uint32)v3 << 24) | ((uint32)v2 << 16) | ((uint32)v1 << 8) | v0 ;
+#endif
+}
+
+/** Pack two 8-bit values into a 16-bit value, so that storing it puts them
+    in memory in argument order. This is the inverse of split_16_to_8x2. */
+static inline uint16 pack_8x2_to_16(uint8 v0, uint8 v1)
+{
+#ifdef highbytefirst
+  return (uint16)((v0 << 8) | v1) ;
+#else
+  return (uint16)((v1 << 8) | v0) ;
+#endif
+}
+
+/** Minimum number of input bytes for which the 4->8 planar expander builds
+    a LUT of sample pairs, rather than looking up each sample. */
+#define IM_EXPAND_PAIR_LUT_MIN 512
+
 /* -------------------------------------------------------------------------- */
 
 void im_expand_colorinfo_free(DL_STATE *page, Bool otf_possible)
@@ -3493,6 +3519,7 @@ static Bool im_expand1to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
                            unsigned int expanded_comps, corecontext_t *context)
 {
   uint8 *dst, *lut ;
+  uint32 nibbles[16] ;
 
   HQASSERT(offset < expanded_comps, "Expanded channel out of range") ;
   HQASSERT(plane >= 0 && plane < ime->lplanes, "Plane doesn't have LUT") ;
@@ -3503,6 +3530,15 @@ static Bool im_expand1to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
   lut = (uint8 *)ime->expluts[plane] ;
   HQASSERT(lut != NULL, "Plane doesn't have LUT") ;
 
+  if ( expanded_comps == 1 ) {
+    /* Planar output stores each nibble's four samples as one word, so make
+       a table of those words from the two LUT values. */
+    uint32 i ;
+    for ( i = 0 ; i < 16 ; ++i )
+      nibbles[i] = pack_8x4_to_32(lut[(i >> 3) & 1], lut[(i >> 2) & 1],
+                                  lut[(i >> 1) & 1], lut[i & 1]) ;
+  }
+
   if ( ime->iplanes == 1 )
     plane = 0 ;
 
@@ -3521,18 +3557,15 @@ static Bool im_expand1to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
     if ( expanded_comps == 1 ) { /* Planar output */
       int32 nbytes = bytes ;
 
+      HQASSERT(((uintptr_t)dst & 3) == 0,
+               "Destination pointer is not 32-bit aligned") ;
       do {
         uint8 cval = src[ 0 ] ;
+        uint32 *dst32 = (uint32 *)dst ;
         PENTIUM_CACHE_LOAD( dst + 7 ) ;
-        dst[ 0 ] = lut[ ( cval >> 7 ) & 0x01 ] ;
-        dst[ 1 ] = lut[ ( cval >> 6 ) & 0x01 ] ;
-        dst[ 2 ] = lut[ ( cval >> 5 ) & 0x01 ] ;
-        dst[ 3 ] = lut[ ( cval >> 4 ) & 0x01 ] ;
-        dst[ 4 ] = lut[ ( cval >> 3 ) & 0x01 ] ;
-        dst[ 5 ] = lut[ ( cval >> 2 ) & 0x01 ] ;
-        dst[ 6 ] = lut[ ( cval >> 1 ) & 0x01 ] ;
-        dst[ 7 ] = lut[ ( cval >> 0 ) & 0x01 ] ;
-        dst += 8 ;
+        dst32[ 0 ] = nibbles[ ( cval >> 4 ) & 0x0f ] ;
+        dst32[ 1 ] = nibbles[ ( cval >> 0 ) & 0x0f ] ;
+        dst = (uint8 *)(dst32 + 2) ;
         src += 1 ;
       } while ( --nbytes > 0 ) ;
     } else { /* Interleaved output */
@@ -3833,6 +3866,7 @@ static Bool im_expand2to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
                            unsigned int expanded_comps)
 {
   uint8 *dst, *lut ;
+  uint16 nibbles[16] ;
 
   HQASSERT(offset < expanded_comps, "Expanded channel out of range") ;
   HQASSERT(plane >= 0 && plane < ime->lplanes, "Plane doesn't have LUT") ;
@@ -3843,6 +3877,14 @@ static Bool im_expand2to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
   lut = (uint8 *)ime->expluts[plane] ;
   HQASSERT(lut != NULL, "Plane doesn't have LUT") ;
 
+  if ( expanded_comps == 1 ) {
+    /* Planar output stores each nibble's two samples together, so make a
+       table of them from the four LUT values. */
+    uint32 i ;
+    for ( i = 0 ; i < 16 ; ++i )
+      nibbles[i] = pack_8x2_to_16(lut[(i >> 2) & 3], lut[i & 3]) ;
+  }
+
   if ( ime->iplanes == 1 )
     plane = 0 ;
 
@@ -3861,14 +3903,15 @@ static Bool im_expand2to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
     if ( expanded_comps == 1 ) { /* Planar output */
       int32 nbytes = bytes ;
 
+      HQASSERT(((uintptr_t)dst & 1) == 0,
+               "Destination pointer is not 16-bit aligned") ;
       do {
         uint8 cval = src[ 0 ] ;
+        uint16 *dst16 = (uint16 *)dst ;
         PENTIUM_CACHE_LOAD( dst + 3 ) ;
-        dst[ 0 ] = lut[ ( cval >> 6 ) & 0x03 ] ;
-        dst[ 1 ] = lut[ ( cval >> 4 ) & 0x03 ] ;
-        dst[ 2 ] = lut[ ( cval >> 2 ) & 0x03 ] ;
-        dst[ 3 ] = lut[ ( cval >> 0 ) & 0x03 ] ;
-        dst += 4 ;
+        dst16[ 0 ] = nibbles[ ( cval >> 4 ) & 0x0f ] ;
+        dst16[ 1 ] = nibbles[ ( cval >> 0 ) & 0x0f ] ;
+        dst = (uint8 *)(dst16 + 2) ;
         src += 1 ;
       } while ( --nbytes > 0 ) ;
     } else { /* Interleaved output */
@@ -4139,6 +4182,8 @@ static Bool im_expand4to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
                            unsigned int expanded_comps)
 {
   uint8 *dst, *lut ;
+  uint16 pairs[256] ;
+  Bool use_pairs = FALSE ;
 
   HQASSERT(offset < expanded_comps, "Expanded channel out of range") ;
   HQASSERT(plane >= 0 && plane < ime->lplanes, "Plane doesn't have LUT") ;
@@ -4149,6 +4194,15 @@ static Bool im_expand4to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
   lut = (uint8 *)ime->expluts[plane] ;
   HQASSERT(lut != NULL, "Plane doesn't have LUT") ;
 
+  if ( expanded_comps == 1 && n >= IM_EXPAND_PAIR_LUT_MIN ) {
+    /* Long planar rows are worth a table giving both samples of each input
+       byte, so they can be stored together. */
+    uint32 i ;
+    for ( i = 0 ; i < 256 ; ++i )
+      pairs[i] = pack_8x2_to_16(lut[(i >> 4) & 0x0f], lut[i & 0x0f]) ;
+    use_pairs = TRUE ;
+  }
+
   if ( ime->iplanes == 1 )
     plane = 0 ;
 
@@ -4164,7 +4218,28 @@ static Bool im_expand4to8(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims,
     if ( bytes > n )
       bytes = n ;
 
-    if ( expanded_comps == 1 ) { /* Planar output */
+    if ( use_pairs ) { /* Planar output, paired samples */
+      int32 nbytes = bytes ;
+
+      HQASSERT(((uintptr_t)dst & 1) == 0,
+               "Destination pointer is not 16-bit aligned") ;
+      while ( (nbytes -= 4) >= 0 ) {
+        uint16 *dst16 = (uint16 *)dst ;
+        PENTIUM_CACHE_LOAD( dst + 7 ) ;
+        dst16[ 0 ] = pairs[ src[ 0 ] ] ;
+        dst16[ 1 ] = pairs[ src[ 1 ] ] ;
+        dst16[ 2 ] = pairs[ src[ 2 ] ] ;
+        dst16[ 3 ] = pairs[ src[ 3 ] ] ;
+        dst = (uint8 *)(dst16 + 4) ;
+        src += 4 ;
+      }
+      nbytes += 4 ;
+      while ( --nbytes >= 0 ) {
+        *(uint16 *)dst = pairs[ src[ 0 ] ] ;
+        dst += 2 ;
+        src += 1 ;
+      }
+    } else if ( expanded_comps == 1 ) { /* Planar output */
       int32 nbytes = bytes ;
 
       do {
@@ -4721,11 +4796,20 @@ static Bool im_expand16to8nolut(IM_EXPAND *ime, IM_EXPBUF *expbuf, IM_STORE *ims
     src = (uint16 *)tsrc ;
 
     nbytes = bytes ;
-    do { /* Let compiler unroll this loop unless proven not good enough. */
-      dst[0] = COLORVALUE_TO_UINT8(src[0]) ;
-      src += 1 ;
-      dst += expanded_comps ;
-    } while ( (nbytes -= 2) > 0 ) ;
+    if ( expanded_comps == 1 ) {
+      /* Unit stride with independent iterations, so compilers can
+         vectorise it. */
+      int32 i, nsamples = (nbytes + 1) >> 1 ;
+      for ( i = 0 ; i < nsamples ; ++i )
+        dst[i] = COLORVALUE_TO_UINT8(src[i]) ;
+      dst += nsamples ;
+    } else {
+      do { /* Let compiler unroll this loop unless proven not good enough. */
+        dst[0] = COLORVALUE_TO_UINT8(src[0]) ;
+        src += 1 ;
+        dst += expanded_comps ;
+      } while ( (nbytes -= 2) > 0 ) ;
+    }
 
     im_storereadrelease(NULL) ;
     x += bytes >> 1 ; /* 1 samples per input / 2 bytes per input */
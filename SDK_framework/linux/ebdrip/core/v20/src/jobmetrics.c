@@ -150,6 +150,12 @@ MACRO_END
   SW_METRIC_INTEGER("groups_storing_shape", JobStats.dl.groups.groupsStoringShape);
   sw_metrics_close_group(&metrics) ; /*Group*/
 
+  if ( !sw_metrics_open_group(&metrics, METRIC_NAME_AND_LENGTH("Forms")) )
+    return FALSE ;
+  SW_METRIC_INTEGER("executed", JobStats.dl.forms.executed);
+  SW_METRIC_INTEGER("clipped_out", JobStats.dl.forms.clippedOut);
+  sw_metrics_close_group(&metrics) ; /*Forms*/
+
   if ( !sw_metrics_open_group(&metrics, METRIC_NAME_AND_LENGTH("PCL")) )
     return FALSE ;
 
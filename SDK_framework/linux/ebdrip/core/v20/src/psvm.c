@@ -41,14 +41,52 @@
 #include "control.h" /* ps_interpreter_level */
 #include "render.h" /* outputpage */
 #include "display.h" /* dl_mem_used */
+#include "metrics.h"
+#include "swenv.h" /* get_rtime */
 
 #include <limits.h> /* CHAR_BIT */
 
 PS_SAVEINFO *workingsave = NULL ;
 
+#ifdef METRICS_BUILD
+static struct psvm_metrics {
+  int32 restores ;          /* Number of restores performed. */
+  int32 restore_time ;      /* Total time spent in restore, in ms. */
+  int32 max_restore_time ;  /* Longest single restore, in ms. */
+} psvm_metrics ;
+
+static Bool psvm_metrics_update(sw_metrics_group *metrics)
+{
+  if ( !sw_metrics_open_group(&metrics, METRIC_NAME_AND_LENGTH("PSVM")) )
+    return FALSE ;
+  SW_METRIC_INTEGER("restores", psvm_metrics.restores) ;
+  SW_METRIC_INTEGER("restore_time_ms", psvm_metrics.restore_time) ;
+  SW_METRIC_INTEGER("max_restore_time_ms", psvm_metrics.max_restore_time) ;
+  sw_metrics_close_group(&metrics) ;
+  return TRUE ;
+}
+
+static void psvm_metrics_reset(int reason)
+{
+  struct psvm_metrics init = { 0 } ;
+  UNUSED_PARAM(int, reason) ;
+  psvm_metrics = init ;
+}
+
+static sw_metrics_callbacks psvm_metrics_hook = {
+  psvm_metrics_update,
+  psvm_metrics_reset,
+  NULL
+} ;
+#endif /* METRICS_BUILD */
+
 static void init_C_globals_psvm(void)
 {
   workingsave = NULL ;
+#ifdef METRICS_BUILD
+  psvm_metrics_reset(SW_METRICS_RESET_BOOT) ;
+  sw_metrics_register(&psvm_metrics_hook) ;
+#endif
 }
 
 static Bool ps_vm_swstart(struct SWSTART *params)
@@ -311,6 +349,9 @@ Bool ps_restore(ps_context_t *pscontext, int32 slevel)
 {
   corecontext_t *context = pscontext->corecontext ;
   deactivate_pagedevice_t dpd ;
+#ifdef METRICS_BUILD
+  int32 start_time ;
+#endif
 
   if ( slevel >= context->savelevel )
     return error_handler( INVALIDRESTORE ) ;
@@ -321,9 +362,21 @@ Bool ps_restore(ps_context_t *pscontext, int32 slevel)
   if ( ! flush_vignette( VD_Default ))
     return FALSE ;
 
+#ifdef METRICS_BUILD
+  start_time = get_rtime() ;
+#endif
+
   if ( ! purge_memory( slevel , & dpd ))
     return FALSE ;
 
+#ifdef METRICS_BUILD
+  start_time = get_rtime() - start_time ;
+  ++psvm_metrics.restores ;
+  psvm_metrics.restore_time += start_time ;
+  if ( start_time > psvm_metrics.max_restore_time )
+    psvm_metrics.max_restore_time = start_time ;
+#endif
+
   return do_pagedevice_reactivate(pscontext, &dpd) ;
 }
 
@@ -689,10 +689,22 @@ static void abort_pagebuffer_device(DL_STATE *page, sheet_data_t *sheet)
 }
 
 /* ---------------------------------------------------------------------- */
+/** Set the RunLineComplete pagebuffer parameter, if it is not already set
+    to the same value. The band's lines are written with the pagebuffer
+    mutex held, so no-one else can change the parameter between writes. */
+#define SET_RUN_LINE_COMPLETE(page_, last_, value_) MACRO_START \
+  Bool value__ = (value_) ; \
+  if ( (last_) != value__ ) { \
+    SET_PGB_PARAM_B(page_, "RunLineComplete", value__); \
+    (last_) = value__ ; \
+  } \
+MACRO_END
+
 static Bool output_rle_to_pagebuffer(DL_STATE *page, sheet_data_t *sheet,
                                      band_data_t *band)
 {
   dcoord linenumber ;
+  int32 complete = -1 ; /* RunLineComplete is not known to be set yet */
 
   VERIFY_OBJECT(band, BAND_DATA_NAME) ;
   VERIFY_OBJECT(sheet, SHEET_DATA_NAME) ;
@@ -713,7 +725,7 @@ static Bool output_rle_to_pagebuffer(DL_STATE *page, sheet_data_t *sheet,
 
     if ( page->rle_flags & RLE_LINE_OUTPUT ) {
       block = rle_block_first(linenumber, band->bbox.y1) ;
-      SET_PGB_PARAM_B(page, "RunLineComplete", !band->incomplete);
+      SET_RUN_LINE_COMPLETE(page, complete, !band->incomplete);
       /* The size of this write doesn't actually matter. The recipient of
          the write uses the block pointer as the start of the chain of the
          RLE blocks to write. */
@@ -729,8 +741,8 @@ static Bool output_rle_to_pagebuffer(DL_STATE *page, sheet_data_t *sheet,
         uint8* content = (uint8*)RLEBLOCK_GET_CONTENTS(block);
         int32 blockSize = RLEBLOCK_GET_SIZE(block);
         block = RLEBLOCK_GET_NEXT(block) ;
-        SET_PGB_PARAM_B(page, "RunLineComplete",
-                        !band->incomplete && block == NULL);
+        SET_RUN_LINE_COMPLETE(page, complete,
+                              !band->incomplete && block == NULL);
         while ( (*theIWriteFile(page->pgbdev))(page->pgbdev, sheet->pgbfd,
                                                content, blockSize) != blockSize ) {
           if ( !printerupset(page, sheet) )
@@ -3466,6 +3478,89 @@ static Bool band_render_graph(corecontext_t *context,
                               task_t **prev_render, task_vector_t *mht,
                               Bool beforeop, task_t *op) ;
 
+#ifdef METRICS_BUILD
+#include "metrics.h"
+#include "swenv.h" /* get_rtime */
+
+static struct render_metrics {
+  int32 bands_split ;              /**< Bands divided into sub-bands up front. */
+  int32 sub_bands ;                /**< Sub-bands those bands became. */
+  int32 sheets ;                   /**< Sheets rendered. */
+  int32 sheet_ms ;                 /**< Elapsed time rendering sheets. */
+  int32 band_ms[NTHREADS_LIMIT] ;  /**< Time each thread rendered bands. */
+  int32 idle_ms[NTHREADS_LIMIT] ;  /**< Time each thread was idle in sheets. */
+  int32 max_idle_ms[NTHREADS_LIMIT] ; /**< Worst idle time in one sheet. */
+} render_metrics ;
+
+static Bool render_metrics_update(sw_metrics_group *metrics)
+{
+  uint32 i ;
+
+  if ( !sw_metrics_open_group(&metrics, METRIC_NAME_AND_LENGTH("Render")) )
+    return FALSE ;
+  SW_METRIC_INTEGER("sheets", render_metrics.sheets) ;
+  SW_METRIC_INTEGER("sheet_ms", render_metrics.sheet_ms) ;
+  SW_METRIC_INTEGER("bands_split", render_metrics.bands_split) ;
+  SW_METRIC_INTEGER("sub_bands", render_metrics.sub_bands) ;
+
+  for ( i = 0 ; i < NTHREADS_LIMIT ; ++i ) {
+    uint8 name[32] ;
+    int32 len ;
+
+    /* Only threads which have rendered something are interesting. */
+    if ( render_metrics.band_ms[i] == 0 && render_metrics.idle_ms[i] == 0 )
+      continue ;
+
+    len = swncopyf(name, sizeof(name), (uint8 *)"Thread%u", i) ;
+    if ( !sw_metrics_open_group(&metrics, (const char *)name, (size_t)len) )
+      return FALSE ;
+    SW_METRIC_INTEGER("busy_ms", render_metrics.band_ms[i]) ;
+    SW_METRIC_INTEGER("idle_ms", render_metrics.idle_ms[i]) ;
+    SW_METRIC_INTEGER("max_sheet_idle_ms", render_metrics.max_idle_ms[i]) ;
+    sw_metrics_close_group(&metrics) ; /*Thread*/
+  }
+  sw_metrics_close_group(&metrics) ; /*Render*/
+
+  return TRUE ;
+}
+
+static void render_metrics_reset(int reason)
+{
+  struct render_metrics init = { 0 } ;
+  UNUSED_PARAM(int, reason) ;
+  render_metrics = init ;
+}
+
+static sw_metrics_callbacks render_metrics_hook = {
+  render_metrics_update,
+  render_metrics_reset,
+  NULL
+} ;
+
+/** Account for the time each rendering thread was idle while a sheet was
+    rendered.  busy holds the per-thread band rendering times when the
+    sheet started. Threads which have never rendered a band are ignored. */
+static void render_metrics_sheet(int32 elapsed, const int32 busy[NTHREADS_LIMIT])
+{
+  uint32 i ;
+
+  ++render_metrics.sheets ;
+  render_metrics.sheet_ms += elapsed ;
+
+  for ( i = 0 ; i < NTHREADS_LIMIT ; ++i ) {
+    if ( render_metrics.band_ms[i] != 0 ) {
+      int32 idle = elapsed - (render_metrics.band_ms[i] - busy[i]) ;
+
+      if ( idle > 0 ) {
+        render_metrics.idle_ms[i] += idle ;
+        if ( idle > render_metrics.max_idle_ms[i] )
+          render_metrics.max_idle_ms[i] = idle ;
+      }
+    }
+  }
+}
+#endif /*METRICS_BUILD*/
+
 /** \brief Get initial bounds for a band from a band and frame number. */
 static void band_extent(DL_STATE *page, int32 framenum, bandnum_t bandnum,
                         dbbox_t *bbox)
@@ -3558,6 +3653,9 @@ static Bool band_render(corecontext_t *context, void *args)
   DL_STATE *page = context->page ;
   render_base_t render_base ;
   render_state_t *prs = &render_base.rs ;
+#ifdef METRICS_BUILD
+  int32 start_ms = get_rtime() ;
+#endif
 
   VERIFY_OBJECT(band, BAND_DATA_NAME) ;
   frame = band->frame_data ;
@@ -3781,6 +3879,16 @@ static Bool band_render(corecontext_t *context, void *args)
 
   context->im_context->expbuf = NULL ;
 
+#ifdef METRICS_BUILD
+  {
+    uint32 tid = SwThreadIndex() ;
+
+    /* Only this thread updates its own entry. */
+    if ( tid < NTHREADS_LIMIT )
+      render_metrics.band_ms[tid] += get_rtime() - start_ms ;
+  }
+#endif
+
 #undef return
   return result ;
 }
@@ -4284,6 +4392,87 @@ static Bool band_render_graph(corecontext_t *context, frame_data_t *frame,
   return result ;
 }
 
+/** Bands estimated to cost less than this are never divided up front. */
+#define BAND_SPLIT_MIN_COST (64 * 1024)
+
+/** Minimum height of a sub-band made by dividing a band up front. */
+#define BAND_SPLIT_MIN_LINES 32
+
+/** \brief Decide how many sub-bands to divide the bands of a frame into.
+
+    Bands are normally rendered whole, so a single dense band (say, a
+    full-width image) occupies one thread while the others sit idle at the
+    end of the sheet. We estimate each band's cost from the objects on its
+    DL, and divide any band costing more than its share of the frame per
+    thread into sub-bands, which are rendered as separate tasks.
+
+    Bands are only divided in Y. Band output writes whole lines; an X split
+    leaves the band incomplete, which only RLE output tolerates. Passes with
+    compositing regions, modular halftoning or partial painting render bands
+    whole, as do bands read back from the pagebuffer.
+
+    \param page   The DL being rendered.
+    \param pass   The pass data for the frame.
+
+    \return An array of sub-band counts, indexed from the first trimmed band,
+            which the caller frees; or NULL if no band is to be divided. */
+static uint32 *band_split_plan(DL_STATE *page, pass_data_t *pass)
+{
+  uint32 *plan ;
+  uint32 total = 0, share, maxsplit ;
+  int32 nthreads ;
+  bandnum_t bandnum, nbands ;
+  Bool split = FALSE ;
+
+  if ( !pass->allowMultipleThreads ||
+       pass->region_types != RENDER_REGIONS_DIRECT ||
+       pass->paint_type != PAINT_TYPE_FINAL ||
+       pass->mht_max_latency != 0 || pass->serialize_mht ||
+       page->rippedtodisk || DOING_RUNLENGTH(page) )
+    return NULL ;
+
+  nthreads = max_simultaneous_tasks() ;
+  maxsplit = (uint32)(page->band_lines / BAND_SPLIT_MIN_LINES) ;
+  if ( nthreads < 2 || maxsplit < 2 )
+    return NULL ;
+  if ( maxsplit > (uint32)nthreads )
+    maxsplit = (uint32)nthreads ;
+
+  nbands = pass->trim_endband - pass->trim_startband + 1 ;
+  if ( (plan = mm_alloc(mm_pool_temp, nbands * sizeof(uint32),
+                        MM_ALLOC_CLASS_BAND_DATA)) == NULL )
+    return NULL ; /* Not an error, we'll render bands whole. */
+
+  for ( bandnum = 0 ; bandnum < nbands ; ++bandnum ) {
+    dbbox_t bbox ;
+    bandnum_t dlband = (pass->trim_startband + bandnum) / page->sizedisplayfact ;
+
+    band_extent(page, 0, pass->trim_startband + bandnum, &bbox) ;
+    plan[bandnum] = dlref_render_cost(dl_get_head(page, dlband), &bbox) ;
+    total = plan[bandnum] > MAXUINT32 - total ? MAXUINT32 : total + plan[bandnum] ;
+  }
+
+  share = total / (uint32)nthreads + 1 ;
+  for ( bandnum = 0 ; bandnum < nbands ; ++bandnum ) {
+    uint32 cost = plan[bandnum], nsplit = 1 ;
+
+    if ( cost >= BAND_SPLIT_MIN_COST && cost > share ) {
+      nsplit = cost / share + 1 ;
+      if ( nsplit > maxsplit )
+        nsplit = maxsplit ;
+      split = TRUE ;
+    }
+    plan[bandnum] = nsplit ;
+  }
+
+  if ( !split ) {
+    mm_free(mm_pool_temp, plan, nbands * sizeof(uint32)) ;
+    return NULL ;
+  }
+
+  return plan ;
+}
+
 /** Construct the task graph for rendering a frame. */
 static Bool frame_render_graph(corecontext_t *context, render_graph_t *graph,
                                frame_data_t *frame)
@@ -4304,6 +4493,7 @@ static Bool frame_render_graph(corecontext_t *context, render_graph_t *graph,
   if (pass->trim_endband >= pass->trim_startband) {
     bandnum_t bandnum ;
     hq_atomic_counter_t before ;
+    uint32 *plan ;
 
     VERIFY_OBJECT(pass->page_data, PAGE_DATA_NAME) ;
 
@@ -4335,24 +4525,64 @@ static Bool frame_render_graph(corecontext_t *context, render_graph_t *graph,
       return FALSE ;
     }
 
+    /* Find any expensive bands to divide between threads. */
+    plan = band_split_plan(graph->page, pass) ;
+
     /* Iterate over bands, constructing task graph for each band, making it
        ready as soon as possible. */
     for ( bandnum = pass->trim_startband ;
           bandnum <= pass->trim_endband ;
           ++bandnum ) {
       dbbox_t bbox ;
+      dcoord yalloc, y2 ;
+      uint32 nsplit = 1 ;
 
       band_extent(graph->page, frame->nFrameNumber, bandnum, &bbox) ;
-      if ( !band_render_graph(context, frame, &bbox, bbox.y2 - bbox.y1 + 1,
-                              0 /*initial surface pass*/,
-                              FALSE /*Don't serialize bands*/,
-                              (graph->mht || pass->serialize_mht)
-                              ? &graph->prev_render : NULL,
-                              graph->mht /*MHT gates*/,
-                              TRUE /*output before*/, graph->last_output) )
-        return FALSE ;
+      yalloc = bbox.y2 - bbox.y1 + 1 ;
+      y2 = bbox.y2 ;
+
+      if ( plan != NULL ) {
+        /* The last band of a frame may be short, so cap the plan by the
+           lines this band actually has. */
+        uint32 maxsplit = (uint32)(yalloc / BAND_SPLIT_MIN_LINES) ;
+
+        nsplit = plan[bandnum - pass->trim_startband] ;
+        if ( nsplit > maxsplit )
+          nsplit = maxsplit > 0 ? maxsplit : 1 ;
+      }
+
+#ifdef METRICS_BUILD
+      if ( nsplit > 1 ) {
+        ++render_metrics.bands_split ;
+        render_metrics.sub_bands += (int32)nsplit ;
+      }
+#endif
+
+      /* Sub-bands keep the whole band's allocation, as if they had been
+         split while rendering, and are output in order. */
+      do {
+        bbox.y2 = bbox.y1 + (y2 - bbox.y1 + 1) / (dcoord)nsplit - 1 ;
+        if ( !band_render_graph(context, frame, &bbox, yalloc,
+                                0 /*initial surface pass*/,
+                                FALSE /*Don't serialize bands*/,
+                                (graph->mht || pass->serialize_mht)
+                                ? &graph->prev_render : NULL,
+                                graph->mht /*MHT gates*/,
+                                TRUE /*output before*/, graph->last_output) ) {
+          if ( plan != NULL )
+            mm_free(mm_pool_temp, plan,
+                    (pass->trim_endband - pass->trim_startband + 1) * sizeof(uint32)) ;
+          return FALSE ;
+        }
+        bbox.y1 = bbox.y2 + 1 ;
+      } while ( --nsplit > 0 ) ;
+      HQASSERT(bbox.y1 == y2 + 1, "Sub-bands did not cover band") ;
     }
 
+    if ( plan != NULL )
+      mm_free(mm_pool_temp, plan,
+              (pass->trim_endband - pass->trim_startband + 1) * sizeof(uint32)) ;
+
     /* Insert the frame render end task just before the sheet render end. */
     if ( !task_replace(graph->last_render, frame->render_end_task, graph->last_render) )
       return FALSE ;
@@ -4783,6 +5013,12 @@ static Bool render_tasks_sheet(corecontext_t *context, pass_data_t *pass,
     if ( task_group_create(&sheet->task_group, TASK_GROUP_SHEET,
                            render_tasks, NULL) ) {
       render_graph_t graph ;
+#ifdef METRICS_BUILD
+      int32 start_ms = get_rtime() ;
+      int32 busy[NTHREADS_LIMIT] ;
+
+      HqMemCpy(busy, render_metrics.band_ms, sizeof(busy)) ;
+#endif
 
       graph.mht = NULL ;
       graph.prev_render = NULL ;
@@ -4835,6 +5071,10 @@ static Bool render_tasks_sheet(corecontext_t *context, pass_data_t *pass,
          capture the error into a local error context which we can later
          propagate to this task's context if we decide to abort the sheet. */
       (void)task_group_join(sheet->task_group, &errcontext) ;
+
+#ifdef METRICS_BUILD
+      render_metrics_sheet(get_rtime() - start_ms, busy) ;
+#endif
     }
     task_group_release(&render_tasks) ;
 
@@ -5951,6 +6191,11 @@ void v20render_C_globals(
 
   band_threads_warned_job = -1 ;
 
+#ifdef METRICS_BUILD
+  render_metrics_reset(SW_METRICS_RESET_BOOT) ;
+  sw_metrics_register(&render_metrics_hook) ;
+#endif
+
   trim_to_page = FALSE;
 
   trim_would_start = 0;
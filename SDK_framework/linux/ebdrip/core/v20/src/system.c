@@ -460,10 +460,12 @@ void free_charpaths( void )
 Bool initSystemMemoryCaches(
   mm_pool_t   pool)       /* I */
 {
-  /* Array must be sorted into ascending block size */
+  /* Array must be sorted into ascending block size. The SAC keeps enough
+     LINELISTs for paths to be built, stroked, flattened and freed without
+     going back to the pool for every segment. */
   struct mm_sac_classes_t sac_classes[3] = { /* size, num, freq */
     { SAC_ALLOC_PATHSIZE,  512, 20 },
-    { SAC_ALLOC_LINESIZE, 1024, 30 },
+    { SAC_ALLOC_LINESIZE, 4096, 30 },
     { SAC_ALLOC_CLIPSIZE,  128, 10 },
   } ;
 
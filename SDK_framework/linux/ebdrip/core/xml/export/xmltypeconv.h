@@ -145,6 +145,34 @@ Bool xml_convert_double(xmlGFilter *filter,
                         utf8_buffer* value,
                         void *data /* double* */) ;
 
+/**
+ * \brief Fast path scanner for plain decimal numbers.
+ *
+ * \param input Pointer to a UTF-8 string.
+ * \param allow_minus Is a leading minus sign permitted?
+ * \param allow_plus Is a leading plus sign permitted?
+ * \param p_double Location to store the scanned value.
+ *
+ * \retval TRUE The number was scanned. The location and length of the UTF-8
+ *              string are updated to a point after the number.
+ * \retval FALSE The number is not in the simple form, and the UTF-8 string
+ *               is not updated. This is not an error; the caller should use
+ *               its full converter, which will raise any error.
+ *
+ * This handles the form [sign] digits [. digits] with at most \c
+ * XML_FAST_DECIMAL_DIGITS significant digits and fewer than ten fractional
+ * digits, which covers almost all numbers in path and geometry data. The
+ * result is identical to the full converters for these numbers.
+ */
+Bool xml_scan_decimal_fast(/*@in@*/ /*@notnull@*/ utf8_buffer* input,
+                           Bool allow_minus, Bool allow_plus,
+                           /*@out@*/ /*@notnull@*/ double *p_double) ;
+
+/** \brief Maximum number of digits accepted by \c xml_scan_decimal_fast().
+
+    The mantissa must be accumulated in a double without rounding. */
+#define XML_FAST_DECIMAL_DIGITS 15
+
 /**
  * \brief float type converter.
  *
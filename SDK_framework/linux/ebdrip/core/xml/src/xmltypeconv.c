@@ -617,6 +617,84 @@ Bool xml_convert_integer(xmlGFilter *filter,
 
 #define BIGGEST_REAL_DIV_10 (DBL_MAX / 10)
 
+/* Reciprocal powers of ten, shared by the fast and full double scanners so
+   they produce identical results. */
+static double fdivs[ 11 ] = { 0.0 , 0.1 , 0.01 , 0.001 , 0.0001 , 0.00001 , 0.000001 ,
+                              0.0000001 , 0.00000001 , 0.000000001 , 0.0000000001 } ;
+
+Bool xml_scan_decimal_fast(utf8_buffer* input,
+                           Bool allow_minus, Bool allow_plus,
+                           double *p_double)
+{
+  UTF8 *curr, *limit, *digits_start ;
+  uint32 nleading, ntrailing, digit ;
+  double value = 0.0 ;
+  Bool negative = FALSE ;
+
+  HQASSERT(input != NULL, "No UTF-8 string to scan") ;
+  HQASSERT(p_double != NULL, "Nowhere to put scanned double") ;
+
+  curr = input->codeunits ;
+  limit = curr + input->unitlength ;
+
+  if ( curr == limit )
+    return FALSE ;
+
+  if ( *curr == '-' ) {
+    if ( !allow_minus )
+      return FALSE ;
+    negative = TRUE ;
+    ++curr ;
+  } else if ( *curr == '+' ) {
+    if ( !allow_plus )
+      return FALSE ;
+    ++curr ;
+  }
+
+  /* Unsigned subtraction folds the range test for '0'..'9' into a single
+     compare. */
+  digits_start = curr ;
+  while ( curr < limit && (digit = (uint32)(*curr - '0')) <= 9 ) {
+    value = 10.0 * value + digit ;
+    ++curr ;
+  }
+  nleading = CAST_PTRDIFFT_TO_UINT32(curr - digits_start) ;
+
+  ntrailing = 0 ;
+  if ( curr < limit && *curr == '.' ) {
+    digits_start = ++curr ;
+    while ( curr < limit && (digit = (uint32)(*curr - '0')) <= 9 ) {
+      value = 10.0 * value + digit ;
+      ++curr ;
+    }
+    ntrailing = CAST_PTRDIFFT_TO_UINT32(curr - digits_start) ;
+
+    /* A decimal point must be followed by digits; the full converter
+       raises the error. */
+    if ( ntrailing == 0 )
+      return FALSE ;
+  }
+
+  /* Leave empty numbers, long mantissas, very small fractions and
+     exponents to the full converter. */
+  if ( nleading + ntrailing == 0 ||
+       nleading + ntrailing > XML_FAST_DECIMAL_DIGITS ||
+       ntrailing >= NUM_ARRAY_ITEMS(fdivs) - 1 ||
+       (curr < limit && (*curr == 'e' || *curr == 'E')) )
+    return FALSE ;
+
+  if ( ntrailing > 0 )
+    value *= fdivs[ntrailing] ;
+  if ( negative )
+    value = -value ;
+
+  *p_double = value ;
+  input->unitlength -= CAST_PTRDIFFT_TO_UINT32(curr - input->codeunits) ;
+  input->codeunits = curr ;
+
+  return TRUE ;
+}
+
 Bool xml_convert_double(xmlGFilter *filter,
                         xmlGIStr *attrlocalname,
                         utf8_buffer* value,
@@ -632,8 +710,6 @@ Bool xml_convert_double(xmlGFilter *filter,
   uint8 ch ;
   Bool all_consumed = FALSE ;
   Bool have_exp = FALSE ;
-  static double fdivs[ 11 ] = { 0.0 , 0.1 , 0.01 , 0.001 , 0.0001 , 0.00001 , 0.000001 ,
-                                0.0000001 , 0.00000001 , 0.000000001 , 0.0000000001 } ;
 
   UNUSED_PARAM(xmlGFilter *, filter) ;
   UNUSED_PARAM(xmlGIStr *, attrlocalname) ;
@@ -641,6 +717,9 @@ Bool xml_convert_double(xmlGFilter *filter,
   HQASSERT(p_double, "Nowhere to put scanned double") ;
   HQASSERT(value != NULL, "No UTF-8 string to convert");
 
+  if ( xml_scan_decimal_fast(value, TRUE, TRUE, p_double) )
+    return TRUE ;
+
   scan = *value ;
   if ( scan.unitlength == 0 )
     return error_handler(RANGECHECK) ;
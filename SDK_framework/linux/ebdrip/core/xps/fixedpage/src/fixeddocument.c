@@ -183,7 +183,7 @@ static Bool print_page(
      part to a fixed page part. */
   success = xps_parse_xml_from_partname(filter, source,
                                         XPS_PROCESS_PRINTTICKET_REL,
-                                        XPS_PART_VERSIONED | XPS_LOWMEMORY,
+                                        XPS_PART_VERSIONED | XPS_LOWMEMORY | XPS_PREFETCH,
                                         fixedpage_doc_element,
                                         NULL, /* relationship */
                                         fixedpage_content_types,
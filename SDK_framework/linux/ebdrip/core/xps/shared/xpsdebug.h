@@ -27,6 +27,9 @@
  *
  * bit 0: Document commits
  * bit 1: Mark Glyph elements with their line number
+ * bit 2: Disable direct images
+ * bit 3: Disable FixedPage resource prefetching
+ * bit 4: Trace FixedPage resource prefetching
  */
 extern int32 debug_xps ;
 #endif
@@ -36,7 +39,9 @@ extern int32 debug_xps ;
 enum { /* Bitflags for debug_xps */
   DEBUG_XPS_COMMIT = 1,
   DEBUG_XPS_MARK_TEXT = 2,
-  DEBUG_DISABLE_DIRECT_IMAGES = 4
+  DEBUG_DISABLE_DIRECT_IMAGES = 4,
+  DEBUG_XPS_NO_PREFETCH = 8,
+  DEBUG_XPS_PREFETCH = 16
 } ;
 
 #endif
@@ -49,6 +49,7 @@ typedef struct XPS_CONTENT_TYPES {
 #define XPS_PART_SIGNED        0x2
 #define XPS_CORE_PROPERTIES    0x4
 #define XPS_LOWMEMORY          0x8 /* Mandatory: low-mem handling and user filters */
+#define XPS_PREFETCH           0x10 /* Preload FixedPage required resources */
 
 extern
 void xps_partname_context_init(void) ;
@@ -0,0 +1,59 @@
+/** \file
+ * \ingroup xps
+ *
+ * $HopeName: COREedoc!shared:xpsprefetch.h(EBDSDK_P.1) $
+ *
+ * Copyright (C) 2014 Global Graphics Software Ltd. All rights reserved.
+ * Global Graphics Software Ltd. Confidential Information.
+ *
+ * \brief
+ * Interface for preloading the resources required by a FixedPage.
+ */
+
+#ifndef __XPSPREFETCH_H__
+#define __XPSPREFETCH_H__
+
+#include "xml.h"
+
+/** \brief Prefetch state for one FixedPage part. */
+typedef struct xps_prefetch_t xps_prefetch_t ;
+
+/**
+ * \brief Install the prefetch filter, which preloads the resources a
+ * FixedPage declares through its RequiredResource relationships as the
+ * markup naming them is read.
+ *
+ * Fonts are loaded into the XPS font cache, and all other resource parts
+ * (images, ICC profiles, remote resource dictionaries) are read through
+ * once so the ZIP device has extracted and inflated them before the
+ * elements that use them are parsed. Failing to preload a resource is not
+ * usually an error; the same failure will be reported when the markup uses
+ * the resource. Interrupts, timeouts and VMERROR stop the parse.
+ *
+ * \param[in] filter_chain  The FixedPage part filter chain.
+ * \param[in] position      Position of the filter in the chain.
+ * \param[out] filter       The new filter.
+ * \param[in] xps_ctxt      The XPS document context.
+ *
+ * \retval TRUE  Success.
+ * \retval FALSE Failure.
+ */
+extern
+Bool xps_prefetch_filter_init(
+      xmlGFilterChain *filter_chain,
+      uint32 position,
+      xmlGFilter **filter,
+      xmlDocumentContext *xps_ctxt) ;
+
+/**
+ * \brief Free the prefetch state of a part, if it has any.
+ *
+ * \param[in,out] prefetch  The prefetch state, set to NULL.
+ */
+extern
+void xps_prefetch_free(
+      xps_prefetch_t **prefetch) ;
+
+/* ============================================================================
+* Log stripped */
+#endif
@@ -150,6 +150,9 @@ struct xpsXmlPartContext {
   /* If the part is open, this will point to the file. */
   FILELIST *flptr ;
 
+  /** Resources to preload ahead of the markup, for a FixedPage part. */
+  struct xps_prefetch_t *prefetch ;
+
   OBJECT_NAME_MEMBER
 } ;
 
@@ -60,6 +60,28 @@ extern
 xps_partname_t *xps_rels_get_target(
       xpsRelationship *relationship) ;
 
+/** \brief Callback type for enumerating relationships. Return FALSE to
+    stop the enumeration. */
+typedef Bool (xps_relationship_enum_fn)(
+      xpsRelationship *relationship,
+      void *data) ;
+
+/**
+ * \brief Call \a enum_fn for every relationship of \a type in the block.
+ *
+ * The remainder of the relationships stream (if any) is parsed before the
+ * enumeration starts, so all relationships of the type are seen.
+ *
+ * \return \c FALSE if parsing the relationships stream failed, or the
+ * callback returned \c FALSE; \c TRUE otherwise.
+ */
+extern
+Bool xps_enumerate_relationship_type(
+      xpsRelationshipsBlock *rels_block,
+      xmlGIStr *type,
+      xps_relationship_enum_fn *enum_fn,
+      void *data) ;
+
 /* ============================================================================
 * Log stripped */
 #endif
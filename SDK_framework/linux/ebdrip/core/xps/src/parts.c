@@ -29,6 +29,7 @@
 #include "xps.h"
 #include "xpspriv.h"
 #include "xpsrelsblock.h"
+#include "xpsprefetch.h"
 
 /* Character lookup table and maro's implement the following as per spec.
  *
@@ -693,6 +694,7 @@ Bool xps_xml_part_context_new(
   new_part_ctxt->defining_resources = FALSE ;
   new_part_ctxt->defining_brush_resource = FALSE ;
   new_part_ctxt->flptr = NULL ;
+  new_part_ctxt->prefetch = NULL ;
   new_part_ctxt->within_element = FALSE ;
   new_part_ctxt->printticket_relationship_seen = FALSE ;
 
@@ -805,6 +807,8 @@ Bool xps_xml_part_context_free(
   HQASSERT(SLL_LIST_IS_EMPTY(&(old_part_ctxt->resourceblock_stack)),
            "resourceblock stack is not empty");
 
+  xps_prefetch_free(&old_part_ctxt->prefetch) ;
+
   HQASSERT(old_part_ctxt->relationships != NULL, "relationships is NULL") ;
 
   /* When the part is a relationships part, the relationships pointer
@@ -1074,6 +1078,12 @@ static Bool xps_parse_xml_internal(
     if (! xps_fixed_payload_filter_init(filter_chain, 10, &new_filter,
                                         valid_children, xps_ctxt))
       return FALSE ;
+
+    /* After the FixedPage has been started by the payload filter. */
+    if (additional_filters & XPS_PREFETCH) {
+      if (! xps_prefetch_filter_init(filter_chain, 12, &new_filter, xps_ctxt))
+        return FALSE ;
+    }
   }
 
   if (optional_part)
@@ -0,0 +1,431 @@
+/** \file
+ * \ingroup xps
+ *
+ * $HopeName: COREedoc!src:prefetch.c(EBDSDK_P.1) $
+ *
+ * Copyright (C) 2014 Global Graphics Software Ltd. All rights reserved.
+ * Global Graphics Software Ltd. Confidential Information.
+ *
+ * \brief
+ * Preloading of FixedPage resources.
+ *
+ * Without this, fonts, images and remote resource dictionaries are located,
+ * inflated from the package and decoded the first time an element refers to
+ * them, interleaved with the page markup parse. When the FixedPage element
+ * starts we collect the RequiredResource relationships of the page. As the
+ * parse reads the page markup, the prefetch filter looks through the data
+ * the parser has read into the page stream's buffer but not yet parsed, and
+ * for each required resource named there, defines the font into the XPS font
+ * cache or reads the resource part through once so the ZIP device has
+ * extracted it. The elements then find their resources ready.
+ *
+ * The markup is not read a second time; only data the parser has already
+ * read is looked at. The ZIP device, PS VM and font loader belong to the
+ * interpreter thread, so the preloading is done there, in the callbacks of
+ * the filter, rather than by helper tasks.
+ */
+
+#include "core.h"
+#include "mm.h"               /* mm_alloc */
+#include "swerrors.h"         /* error_clear_context */
+#include "swctype.h"          /* tolower */
+#include "tables.h"           /* char_to_hex_nibble */
+#include "hq32x2.h"           /* Hq32x2 */
+#include "objects.h"          /* OBJECT */
+#include "fileio.h"           /* FILELIST */
+
+#include "xml.h"
+
+#include "xpspriv.h"
+#include "xpsparts.h"
+#include "xpsrelsblock.h"
+#include "xpstypestream.h"
+#include "xpsfonts.h"
+#include "xpsdebug.h"
+#include "xpsprefetch.h"
+
+#include "namedef_.h"
+
+/** Number of bytes read per call when reading a part through. */
+#define XPS_PREFETCH_SKIP (64 * 1024)
+
+/** Longest resource name searched for in the page markup. */
+#define XPS_PREFETCH_NAME_MAX 128
+
+/** Most required resources considered for one page. */
+#define XPS_PREFETCH_MAX_RESOURCES 64
+
+/** \brief A required resource which may be preloaded. */
+typedef struct xps_prefetch_resource_t {
+  xps_partname_t *target ;  /**< Resource partname. */
+  /** Last segment of the normalised partname, percent-decoded. */
+  uint8 name[XPS_PREFETCH_NAME_MAX] ;
+  int32 name_len ;          /**< Length of the decoded last segment. */
+  Bool referenced ;         /**< Has the page markup mentioned it? */
+} xps_prefetch_resource_t ;
+
+/** \brief Prefetch state for one FixedPage part. */
+struct xps_prefetch_t {
+  int32 nresources ;        /**< Number of required resources collected. */
+  int32 unreferenced ;      /**< Collected resources not yet found. */
+  int32 fonts ;             /**< Number of fonts preloaded. */
+  int32 parts ;             /**< Number of other parts preloaded. */
+  Hq32x2 searched ;         /**< Page stream offset searched up to. */
+  xps_prefetch_resource_t resources[XPS_PREFETCH_MAX_RESOURCES] ;
+} ;
+
+/** Can the error from a failed preload be forgotten? Interrupts, timeouts
+    and running out of memory must stop the page; anything else is reported
+    again if the markup uses the resource. */
+static Bool xps_prefetch_recoverable(void)
+{
+  error_context_t *errcontext = get_core_context_interp()->error ;
+
+  switch ( error_latest_context(errcontext) ) {
+  case INTERRUPT:
+  case TIMEOUT:
+  case VMERROR:
+    return FALSE ;
+  }
+
+  error_clear_context(errcontext) ;
+  return TRUE ;
+}
+
+/** Decode the character at \a in, which may be a percent-encoded triplet,
+    and lower case it, as partnames compare without regard to case. The
+    number of bytes consumed is returned in \a used. */
+static inline uint8 xps_prefetch_decode(
+      const uint8 *in, int32 len,
+      int32 *used)
+{
+  if ( in[0] == '%' && len >= 3 &&
+       char_to_hex_nibble[in[1]] >= 0 && char_to_hex_nibble[in[2]] >= 0 ) {
+    *used = 3 ;
+    return (uint8)tolower((char_to_hex_nibble[in[1]] << 4) |
+                          char_to_hex_nibble[in[2]]) ;
+  }
+
+  *used = 1 ;
+  return (uint8)tolower(in[0]) ;
+}
+
+/** Read a resource part through to EOF, so the ZIP device extracts and
+    inflates all of it. */
+static Bool xps_prefetch_part(
+      xmlGFilter *filter,
+      xps_partname_t *partname)
+{
+  OBJECT ofile = OBJECT_NOTVM_NOTHING ;
+  xmlGIStr *mimetype ;
+  FILELIST *flptr ;
+  int32 res ;
+
+  if (! xps_open_file_from_partname(filter, partname, &ofile,
+                                    XML_INTERN(rel_xps_2005_06_required_resource),
+                                    NULL, &mimetype, FALSE))
+    return FALSE ;
+
+  flptr = oFile(ofile) ;
+  HQASSERT(flptr != NULL, "No file for prefetched part") ;
+
+  do {
+    res = file_skip(flptr, XPS_PREFETCH_SKIP, NULL) ;
+  } while ( res > 0 ) ;
+
+  if ( res == 0 )
+    (void)(*theIFileLastError(flptr))(flptr) ;
+
+  xml_file_close(&ofile) ;
+
+  return (res != 0) ;
+}
+
+/** Relationships enumeration callback, collecting one required resource. */
+static Bool xps_prefetch_collect(
+      xpsRelationship *relationship,
+      void *data)
+{
+  xps_prefetch_t *prefetch = data ;
+  xps_prefetch_resource_t *resource ;
+  xps_partname_t *target ;
+  const uint8 *name ;
+  int32 len, start, used ;
+
+  HQASSERT(prefetch != NULL, "No prefetch state") ;
+
+  if ( prefetch->nresources == XPS_PREFETCH_MAX_RESOURCES )
+    return TRUE ; /* The rest load when the markup uses them. */
+
+  target = xps_rels_get_target(relationship) ;
+  HQASSERT(target->norm_name != NULL, "No normalised partname") ;
+
+  /* The markup may refer to the resource by a relative or absolute name,
+     and may or may not percent-encode it, but either way the decoded last
+     segment must appear. */
+  name = intern_value(target->norm_name) ;
+  len = CAST_UNSIGNED_TO_INT32(intern_length(target->norm_name)) ;
+  for ( start = len ; start > 0 && name[start - 1] != '/' ; --start )
+    EMPTY_STATEMENT() ;
+
+  resource = &prefetch->resources[prefetch->nresources] ;
+  resource->name_len = 0 ;
+  for ( ; start < len ; start += used ) {
+    if ( resource->name_len == XPS_PREFETCH_NAME_MAX )
+      return TRUE ; /* Too long to look for; it loads when used. */
+    resource->name[resource->name_len++] =
+      xps_prefetch_decode(name + start, len - start, &used) ;
+  }
+
+  if ( resource->name_len == 0 )
+    return TRUE ;
+
+  resource->target = target ;
+  resource->referenced = FALSE ;
+  ++prefetch->nresources ;
+  ++prefetch->unreferenced ;
+
+  return TRUE ;
+}
+
+/** Does \a name appear in \a buffer? The markup is decoded and lower cased
+    as it is compared, in the same way as the name was. */
+static Bool xps_prefetch_find(
+      const uint8 *buffer, int32 len,
+      const uint8 *name, int32 name_len)
+{
+  int32 i, j, k, used ;
+
+  for ( i = 0 ; i <= len - name_len ; ++i ) {
+    for ( j = 0, k = i ; j < name_len && k < len ; ++j, k += used ) {
+      if ( xps_prefetch_decode(buffer + k, len - k, &used) != name[j] )
+        break ;
+    }
+    if ( j == name_len )
+      return TRUE ;
+  }
+
+  return FALSE ;
+}
+
+/** Preload one collected resource. */
+static Bool xps_prefetch_resource(
+      xmlGFilter *filter,
+      xps_prefetch_t *prefetch,
+      xps_partname_t *target)
+{
+  xmlGIStr *mimetype ;
+  Bool status ;
+
+  status = xps_types_get_part_mimetype(filter, target, &mimetype) ;
+
+  if ( status ) {
+    if ( mimetype == XML_INTERN(mimetype_ms_opentype) ||
+         mimetype == XML_INTERN(mimetype_package_obfuscated_opentype) ) {
+      OBJECT *fontdict ;
+
+      /* Glyphs without a font face index or IsSideways are the common case;
+         the cache is keyed on both, so other variants load when used. */
+      status = xps_font_define(target, -1, filter, &fontdict, 0) ;
+      if ( status )
+        ++prefetch->fonts ;
+    } else {
+      status = xps_prefetch_part(filter, target) ;
+      if ( status )
+        ++prefetch->parts ;
+    }
+  }
+
+  return status ;
+}
+
+/** Collect the RequiredResource relationships of the page. */
+static Bool xps_prefetch_start(
+      xpsXmlPartContext *xmlpart_ctxt)
+{
+  xps_prefetch_t *prefetch ;
+
+  HQASSERT(xmlpart_ctxt->prefetch == NULL, "Page prefetch already started") ;
+
+  prefetch = mm_alloc(mm_xml_pool, sizeof(xps_prefetch_t),
+                      MM_ALLOC_CLASS_XML_STREAM) ;
+  if ( prefetch == NULL )
+    return error_handler(VMERROR) ;
+
+  prefetch->nresources = 0 ;
+  prefetch->unreferenced = 0 ;
+  prefetch->fonts = 0 ;
+  prefetch->parts = 0 ;
+  Hq32x2FromInt32(&prefetch->searched, 0) ;
+  xmlpart_ctxt->prefetch = prefetch ;
+
+  /* Failures are reported when the markup uses the resource, so unless the
+     error stops the page, forget it and carry on without preloading. */
+  if ( !xps_enumerate_relationship_type(xmlpart_ctxt->relationships,
+                                        XML_INTERN(rel_xps_2005_06_required_resource),
+                                        xps_prefetch_collect, prefetch) ) {
+    prefetch->unreferenced = 0 ;
+    return xps_prefetch_recoverable() ;
+  }
+
+  return TRUE ;
+}
+
+/** Look through the page markup the parser has read but not yet parsed,
+    and preload the required resources it names. Only the part of the page
+    stream buffer not searched before is looked at, so each byte of markup
+    is searched once. A name split between two buffers is not found; that
+    resource loads when the markup uses it. */
+static Bool xps_prefetch_lookahead(
+      xmlGFilter *filter,
+      xps_prefetch_t *prefetch,
+      FILELIST *flptr,
+      Bool first)
+{
+  uint8 *buffer ;
+  int32 len, skip = 0, i ;
+  Hq32x2 pos, end ;
+
+  len = theICount(flptr) ;
+  if ( len <= 0 )
+    return TRUE ;
+
+  if ( (*theIMyFilePos(flptr))(flptr, &pos) == EOF ) {
+    /* Without the stream position we can't tell new markup from old. */
+    prefetch->unreferenced = 0 ;
+    return xps_prefetch_recoverable() ;
+  }
+
+  buffer = theIPtr(flptr) ;
+  Hq32x2AddInt32(&end, &pos, len) ;
+  if ( Hq32x2Compare(&end, &prefetch->searched) <= 0 )
+    return TRUE ; /* No more markup has been read. */
+
+  if ( first ) {
+    /* Nothing but the FixedPage element has been parsed, so the part of the
+       buffer the parser is working through is still to come. */
+    len += CAST_PTRDIFFT_TO_INT32(buffer - theIBuffer(flptr)) ;
+    buffer = theIBuffer(flptr) ;
+  } else if ( Hq32x2Compare(&prefetch->searched, &pos) > 0 ) {
+    Hq32x2 searched ;
+
+    Hq32x2Subtract(&searched, &prefetch->searched, &pos) ;
+    if ( Hq32x2ToInt32(&searched, &skip) ) {
+      HQASSERT(skip > 0 && skip < len, "Searched offset outside buffer") ;
+      buffer += skip ;
+      len -= skip ;
+    }
+  }
+  prefetch->searched = end ;
+
+  for ( i = 0 ; i < prefetch->nresources ; ++i ) {
+    xps_prefetch_resource_t *resource = &prefetch->resources[i] ;
+
+    if ( !resource->referenced &&
+         xps_prefetch_find(buffer, len, resource->name, resource->name_len) ) {
+      resource->referenced = TRUE ;
+      --prefetch->unreferenced ;
+
+      if ( !xps_prefetch_resource(filter, prefetch, resource->target) &&
+           !xps_prefetch_recoverable() )
+        return FALSE ;
+    }
+  }
+
+#if defined(DEBUG_BUILD)
+  HQTRACE((debug_xps & DEBUG_XPS_PREFETCH) != 0 && prefetch->unreferenced == 0,
+          ("XPS page prefetched %d fonts and %d parts of %d required",
+           prefetch->fonts, prefetch->parts, prefetch->nresources)) ;
+#endif
+
+  return TRUE ;
+}
+
+/** Start element callback for every element of a FixedPage part. The first
+    element is the FixedPage itself, which collects the required resources
+    to look for; every element then looks for them in any markup read since
+    the last look. */
+static Bool xps_prefetch_start_element(
+      xmlGFilter *filter,
+      const xmlGIStr *localname,
+      const xmlGIStr *prefix,
+      const xmlGIStr *uri,
+      xmlGAttributes *attrs)
+{
+  xmlGFilterChain *filter_chain ;
+  xpsXmlPartContext *xmlpart_ctxt ;
+  Bool first = FALSE ;
+
+  UNUSED_PARAM( const xmlGIStr * , localname ) ;
+  UNUSED_PARAM( const xmlGIStr * , prefix ) ;
+  UNUSED_PARAM( const xmlGIStr * , uri ) ;
+  UNUSED_PARAM( xmlGAttributes * , attrs ) ;
+
+  HQASSERT(filter != NULL, "filter is NULL") ;
+  filter_chain = xmlg_get_fc(filter) ;
+  HQASSERT(filter_chain != NULL, "filter_chain is NULL") ;
+  xmlpart_ctxt = xmlg_fc_get_user_data(filter_chain) ;
+  HQASSERT(xmlpart_ctxt != NULL, "no xps xmlpart context") ;
+
+  if ( xmlpart_ctxt->prefetch == NULL ) {
+#if defined(DEBUG_BUILD)
+    if ( (debug_xps & DEBUG_XPS_NO_PREFETCH) != 0 )
+      return TRUE ;
+#endif
+    if ( xmlpart_ctxt->relationships == NULL )
+      return TRUE ;
+    if ( !xps_prefetch_start(xmlpart_ctxt) )
+      return FALSE ;
+    first = TRUE ;
+  }
+
+  if ( xmlpart_ctxt->prefetch->unreferenced == 0 || xmlpart_ctxt->flptr == NULL )
+    return TRUE ;
+
+  return xps_prefetch_lookahead(filter, xmlpart_ctxt->prefetch,
+                                xmlpart_ctxt->flptr, first) ;
+}
+
+Bool xps_prefetch_filter_init(
+      xmlGFilterChain *filter_chain,
+      uint32 position,
+      xmlGFilter **filter,
+      xmlDocumentContext *xps_ctxt)
+{
+  xmlGFilter *new_filter ;
+
+  HQASSERT(filter_chain != NULL, "filter_chain is NULL") ;
+  HQASSERT(filter != NULL, "filter is NULL") ;
+  HQASSERT(xps_ctxt != NULL, "xps_ctxt is NULL") ;
+
+  *filter = NULL ;
+
+  if (! xmlg_fc_new_filter(filter_chain, &new_filter, position, xps_ctxt,
+                           NULL /* no dispose callback */))
+    return error_handler(UNDEFINED) ;
+
+  /* watch all elements */
+  if (! xmlg_register_start_element_cb(new_filter, NULL, NULL, /* all elements */
+                                       xps_prefetch_start_element)) {
+    xmlg_f_destroy(&new_filter) ;
+    return error_handler(UNDEFINED) ;
+  }
+
+  *filter = new_filter ;
+
+  return TRUE ;
+}
+
+void xps_prefetch_free(
+      xps_prefetch_t **prefetch)
+{
+  HQASSERT(prefetch != NULL, "Nowhere to find prefetch state") ;
+
+  if ( *prefetch != NULL ) {
+    mm_free(mm_xml_pool, *prefetch, sizeof(xps_prefetch_t)) ;
+    *prefetch = NULL ;
+  }
+}
+
+/* ============================================================================
+* Log stripped */
@@ -633,5 +633,43 @@ xps_partname_t *xps_rels_get_target(
   return relationship->target ;
 }
 
+Bool xps_enumerate_relationship_type(
+      xpsRelationshipsBlock *rels_block,
+      xmlGIStr *type,
+      xps_relationship_enum_fn *enum_fn,
+      void *data)
+{
+  uint32 hval ;
+  struct xpsRelationship *curr ;
+  relationships_parser_t *relationships_parser ;
+
+  HQASSERT(rels_block != NULL, "rels_block is NULL") ;
+  HQASSERT(type != NULL, "type is NULL") ;
+  HQASSERT(enum_fn != NULL, "enum_fn is NULL") ;
+
+  /* Relationships parts are small, so read the rest of the stream now
+     rather than trying to enumerate incrementally. */
+  relationships_parser = rels_block->relationships_parser ;
+  if (relationships_parser != NULL) {
+    while (relationships_parser->more_data) {
+      if (! xml_parse_chunk(relationships_parser->chunk_parser,
+                            &(relationships_parser->more_data))) {
+        /* Don't leave a failed parser for later lookups to resume. */
+        (void)xps_xml_close_relationships_parser(&(rels_block->relationships_parser),
+                                                 TRUE) ;
+        return FALSE ;
+      }
+    }
+  }
+
+  for (curr = find_via_type(rels_block, type, &hval) ;
+       curr != NULL ; curr = curr->next_via_type) {
+    if (type == curr->type && ! (*enum_fn)(curr, data))
+      return FALSE ;
+  }
+
+  return TRUE ;
+}
+
 /* ============================================================================
 * Log stripped */
@@ -251,6 +251,11 @@ Bool xps_xml_to_double(
 
   *error_result = 0 ;
 
+  /* Nearly all numbers in XPS markup are short plain decimals. */
+  if ( xml_scan_decimal_fast(input, type != xps_prn, type != xps_dec,
+                             p_double) )
+    return TRUE ;
+
   scan = *input ;
   if ( scan.unitlength == 0 )
     return xps_scan_numeric_error(RANGECHECK, error_result) ;
@@ -969,6 +974,34 @@ Bool convert_point(
 
 }
 
+/* abbr_convert_point() - the abbreviated geometry version of
+ * convert_point(). Path data is dominated by coordinate pairs, so this goes
+ * straight to the numeric scanner and matches the usual comma separator
+ * inline.
+ */
+static inline
+Bool abbr_convert_point(
+  utf8_buffer*  scan,
+  SYSTEMVALUE*  point)
+{
+  int32 error_result ;
+
+  if ( !xps_xml_to_double(scan, &point[0], xps_rn, &error_result) )
+    return error_handler(error_result) ;
+
+  if ( scan->unitlength > 0 && scan->codeunits[0] == ',' ) {
+    ++scan->codeunits ;
+    --scan->unitlength ;
+    (void)xml_match_space(scan) ; /* Zero or more trailing spaces */
+  } else if ( !xps_match_scs_collapse(scan) )
+    return error_handler(SYNTAXERROR) ;
+
+  if ( !xps_xml_to_double(scan, &point[1], xps_rn, &error_result) )
+    return error_handler(error_result) ;
+
+  return TRUE ;
+}
+
 /* From XPS 0.90 s0schema.xsd
     <!-- Point: 2 numbers, separated by , and arbitrary whitespace -->
     <xs:simpleType name="ST_Point">
@@ -1945,7 +1978,14 @@ static Bool convert_abbr_path(xmlGFilter *filter,
     utf8_buffer scan_retry = scan;
     int32 op;
 
-    op = utf8_iterator_get_next(&scan);
+    /* Path operators are all ASCII, so only decode a UTF-8 sequence if
+       the data is junk. */
+    if ( scan.codeunits[0] < 0x80 ) {
+      op = scan.codeunits[0] ;
+      ++scan.codeunits ;
+      --scan.unitlength ;
+    } else
+      op = utf8_iterator_get_next(&scan);
 
     /* All op's can be followed by whitespace, with collapse */
     (void)xml_match_space(&scan) ;
@@ -1981,8 +2021,8 @@ static Bool convert_abbr_path(xmlGFilter *filter,
 
     case 'm': /* Moveto: m x,y */
 
-      /* convert_point raises PS error. */
-      if (! convert_point(filter, attrlocalname, &scan, &args[0]))
+      /* abbr_convert_point raises PS error. */
+      if (! abbr_convert_point(&scan, &args[0]))
         return FALSE;
 
       currentpoint[0] += args[0];
@@ -1996,8 +2036,8 @@ static Bool convert_abbr_path(xmlGFilter *filter,
 
     case 'M': /* Moveto: M x,y */
 
-      /* convert_point raises PS error. */
-      if (! convert_point(filter, attrlocalname, &scan, &currentpoint[0]) ||
+      /* abbr_convert_point raises PS error. */
+      if (! abbr_convert_point(&scan, &currentpoint[0]) ||
           ! gs_moveto(TRUE, currentpoint, path))
         return FALSE;
 
@@ -2006,8 +2046,8 @@ static Bool convert_abbr_path(xmlGFilter *filter,
 
     case 'l': /* Lineto: l x,y */
 
-      /* convert_point raises PS error. */
-      if (! convert_point(filter, attrlocalname, &scan, &args[0]))
+      /* abbr_convert_point raises PS error. */
+      if (! abbr_convert_point(&scan, &args[0]))
         return FALSE;
 
       currentpoint[0] += args[0];
@@ -2020,7 +2060,7 @@ static Bool convert_abbr_path(xmlGFilter *filter,
 
     case 'L': /* Lineto: L x,y */
 
-      if (! convert_point(filter, attrlocalname, &scan, &currentpoint[0]) ||
+      if (! abbr_convert_point(&scan, &currentpoint[0]) ||
           ! gs_lineto(TRUE, TRUE, currentpoint, path))
         return FALSE;
 
@@ -2072,19 +2112,19 @@ static Bool convert_abbr_path(xmlGFilter *filter,
 
     case 'C': /* Cubic bezier curve: C x1,y1 x2,y2 x3,y3 */
 
-      if (! convert_point(filter, attrlocalname, &scan, &args[0]))
+      if (! abbr_convert_point(&scan, &args[0]))
         return FALSE;
 
       if (xml_match_space(&scan) == 0)
         return error_handler(SYNTAXERROR) ;
 
-      if (! convert_point(filter, attrlocalname, &scan, &args[2]))
+      if (! abbr_convert_point(&scan, &args[2]))
         return FALSE;
 
       if (xml_match_space(&scan) == 0)
         return error_handler(SYNTAXERROR) ;
 
-      if (! convert_point(filter, attrlocalname, &scan, &args[4]))
+      if (! abbr_convert_point(&scan, &args[4]))
         return FALSE;
 
       if (! absolute) {
@@ -2114,13 +2154,13 @@ static Bool convert_abbr_path(xmlGFilter *filter,
 
     case 'Q': /* Quadratic bezier curve: Q x1,y1 x2,y2 */
 
-      if (! convert_point(filter, attrlocalname, &scan, &args[0]))
+      if (! abbr_convert_point(&scan, &args[0]))
         return FALSE;
 
       if (xml_match_space(&scan) == 0)
         return error_handler(SYNTAXERROR) ;
 
-      if (! convert_point(filter, attrlocalname, &scan, &args[2]))
+      if (! abbr_convert_point(&scan, &args[2]))
         return FALSE;
 
       if (! absolute) {
@@ -2145,13 +2185,13 @@ static Bool convert_abbr_path(xmlGFilter *filter,
 
     case 'S': /* Smooth cubic bezier curve: S x1,y1 x2,y2 */
 
-      if (! convert_point(filter, attrlocalname, &scan, &args[2]))
+      if (! abbr_convert_point(&scan, &args[2]))
         return FALSE;
 
       if (xml_match_space(&scan) == 0)
         return error_handler(SYNTAXERROR) ;
 
-      if (! convert_point(filter, attrlocalname, &scan, &args[4]))
+      if (! abbr_convert_point(&scan, &args[4]))
         return FALSE;
 
       if (bezier_last) {
@@ -2229,7 +2269,7 @@ static Bool convert_abbr_path(xmlGFilter *filter,
       if (xml_match_space(&scan) == 0)
         return error_handler(SYNTAXERROR) ;
 
-      if (! convert_point(filter, attrlocalname, &scan, &args[3]))
+      if (! abbr_convert_point(&scan, &args[3]))
         return FALSE;
 
       if (! absolute) {
@@ -88,6 +88,38 @@ typedef struct HTI {
   DITHERTABLES pHTables[OIL_MAXSCREENOBJECTS];
 } HTI ;
 
+/** @brief The halftone instance this example hands back to the RIP.
+ *
+ * The RIP allocates instances of \c sw_htm_api::info.instance_size bytes, so
+ * subclassing the instance lets @c DoHalftone() find its threshold tables
+ * directly rather than searching for the instance.
+ */
+typedef struct OIL_HTM_INSTANCE {
+  sw_htm_instance super ;     /*!< The RIP's instance. Must be first. */
+  HTI *pHTI ;                 /*!< The threshold tables for this instance. */
+} OIL_HTM_INSTANCE ;
+
+/** @brief Screen a band of lines through a stack of threshold cells.
+ *
+ * This is the work of @c DoHalftone() for the multi-level examples. Each
+ * pixel set in the mask bitmap is compared against the threshold cells for
+ * its object type, and the resulting level is packed into the destination
+ * channel at @a uDstDepth bits per pixel. Pixels outside the mask are left
+ * untouched. It is reentrant, so may be called for several bands at once.
+ *
+ * \param[in]  pHTI             The threshold tables to use.
+ * \param[in]  request          The RIP's halftoning request.
+ * \param[in]  uDstDepth        Destination bits per pixel, 1, 2 or 4.
+ * \param[in]  fScreenUnmarked  If FALSE, pixels with no object properties
+ *                              are set to level 0; if TRUE they are screened
+ *                              with the image cells.
+ * \return     TRUE when the lines have been screened.
+ */
+HqBool htm_screen_lines(const HTI *pHTI,
+                        const sw_htm_dohalftone_request *request,
+                        unsigned int uDstDepth,
+                        HqBool fScreenUnmarked);
+
 /* interface function prototypes */
 /* 4-bpp */
 sw_htm_api *htm4bpp_getInstance();
@@ -238,8 +238,10 @@ static sw_htm_result RIPCALL doHalftoneSelect(sw_htm_instance *instance,
   instance->num_src_channels = instance->num_dst_channels = 1 ;
   instance->process_empty_bands = FALSE ;
 
-  /* Finally, store this instance in the screen table. */
+  /* Finally, store this instance in the screen table, and the table in
+     the instance so DoHalftone() can find it. */
   ourInst->selected = instance ;
+  ((OIL_HTM_INSTANCE *)instance)->pHTI = ourInst ;
 
   return SW_HTM_SUCCESS ;
 }
@@ -262,27 +264,18 @@ static sw_htm_result RIPCALL doHalftoneSelect(sw_htm_instance *instance,
 
 static void RIPCALL doHalftoneRelease(sw_htm_instance *instance)
 {
-  int i ;
+  HTI *ourInst ;
 
   HQASSERT(NULL != instance , "No halftone instance") ;
 
-  /* Locate the instance in our list. If we had many entries and did not want
-     to search all of them for the selected entry, we could subclass the
-     instance, and put the screen index or a table pointer into the subclass.
-     We would then downcast the instance pointer to the subclass and extract
-     the screen index or table pointer in two lines of code. */
-  for ( i = 0 ; i < 4 ; i++ )
-  {
-    HTI *ptr = g_4bppHTI[ i ];
-
-    if ( ptr->selected == instance )
-    {
-      ptr->selected = NULL ;
-      break ;
-    }
-  }
+  /* Our instances are subclassed, so the table entry comes straight from
+     the instance. */
+  ourInst = ((OIL_HTM_INSTANCE *)instance)->pHTI ;
 
-  HQASSERT(i < 4, "Failed to find halftone instance") ;
+  HQASSERT(NULL != ourInst && ourInst->selected == instance,
+           "Failed to find halftone instance") ;
+  if ( NULL != ourInst && ourInst->selected == instance )
+    ourInst->selected = NULL ;
 }
 
 /** @brief Implementation of RenderInitiation().
@@ -352,7 +345,7 @@ sw_htm_api *htm4bpp_getInstance()
   htmApi.info.version = SW_HTM_API_VERSION_20071110 ;
   htmApi.info.name = (uint8*)"htm4bpp" ;
   htmApi.info.display_name = (uint8*)"htm4bpp example screening module" ;
-  htmApi.info.instance_size = sizeof(sw_htm_instance);
+  htmApi.info.instance_size = sizeof(OIL_HTM_INSTANCE);
 
   htmApi.HalftoneSelect = doHalftoneSelect ;
   htmApi.HalftoneRelease = doHalftoneRelease ;
@@ -0,0 +1,233 @@
+/* Copyright (C) 2014 Global Graphics Software Ltd. All rights reserved.
+ *
+ * This example is provided on an "as is" basis and without
+ * warranty of any kind. Global Graphics Software Ltd. does not
+ * warrant or make any representations regarding the use or results
+ * of use of this example.
+ *
+ * $HopeName: SWebd_OIL_example_gg!src:oil_htmscreen.c(EBDSDK_P.1) $
+ */
+/*! \file
+ *  \ingroup OIL
+ *  \brief Multi-level threshold screening engine for the HTM examples.
+ *
+ * The 2bpp and 4bpp example screening modules both compare each contone
+ * pixel against a stack of threshold cells chosen by the pixel's object
+ * type. This file does that work for both of them, a whole line at a time.
+ *
+ * The mask and destination rasters are processed a raster unit at a time
+ * rather than a pixel at a time: units with no mask bits set are skipped
+ * outright, each destination unit is assembled in a register and written
+ * once, and the cell rows and columns are tracked incrementally along the
+ * line instead of being found by division for every pixel. The engine keeps
+ * no state between calls, so the RIP may call it for different bands from
+ * several render threads at once.
+ */
+
+#include "oil.h"
+#include "pms_export.h"
+#include "oil_htm.h"
+#include "swrle.h"
+
+/** @brief Object table entry for pixels which are not screened. */
+#define HTM_OBJ_NONE (-1)
+
+/** @brief The maximum number of threshold levels in a DITHERTABLES entry. */
+#define HTM_MAX_LEVELS (15)
+
+/** @brief Position in one object type's threshold cells along a line. */
+typedef struct HTM_LINECELL {
+  const unsigned char *apRow[HTM_MAX_LEVELS]; /*!< Cell row for each output level. */
+  unsigned int uWidth;                        /*!< Cell width in pixels. */
+  unsigned int uCol;                          /*!< Column in the cell of the current pixel. */
+} HTM_LINECELL;
+
+/** @brief Find the output level for a source value.
+ *
+ * Start at the highest threshold level and work down until the source value
+ * is greater than the threshold. That level is the output level. A source
+ * value of 255 is always the highest level, and 0 is always level 0.
+ */
+static unsigned int htm_level(const HTM_LINECELL *pCell, unsigned int uSrc,
+                              unsigned int uLevels)
+{
+  unsigned int s;
+
+  if ( uSrc == 255 )
+    return uLevels;
+
+  if ( uSrc != 0 )
+  {
+    for ( s = uLevels ; s > 0 ; --s )
+    {
+      if ( uSrc > pCell->apRow[s - 1][pCell->uCol] )
+        return s;
+    }
+  }
+
+  return 0;
+}
+
+/** @brief Move all of the cells on by a number of pixels along the line. */
+static void htm_advance(HTM_LINECELL *aCells, unsigned int uPixels)
+{
+  int obj;
+
+  for ( obj = 0 ; obj < OIL_MAXSCREENOBJECTS ; obj++ )
+  {
+    HTM_LINECELL *pCell = &aCells[obj];
+
+    pCell->uCol = (pCell->uCol + uPixels) % pCell->uWidth;
+  }
+}
+
+HqBool htm_screen_lines(const HTI *pHTI,
+                        const sw_htm_dohalftone_request *request,
+                        unsigned int uDstDepth,
+                        HqBool fScreenUnmarked)
+{
+  const sw_htm_render_info *render_info = request->render_info;
+  const unsigned int uLevels = (1u << uDstDepth) - 1;
+  const unsigned int uPixPerUnit = SW_HTM_RASTER_UNIT_BITS / uDstDepth;
+  const sw_htm_raster_unit uTopBit =
+    (sw_htm_raster_unit)1 << (SW_HTM_RASTER_UNIT_BITS - 1);
+  const sw_htm_raster_unit uAllBits = ~(sw_htm_raster_unit)0;
+  HTM_LINECELL aCells[OIL_MAXSCREENOBJECTS];
+  signed char aObjTable[256];
+  sw_htm_coord lineY = request->first_line_y;
+  sw_htm_coord width = render_info->width;
+  uint32 iLine;
+  int obj, map;
+
+  HQASSERT(NULL != pHTI, "No halftone tables");
+  HQASSERT(uLevels <= HTM_MAX_LEVELS, "Too many output levels for the tables");
+  HQASSERT(SW_HTM_RASTER_UNIT_BITS % uDstDepth == 0,
+           "Destination depth does not divide a raster unit");
+  HQASSERT(render_info->src_bit_depth == 8 || render_info->src_bit_depth == 16,
+           "Unsupported source depth");
+
+  if ( request->msk_hint == SW_HTM_MASKHINT_ALL_OFF )
+    return TRUE;
+
+  /* Decide once which cells each object properties value uses, rather than
+     testing the object bits for every pixel. */
+  for ( map = 0 ; map < 256 ; map++ )
+  {
+    if ( map == 0 && !fScreenUnmarked )
+      aObjTable[map] = HTM_OBJ_NONE;
+    else if ( (map & RLE_TEXT_OBJECT) != 0 )
+      aObjTable[map] = GG_OBJ_TEXT;
+    else if ( (map & RLE_LW_OBJECT) != 0 )
+      aObjTable[map] = GG_OBJ_GFX;
+    else /* RLE_VIGNETTE_OBJECT | RLE_IMAGE_OBJECT | RLE_COMPOSITED_OBJECT */
+      aObjTable[map] = GG_OBJ_IMAGE;
+  }
+
+  for ( iLine = 0 ; iLine < request->num_lines ; iLine++, lineY++ )
+  {
+    const sw_htm_raster_unit *pMsk = request->msk_bitmap
+      + (iLine * render_info->msk_linebytes / sizeof(sw_htm_raster_unit));
+    sw_htm_raster_unit *pDst = request->dst_channels[0]
+      + (iLine * render_info->dst_linebytes / sizeof(sw_htm_raster_unit));
+    const uint8 *pSrc8 = (const uint8 *)request->src_channels[0]
+      + (iLine * render_info->src_linebytes);
+    const uint16 *pSrc16 = (const uint16 *)pSrc8;
+    const uint8 *pObjMap = NULL;
+    sw_htm_coord x0;
+
+    if ( request->object_props_map != NULL )
+      pObjMap = (const uint8 *)request->object_props_map
+        + (iLine * render_info->src_linebytes);
+
+    /* Point at this line's row of each cell. */
+    for ( obj = 0 ; obj < OIL_MAXSCREENOBJECTS ; obj++ )
+    {
+      const DITHERTABLES *pTable = &pHTI->pHTables[obj];
+      const unsigned char *const *apCell = *pTable->ditherMatrix;
+      unsigned int uRowOffset = (lineY % pTable->uHeight) * pTable->uWidth;
+      unsigned int s;
+
+      for ( s = 0 ; s < uLevels ; s++ )
+        aCells[obj].apRow[s] = apCell[s] + uRowOffset;
+      aCells[obj].uWidth = pTable->uWidth;
+      aCells[obj].uCol = 0;
+    }
+
+    for ( x0 = 0 ; x0 < width ; x0 += SW_HTM_RASTER_UNIT_BITS )
+    {
+      unsigned int uPixels = SW_HTM_RASTER_UNIT_BITS;
+      sw_htm_raster_unit uMask;
+      unsigned int d;
+
+      if ( request->msk_hint == SW_HTM_MASKHINT_ALL_ON )
+        uMask = uAllBits;
+      else
+        uMask = *pMsk;
+      pMsk++;
+
+      /* Ignore any mask bits beyond the end of the line. */
+      if ( (sw_htm_coord)uPixels > width - x0 )
+      {
+        uPixels = (unsigned int)(width - x0);
+        uMask &= ~(uAllBits >> uPixels);
+      }
+
+      if ( uMask == 0 )
+      {
+        htm_advance(aCells, uPixels);
+        pDst += uDstDepth;
+        continue;
+      }
+
+      /* Each mask unit covers uDstDepth destination units. */
+      for ( d = 0 ; d < uDstDepth && d * uPixPerUnit < uPixels ; d++, pDst++ )
+      {
+        sw_htm_raster_unit uOut = 0, uSet = 0;
+        unsigned int i, uFirst = d * uPixPerUnit;
+        unsigned int uShift = SW_HTM_RASTER_UNIT_BITS;
+        sw_htm_raster_unit uBit = uTopBit >> uFirst;
+
+        for ( i = 0 ; i < uPixPerUnit && uFirst + i < uPixels ;
+              i++, uBit >>= 1 )
+        {
+          sw_htm_coord x = x0 + uFirst + i;
+
+          uShift -= uDstDepth;
+
+          if ( (uMask & uBit) != 0 )
+          {
+            int objtype = pObjMap != NULL ? aObjTable[pObjMap[x]] : GG_OBJ_IMAGE;
+
+            uSet |= (sw_htm_raster_unit)uLevels << uShift;
+
+            if ( objtype != HTM_OBJ_NONE )
+            {
+              unsigned int uSrc = render_info->src_bit_depth == 8
+                ? pSrc8[x] : (unsigned int)(pSrc16[x] >> 8);
+
+              uOut |= (sw_htm_raster_unit)htm_level(&aCells[objtype], uSrc,
+                                                    uLevels) << uShift;
+            }
+          }
+
+          for ( obj = 0 ; obj < OIL_MAXSCREENOBJECTS ; obj++ )
+          {
+            if ( ++aCells[obj].uCol == aCells[obj].uWidth )
+              aCells[obj].uCol = 0;
+          }
+        }
+
+        if ( uSet == uAllBits )
+          *pDst = uOut;
+        else if ( uSet != 0 )
+          *pDst = (*pDst & ~uSet) | uOut;
+      }
+
+      /* Skip destination units wholly beyond the end of the line. */
+      pDst += uDstDepth - d;
+    }
+  }
+
+  return TRUE;
+}
+
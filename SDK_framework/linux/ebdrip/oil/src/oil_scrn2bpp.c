@@ -21,8 +21,6 @@
 #include <string.h>
 #include <stdio.h>
 
-extern HTI* g_2bppHTI[];
-
 /** @brief Implementation of DoHalftone().
  *
  * This is the function which actually actions a request for halftoning.
@@ -43,16 +41,7 @@ extern HTI* g_2bppHTI[];
 HqBool RIPCALL do2bppHalftone(sw_htm_instance *instance,
                               const sw_htm_dohalftone_request *request)
 {
-  static uint8 anClearPix[4]     = {0x3f, 0xcf, 0xf3, 0xfc};
-  static uint8 anSetPixLevel[3][4] = { {0x40, 0x10, 0x04, 0x01},
-                                       {0x80, 0x20, 0x08, 0x02},
-                                       {0xc0, 0x30, 0x0c, 0x03} };
-  sw_htm_coord  lineY = request->first_line_y ;
-  uint32        iLine ;
-
-  int           i ;
-  int32 x;
-  HTI           *ourInst = NULL ;
+  HTI           *ourInst ;
 
   HQASSERT(NULL != request, "") ;
   HQASSERT(NULL != instance , "") ;
@@ -73,20 +62,11 @@ HqBool RIPCALL do2bppHalftone(sw_htm_instance *instance,
   /* At the moment, the mask must always be present. */
   HQASSERT(NULL != request->msk_bitmap , "") ;
 
-  /* Locate the instance in our list. If we had many entries and did not want
-     to search all of them for the selected entry, we could subclass the
-     instance, and put the screen index or a table pointer into the subclass.
-     We would then downcast the instance pointer to the subclass and extract
-     the screen index or table pointer in two lines of code. */
-  for ( i = 0 ; i < 4 ; i++ )
-  {  HTI *ptr = g_2bppHTI[ i ];
-     if ( ptr->selected == instance )
-     { ourInst = ptr ;
-       break ;
-     }
-  }
+  /* Our instances are subclassed, so the tables come straight from the
+     instance. */
+  ourInst = ((OIL_HTM_INSTANCE *)instance)->pHTI ;
 
-  if (!ourInst)
+  if (!ourInst || ourInst->selected != instance)
   { request->DoneHalftone( request, SW_HTM_ERROR_BAD_HINSTANCE ) ;
     return FALSE ;
   }
@@ -112,120 +92,7 @@ HqBool RIPCALL do2bppHalftone(sw_htm_instance *instance,
       colorant = 0;
 #endif
 
-  /* Now, for each line */
-  for (iLine = 0; iLine < request->num_lines ; iLine++, lineY++ )
-  {
-    sw_htm_raster_ptr pMsk = request->msk_bitmap
-                          + ( iLine * request->render_info->msk_linebytes
-                              / sizeof(sw_htm_raster_unit) ) ;
-
-    sw_htm_raster_ptr pDst = request->dst_channels[ 0 ]
-                          + ( iLine * request->render_info->dst_linebytes
-                              / sizeof(sw_htm_raster_unit) ) ;
-
-    uint8* pSrc = (uint8*)request->src_channels[ 0 ]
-                          + ( iLine *request->render_info->src_linebytes );
-    uint8* pDest8 = (uint8*)pDst;
-
-    uint8* pObjMap = (uint8*)request->object_props_map + ( iLine * request->render_info->src_linebytes );
-
-
-    /* The index into the vertical axis of the cell for this line. */
-    int32 celloffset;
-    const uint8 **ppCell;
-    int32 s;
-    int32 scnSize;
-    uint32 x32 = 0x80000000;
-    uint8 uSrc = 0;
-    uint8 uMap = 0;
-#ifdef LOWBYTEFIRST
-    int8 anSwap[16] = {
-      3, 3, 3, 3,
-      1, 1, 1, 1,
-      -1, -1, -1, -1,
-      -3, -3, -3, -3 };
-#endif
-
-    for(x = 0; x < request->render_info->width; x++)
-    {
-        if(*pMsk & x32)
-        {
-#ifdef LOWBYTEFIRST
-            pDest8 = (uint8*)pDst + (x>>2) + anSwap[x&15];
-#else
-            pDest8 = (uint8*)pDst + (x>>2);
-#endif
-            /* clear the pixel in the byte */
-            *pDest8 &= anClearPix[x%4];
-            uMap = pObjMap[x];
-            if(uMap)
-            {
-              uSrc = pSrc[x];
-              /* Find the byte in the screen pattern cell that contains the first level threshold value */
-              if(uMap & RLE_TEXT_OBJECT)
-              {
-                  celloffset = (((lineY % ourInst->pHTables[GG_OBJ_TEXT].uHeight) * ourInst->pHTables[GG_OBJ_TEXT].uWidth)
-                               + (x % ourInst->pHTables[GG_OBJ_TEXT].uWidth));
-                  ppCell = &(*ourInst->pHTables[GG_OBJ_TEXT].ditherMatrix)[2];
-                  scnSize = (ourInst->pHTables[GG_OBJ_TEXT].uWidth * ourInst->pHTables[GG_OBJ_TEXT].uHeight);
-              }
-              else if(uMap & RLE_LW_OBJECT)
-              {
-                  celloffset = (((lineY % ourInst->pHTables[GG_OBJ_GFX].uHeight) * ourInst->pHTables[GG_OBJ_GFX].uWidth)
-                               + (x % ourInst->pHTables[GG_OBJ_GFX].uWidth));
-                  ppCell = &(*ourInst->pHTables[GG_OBJ_GFX].ditherMatrix)[2];
-                  scnSize = (ourInst->pHTables[GG_OBJ_GFX].uWidth * ourInst->pHTables[GG_OBJ_GFX].uHeight);
-              }
-              else /* RLE_VIGNETTE_OBJECT | RLE_IMAGE_OBJECT | RLE_COMPOSITED_OBJECT */
-              {
-                  celloffset = (((lineY % ourInst->pHTables[GG_OBJ_IMAGE].uHeight) * ourInst->pHTables[GG_OBJ_IMAGE].uWidth)
-                               + (x % ourInst->pHTables[GG_OBJ_IMAGE].uWidth));
-                  ppCell = &(*ourInst->pHTables[GG_OBJ_IMAGE].ditherMatrix)[2];
-                  scnSize = (ourInst->pHTables[GG_OBJ_IMAGE].uWidth * ourInst->pHTables[GG_OBJ_IMAGE].uHeight);
-              }
-
-#ifdef GG_OBJ_TYPES
-              uaMaps[uMap]++;
-#endif
-
-              if(uSrc==255)
-              {
-                 *pDest8 |= anSetPixLevel[2][x%4];
-              }
-              else if(uSrc)
-              {
-                /* Start at the third threshold value, and work backwards until the source value
-                   is greater than the threshold value. This level is the output level, 1, 2 or 3. */
-                for(s=2;s>=0;s--)
-                {
-                  if(uSrc > (*ppCell)[celloffset])
-                  {
-                    *pDest8 |= anSetPixLevel[s][x%4];
-                    break;
-                  }
-                  ppCell--; 
-                }
-              }
-            }
-        }
-
-        x32>>=1;
-        if(x32==0)
-        {
-            x32 = 0x80000000;
-            pMsk++;
-        }
-
-    }
-  } /* for each line */
-
-#ifdef GG_OBJ_TYPES
-  for( x=0; x<256; x++)
-  {
-      if(uaMaps[x])
-          printf("uaMaps[%d]=%d\n", x, uaMaps[x]);
-  }
-#endif
+  htm_screen_lines(ourInst, request, 2, FALSE) ;
 
   request->DoneHalftone( request, SW_HTM_SUCCESS ) ;
 
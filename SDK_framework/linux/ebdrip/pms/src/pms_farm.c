@@ -0,0 +1,453 @@
+/* Copyright (C) 2014 Global Graphics Software Ltd. All rights reserved.
+ *
+ * This example is provided on an "as is" basis and without
+ * warranty of any kind. Global Graphics Software Ltd. does not
+ * warrant or make any representations regarding the use or results
+ * of use of this example.
+ */
+
+/*! \file
+ *  \ingroup PMS
+ *  \brief Run several RIP instances over one list of job files.
+ *
+ * The RIP, the OIL and the PMS all keep the state of the current job in
+ * globals, so a process can only run one RIP instance. To make use of more
+ * cores than the render threads of one instance can, the farm forks a
+ * number of worker processes before any PMS threads are started. Each
+ * worker runs the usual PMS and RIP with an equal share of the RIP memory,
+ * and asks the parent for its next job whenever it finishes one, so a long
+ * job on one instance does not hold up the jobs behind it.
+ *
+ * The parent keeps the job list, hands out jobs in order, and collects the
+ * job count, page count and busy time reported by each instance. When all
+ * of the jobs are done it reports the throughput of every instance.
+ *
+ * The farm is only supported where fork() is available.
+ */
+
+#include "pms.h"
+#include "pms_platform.h"
+#include "pms_farm.h"
+#include <string.h>
+
+#if defined(UNIX) || defined(MACOSX)
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+#define PMS_FARM_SUPPORTED
+#endif
+
+extern int nJobs;
+extern char **aszJobNames;
+
+/*! \brief Most RIP instances the farm will start. */
+#define PMS_FARM_MAX_INSTANCES 64
+
+/*! \brief Report sent from a worker to the parent when it wants a job. */
+typedef struct {
+  int nJob;                 /*!< Index of the job just finished, -1 if none */
+  unsigned int cPages;      /*!< Pages checked in by that job */
+  unsigned long ulTime;     /*!< Time that job took, in milliseconds */
+} PMS_TyFarmReport;
+
+#ifdef PMS_FARM_SUPPORTED
+
+/*! \brief The parent's view of one worker. */
+typedef struct {
+  pid_t pid;                /*!< Worker process */
+  int fdReport;             /*!< Read end of the reports from the worker */
+  int fdJob;                /*!< Write end of the job indices to the worker */
+  int bActive;              /*!< Worker has not exited yet */
+  unsigned int cJobs;       /*!< Jobs completed */
+  unsigned int cPages;      /*!< Pages completed */
+  unsigned long ulBusy;     /*!< Total time spent on jobs, in milliseconds */
+} PMS_TyFarmWorker;
+
+/*! \brief State of this process, when it is a worker. */
+static struct {
+  int bWorker;              /*!< This process is a farm worker */
+  int nInstance;            /*!< Instance number, from 1 */
+  int nInstances;           /*!< Number of instances the farm was asked for */
+  int fdReport;             /*!< Write end of the reports to the parent */
+  int fdJob;                /*!< Read end of the job indices from the parent */
+  int nJob;                 /*!< Index of the current job, -1 if none */
+  unsigned int cPages;      /*!< Pages checked in by the current job */
+  unsigned long ulStart;    /*!< Time the current job was started */
+} l_tFarm = { FALSE, 0, 0, -1, -1, -1, 0, 0 };
+
+/**
+ * \brief Write all of a buffer to a pipe.
+ */
+static int FarmWrite(int fd, const void *pBuffer, size_t cbBuffer)
+{
+  const char *p = pBuffer;
+
+  while(cbBuffer > 0)
+  {
+    ssize_t cbDone = write(fd, p, cbBuffer);
+    if(cbDone < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    p += cbDone;
+    cbBuffer -= (size_t)cbDone;
+  }
+  return TRUE;
+}
+
+/**
+ * \brief Read all of a buffer from a pipe.
+ *
+ * \return FALSE on error, or if the other end was closed.
+ */
+static int FarmRead(int fd, void *pBuffer, size_t cbBuffer)
+{
+  char *p = pBuffer;
+
+  while(cbBuffer > 0)
+  {
+    ssize_t cbDone = read(fd, p, cbBuffer);
+    if(cbDone < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    if(cbDone == 0)
+      return FALSE;
+    p += cbDone;
+    cbBuffer -= (size_t)cbDone;
+  }
+  return TRUE;
+}
+
+/**
+ * \brief Hand out the jobs to the workers until they have all exited.
+ */
+static void FarmDispatch(PMS_TyFarmWorker *aWorkers, int nWorkers)
+{
+  int nNextJob = 0;
+  int nActive = nWorkers;
+  int i;
+
+  while(nActive > 0)
+  {
+    fd_set fdsReady;
+    int fdMax = -1;
+
+    FD_ZERO(&fdsReady);
+    for(i = 0; i < nWorkers; i++)
+    {
+      if(aWorkers[i].bActive)
+      {
+        FD_SET(aWorkers[i].fdReport, &fdsReady);
+        if(aWorkers[i].fdReport > fdMax)
+          fdMax = aWorkers[i].fdReport;
+      }
+    }
+
+    if(select(fdMax + 1, &fdsReady, NULL, NULL, NULL) < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      PMS_SHOW_ERROR("PMS_FarmRun: select failed (%d).\n", errno);
+      break;
+    }
+
+    for(i = 0; i < nWorkers; i++)
+    {
+      PMS_TyFarmWorker *pWorker = &aWorkers[i];
+      PMS_TyFarmReport tReport;
+      int nJob;
+
+      if(!pWorker->bActive || !FD_ISSET(pWorker->fdReport, &fdsReady))
+        continue;
+
+      if(!FarmRead(pWorker->fdReport, &tReport, sizeof(tReport)))
+      {
+        /* The worker has exited, or failed. Any job it had is lost. */
+        close(pWorker->fdReport);
+        close(pWorker->fdJob);
+        pWorker->bActive = FALSE;
+        nActive--;
+        continue;
+      }
+
+      if(tReport.nJob >= 0)
+      {
+        pWorker->cJobs++;
+        pWorker->cPages += tReport.cPages;
+        pWorker->ulBusy += tReport.ulTime;
+      }
+
+      nJob = (nNextJob < nJobs) ? nNextJob++ : -1;
+      if(nJob >= 0)
+        PMS_SHOW("Farm: instance %d takes job %s\n", i + 1, aszJobNames[nJob]);
+
+      if(!FarmWrite(pWorker->fdJob, &nJob, sizeof(nJob)))
+        PMS_SHOW_ERROR("PMS_FarmRun: Failed to send job to instance %d.\n", i + 1);
+    }
+  }
+
+  /* Tidy up anything left after an error. */
+  for(i = 0; i < nWorkers; i++)
+  {
+    if(aWorkers[i].bActive)
+    {
+      close(aWorkers[i].fdReport);
+      close(aWorkers[i].fdJob);
+      aWorkers[i].bActive = FALSE;
+    }
+  }
+}
+
+/**
+ * \brief Report the throughput of each instance, and of the whole farm.
+ */
+static void FarmReport(PMS_TyFarmWorker *aWorkers, int nWorkers, unsigned long ulElapsed)
+{
+  unsigned int cJobs = 0, cPages = 0;
+  int i;
+
+  PMS_SHOW("\nFarm throughput:\n");
+  for(i = 0; i < nWorkers; i++)
+  {
+    PMS_TyFarmWorker *pWorker = &aWorkers[i];
+
+    PMS_SHOW(" Instance %d: %u jobs, %u pages, busy %lu ms, %.1f pages/min\n",
+             i + 1, pWorker->cJobs, pWorker->cPages, pWorker->ulBusy,
+             pWorker->ulBusy > 0 ? pWorker->cPages * 60000.0 / pWorker->ulBusy : 0.0);
+    cJobs += pWorker->cJobs;
+    cPages += pWorker->cPages;
+  }
+  PMS_SHOW(" Total: %u jobs, %u pages in %lu ms, %.1f pages/min\n",
+           cJobs, cPages, ulElapsed,
+           ulElapsed > 0 ? cPages * 60000.0 / ulElapsed : 0.0);
+}
+
+#endif /* PMS_FARM_SUPPORTED */
+
+/**
+ * \brief Start a farm of RIP instances to run the job files on the command line.
+ *
+ * Must be called before any PMS threads are started. Each worker is given an
+ * equal share of the RIP memory.\n
+ * \param[in] nInstances Number of RIP instances to run.
+ * \return TRUE if the calling process should go on to run jobs as usual,
+ *         which is the case in the workers and if no farm was started.
+ *         FALSE in the parent, once all of the jobs have been run.
+ */
+int PMS_FarmRun(int nInstances)
+{
+#ifdef PMS_FARM_SUPPORTED
+  PMS_TyFarmWorker aWorkers[PMS_FARM_MAX_INSTANCES];
+  unsigned long ulStart;
+  int nWorkers, i;
+
+  if(nInstances <= 1)
+    return TRUE;
+
+  if(nJobs <= 0)
+  {
+    PMS_SHOW_ERROR("PMS_FarmRun: The farm only runs job files given on the command line.\n");
+    return TRUE;
+  }
+
+  if(nInstances > PMS_FARM_MAX_INSTANCES)
+    nInstances = PMS_FARM_MAX_INSTANCES;
+  if(nInstances > nJobs)
+    nInstances = nJobs;
+
+  /* Share the RIP memory between the instances. */
+  g_tSystemInfo.cbRIPMemory /= (unsigned int)nInstances;
+  if(g_tSystemInfo.cbRIPMemory < MIN_REQUIRED_RIP_MEM)
+  {
+    PMS_SHOW_ERROR("PMS_FarmRun: RIP memory per instance raised to the minimum of %d bytes.\n",
+                   MIN_REQUIRED_RIP_MEM);
+    g_tSystemInfo.cbRIPMemory = MIN_REQUIRED_RIP_MEM;
+  }
+
+  /* Don't let the workers inherit anything still buffered for output. */
+  fflush(stdout);
+  fflush(stderr);
+
+  ulStart = PMS_TimeInMilliSecs();
+
+  for(nWorkers = 0; nWorkers < nInstances; nWorkers++)
+  {
+    PMS_TyFarmWorker *pWorker = &aWorkers[nWorkers];
+    int afdReport[2], afdJob[2];
+
+    if(pipe(afdReport) != 0)
+      break;
+    if(pipe(afdJob) != 0)
+    {
+      close(afdReport[0]);
+      close(afdReport[1]);
+      break;
+    }
+
+    pWorker->pid = fork();
+    if(pWorker->pid < 0)
+    {
+      close(afdReport[0]);
+      close(afdReport[1]);
+      close(afdJob[0]);
+      close(afdJob[1]);
+      break;
+    }
+
+    if(pWorker->pid == 0)
+    {
+      /* The worker keeps only its own ends of its own pipes. */
+      for(i = 0; i < nWorkers; i++)
+      {
+        close(aWorkers[i].fdReport);
+        close(aWorkers[i].fdJob);
+      }
+      close(afdReport[0]);
+      close(afdJob[1]);
+
+      l_tFarm.bWorker = TRUE;
+      l_tFarm.nInstance = nWorkers + 1;
+      l_tFarm.nInstances = nInstances;
+      l_tFarm.fdReport = afdReport[1];
+      l_tFarm.fdJob = afdJob[0];
+      l_tFarm.nJob = -1;
+      return TRUE;
+    }
+
+    close(afdReport[1]);
+    close(afdJob[0]);
+    pWorker->fdReport = afdReport[0];
+    pWorker->fdJob = afdJob[1];
+    pWorker->bActive = TRUE;
+    pWorker->cJobs = 0;
+    pWorker->cPages = 0;
+    pWorker->ulBusy = 0;
+  }
+
+  if(nWorkers == 0)
+  {
+    PMS_SHOW_ERROR("PMS_FarmRun: Failed to start any RIP instances, running jobs in this process.\n");
+    g_tSystemInfo.cbRIPMemory *= (unsigned int)nInstances;
+    return TRUE;
+  }
+  if(nWorkers < nInstances)
+    PMS_SHOW_ERROR("PMS_FarmRun: Only started %d of %d RIP instances.\n", nWorkers, nInstances);
+
+  FarmDispatch(aWorkers, nWorkers);
+
+  for(i = 0; i < nWorkers; i++)
+  {
+    while(waitpid(aWorkers[i].pid, NULL, 0) < 0 && errno == EINTR)
+      ;
+  }
+
+  FarmReport(aWorkers, nWorkers, PMS_TimeInMilliSecs() - ulStart);
+
+  return FALSE;
+#else
+  if(nInstances > 1)
+    PMS_SHOW_ERROR("PMS_FarmRun: The farm is not supported on this platform.\n");
+  return TRUE;
+#endif
+}
+
+/**
+ * \brief Is this process a farm worker?
+ */
+int PMS_FarmIsWorker(void)
+{
+#ifdef PMS_FARM_SUPPORTED
+  return l_tFarm.bWorker;
+#else
+  return FALSE;
+#endif
+}
+
+/**
+ * \brief Get the numbers this process should give its jobs.
+ *
+ * Job numbers name the output files, and all of the instances write to the
+ * same directory. So each worker numbers its jobs from its instance number,
+ * in steps of the number of instances, which keeps the numbers unique across
+ * the farm even when one job file holds several jobs.\n
+ * \param[out] pnFirst Number of the first job.
+ * \param[out] pnStep Amount to add for each job after it.
+ */
+void PMS_FarmJobNumbers(unsigned int *pnFirst, unsigned int *pnStep)
+{
+#ifdef PMS_FARM_SUPPORTED
+  if(l_tFarm.bWorker)
+  {
+    *pnFirst = (unsigned int)l_tFarm.nInstance;
+    *pnStep = (unsigned int)l_tFarm.nInstances;
+    return;
+  }
+#endif
+  *pnFirst = 1;
+  *pnStep = 1;
+}
+
+/**
+ * \brief Get the next job for this worker from the parent.
+ *
+ * Also reports the pages and time taken by the previous job.\n
+ * \return Index of the next job in the command line job list, or -1 when
+ *         there are no more jobs.
+ */
+int PMS_FarmNextJob(void)
+{
+#ifdef PMS_FARM_SUPPORTED
+  PMS_TyFarmReport tReport;
+  unsigned long ulNow = PMS_TimeInMilliSecs();
+  int nJob;
+
+  PMS_ASSERT(l_tFarm.bWorker, ("PMS_FarmNextJob: Not a farm worker\n"));
+
+  /* The parent has already said there are no more jobs. */
+  if(l_tFarm.fdJob < 0)
+    return -1;
+
+  tReport.nJob = l_tFarm.nJob;
+  tReport.cPages = l_tFarm.cPages;
+  tReport.ulTime = (l_tFarm.nJob >= 0) ? ulNow - l_tFarm.ulStart : 0;
+
+  if(!FarmWrite(l_tFarm.fdReport, &tReport, sizeof(tReport)) ||
+     !FarmRead(l_tFarm.fdJob, &nJob, sizeof(nJob)))
+    nJob = -1;
+
+  l_tFarm.nJob = nJob;
+  l_tFarm.cPages = 0;
+  l_tFarm.ulStart = ulNow;
+
+  if(nJob < 0)
+  {
+    /* Closing the pipes tells the parent this instance is finished. */
+    close(l_tFarm.fdReport);
+    close(l_tFarm.fdJob);
+    l_tFarm.fdReport = -1;
+    l_tFarm.fdJob = -1;
+  }
+
+  return nJob;
+#else
+  return -1;
+#endif
+}
+
+/**
+ * \brief Count a page checked in by the current job.
+ */
+void PMS_FarmPageDone(void)
+{
+#ifdef PMS_FARM_SUPPORTED
+  if(l_tFarm.bWorker)
+    l_tFarm.cPages++;
+#endif
+}
@@ -0,0 +1,24 @@
+/* Copyright (C) 2014 Global Graphics Software Ltd. All rights reserved.
+ *
+ * This example is provided on an "as is" basis and without
+ * warranty of any kind. Global Graphics Software Ltd. does not
+ * warrant or make any representations regarding the use or results
+ * of use of this example.
+ */
+
+/*! \file
+ *  \ingroup PMS
+ *  \brief Header file for running a farm of RIP instances over a job list.
+ *
+ */
+
+#ifndef _PMS_FARM_H_
+#define _PMS_FARM_H_
+
+int PMS_FarmRun(int nInstances);
+int PMS_FarmIsWorker(void);
+void PMS_FarmJobNumbers(unsigned int *pnFirst, unsigned int *pnStep);
+int PMS_FarmNextJob(void);
+void PMS_FarmPageDone(void);
+
+#endif /* _PMS_FARM_H_ */
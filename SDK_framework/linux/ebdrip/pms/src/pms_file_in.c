@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "pms_malloc.h"
+#include "pms_farm.h"
 
 /* Extern variable declarations */
 /*! \brief Number of jobs to be processed. Value is set by commandline parser */
@@ -40,6 +41,17 @@ static char ** szFilenames;
 /*! \brief Holds the File Descriptor of currently open file. */
 static FILE* l_fileCurrent = NULL;
 
+/*! \brief Size of the read-ahead buffer used when streaming a job from file. */
+#define FILE_READAHEAD_SIZE (256 * 1024)
+
+/*! \brief Read-ahead buffer. Peeks are served from this, so that the file is
+    read in large chunks rather than read and seeked back for every peek. */
+static unsigned char *l_pReadAhead = NULL;
+/*! \brief The amount of valid data in the read-ahead buffer. */
+static int l_nReadAheadUsed;
+/*! \brief Position of the next unconsumed byte in the read-ahead buffer. */
+static int l_nReadAheadPos;
+
 /* Forward Declarations */
 static int GetNextFilename(char * pszFilename);
 
@@ -133,6 +145,13 @@ int File_OpenDataStream(void)
     l_fileCurrent = NULL;
     PMS_SHOW("Stored %d bytes.\n", l_nStoreBufferUsed);
   }
+  else
+  {
+    /* Without a read-ahead buffer, peeks read straight from the file. */
+    l_pReadAhead = OSMalloc(FILE_READAHEAD_SIZE, PMS_MemoryPoolMisc);
+    l_nReadAheadUsed = 0;
+    l_nReadAheadPos = 0;
+  }
 
   return 1; /* 1 means we have a job ready to rip */
 }
@@ -151,6 +170,12 @@ int File_CloseDataStream(void)
     l_pStoreBuffer = NULL;
   }
 
+  if(l_pReadAhead)
+  {
+    OSFree(l_pReadAhead, PMS_MemoryPoolMisc);
+    l_pReadAhead = NULL;
+  }
+
   return TRUE;
 }
 
@@ -178,6 +203,38 @@ int File_PeekDataStream(unsigned char * buffer, int nBytesToRead)
     }
     memcpy(buffer, l_pStoreBuffer + l_nStoreBufferPos, nbytes_read);
   }
+  else if(l_pReadAhead)
+  {
+    int nAvail = l_nReadAheadUsed - l_nReadAheadPos;
+
+    if(nBytesToRead > FILE_READAHEAD_SIZE)
+      nBytesToRead = FILE_READAHEAD_SIZE;
+
+    if(nAvail < nBytesToRead && l_fileCurrent != NULL)
+    {
+      /* Move the unconsumed data down, and top up the rest of the buffer. */
+      memmove(l_pReadAhead, l_pReadAhead + l_nReadAheadPos, nAvail);
+      l_nReadAheadPos = 0;
+      l_nReadAheadUsed = nAvail;
+
+      nbytes_read = (int)fread(l_pReadAhead + nAvail, 1, FILE_READAHEAD_SIZE - nAvail, l_fileCurrent);
+      if(nbytes_read <= 0)
+      {
+        if(ferror(l_fileCurrent))
+          PMS_SHOW_ERROR("Failed to read from file");
+        fclose(l_fileCurrent);
+        l_fileCurrent = NULL;
+      }
+      else
+      {
+        l_nReadAheadUsed += nbytes_read;
+        nAvail += nbytes_read;
+      }
+    }
+
+    nbytes_read = (nAvail < nBytesToRead) ? nAvail : nBytesToRead;
+    memcpy(buffer, l_pReadAhead + l_nReadAheadPos, nbytes_read);
+  }
   else
   {
     if(l_fileCurrent==NULL)
@@ -218,6 +275,12 @@ int File_ConsumeDataStream(int nBytesToConsume)
   {
     l_nStoreBufferPos += nBytesToConsume;
   }
+  else if(l_pReadAhead)
+  {
+    PMS_ASSERT(l_nReadAheadPos + nBytesToConsume <= l_nReadAheadUsed,
+               ("File_ConsumeDataStream: Consuming data which has not been peeked\n"));
+    l_nReadAheadPos += nBytesToConsume;
+  }
   else
   {
     if(l_fileCurrent==NULL)
@@ -369,6 +432,16 @@ int File_Bytes(void * handle)
  */
 static int GetNextFilename(char * pszFilename)
 {
+  if( PMS_FarmIsWorker() )
+  {
+    /* The farm parent decides which job this instance runs next. */
+    int nJob = PMS_FarmNextJob();
+    if( nJob < 0 || nJob >= nFiles )
+      return FALSE;
+    strcpy((char *)pszFilename, szFilenames[nJob] );
+    return TRUE;
+  }
+
   if( iFileIndex < nFiles )
   {
     /* no check for directory separator - command line parameter must be platform specific */
@@ -737,19 +737,24 @@ int PMS_CheckinBand(PMS_TyBandPacket *ThisBand)
 #endif
           }
 
-          pRasterBuffer = (unsigned char*)OSMalloc(bytesPerBand, PMS_MemoryPoolPMS);
+          /* Band buffers are recycled from pages already printed. */
+          pRasterBuffer = AllocBandBuffer(bytesPerBand);
           if(!pRasterBuffer)
           {
             PMS_SHOW_ERROR("\n**** Page Handler: Memory allocation failed **** \n\n");
             return FALSE;
           }
           src = ThisBand->atColoredBand[i].pBandRaster;
-          for(y = 0; y < height; y ++) {
-            /* Note that we need to copy all the data produced by the rip
-             * (including padding) because bit-depths less than 8-bits need
-             * their byte order rearranging. */
-            memcpy(pRasterBuffer + (y * lineSize), src, lineSize);
-            src += srcStride;
+          /* Note that we need to copy all the data produced by the rip
+           * (including padding) because bit-depths less than 8-bits need
+           * their byte order rearranging. */
+          if(srcStride == lineSize) {
+            memcpy(pRasterBuffer, src, bytesPerBand);
+          } else {
+            for(y = 0; y < height; y ++) {
+              memcpy(pRasterBuffer + (y * lineSize), src, lineSize);
+              src += srcStride;
+            }
           }
           pstPageToPrint->atPlane[nColorant].atBand[ThisBand->uBandNumber-1].pBandRaster = pRasterBuffer;
         }
@@ -771,18 +776,11 @@ int PMS_CheckinBand(PMS_TyBandPacket *ThisBand)
  */
 int PMS_CancelPrintedPage(PMS_TyPage *pstPageToDelete)
 {
-  unsigned int i, j;
+  unsigned int i;
 
   for(i = 0; i < PMS_MAX_PLANES_COUNT; i++)
   {
-    for(j = 0; j < PMS_BAND_LIMIT; j++)
-    {
-      if(pstPageToDelete->atPlane[i].atBand[j].pBandRaster != NULL)
-      {
-        OSFree(pstPageToDelete->atPlane[i].atBand[j].pBandRaster, PMS_MemoryPoolPMS);
-        pstPageToDelete->atPlane[i].atBand[j].pBandRaster = NULL;
-      }
-    }
+    ReleasePlaneRasters(&pstPageToDelete->atPlane[i]);
   }
 
   /* now allow the page list in PMSOutput to be cleared
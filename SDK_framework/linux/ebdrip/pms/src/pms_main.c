@@ -29,6 +29,7 @@
 #include "pms_file_in.h"
 #endif
 #include "pms_thread.h"
+#include "pms_farm.h"
 #ifdef PMS_SUPPORT_SOCKET
 #include "pms_socket.h"
 #endif
@@ -61,6 +62,7 @@ int g_nPageCount;
 PMS_eRIPState g_eRipState;
 PMS_eJOBState g_eJobState;
 unsigned int g_SocketInPort;
+int g_nFarmInstances;
 int g_nInputTrays = 0;
 PMS_TyTrayInfo * g_pstTrayInfo = NULL;
 int g_nOutputTrays = 0;
@@ -80,6 +82,7 @@ void *g_semPageComplete; /* Semaphore to syncronize submission of band packets f
 void *g_csPageList;      /* Critical section for thread-safe accessing of g_pstPageList */
 void *g_csMemoryUsage;   /* Critical section for thread-safe accessing of nValidBytes in sockets */
 void *g_csSocketInput;   /* Critical section for thread-safe accessing of l_tPMSMem */
+void *g_csBandPool;      /* Critical section for thread-safe accessing of the free band buffers */
 int g_printPMSLog;
 
 unsigned int g_bDebugMemory;
@@ -150,6 +153,15 @@ int PMS_main()
   /* Set up default job settings (after ParseCommandLine() so as to honour its settings) */
   EngineGetJobSettings();
 
+  /* Start any farm of RIP instances before the PMS threads are started. The
+     parent returns once the workers have run all of the jobs. */
+  if( ! PMS_FarmRun( g_nFarmInstances ) )
+  {
+    PMS_FS_ShutdownFS();
+    CleanUp();
+    return 1;
+  }
+
   if(PMS_IM_Initialize() == 0)
   {
       CleanUp();
@@ -247,6 +259,7 @@ static void InitGlobals(void)
   g_tSystemInfo.uUseEngineSimulator = FALSE;
   g_tSystemInfo.uUseRIPAhead = TRUE;
   g_SocketInPort = 0;                 /* initialise to 0, this means no socket input is enabled */
+  g_nFarmInstances = 1;               /* one RIP instance, in this process */
   g_printPMSLog = 1;
   g_bLogPMSDebugMessages = 0;
   g_bTaggedBackChannel = 0;
@@ -306,6 +319,7 @@ static void InitGlobals(void)
   g_csMemoryUsage = PMS_CreateCriticalSection();
   g_csPageList = PMS_CreateCriticalSection();
   g_csSocketInput = PMS_CreateCriticalSection();
+  g_csBandPool = PMS_CreateCriticalSection();
 
   /* Create semaphore function uses OSMalloc, therefore must be done after Memory usage critical section is created */
   g_semCheckin = PMS_CreateSemaphore(0);
@@ -360,6 +374,7 @@ static void DisplayCommandLine(void)
           printf("[-x <horizonal resolution in dpi>]\n");
           printf("[-y <vertical resolution in dpi>]\n");
           printf("[-n <number of renderer threads>]\n");
+          printf("[-F <number of RIP instances to share the job files between>]\n");
           printf("[-d <RIP depth in bpp>[,<Output depth in bpp>]]\n");
           printf("[-r <color mode 1=Mono; 3=CMYK Composite; 5=RGB Composite; 6=RGB Pixel Interleaved>]\n");
           printf("[-k <to force mono if cmy absent in cmyk jobs yes|no>]\n");
@@ -1298,6 +1313,31 @@ static void ParseCommandLine(void)
 
           break;
 
+        case 'F': /* Number of RIP instances in the farm */
+          if (--nArgc < 1 || pszSwitch[2] != 0)
+          {
+            DisplayCommandLine();
+            PMS_SHOW_ERROR("\n Missing arguments or improper switch.\n Exiting.....");
+            exit(1);
+          }
+          ++aszArgv;
+
+          /* convert to number */
+          str = *aszArgv;
+
+          if(str == NULL)
+          {
+            PMS_SHOW_ERROR("Input a number for number of RIP instances.\n");
+            break;
+          }
+
+          g_nFarmInstances = atoi(str);
+          if( g_nFarmInstances < 1 )
+          {
+            g_nFarmInstances = 1;
+          }
+          break;
+
         case 'M':
           if (--nArgc < 1 || pszSwitch[2] != 0 ) {
             DisplayCommandLine();
@@ -1382,6 +1422,21 @@ static void ParseCommandLine(void)
     g_bBackChannelPageOutput = 0;
     g_bTaggedBackChannel = 0;
   }
+
+  /* The farm shares out the job files on the command line. Each instance
+     would try to listen on the same socket or watch the same hot folder. */
+  if (g_nFarmInstances > 1)
+  {
+    int bOtherInput = (g_SocketInPort != 0);
+#ifdef PMS_HOT_FOLDER_SUPPORT
+    bOtherInput = bOtherInput || (g_pPMSHotFolderPath != NULL);
+#endif
+    if (bOtherInput || !g_tSystemInfo.bFileInput)
+    {
+      PMS_SHOW_ERROR("Warning: -F only applies to job files on the command line - ignoring 'F' flag\n");
+      g_nFarmInstances = 1;
+    }
+  }
   /*
       We need to force various settings for HWA
       direct single output mode (-j 3)
@@ -1457,12 +1512,18 @@ static void ParseCommandLine(void)
 void StartOIL()
 {
   PMS_TyJob * pstJob;
-  static unsigned int  nJobNumber = 1;
+  static unsigned int  nJobNumber = 0;
+  unsigned int nFirstJobNumber, nJobNumberStep;
   int bJobSubmitted;
   int bJobSucceeded;
 
   g_eRipState = PMS_Rip_Initializing;
 
+  /* Farm instances share an output directory, so keep their job numbers apart. */
+  PMS_FarmJobNumbers(&nFirstJobNumber, &nJobNumberStep);
+  if(nJobNumber == 0)
+    nJobNumber = nFirstJobNumber;
+
   /* Check that the PMS API function pointers have been initialised */
   PMS_ASSERT(l_apfnRip_IF_KcCalls, ("StartOIL: PMS API function array point not initialised.\n"));
 
@@ -1505,7 +1566,7 @@ void StartOIL()
 
         if( bJobSubmitted )
         {
-          nJobNumber++;
+          nJobNumber += nJobNumberStep;
           pstJob->uJobId = nJobNumber;
         }
 
@@ -1562,6 +1623,9 @@ static void CleanUp()
   PMS_DestroySemaphore(g_semTaggedOutput);
   PMS_DestroySemaphore(g_semPageComplete);
 
+  FlushBandBuffers();
+
+  PMS_DestroyCriticalSection(g_csBandPool);
   PMS_DestroyCriticalSection(g_csPageList);
   PMS_DestroyCriticalSection(g_csSocketInput);
   PMS_DestroyCriticalSection(g_csMemoryUsage);
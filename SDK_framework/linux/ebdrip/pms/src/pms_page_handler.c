@@ -27,6 +27,7 @@
 #include "pms_pdf_out.h"
 #endif
 #include "pms_thread.h"
+#include "pms_farm.h"
 #ifndef VXWORKS
 #ifndef THREADX
 #include <memory.h> /* for memset */
@@ -34,6 +35,145 @@
 #endif
 PMS_TyPage *g_pstCurrentPMSPage;
 
+/*! \brief The most free band buffers kept for reuse. */
+#define MAX_FREE_BAND_BUFFERS  64
+
+/*! \brief Header written over the start of a free band buffer in the pool. */
+typedef struct PMS_TyFreeBand {
+  struct PMS_TyFreeBand *pNext;   /*!< Next free band buffer */
+  unsigned int cbSize;            /*!< Usable size of this buffer */
+} PMS_TyFreeBand;
+
+static PMS_TyFreeBand *l_pFreeBands = NULL;   /* Free band buffers, most recently released first */
+static unsigned int l_nFreeBands = 0;         /* Number of buffers in l_pFreeBands */
+
+/**
+ * \brief Get a buffer for a band of raster.
+ *
+ * Band buffers released by earlier pages are reused rather than allocating
+ * and freeing a buffer for every band of every page.
+ * Buffers are taken on the RIP thread as bands are checked in, and returned
+ * on the output thread as pages are printed.
+ *
+ * \param cbSize Number of bytes required.
+ * \return Pointer to the buffer, or NULL if it could not be allocated.
+ */
+unsigned char *AllocBandBuffer(unsigned int cbSize)
+{
+  PMS_TyFreeBand **ppFree, *pFound = NULL;
+
+  /*CRITICAL SECTION - START*/
+  PMS_EnterCriticalSection(g_csBandPool);
+  for(ppFree = &l_pFreeBands; *ppFree != NULL; ppFree = &(*ppFree)->pNext)
+  {
+    if((*ppFree)->cbSize >= cbSize)
+    {
+      pFound = *ppFree;
+      *ppFree = pFound->pNext;
+      l_nFreeBands--;
+      break;
+    }
+  }
+  PMS_LeaveCriticalSection(g_csBandPool);
+  /*CRITICAL SECTION - END*/
+
+  if(pFound != NULL)
+    return (unsigned char *)pFound;
+
+  return (unsigned char *)OSMalloc(cbSize, PMS_MemoryPoolPMS);
+}
+
+/**
+ * \brief Return a band buffer obtained from AllocBandBuffer().
+ *
+ * \param pBuffer The buffer to release.
+ * \param cbSize Size of the buffer, as given to AllocBandBuffer().
+ */
+void ReleaseBandBuffer(unsigned char *pBuffer, unsigned int cbSize)
+{
+  PMS_TyFreeBand *pFree = (PMS_TyFreeBand *)pBuffer;
+
+  if(pBuffer == NULL)
+    return;
+
+  if(cbSize >= sizeof(PMS_TyFreeBand))
+  {
+    /*CRITICAL SECTION - START*/
+    PMS_EnterCriticalSection(g_csBandPool);
+    if(l_nFreeBands < MAX_FREE_BAND_BUFFERS)
+    {
+      pFree->cbSize = cbSize;
+      pFree->pNext = l_pFreeBands;
+      l_pFreeBands = pFree;
+      l_nFreeBands++;
+      pFree = NULL;
+    }
+    PMS_LeaveCriticalSection(g_csBandPool);
+    /*CRITICAL SECTION - END*/
+  }
+
+  if(pFree != NULL)
+    OSFree(pBuffer, PMS_MemoryPoolPMS);
+}
+
+/**
+ * \brief Free all the band buffers held for reuse.
+ *
+ * Called at the end of each job, so that memory is not held between jobs
+ * that may have different band sizes.
+ */
+void FlushBandBuffers()
+{
+  PMS_TyFreeBand *pFree;
+
+  /*CRITICAL SECTION - START*/
+  PMS_EnterCriticalSection(g_csBandPool);
+  while(l_pFreeBands != NULL)
+  {
+    pFree = l_pFreeBands;
+    l_pFreeBands = pFree->pNext;
+    OSFree(pFree, PMS_MemoryPoolPMS);
+  }
+  l_nFreeBands = 0;
+  PMS_LeaveCriticalSection(g_csBandPool);
+  /*CRITICAL SECTION - END*/
+}
+
+/**
+ * \brief Release the band rasters held by a plane.
+ *
+ * All the bands of a blank plane share a single buffer, which is released once.
+ *
+ * \param ptPlane The plane whose rasters are to be released.
+ */
+void ReleasePlaneRasters(PMS_TyPlane *ptPlane)
+{
+  unsigned int j, cbMax;
+
+  if(ptPlane->bBlankPlane == TRUE)
+  {
+    cbMax = 0;
+    for(j=0; j < ptPlane->uBandTotal; j++)
+    {
+      if(ptPlane->atBand[j].cbBandSize > cbMax)
+        cbMax = ptPlane->atBand[j].cbBandSize;
+    }
+    ReleaseBandBuffer(ptPlane->atBand[0].pBandRaster, cbMax);
+    for(j=0; j < ptPlane->uBandTotal; j++)
+      ptPlane->atBand[j].pBandRaster = NULL;
+    return;
+  }
+
+  for(j=0; j < PMS_BAND_LIMIT; j++)
+  {
+    if(ptPlane->atBand[j].pBandRaster)
+    {
+      ReleaseBandBuffer(ptPlane->atBand[j].pBandRaster, ptPlane->atBand[j].cbBandSize);
+      ptPlane->atBand[j].pBandRaster = NULL;
+    }
+  }
+}
+
 /**
  * \brief Append the checked-in Page to PMS's page queue.
  *
@@ -82,6 +222,7 @@ void AppendToPageQueue(PMS_TyPage *ptPMSPage)
 
     *pstLastNode = pstNewNode;
     g_nPageCount++;
+    PMS_FarmPageDone();
 
     PMS_LeaveCriticalSection(g_csPageList);
     /*CRITICAL SECTION - END*/
@@ -141,6 +282,8 @@ void PrintPageList()
  * PMSPage.  The last parameter is a sample PMS plane structure that has a template for the
  * plane and band data - all planes must contain the same number of bands with the same band sizes)
  *
+ * Every band of the blank plane points at the same buffer of blank data, sized for the
+ * largest band, so the plane costs one buffer rather than a page of raster.
  */
 void CreatePMSBlankPlane(PMS_TyPage *ptPMSPage, PMS_eColourant eColorant, PMS_TyPlane *ptPMSSamplePlane)
 {
@@ -172,23 +315,31 @@ void CreatePMSBlankPlane(PMS_TyPage *ptPMSPage, PMS_eColourant eColorant, PMS_Ty
     break;
   }
 
+  size = 0;
   for (i=0; i<ptPMSSamplePlane->uBandTotal; i++)
   {
-    /* create the band buffer data */
-    size = ptPMSSamplePlane->atBand[i].cbBandSize;
-    ptBuffer = OSMalloc(size, PMS_MemoryPoolPMS);
-    PMS_ASSERT(ptBuffer!=NULL, ("CreatePMSBlankPlane: Failed to allocate %d bytes \n", size));
-    if(ptPMSPage->eColorantFamily == PMS_ColorantFamily_RGB)
-    {
-      /* For white RGB must be all 1s */
-      memset(ptBuffer, 0xFF, size);
-    }
-    else
-    {
-      /* For white CMYK must be all 0s */
-      memset(ptBuffer, 0x00, size);
-    }
+    if (ptPMSSamplePlane->atBand[i].cbBandSize > size)
+      size = ptPMSSamplePlane->atBand[i].cbBandSize;
+  }
+
+  /* create the band buffer data shared by all the bands */
+  ptBuffer = AllocBandBuffer(size);
+  PMS_ASSERT(ptBuffer!=NULL, ("CreatePMSBlankPlane: Failed to allocate %d bytes \n", size));
+  if(ptBuffer == NULL)
+    return;
+  if(ptPMSPage->eColorantFamily == PMS_ColorantFamily_RGB)
+  {
+    /* For white RGB must be all 1s */
+    memset(ptBuffer, 0xFF, size);
+  }
+  else
+  {
+    /* For white CMYK must be all 0s */
+    memset(ptBuffer, 0x00, size);
+  }
 
+  for (i=0; i<ptPMSSamplePlane->uBandTotal; i++)
+  {
     /* fill out the band data */
     ptPMSPage->atPlane[plane].atBand[i].pBandRaster = ptBuffer;
     ptPMSPage->atPlane[plane].atBand[i].uBandHeight = ptPMSSamplePlane->atBand[i].uBandHeight;
@@ -411,43 +562,29 @@ void PrintPage(PMS_TyPage * pstPageToPrint)
        g_tSystemInfo.bScanlineInterleave)
     {
       int i;
-      unsigned int j;
       for(i=0; i < PMS_MAX_PLANES_COUNT; i++)
       {
-        for(j=0; j < pstPageToPrint->atPlane[i].uBandTotal; j++)
-        {
-          if ( pstPageToPrint->atPlane[i].atBand[j].pBandRaster)
-          {
-            /* free the PMS memory allocated for each band of each plane */
-            OSFree(pstPageToPrint->atPlane[i].atBand[j].pBandRaster, PMS_MemoryPoolPMS);
-            pstPageToPrint->atPlane[i].atBand[j].pBandRaster = NULL;
-          }
-        }
+        /* return the PMS memory allocated for each band of each plane */
+        ReleasePlaneRasters(&pstPageToPrint->atPlane[i]);
       }
     }
     else
     {
       /* In page and band direct delivery model, only the band memory allocated in blank planes belong to PMS. We need to free them here*/
       int i;
-      unsigned int j;
       for(i=0; i < PMS_MAX_PLANES_COUNT; i++)
       {
         if (pstPageToPrint->atPlane[i].bBlankPlane == TRUE) /* free only if its a blank plane */
         {
-          for(j=0; j < pstPageToPrint->atPlane[i].uBandTotal; j++)
-          {
-            if (pstPageToPrint->atPlane[i].atBand[j].pBandRaster)
-            {
-              /* free the PMS memory allocated for each band of each blank plane */
-              OSFree(pstPageToPrint->atPlane[i].atBand[j].pBandRaster, PMS_MemoryPoolPMS);
-              pstPageToPrint->atPlane[i].atBand[j].pBandRaster = NULL;
-            }
-          }
+          /* return the PMS memory allocated for the blank plane */
+          ReleasePlaneRasters(&pstPageToPrint->atPlane[i]);
         }
       }
     }
   } else { /* otherwise end of job */
 
+    FlushBandBuffers();
+
     switch(g_tSystemInfo.eOutputType) 
     {
     default:
@@ -25,5 +25,9 @@ void PrintPageList();
 void PrintPage(PMS_TyPage * pstPageToPrint);
 void RemovePage(PMS_TyPage *pstPageToDelete);
 int IsEngineIdle();
+unsigned char *AllocBandBuffer(unsigned int cbSize);
+void ReleaseBandBuffer(unsigned char *pBuffer, unsigned int cbSize);
+void ReleasePlaneRasters(PMS_TyPlane *ptPlane);
+void FlushBandBuffers();
 
 #endif /* _PMS_PAGE_HANDLER_H_ */
@@ -16,6 +16,12 @@
  *
  * The structure of the ebdwrapper PDF output file is simply an image wrapped in some PDF commands.
  *
+ * Bands are pixel interleaved and compressed by a pool of worker threads, one
+ * per RIP renderer thread, and written to the output in band order as each
+ * one completes. Each band is deflated as an independent stream ending on a
+ * byte boundary, and the streams are joined by a single zlib header and
+ * Adler-32 trailer, so the whole page is one valid Flate image stream.
+ *
  * This module supports;
  * \li 1, 2, 4, 8 and 16 bits per pixel (per colorant).
  * \li CMYK, RGB, and Mono.
@@ -44,6 +50,7 @@
  */
 #include "pms.h"
 #include "pms_malloc.h"
+#include "pms_platform.h"
 #include "pms_pdf_out.h"
 #include "zlib.h"
 #include <string.h>
@@ -65,32 +72,66 @@
 /*! \brief Added comments to the PDF output file. */
 #define ADD_PDF_COMMENTS
 
+/*! \brief The maximum number of bands pixel interleaved and compressed at once. */
+#define PDF_MAX_WORKERS 8
+
 /*! \brief Memory allocation function to be used by the zlib library. */
 static void *zlib_alloc(void *opaque, uInt items, uInt size);
 
 /*! \brief Memory free function to be used by the zlib library. */
 static void zlib_free(void *opaque, void *address);
 
+/*! \brief One band being pixel interleaved and compressed.
+ *
+ * Each job slot is served by its own worker thread, and band \c n always goes
+ * to slot \c n modulo the number of slots, so the output thread reassembles
+ * the page in order by visiting the slots in turn.
+ */
+typedef struct tagPDFBandJob {
+  PMS_TyPage *ptPMSPage;          /**< Page the band belongs to */
+  int nBand;                      /**< Band to process, or -1 to stop the worker */
+  int bLastBand;                  /**< Finish the compressed stream after this band */
+  char *pRasterBuffer ;           /**< Pixel-interleaved raster data */
+  char *pCompressBuffer ;         /**< Compressed raster data */
+  char *pOutput;                  /**< Data to write, in one of the buffers above */
+  unsigned int cbRaster;          /**< Bytes of pixel-interleaved raster data */
+  unsigned int cbOutput;          /**< Bytes of data to write */
+  unsigned long ulAdler;          /**< Adler-32 checksum of the raster data */
+  unsigned int uChecksum;         /**< Byte sum of the raster data */
+  int bOK;                        /**< Band was processed successfully */
+#ifndef NOCOMPRESS
+  int bZInit;                     /**< zstate has been initialised */
+  struct z_stream_s zstate ;      /**< zlib context structure */
+#endif
+  void *semStart;                 /**< Signalled when there is a band to process */
+  void *semDone;                  /**< Signalled when the band has been processed */
+  void *pThread;                  /**< Worker thread, or NULL to process inline */
+} TPDFBANDJOB;
+
 /*! \brief Parameters for the PDF output module. */
 typedef struct tagPDFout_globals {
-  char *pRasterBuffer ;           /**< Pixel-interleaved raster data */
   unsigned int cbRasterBuffer;    /**< Raster buffer size */
-  char *pCompressBuffer ;         /**< Compressed raster data */
   unsigned int cbCompressBuffer;  /**< Compression buffer size */
+  TPDFBANDJOB atJobs[PDF_MAX_WORKERS]; /**< Bands being processed */
+  unsigned int nJobs;             /**< Number of job slots in use */
 
   FILE * hFileOut;                /**< Output file handle */
   PMS_TyBackChannelWriteFileOut tWriteFileOut; /**< Backchannel output */
   unsigned int nobjects;          /**< Number of objects in PDF file */
   unsigned int filepos;           /**< Current file position */
   unsigned int offsets[MAXOBJ] ;  /**< Location of PDF objects */
-  struct z_stream_s zstate ;      /**< zlib context structure */
+  unsigned int cbImageStream;     /**< Length of the image stream */
+  unsigned long ulAdler;          /**< Adler-32 checksum of the page raster data */
 #ifdef ADD_PDF_COMMENTS
   unsigned int uPageChecksum;     /**< Checksum for comments for regression testing */
 #endif
+#ifdef COMPRESS_TEST
+  char *pTestCompPos;             /**< Copy of the image stream for testing */
+#endif
 }TPDFOUT_GLOBALS, *PTPDFOUT_GLOBALS;
 
 /*! PDF output module variables */
-TPDFOUT_GLOBALS gtPDFOut = { NULL, 0, NULL, 0, NULL };
+TPDFOUT_GLOBALS gtPDFOut = { 0 };
 
 /**
  * \brief Open PDF data stream output.
@@ -117,7 +158,6 @@ static int PDF_OpenOutput(const char *pszFilename)
  * \brief Close PDF data stream output.
  *
  * Close the PDF output file if writing direct to file.
- * Free raster buffer and compression buffer used.
  */
 static void PDF_CloseOutput()
 {
@@ -129,18 +169,6 @@ static void PDF_CloseOutput()
       gtPDFOut.hFileOut = NULL;
     }
   }
-
-  if(gtPDFOut.pRasterBuffer)
-  {
-    OSFree(gtPDFOut.pRasterBuffer, PMS_MemoryPoolPMS);
-    gtPDFOut.pRasterBuffer = NULL;
-  }
-
-  if(gtPDFOut.pCompressBuffer)
-  {
-    OSFree(gtPDFOut.pCompressBuffer, PMS_MemoryPoolPMS);
-    gtPDFOut.pCompressBuffer = NULL;
-  }
 }
 
 /**
@@ -466,8 +494,8 @@ static int PDF_WriteFileTrailer(PMS_TyPage *ptPMSPage)
 
   /* The second object is the length of the image stream plus one for the new line char. */
   length = sprintf(buffer,    "2 0 obj\n" /* Length of image */
-                              "%ld\n"
-                              "endobj\n", gtPDFOut.zstate.total_out + 1);
+                              "%u\n"
+                              "endobj\n", gtPDFOut.cbImageStream + 1);
   if(PDF_WriteOutput(buffer, length) < length)
   {
     PMS_SHOW_ERROR("PDF_WriteFileTrailer: File IO failed.\n");
@@ -1399,6 +1427,255 @@ static unsigned int PDF_PixelInterleave(PMS_TyPage *ptPMSPage, int nBand, char *
   return cbSizeWritten;
 }
 
+/**
+ * \brief Pixel interleave and compress one band.
+ *
+ * This runs on a worker thread, or on the PMS output thread if there is only
+ * one job slot. It only reads the page, and only writes to its own job slot.
+ *
+ * \param pJob The band to process.
+ */
+static void PDF_ProcessBand(TPDFBANDJOB *pJob)
+{
+#ifdef ADD_PDF_COMMENTS
+  unsigned char *p;
+#endif
+#ifndef NOCOMPRESS
+  int nResult;
+#endif
+
+  pJob->cbRaster = PDF_PixelInterleave(pJob->ptPMSPage, pJob->nBand, pJob->pRasterBuffer);
+
+#ifdef ADD_PDF_COMMENTS
+  pJob->uChecksum = 0;
+  for(p = (unsigned char *)pJob->pRasterBuffer; p < ((unsigned char *)(pJob->pRasterBuffer + pJob->cbRaster)); p++) {
+    pJob->uChecksum += *p;
+  }
+#endif
+
+#ifdef NOCOMPRESS
+  pJob->pOutput = pJob->pRasterBuffer;
+  pJob->cbOutput = pJob->cbRaster;
+  pJob->bOK = TRUE;
+#else
+  pJob->ulAdler = adler32(adler32(0L, Z_NULL, 0), (Bytef*)pJob->pRasterBuffer, pJob->cbRaster);
+
+  /* Each band is a separate raw deflate stream. A sync flush ends it on a
+     byte boundary without marking the final block, so the next band's stream
+     can follow straight on. */
+  if(deflateReset(&pJob->zstate) != Z_OK)
+  {
+    pJob->bOK = FALSE;
+    return;
+  }
+  pJob->zstate.avail_in = pJob->cbRaster;
+  pJob->zstate.next_in = (Bytef*)pJob->pRasterBuffer;
+  pJob->zstate.avail_out = gtPDFOut.cbCompressBuffer;
+  pJob->zstate.next_out = (Bytef*)pJob->pCompressBuffer;
+
+  nResult = deflate(&pJob->zstate, pJob->bLastBand ? Z_FINISH : Z_SYNC_FLUSH);
+  if(pJob->bLastBand)
+    pJob->bOK = (nResult == Z_STREAM_END);
+  else
+    pJob->bOK = (nResult == Z_OK && pJob->zstate.avail_in == 0 && pJob->zstate.avail_out != 0);
+
+  pJob->pOutput = pJob->pCompressBuffer;
+  pJob->cbOutput = gtPDFOut.cbCompressBuffer - pJob->zstate.avail_out;
+#endif
+}
+
+/**
+ * \brief Worker thread processing the bands sent to one job slot.
+ *
+ * \param pArg The job slot.
+ */
+static void PDF_BandWorker(void *pArg)
+{
+  TPDFBANDJOB *pJob = (TPDFBANDJOB *)pArg;
+
+  for(;;)
+  {
+    PMS_WaitOnSemaphore_Forever(pJob->semStart);
+    if(pJob->nBand < 0)
+      break;
+    PDF_ProcessBand(pJob);
+    PMS_IncrementSemaphore(pJob->semDone);
+  }
+}
+
+/**
+ * \brief Start processing a band.
+ *
+ * \param ptPMSPage Pointer to PMS page structure that contains the complete page.
+ * \param nBand Band to process.
+ * \param bLastBand Non-zero if this is the last band of the page.
+ */
+static void PDF_StartBand(PMS_TyPage *ptPMSPage, unsigned int nBand, int bLastBand)
+{
+  TPDFBANDJOB *pJob = &gtPDFOut.atJobs[nBand % gtPDFOut.nJobs];
+
+  pJob->ptPMSPage = ptPMSPage;
+  pJob->nBand = (int)nBand;
+  pJob->bLastBand = bLastBand;
+  pJob->bOK = FALSE;
+
+  if(pJob->pThread)
+    PMS_IncrementSemaphore(pJob->semStart);
+  else
+    PDF_ProcessBand(pJob);
+}
+
+/**
+ * \brief Wait for a band to be processed.
+ *
+ * \param nBand Band started by PDF_StartBand().
+ * \return The job slot holding the processed band.
+ */
+static TPDFBANDJOB *PDF_FinishBand(unsigned int nBand)
+{
+  TPDFBANDJOB *pJob = &gtPDFOut.atJobs[nBand % gtPDFOut.nJobs];
+
+  if(pJob->pThread)
+    PMS_WaitOnSemaphore_Forever(pJob->semDone);
+
+  return pJob;
+}
+
+/**
+ * \brief Stop the band workers and free the job slots.
+ *
+ * Any bands started must have been finished before calling this.
+ */
+static void PDF_StopWorkers(void)
+{
+  unsigned int i;
+
+  for(i = 0; i < gtPDFOut.nJobs; i++)
+  {
+    TPDFBANDJOB *pJob = &gtPDFOut.atJobs[i];
+
+    if(pJob->pThread)
+    {
+      pJob->nBand = -1;
+      PMS_IncrementSemaphore(pJob->semStart);
+      PMS_CloseThread(pJob->pThread, -1);
+    }
+    if(pJob->semStart)
+      PMS_DestroySemaphore(pJob->semStart);
+    if(pJob->semDone)
+      PMS_DestroySemaphore(pJob->semDone);
+#ifndef NOCOMPRESS
+    if(pJob->bZInit)
+      deflateEnd(&pJob->zstate);
+#endif
+    if(pJob->pRasterBuffer)
+      OSFree(pJob->pRasterBuffer, PMS_MemoryPoolPMS);
+    if(pJob->pCompressBuffer)
+      OSFree(pJob->pCompressBuffer, PMS_MemoryPoolPMS);
+    memset(pJob, 0x00, sizeof(*pJob));
+  }
+  gtPDFOut.nJobs = 0;
+}
+
+/**
+ * \brief Allocate the job slots, and start a worker thread for each if there is more than one.
+ *
+ * \param nJobs Number of job slots, between 1 and PDF_MAX_WORKERS.
+ * \return PMS_ePDF_Errors error code.
+ */
+static int PDF_StartWorkers(unsigned int nJobs)
+{
+  PMS_ASSERT(nJobs > 0 && nJobs <= PDF_MAX_WORKERS, ("PDF_StartWorkers: Bad number of workers %u\n", nJobs));
+
+  for(gtPDFOut.nJobs = 0; gtPDFOut.nJobs < nJobs; gtPDFOut.nJobs++)
+  {
+    TPDFBANDJOB *pJob = &gtPDFOut.atJobs[gtPDFOut.nJobs];
+
+    memset(pJob, 0x00, sizeof(*pJob));
+
+    pJob->pRasterBuffer = (char *)OSMalloc(gtPDFOut.cbRasterBuffer,PMS_MemoryPoolPMS);
+    if(!pJob->pRasterBuffer)
+    {
+      PMS_SHOW_ERROR("PDF_StartWorkers: Failed to allocate %d bytes of memory for packed raster band.\n",
+        gtPDFOut.cbRasterBuffer);
+      gtPDFOut.nJobs++;
+      PDF_StopWorkers();
+      return PDF_Error_Memory;
+    }
+
+#ifndef NOCOMPRESS
+    pJob->pCompressBuffer = (char *)OSMalloc(gtPDFOut.cbCompressBuffer,PMS_MemoryPoolPMS);
+    if(!pJob->pCompressBuffer)
+    {
+      PMS_SHOW_ERROR("PDF_StartWorkers: Failed to allocate %d bytes of memory for compression buffer\n",
+        gtPDFOut.cbCompressBuffer);
+      gtPDFOut.nJobs++;
+      PDF_StopWorkers();
+      return PDF_Error_Memory;
+    }
+
+    /* Raw deflate, so the bands carry no zlib header or trailer of their own */
+    pJob->zstate.zalloc = &zlib_alloc ;
+    pJob->zstate.zfree = &zlib_free ;
+    pJob->zstate.opaque = NULL ;
+    if ( deflateInit2(&pJob->zstate, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK )
+    {
+      PMS_SHOW_ERROR("PDF_StartWorkers: Compression failed.\n");
+      gtPDFOut.nJobs++;
+      PDF_StopWorkers();
+      return PDF_Error_Memory;
+    }
+    pJob->bZInit = TRUE;
+#endif
+
+    if(nJobs > 1)
+    {
+      pJob->semStart = PMS_CreateSemaphore(0);
+      pJob->semDone = PMS_CreateSemaphore(0);
+      if(pJob->semStart && pJob->semDone)
+        pJob->pThread = PMS_BeginThread(PDF_BandWorker, 0, pJob);
+      if(!pJob->pThread)
+      {
+        PMS_SHOW_ERROR("PDF_StartWorkers: Failed to start band worker %u.\n", gtPDFOut.nJobs);
+        gtPDFOut.nJobs++;
+        PDF_StopWorkers();
+        return PDF_Error_Memory;
+      }
+    }
+  }
+
+  return PDF_NoError;
+}
+
+/**
+ * \brief Write part of the image stream.
+ *
+ * \param pBuffer Pointer to data to output.
+ * \param cbLength Number of bytes to output.
+ * \return PMS_ePDF_Errors error code.
+ */
+static int PDF_WriteImageData(char *pBuffer, unsigned int cbLength)
+{
+  int nWritten;
+
+  if(cbLength == 0)
+    return PDF_NoError;
+
+  nWritten = PDF_WriteOutput(pBuffer, (int)cbLength);
+  if(nWritten != (int)cbLength)
+  {
+    PMS_SHOW_ERROR("PDF_PageHandler: Write output failed.\n");
+    return PDF_Error_FileIO;
+  }
+  gtPDFOut.filepos += nWritten;
+  gtPDFOut.cbImageStream += nWritten;
+#ifdef COMPRESS_TEST
+  memcpy(gtPDFOut.pTestCompPos, pBuffer, cbLength);
+  gtPDFOut.pTestCompPos += cbLength;
+#endif
+  return PDF_NoError;
+}
+
 /**
  * \brief The one and only function call to the PDF output method.
  *
@@ -1408,28 +1685,19 @@ static unsigned int PDF_PixelInterleave(PMS_TyPage *ptPMSPage, int nBand, char *
 int PDF_PageHandler( PMS_TyPage *ptPMSPage )
 {
   PMS_ePDF_Errors eResult = PDF_NoError;
-  unsigned int nBytesPerLine;
-  unsigned int uBytesToWrite;
   unsigned int uBands;
   unsigned int uBandHeight;
   unsigned int uFirstColorant;
-  unsigned int cbBandSize;
-  unsigned int j;
-  char *pWriteBuf;
+  unsigned int nJobs;
+  unsigned int j, nNext;
+  unsigned long ulStartTime;
   int nCopyNo;
-  int nWritten;
-#ifdef ADD_PDF_COMMENTS
-  unsigned char *p;
-#endif
 #ifndef NOCOMPRESS
-  unsigned int uLastTotal;
-  int nResult;
+  unsigned char aZlibWrapper[4];
 #endif
 #ifdef COMPRESS_TEST
   char *pTestCompressedFull;
-  char *pTestCompPos;
   char *pTestUncompressedFull;
-  char *pTestUncompPos;
   struct z_stream_s zstateUncompress;
 #endif
 
@@ -1470,42 +1738,36 @@ int PDF_PageHandler( PMS_TyPage *ptPMSPage )
     return PDF_Error_Memory;
   }
 
-  /* dataWidth (bits per scanline including padding) is a multiple of 32, so divide by 8 to get bytes */
-  nBytesPerLine = (ptPMSPage->nRasterWidthBits >> 3);
+  /* Compress as many bands at once as the RIP renders. */
+  nJobs = (g_tSystemInfo.nRendererThreads > 1) ? (unsigned int)g_tSystemInfo.nRendererThreads : 1;
+  if(nJobs > PDF_MAX_WORKERS)
+    nJobs = PDF_MAX_WORKERS;
+  if(nJobs > uBands)
+    nJobs = uBands > 0 ? uBands : 1;
+
+  /* Bytes per line needed to store pixel interleaved packed raster band.
+     Note: The amount of memory could be reduced for bit depths less than 8. */
+  gtPDFOut.cbRasterBuffer = ((ptPMSPage->nRasterWidthBits >> 3) * ptPMSPage->uTotalPlanes) * uBandHeight;
+
+  /* Compression buffer size.
+     Note: zlib worst case expansion is an overhead of five bytes per 16KB (about 0.03%)
+           plus size bytes.
+     Allocate, band size + 1% + 32 bytes */
+  gtPDFOut.cbCompressBuffer = (((gtPDFOut.cbRasterBuffer * 100) / 99) + 32);
+
+  eResult = PDF_StartWorkers(nJobs);
+  if(eResult != PDF_NoError)
+  {
+    PMS_SHOW_ERROR("PDF_PageHandler: Failed to set up %u band buffers. WidthBits=%d, Planes=%d, BandHeight=%d\n",
+      nJobs, ptPMSPage->nRasterWidthBits, ptPMSPage->uTotalPlanes, uBandHeight);
+    return eResult;
+  }
 
   /* Output several times. */
   /* \todo Perf - just copy the file, we don't need to recreate the PDF every time */
   for(nCopyNo = 1; nCopyNo <= ptPMSPage->nCopies; nCopyNo++)
   {
-    /* Bytes per line needed to store pixel interleaved packed raster band.
-       Note: The amount of memory could be reduced for bit depths less than 8. */
-    gtPDFOut.cbRasterBuffer = ((ptPMSPage->nRasterWidthBits >> 3) * ptPMSPage->uTotalPlanes) * uBandHeight;
-
-    /* \todo Make the raster buffer persistent, and only reallocate if a larger one is needed */
-    /* \todo Even better - output bands of raster rather store the whole page (it shouldn't be too tricky to do) */
-    gtPDFOut.pRasterBuffer = (char *)OSMalloc(gtPDFOut.cbRasterBuffer,PMS_MemoryPoolPMS);
-    if(!gtPDFOut.pRasterBuffer)
-    {
-      PMS_SHOW_ERROR("PDF_PageHandler: Failed to allocate %d bytes of memory for packed raster line. WidthBits=%d, Planes=%d, BandHeight=%d\n",
-        gtPDFOut.cbRasterBuffer, ptPMSPage->nRasterWidthBits, ptPMSPage->uTotalPlanes, uBandHeight);
-      return PDF_Error_Memory;
-    }
-
-    /* Compression buffer size.
-       Note: zlib worst case expansion is an overhead of five bytes per 16KB (about 0.03%)
-             plus size bytes.
-       Allocate, band size + 1% + 32 bytes */
-    gtPDFOut.cbCompressBuffer = (((gtPDFOut.cbRasterBuffer * 100) / 99) + 32);
-    /* \todo Make the compression buffer persistent, and only reallocate if a larger one is needed */
-    gtPDFOut.pCompressBuffer = (char *)OSMalloc(gtPDFOut.cbCompressBuffer,PMS_MemoryPoolPMS);
-    if(!gtPDFOut.pCompressBuffer)
-    {
-      PMS_SHOW_ERROR("PDF_PageHandler: Failed to allocate %d bytes of memory for compression buffer\n",
-        gtPDFOut.cbCompressBuffer);
-      OSFree(gtPDFOut.pRasterBuffer, PMS_MemoryPoolPMS);
-      gtPDFOut.pRasterBuffer = NULL;
-      return PDF_Error_Memory;
-    }
+    ulStartTime = PMS_TimeInMilliSecs();
 
     /* write pdf header */
     eResult = PDF_WriteFileHeader(ptPMSPage);
@@ -1517,165 +1779,98 @@ int PDF_PageHandler( PMS_TyPage *ptPMSPage )
       break;
     }
 
-#ifndef NOCOMPRESS
-    /* initialise compressor */
-    gtPDFOut.zstate.zalloc = &zlib_alloc ;
-    gtPDFOut.zstate.zfree = &zlib_free ;
-    gtPDFOut.zstate.opaque = NULL ;
-
-    if ( deflateInit(&gtPDFOut.zstate, Z_BEST_SPEED) != Z_OK )
-    {
-      PMS_SHOW_ERROR("PDF_PageHandler: Compression failed.\n");
-      eResult = PDF_Error_FileIO;
-      PDF_CloseOutput();
-      break;
-    }
-    uLastTotal = 0;
-
+    gtPDFOut.cbImageStream = 0;
 #ifdef COMPRESS_TEST
     pTestCompressedFull = malloc((ptPMSPage->nRasterWidthBits/8) * ptPMSPage->nPageHeightPixels * 4);
     pTestUncompressedFull = malloc((ptPMSPage->nRasterWidthBits/8) * ptPMSPage->nPageHeightPixels * 4);
-    pTestCompPos = pTestCompressedFull;
-    pTestUncompPos = pTestUncompressedFull;
+    gtPDFOut.pTestCompPos = pTestCompressedFull;
 #endif
+
+#ifndef NOCOMPRESS
+    /* zlib header for a 32K window at the fastest compression level */
+    aZlibWrapper[0] = 0x78;
+    aZlibWrapper[1] = 0x01;
+    eResult = PDF_WriteImageData((char *)aZlibWrapper, 2);
+    gtPDFOut.ulAdler = adler32(0L, Z_NULL, 0);
 #endif
 
+    /* Keep every job slot busy, and write the bands out in order as they complete. */
+    for(nNext = 0; nNext < nJobs && nNext < uBands; nNext++)
+    {
+      PDF_StartBand(ptPMSPage, nNext, nNext + 1 == uBands);
+    }
+
     for(j=0; j < uBands; j++)
     {
+      TPDFBANDJOB *pJob;
+
       /* If the band height increases then we need a larger buffer */
       PMS_ASSERT(ptPMSPage->atPlane[uFirstColorant].atBand[j].uBandHeight <= uBandHeight, ("Band Height increased... RasterBuffer and Compress need to be reallocated.\n"));
 
-      /* pixel interleave */
-      cbBandSize = PDF_PixelInterleave(ptPMSPage, j, gtPDFOut.pRasterBuffer);
+      pJob = PDF_FinishBand(j);
+      if(eResult == PDF_NoError && !pJob->bOK)
+      {
+        PMS_SHOW_ERROR("PDF_PageHandler: Compression of band %u failed.\n", j);
+        eResult = PDF_Error_FileIO;
+      }
 
+      if(eResult == PDF_NoError)
+      {
 #ifdef ADD_PDF_COMMENTS
-      for(p = (unsigned char *)gtPDFOut.pRasterBuffer; p < ((unsigned char *)(gtPDFOut.pRasterBuffer + cbBandSize)); p++) {
-        gtPDFOut.uPageChecksum += *p;
-      }
+        gtPDFOut.uPageChecksum += pJob->uChecksum;
 #endif
-
 #ifndef NOCOMPRESS
-      /* compress */
-      gtPDFOut.zstate.avail_in = cbBandSize;
-      gtPDFOut.zstate.next_in = (Bytef*)gtPDFOut.pRasterBuffer;
-      gtPDFOut.zstate.avail_out = gtPDFOut.cbCompressBuffer;
-      gtPDFOut.zstate.next_out = (Bytef*)gtPDFOut.pCompressBuffer;
-
-      /* flush compressor */
-      nResult = deflate(&gtPDFOut.zstate, Z_SYNC_FLUSH);
-      if(gtPDFOut.zstate.avail_in!=0)
+        gtPDFOut.ulAdler = adler32_combine(gtPDFOut.ulAdler, pJob->ulAdler, pJob->cbRaster);
+#endif
+        eResult = PDF_WriteImageData(pJob->pOutput, pJob->cbOutput);
+      }
+
+      /* The slot is free again; give it the next band, unless we are giving up. */
+      if(eResult == PDF_NoError && nNext < uBands)
       {
-        PMS_SHOW_ERROR("*** ASSERT *** Raster data not entirely consumed by compressor... gtPDFOut.zstate\n" \
-               "  .avail_in = %u\n" \
-               "  .avail_out = %u\n" \
-               "  .total_in = %lu\n" \
-               "  .total_out = %lu\n" \
-               "  cbBandSize = %u\n",
-            gtPDFOut.zstate.avail_in,
-            gtPDFOut.zstate.avail_out,
-            gtPDFOut.zstate.total_in,
-            gtPDFOut.zstate.total_out,
-            cbBandSize
-          );
+        PDF_StartBand(ptPMSPage, nNext, nNext + 1 == uBands);
+        nNext++;
       }
-      if ( nResult != Z_OK && nResult != Z_STREAM_END )
+      else if(nNext < uBands)
       {
-        PMS_SHOW_ERROR("PDF_PageHandler: Compression no flush failed.\n");
-        eResult = PDF_Error_FileIO;
-        PDF_CloseOutput();
+        /* Collect the bands already started, then stop. */
+        for(j++; j < nNext; j++)
+          (void)PDF_FinishBand(j);
         break;
       }
+    }
 
-      uBytesToWrite = gtPDFOut.zstate.total_out - uLastTotal;
-#else
-      uBytesToWrite = cbBandSize;
-#endif
-
-      if(uBytesToWrite)
-      {
 #ifndef NOCOMPRESS
-        pWriteBuf = gtPDFOut.pCompressBuffer;
-        uLastTotal = gtPDFOut.zstate.total_out;
-#ifdef COMPRESS_TEST
-        memcpy(pTestCompPos, gtPDFOut.pCompressBuffer, uBytesToWrite);
-        pTestCompPos += uBytesToWrite;
-#endif
-#else
-        pWriteBuf = gtPDFOut.pRasterBuffer;
-#endif
-        /* write */
-        nWritten = PDF_WriteOutput(pWriteBuf, uBytesToWrite);
-        if(nWritten!=(int)uBytesToWrite)
-        {
-          PMS_SHOW_ERROR("PDF_PageHandler: Write output failed.\n");
-          eResult = PDF_Error_FileIO;
-          PDF_CloseOutput();
-          deflateEnd(&gtPDFOut.zstate);
-          return eResult;
-        }
-        gtPDFOut.filepos += nWritten ;
+    if(eResult == PDF_NoError)
+    {
+      if(uBands == 0)
+      {
+        /* No bands, so there is no final block yet; add an empty one. */
+        aZlibWrapper[0] = 0x03;
+        aZlibWrapper[1] = 0x00;
+        eResult = PDF_WriteImageData((char *)aZlibWrapper, 2);
       }
     }
-
-#ifndef NOCOMPRESS
-    /* finish compressor */
-    if(uBands>0)
+    if(eResult == PDF_NoError)
     {
-      /* finish compression */
-      do {
-        gtPDFOut.zstate.avail_in = 0;
-        gtPDFOut.zstate.next_in = (Bytef*)NULL;
-        gtPDFOut.zstate.avail_out = gtPDFOut.cbCompressBuffer;
-        gtPDFOut.zstate.next_out = (Bytef*)gtPDFOut.pCompressBuffer;
-        nResult = deflate(&gtPDFOut.zstate, Z_FINISH) ;
-        if(gtPDFOut.zstate.avail_in!=0)
-        {
-          PMS_SHOW_ERROR("*** ASSERT *** Raster data not entirely consumed by compressor... Z_FINISH gtPDFOut.zstate\n" \
-                 "  .avail_in = %u\n" \
-                 "  .avail_out = %u\n" \
-                 "  .total_in = %lu\n" \
-                 "  .total_out = %lu\n",
-              gtPDFOut.zstate.avail_in,
-              gtPDFOut.zstate.avail_out,
-              gtPDFOut.zstate.total_in,
-              gtPDFOut.zstate.total_out
-            );
-        }
-        if ( nResult != Z_OK && nResult != Z_STREAM_END )
-        {
-          PMS_SHOW_ERROR("PDF_PageHandler: Compression finish failed.\n");
-        }
-        uBytesToWrite = gtPDFOut.zstate.total_out - uLastTotal;
-
-        if(uBytesToWrite)
-        {
-          uLastTotal = gtPDFOut.zstate.total_out;
-          nWritten = PDF_WriteOutput(gtPDFOut.pCompressBuffer, uBytesToWrite);
-          if(nWritten!=(int)uBytesToWrite)
-          {
-            eResult = PDF_Error_FileIO;
-            PDF_CloseOutput();
-            deflateEnd(&gtPDFOut.zstate);
-            return eResult;
-          }
-          gtPDFOut.filepos += nWritten;
-#ifdef COMPRESS_TEST
-          memcpy(pTestCompPos, gtPDFOut.pCompressBuffer, uBytesToWrite);
-          pTestCompPos += uBytesToWrite;
-#endif
-        }
-      }while(nResult == Z_OK);
+      /* zlib trailer is the Adler-32 checksum of the whole raster, most significant byte first */
+      aZlibWrapper[0] = (unsigned char)(gtPDFOut.ulAdler >> 24);
+      aZlibWrapper[1] = (unsigned char)(gtPDFOut.ulAdler >> 16);
+      aZlibWrapper[2] = (unsigned char)(gtPDFOut.ulAdler >> 8);
+      aZlibWrapper[3] = (unsigned char)(gtPDFOut.ulAdler);
+      eResult = PDF_WriteImageData((char *)aZlibWrapper, 4);
     }
+#endif
 
-    /* end deflate */
-    if ( deflateEnd(&gtPDFOut.zstate) != Z_OK )
+    if(eResult != PDF_NoError)
     {
-      PMS_SHOW_ERROR("PDF_PageHandler: Compression end failed.\n");
-      eResult = PDF_Error_FileIO;
       PDF_CloseOutput();
-      return eResult;
-    }
+#ifdef COMPRESS_TEST
+      free(pTestCompressedFull);
+      free(pTestUncompressedFull);
 #endif
+      break;
+    }
 
     /* write pdf trailer */
     PDF_WriteFileTrailer(ptPMSPage);
@@ -1683,6 +1878,10 @@ int PDF_PageHandler( PMS_TyPage *ptPMSPage )
     /* close */
     PDF_CloseOutput();
 
+    PMS_SHOW("PDF_PageHandler: Job %d Page %d copy %d: %u bands, %u bytes of image data, written in %lu ms using %u workers.\n",
+             ptPMSPage->JobId, ptPMSPage->PageId, nCopyNo, uBands, gtPDFOut.cbImageStream,
+             PMS_TimeInMilliSecs() - ulStartTime, nJobs);
+
 #ifndef NOCOMPRESS
 #ifdef COMPRESS_TEST
     memset(&zstateUncompress, 0x00, sizeof(zstateUncompress));
@@ -1698,7 +1897,7 @@ int PDF_PageHandler( PMS_TyPage *ptPMSPage )
     }
     else
     {
-      zstateUncompress.avail_in = (uInt)(pTestCompPos - pTestCompressedFull);
+      zstateUncompress.avail_in = (uInt)(gtPDFOut.pTestCompPos - pTestCompressedFull);
       zstateUncompress.avail_out = (ptPMSPage->nRasterWidthBits/8) * ptPMSPage->nPageHeightPixels * 4;
       zstateUncompress.next_in = (Bytef *)pTestCompressedFull;
       zstateUncompress.next_out = (Bytef *)pTestUncompressedFull;
@@ -1724,6 +1923,9 @@ int PDF_PageHandler( PMS_TyPage *ptPMSPage )
 #endif
 #endif
   }
+
+  PDF_StopWorkers();
+
 #ifdef DIRECTVIEWPDFTIFF
   if((eResult == PDF_NoError) && (g_tSystemInfo.eOutputType == PMS_PDF_VIEW) && (!g_bBackChannelPageOutput))
   {
@@ -124,6 +124,14 @@ extern void * g_csSocketInput;
 */
 extern void * g_csMemoryUsage;
 
+/*! \brief Critical Section for thread-safe accessing of the pool of free band buffers
+ *
+ * PC/Windows
+ *
+ * Casted to void * for platform portability.
+*/
+extern void * g_csBandPool;
+
 
 
 #endif /* _PMS_PLATFORM_H_ */
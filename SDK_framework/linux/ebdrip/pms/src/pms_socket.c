@@ -36,6 +36,7 @@
 #include <sys/uio.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/select.h>
 
 #elif defined(THREADX)
 #include <rtipapi.h>
@@ -95,6 +96,10 @@ int sockclose(int sock);
 void socklisten(int sock, void (*handler) (void *));
 void sockerror(char *msg);
 
+/* How long the receiving thread and readers wait for the other side before
+   checking the input state again. */
+#define SOCKET_INPUT_WAIT_MS 100
+
 typedef struct tagPMSSocketInputBuffer{
   unsigned char *buffer;   /* buffer */
   int in;                  /* position in array to next data in */
@@ -106,6 +111,8 @@ typedef struct tagPMSSocketInputBuffer{
   int bEndOfJobReceived;   /* Client has closed the sending end. */
   void *pOpenInputThread;  /* Job connection thread */
   int bWaitingForAccept;   /* True if this socket is waiting for a connection */
+  void *semDataIn;         /* Signalled when data or the end of the job arrives */
+  void *semSpaceFree;      /* Signalled when data is consumed from a full buffer */
 } PMS_TySocketInputBuffer;
 
 typedef struct tagPMSSocket{
@@ -222,6 +229,8 @@ static PMS_TySocket * AddSocket()
   }
 
   pNewSocket->semOutput = PMS_CreateSemaphore(TRUE);
+  pNewSocket->tSocketInput.semDataIn = PMS_CreateSemaphore(0);
+  pNewSocket->tSocketInput.semSpaceFree = PMS_CreateSemaphore(0);
 
   if(l_pListSockets)
   {
@@ -256,6 +265,8 @@ static int RemoveSocket(PMS_TySocket * pSocketToRemove)
         OSFree(pSocket->tSocketInput.buffer, PMS_MemoryPoolPMS);
       }
       PMS_DestroySemaphore(pSocket->semOutput);
+      PMS_DestroySemaphore(pSocket->tSocketInput.semDataIn);
+      PMS_DestroySemaphore(pSocket->tSocketInput.semSpaceFree);
       OSFree(pSocket, PMS_MemoryPoolPMS);
       return TRUE;
     }
@@ -780,6 +791,42 @@ int Socket_GetHostAddress(char *pszAddress, int cbSize)
 }
 
 
+/**
+ * \brief Wait until a socket has data to receive, or a timeout expires.
+ *
+ * The data socket is non-blocking, so without this the receiving thread
+ * would spin on recv() while the client is slow to send.
+ * \return TRUE if the socket may have data (or has an error to report),
+ * FALSE if the timeout expired.
+ */
+static int Socket_WaitForData(SOCKET hSocket, unsigned int nMilliSeconds)
+{
+#if defined(WIN32) || defined(UNIX) || defined(MACOSX)
+  fd_set readfds;
+  struct timeval tv;
+
+  FD_ZERO(&readfds);
+  FD_SET(hSocket, &readfds);
+  tv.tv_sec = nMilliSeconds / 1000;
+  tv.tv_usec = (nMilliSeconds % 1000) * 1000;
+
+  /* Errors are reported by the recv() that follows. */
+  return select((int)hSocket + 1, &readfds, NULL, NULL, &tv) != 0;
+#else
+  UNUSED_PARAM(SOCKET, hSocket);
+  UNUSED_PARAM(unsigned int, nMilliSeconds);
+  PMS_RelinquishTimeSlice();
+  return TRUE;
+#endif
+}
+
+/**
+ * \brief Receiving thread for a job connection.
+ *
+ * Fills the receive ring buffer from the socket until the client closes
+ * its end, waiting on the socket when there is nothing to receive and on
+ * the consumer when the buffer is full, rather than polling either.
+ */
 void Socket_Input_Handler(void *pParam)
 {
   static int nTotalRecv = 0;
@@ -787,6 +834,7 @@ void Socket_Input_Handler(void *pParam)
   int nResult = 0;
   PMS_SOCKET_HANDLE hPMSSocket = (PMS_SOCKET_HANDLE)pParam;
   PMS_TySocket *pSocket = (PMS_TySocket*)hPMSSocket;
+  SOCKET hSocket;
   int bTryAgain = 1;
 
   PMS_SOCKET_TRACE("Socket_Input_Handler()\n");
@@ -795,8 +843,15 @@ void Socket_Input_Handler(void *pParam)
   do {
     PMS_EnterCriticalSection(g_csSocketInput);
 
+    hSocket = pSocket->hSocketData;
+    BytesToRead = 0;
+
+    if(pSocket->tSocketInput.bEndOfJobReceived || hSocket == INVALID_SOCKET)
+    {
+      pSocket->tSocketInput.nNoMoreData = 1;
+    }
     /* check there is space in the buffer to read into */
-    if (pSocket->tSocketInput.nValidBytes < g_tSystemInfo.cbReceiveBuffer)
+    else if (pSocket->tSocketInput.nValidBytes < g_tSystemInfo.cbReceiveBuffer)
     {
       /* there is space, determine how much */
       if ((pSocket->tSocketInput.out > pSocket->tSocketInput.in))
@@ -809,10 +864,26 @@ void Socket_Input_Handler(void *pParam)
         /* wrap around so fill to end of buffer */
         BytesToRead = g_tSystemInfo.cbReceiveBuffer - pSocket->tSocketInput.in ;
       }
+    }
+
+    PMS_LeaveCriticalSection(g_csSocketInput);
 
-      /* now read the data */
+    if(pSocket->tSocketInput.nNoMoreData)
+    {
+      bTryAgain = 0;
+    }
+    else if(BytesToRead == 0)
+    {
+      /* buffer full, wait for the consumer to make some space */
+      (void)PMS_WaitOnSemaphore(pSocket->tSocketInput.semSpaceFree, SOCKET_INPUT_WAIT_MS);
+    }
+    else if(Socket_WaitForData(hSocket, SOCKET_INPUT_WAIT_MS))
+    {
+      PMS_EnterCriticalSection(g_csSocketInput);
+
+      /* The socket may have been closed while we were waiting. */
       BytesRead = 0;
-      if(pSocket->tSocketInput.bEndOfJobReceived)
+      if(pSocket->hSocketData == INVALID_SOCKET)
       {
         pSocket->tSocketInput.nNoMoreData = 1;
       }
@@ -839,22 +910,24 @@ void Socket_Input_Handler(void *pParam)
             pSocket->tSocketInput.in = 0;
           }
         }
+
+        /* Readers stop waiting once there is no more data to come, so
+           a failed receive must end the job too. */
+        if(nResult || pSocket->tSocketInput.bEndOfJobReceived)
+          pSocket->tSocketInput.nNoMoreData = 1;
       }
-    }
-    else
-    {
-      /* buffer full, do not read */
-    }
 
-    if(nResult || pSocket->tSocketInput.nNoMoreData)
-      bTryAgain = 0;
-      
-    PMS_LeaveCriticalSection(g_csSocketInput);
- 
-    PMS_RelinquishTimeSlice();
+      bTryAgain = !pSocket->tSocketInput.nNoMoreData;
 
+      PMS_LeaveCriticalSection(g_csSocketInput);
+
+      if(BytesRead || !bTryAgain)
+        (void)PMS_IncrementSemaphore(pSocket->tSocketInput.semDataIn);
+    }
   } while (bTryAgain);
 
+  /* Wake any reader waiting for the end of the job. */
+  (void)PMS_IncrementSemaphore(pSocket->tSocketInput.semDataIn);
 }
 
 /**
@@ -931,7 +1004,7 @@ int Socket_OpenInDataStream(PMS_SOCKET_HANDLE hPMSSocket)
     while( (pSocket->tSocketInput.nNoMoreData == 0) &&
            (pSocket->tSocketInput.nValidBytes < g_tSystemInfo.cbReceiveBuffer) )
     {
-      PMS_RelinquishTimeSlice();
+      (void)PMS_WaitOnSemaphore(pSocket->tSocketInput.semDataIn, SOCKET_INPUT_WAIT_MS);
     }
     PMS_ASSERT(pSocket->tSocketInput.nNoMoreData == 1, ("Receive buffer filled before end of job. Increase receive job and try again.\n"));
     PMS_SHOW("Stored %d bytes.\n", pSocket->tSocketInput.nValidBytes);
@@ -1025,9 +1098,11 @@ int Socket_PeekInDataStream(PMS_SOCKET_HANDLE hPMSSocket, unsigned char * buffer
       
     PMS_LeaveCriticalSection(g_csSocketInput);
 
-    PMS_RelinquishTimeSlice();
-
-    /* We block here until there is no more data or we have some data to return */
+    /* We block here until there is no more data or we have some data to
+       return, sleeping until the receiving thread signals rather than
+       polling. The timeout covers a receiving thread that has gone away. */
+    if(bTryAgain)
+      (void)PMS_WaitOnSemaphore(pSocket->tSocketInput.semDataIn, SOCKET_INPUT_WAIT_MS);
   } while (bTryAgain);
 
   PMS_SOCKET_TRACE("Socket_PeekInDataStream() returning %d bytes\n", nBytesRead);
@@ -1066,6 +1141,10 @@ int Socket_ConsumeInDataStream(PMS_SOCKET_HANDLE hPMSSocket, int nBytesToConsume
     ("Trying to consume more bytes (%d bytes) than were stored in the buffer (%d bytes).",
     nBytesToConsume, pSocket->tSocketInput.nValidBytes ));
 
+  /* Wake the receiving thread if it is waiting for space. */
+  if(pSocket->tSocketInput.nValidBytes == g_tSystemInfo.cbReceiveBuffer && nBytesToConsume > 0)
+    (void)PMS_IncrementSemaphore(pSocket->tSocketInput.semSpaceFree);
+
   pSocket->tSocketInput.nValidBytes -= nBytesToConsume;
   if(pSocket->tSocketInput.nValidBytes < 0)
   {
@@ -19,6 +19,7 @@
 #include "gge_tiff.h"
 #include "pms.h"
 #include "pms_malloc.h"
+#include "pms_platform.h"
 #include "pms_tiff_out.h"
 #include <stdio.h>
 #include <string.h>
@@ -46,6 +47,7 @@ int TIFF_PageHandler( PMS_TyPage *ptPMSPage )
   unsigned int i, j, y;
   static unsigned int nCurrentJobID = 0, nPageNo = 0;
   char *pDst,pDestFile[PMS_MAX_OUTPUTFOLDER_LENGTH];
+  unsigned long ulStartTime;
 
   /* checks for features not supported */
   switch (ptPMSPage->uOutputDepth) {
@@ -209,6 +211,7 @@ int TIFF_PageHandler( PMS_TyPage *ptPMSPage )
 
   for(nCopyNo = 1; nCopyNo <= ptPMSPage->nCopies; nCopyNo++)
   {
+    ulStartTime = PMS_TimeInMilliSecs();
     sprintf(szRasterFilename, "%s%d-%d", pDestFile, ptPMSPage->JobId, nPageNo);
     tMyTIFFHeader.pszPathName = (char*)szRasterFilename;
 
@@ -667,6 +670,8 @@ int TIFF_PageHandler( PMS_TyPage *ptPMSPage )
         PMS_SHOW_ERROR("\nTIFF_PageHandler: Failed to close tiff. Return value(%d)\n", nResult);
         return TIFF_Error_GGETiff;
     }
+    PMS_SHOW("TIFF_PageHandler: Job %d Page %d copy %d written in %lu ms.\n",
+             ptPMSPage->JobId, ptPMSPage->PageId, nCopyNo, PMS_TimeInMilliSecs() - ulStartTime);
 #ifdef DIRECTVIEWPDFTIFF
     if((nCopyNo == 1) && (g_tSystemInfo.eOutputType == PMS_TIFF_VIEW) && (!g_bBackChannelPageOutput))
     {
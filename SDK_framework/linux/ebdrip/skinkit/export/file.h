@@ -181,6 +181,26 @@ extern int32 PKMakePSFilename(uint8* filename, uint8* psFilename);
  */
 extern FileDesc* PKOpenFile(uint8 *filename, int32 openflags, int32 * pError );
 
+/**
+ * \brief Serve reads of a file opened read-only from a memory mapping of
+ * the file rather than with read() calls.
+ *
+ * The mapping is advised for sequential access until the file is seeked to a
+ * new position, and for random access from then on. Data beyond the extent
+ * of the file when it was mapped is read with read() as usual.
+ *
+ * Only map files that nobody else writes while they are being read. If a
+ * mapped file is truncated, reading the part that was removed raises
+ * SIGBUS. Files modified in the last few seconds, or that change while
+ * being mapped, are not mapped, but that cannot catch every writer.
+ *
+ * \param pDescriptor The file descriptor, as returned from PKOpenFile().
+ * \return \c TRUE if the file is now mapped; \c FALSE if it cannot be
+ * mapped (it is not a regular file, is empty, is too large for the address
+ * space or may be changing), in which case it is still read with read().
+ */
+extern HqBool PKMapFile(FileDesc* pDescriptor );
+
 /**
  * \brief Read a specified number of bytes from a file into a buffer.
  * \param pDescriptor The file descriptor, as returned from PKOpenFile().
@@ -63,9 +63,20 @@
  * in this header file. If this macro is set to <code>FALSE</code>, no
  * compression will be applied to fresh files created at runtime.
  *
- * <p>The implementation of this API is thread-safe, to the extent that there
- * is no undocumented global state within the implementation that might
- * prevent concurrent use. However, the tree structures themselves are
+ * <p>The RAM used by file data buffers can be bounded with
+ * <code>MFSSetMemoryBudget()</code>. The budget covers every tree, because
+ * all trees draw on the same heap. When it is exceeded, the data of the
+ * least-recently closed files is moved out to a backing file on disk,
+ * named with <code>MFSSetSpillFile()</code>, and is read back transparently
+ * the next time the file is opened. Open files always stay in RAM, so the
+ * budget bounds closed files plus the working set of open ones. While a
+ * budget is in force, writable files grow in fixed-size chunks rather than
+ * by doubling their buffer, so that open files do not overshoot it.
+ *
+ * <p>The implementation of this API is thread-safe, to the extent that the
+ * only global state within the implementation (the memory budget and the
+ * list of closed files that may be moved to disk) is protected by a lock
+ * created by <code>MFSStartBudget()</code>. However, the tree structures themselves are
  * \e not protected by this layer. Broadly, this means that
  * concurrent use of this API should be limited to <em>disjoint
  * filesystem trees, or disjoint portions of a single tree</em>. For
@@ -99,6 +110,14 @@
  */
 #define COMPRESS_NEW_FILES TRUE
 
+/** \brief Values of <code>MFSFILE::fSpilled</code>. */
+enum
+{
+  MFS_SPILL_NONE,       /**< \brief The file's data is in memory. */
+  MFS_SPILL_DATA,       /**< \brief The uncompressed data is on disk. */
+  MFS_SPILL_COMPRESSED  /**< \brief The compressed data is on disk. */
+};
+
 /*
  * ************************** Foward Declarations *****************************
  */
@@ -154,6 +173,32 @@ typedef struct _MFSFILE
   uint8               *pCompressedData;
   /** \brief Flag indicating that the file has been modified. */
   uint32               fModified;
+
+  /* The following fields are managed by the memory budget, and should be
+     left out of (or zero in) static initializers. */
+
+  /** \brief Indicates whether the file's data has been moved out to the
+      backing file, and if so whether it was the compressed or the
+      uncompressed buffer. One of the <code>MFS_SPILL_*</code> values. */
+  uint32               fSpilled;
+  /** \brief Offset of the file's data within the backing file, if it has
+      been moved out. */
+  uint32               spillOffset;
+  /** \brief Length of the file's data within the backing file, if it has
+      been moved out. */
+  uint32               cbSpilled;
+  /** \brief Which backing file the file's data was moved out to. */
+  uint32               spillGeneration;
+  /** \brief Indicates that another thread is writing the file's data to
+      the backing file, and that its buffers must be left alone. */
+  uint32               fMoving;
+  /** \brief Indicates whether the file is on the list of closed files
+      holding RAM. */
+  uint32               fIdle;
+  /** \brief The next less-recently closed file on the idle list. */
+  struct _MFSFILE     *pColder;
+  /** \brief The next more-recently closed file on the idle list. */
+  struct _MFSFILE     *pWarmer;
 } MFSFILE;
 
 /**
@@ -873,5 +918,60 @@ void MFSReleaseRoot( MFSNODE *pMFSRoot );
  */
 void MFSMemUsage( MFSNODE *pNode, uint32 *pROMSize, uint32 *pRAMSize );
 
+/**
+ * \brief Create the lock protecting the memory budget.
+ *
+ * This must be called before the filesystem is used from more than one
+ * thread, and before any of the other budget functions. Without it, the
+ * budget functions do nothing and no budget is applied.
+ *
+ * \return TRUE on success; FALSE if the lock could not be created.
+ */
+int32 MFSStartBudget( void );
+
+/**
+ * \brief Destroy the lock created by <code>MFSStartBudget()</code>,
+ * removing any budget and deleting the backing file.
+ *
+ * Call this after all files which were moved out to the backing file have
+ * been deleted, typically after the trees have been released. Any file
+ * still in the backing file loses its data, and can no longer be opened.
+ */
+void MFSEndBudget( void );
+
+/**
+ * \brief Set the number of bytes of RAM which closed file data may use
+ * across all trees before it is moved out to the backing file.
+ *
+ * \param cbBudget The budget in bytes, or zero for no budget.
+ */
+void MFSSetMemoryBudget( uint32 cbBudget );
+
+/**
+ * \brief Name the backing file to which closed file data is moved when
+ * the memory budget is exceeded.
+ *
+ * The file is created when it is first needed, and deleted when no file
+ * data remains in it. The name cannot be changed while the backing file
+ * holds data.
+ *
+ * \param pszFilename Platform filename of the backing file, or
+ * <code>NULL</code> (or an empty string) to keep all file data in RAM.
+ *
+ * \return TRUE on success; FALSE if the name is too long, or the backing
+ * file is in use.
+ */
+int32 MFSSetSpillFile( uint8 *pszFilename );
+
+/**
+ * \brief Report the memory budget and the RAM currently used by file data
+ * buffers across all trees.
+ *
+ * \param pcbBudget Receives the budget, or zero if there is none.
+ *
+ * \param pcbInUse Receives the number of bytes of file data held in RAM.
+ */
+void MFSGetMemoryBudget( uint32 *pcbBudget, uint32 *pcbInUse );
+
 #endif
 
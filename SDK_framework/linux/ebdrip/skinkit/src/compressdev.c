@@ -0,0 +1,489 @@
+/* Copyright (C) 2014 Global Graphics Software Ltd. All rights reserved.
+ *
+ * This example is provided on an "as is" basis and without
+ * warranty of any kind. Global Graphics Software Ltd. does not
+ * warrant or make any representations regarding the use or results
+ * of use of this example.
+ *
+ * $HopeName: SWskinkit!src:compressdev.c(EBDSDK_P.1) $
+ */
+
+/**
+ * \file
+ * \ingroup skinkit
+ * \brief Implementation of the %compress% band compression device type.
+ *
+ * When the pagebuffer device reports \c RIPCanCompress, the RIP compresses
+ * each rendered band on the render thread that produced it, by creating an
+ * instance of this device type, writing the band to it, and reading the
+ * compressed band back over the original. The RIP then tells the pagebuffer
+ * device the band is compressed with \c BandIsCompressed.
+ *
+ * Bands are deflated in the same zlib format the pagebuffer device uses
+ * for its own band cache, so the pagebuffer device's existing decompressor
+ * serves partial painting readback and final output unchanged. Each band
+ * gets its own device instance, and so its own zlib stream and scratch
+ * buffer, so bands may be compressed on several threads at once.
+ */
+
+#include <string.h>
+
+#include "std.h"
+#include "swdevice.h"
+#include "skindevs.h"
+#include "mem.h"
+#include "hqmemcpy.h"
+#include "zlibutil.h"
+
+/** \brief The only descriptor this device hands out. */
+#define COMPRESS_FD       INT32_TO_DEVICE_FILEDESCRIPTOR(1)
+
+/**
+ * @brief  Structure to hold device-specific state.
+ */
+typedef struct CompressDeviceState
+{
+  float    minCompressRatio; /**< Largest output/input size ratio kept. */
+  int32    colorFactor;      /**< Band size multiplier for the read/write length. */
+  int32    scratchSize;      /**< Suggested scratch buffer size for the page. */
+  uint8  * pScratch;         /**< Compressed band data. */
+  uint32   cbScratch;        /**< Allocated size of pScratch. */
+  int32    cbCompressed;     /**< Bytes in pScratch, or -1 if the band didn't compress. */
+  HqBool   fOpen;            /**< Is the file open? */
+  HqBool   fStreamInit;      /**< Has stream been initialised? */
+  z_stream stream;           /**< Deflate stream reused for each band. */
+} CompressDeviceState;
+
+static int32 RIPCALL compressdev_ioerror( DEVICELIST *dev );
+
+static int32 compressdev_noerror( DEVICELIST *dev );
+
+static int32 RIPCALL compressdev_init_device( DEVICELIST *dev );
+
+static int32 RIPCALL compressdev_dismount_device( DEVICELIST *dev );
+
+static DEVICE_FILEDESCRIPTOR RIPCALL compressdev_open_file
+  ( DEVICELIST *dev, uint8 *filename, int32 openflags );
+
+static int32 RIPCALL compressdev_read_file
+  ( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor, uint8 *buff, int32 len );
+
+static int32 RIPCALL compressdev_write_file
+  ( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor, uint8 *buff, int32 len );
+
+static int32 RIPCALL compressdev_close_file( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor );
+
+static int32 RIPCALL compressdev_seek_file
+  ( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor, Hq32x2 *destination, int32 flags );
+
+static int32 RIPCALL compressdev_bytes_file
+  ( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor, Hq32x2 *bytes, int32 reason );
+
+static int32 RIPCALL compressdev_status_file
+  ( DEVICELIST *dev, uint8 *filename, STAT *statbuff );
+
+static void* RIPCALL compressdev_start_file_list( DEVICELIST *dev, uint8 *pattern );
+
+static int32 RIPCALL compressdev_next_file
+  ( DEVICELIST *dev, void **handle, uint8 *pattern, FILEENTRY *entry );
+
+static int32 RIPCALL compressdev_end_file_list( DEVICELIST *dev, void *handle );
+
+static int32 RIPCALL compressdev_rename_file
+  ( DEVICELIST *dev, uint8 *file1, uint8 *file2 );
+
+static int32 RIPCALL compressdev_delete_file( DEVICELIST *dev, uint8 *filename );
+
+static int32 RIPCALL compressdev_set_param( DEVICELIST *dev, DEVICEPARAM *param );
+
+static int32 RIPCALL compressdev_start_param( DEVICELIST *dev );
+
+static int32 RIPCALL compressdev_get_param( DEVICELIST *dev, DEVICEPARAM *param );
+
+static int32 RIPCALL compressdev_status_device( DEVICELIST *dev, DEVSTAT *devstat );
+
+static int32 RIPCALL compressdev_spare( void );
+
+/** \brief The band compression device type structure. */
+DEVICETYPE Compress_Device_Type = {
+  COMPRESS_DEVICE_TYPE,        /**< the device ID number */
+  DEVICERELATIVE,              /**< flags to indicate specifics of device */
+  CAST_SIZET_TO_INT32(sizeof (CompressDeviceState)), /**< the size of the private data */
+  0,                           /**< minimum ticks between tickle functions */
+  NULL,                        /**< procedure to service the device */
+  skindevices_last_error,      /**< return last error for this device */
+  compressdev_init_device,     /**< call to initialise device */
+  compressdev_open_file,       /**< call to open file on device */
+  compressdev_read_file,       /**< call to read data from file on device */
+  compressdev_write_file,      /**< call to write data to file on device */
+  compressdev_close_file,      /**< call to close file on device */
+  compressdev_close_file,      /**< call to abort action on the device */
+  compressdev_seek_file,       /**< call to seek file on device */
+  compressdev_bytes_file,      /**< call to get bytes avail on an open file */
+  compressdev_status_file,     /**< call to check status of file */
+  compressdev_start_file_list, /**< call to start listing files */
+  compressdev_next_file,       /**< call to get next file in list */
+  compressdev_end_file_list,   /**< call to end listing */
+  compressdev_rename_file,     /**< rename file on the device */
+  compressdev_delete_file,     /**< remove file from device */
+  compressdev_set_param,       /**< call to set device parameter */
+  compressdev_start_param,     /**< call to start getting device parameters */
+  compressdev_get_param,       /**< call to get the next device parameter */
+  compressdev_status_device,   /**< call to get the status of the device */
+  compressdev_dismount_device, /**< call to dismount the device */
+  compressdev_ioerror,         /**< call to return buffer size */
+  NULL,                        /**< ioctl slot (optional) */
+  compressdev_spare,           /**< spare slot */
+};
+
+static void compressdev_set_last_error( DEVICELIST *dev, int32 nError )
+{
+  UNUSED_PARAM(DEVICELIST *, dev);
+  skindevices_set_last_error(nError);
+}
+
+static int32 RIPCALL compressdev_ioerror( DEVICELIST *dev )
+{
+  compressdev_set_last_error( dev, DeviceIOError );
+  return -1;
+}
+
+static int32 compressdev_noerror( DEVICELIST *dev )
+{
+  compressdev_set_last_error( dev, DeviceNoError );
+  return 0;
+}
+
+/** \brief Free the scratch buffer and deflate stream. */
+static void compressdev_release( CompressDeviceState *pDeviceState )
+{
+  if ( pDeviceState->pScratch != NULL ) {
+    MemFree( pDeviceState->pScratch );
+    pDeviceState->pScratch = NULL;
+    pDeviceState->cbScratch = 0;
+  }
+
+  if ( pDeviceState->fStreamInit ) {
+    deflateEnd( &pDeviceState->stream );
+    pDeviceState->fStreamInit = FALSE;
+  }
+}
+
+/** \brief Make sure the scratch buffer holds at least cbNeeded bytes. */
+static HqBool compressdev_ensure_scratch( CompressDeviceState *pDeviceState,
+                                         uint32 cbNeeded )
+{
+  if ( pDeviceState->cbScratch < cbNeeded ) {
+    if ( pDeviceState->pScratch != NULL )
+      MemFree( pDeviceState->pScratch );
+    pDeviceState->pScratch = MemAlloc( cbNeeded, FALSE, FALSE );
+    if ( pDeviceState->pScratch == NULL ) {
+      pDeviceState->cbScratch = 0;
+      return FALSE;
+    }
+    pDeviceState->cbScratch = cbNeeded;
+  }
+
+  return TRUE;
+}
+
+static int32 RIPCALL compressdev_init_device( DEVICELIST *dev )
+{
+  CompressDeviceState *pDeviceState = (CompressDeviceState*) dev->private_data;
+
+  pDeviceState->minCompressRatio = 1.0f;
+  pDeviceState->colorFactor = 1;
+  pDeviceState->scratchSize = 0;
+  pDeviceState->pScratch = NULL;
+  pDeviceState->cbScratch = 0;
+  pDeviceState->cbCompressed = -1;
+  pDeviceState->fOpen = FALSE;
+  pDeviceState->fStreamInit = FALSE;
+
+  return compressdev_noerror( dev );
+}
+
+static int32 RIPCALL compressdev_dismount_device( DEVICELIST *dev )
+{
+  compressdev_release( (CompressDeviceState*) dev->private_data );
+
+  return compressdev_noerror( dev );
+}
+
+static DEVICE_FILEDESCRIPTOR RIPCALL compressdev_open_file
+  ( DEVICELIST *dev, uint8 *filename, int32 openflags )
+{
+  CompressDeviceState *pDeviceState = (CompressDeviceState*) dev->private_data;
+
+  UNUSED_PARAM( uint8 *, filename );
+
+  if ( pDeviceState->fOpen || (openflags & SW_WRONLY) == 0 ) {
+    compressdev_set_last_error( dev, DeviceInvalidAccess );
+    return -1;
+  }
+
+  /* Favour speed: the band has to be compressed before it can be output. */
+  if ( !pDeviceState->fStreamInit ) {
+    if ( gg_deflateInit( &pDeviceState->stream, Z_BEST_SPEED ) != Z_OK ) {
+      compressdev_set_last_error( dev, DeviceVMError );
+      return -1;
+    }
+    pDeviceState->fStreamInit = TRUE;
+  }
+
+  if ( pDeviceState->scratchSize > 0 &&
+       !compressdev_ensure_scratch( pDeviceState,
+                                    (uint32)pDeviceState->scratchSize ) ) {
+    compressdev_set_last_error( dev, DeviceVMError );
+    return -1;
+  }
+
+  pDeviceState->cbCompressed = -1;
+  pDeviceState->fOpen = TRUE;
+
+  (void)compressdev_noerror( dev );
+  return COMPRESS_FD;
+}
+
+/**
+ * \brief Compress a band.
+ *
+ * The band is \a len times the \c ColorFactor bytes long. It is kept only
+ * if it compresses to no more than \c MinBandCompressRatio of its size, so
+ * a ratio of 0 leaves every band uncompressed.
+ */
+static int32 RIPCALL compressdev_write_file
+  ( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor, uint8 *buff, int32 len )
+{
+  CompressDeviceState *pDeviceState = (CompressDeviceState*) dev->private_data;
+  uint32 cbBand, cbLimit;
+  int32 result;
+
+  if ( descriptor != COMPRESS_FD || !pDeviceState->fOpen || len < 0 )
+    return compressdev_ioerror( dev );
+
+  pDeviceState->cbCompressed = -1;
+
+  cbBand = (uint32)len * (uint32)pDeviceState->colorFactor;
+  cbLimit = (uint32)((float)cbBand * pDeviceState->minCompressRatio);
+  if ( cbLimit >= cbBand ) /* No point unless it gets smaller. */
+    cbLimit = cbBand > 0 ? cbBand - 1 : 0;
+
+  if ( cbLimit == 0 ) {
+    (void)compressdev_noerror( dev );
+    return len;
+  }
+
+  if ( !compressdev_ensure_scratch( pDeviceState, cbLimit ) ) {
+    compressdev_set_last_error( dev, DeviceVMError );
+    return -1;
+  }
+
+  result = gg_deflate( &pDeviceState->stream, pDeviceState->pScratch,
+                       &cbLimit, buff, cbBand );
+  switch ( result ) {
+  case Z_OK:
+    pDeviceState->cbCompressed = (int32)cbLimit;
+    break;
+  case Z_BUF_ERROR:
+    /* Didn't compress well enough; the RIP will output it uncompressed. */
+    break;
+  case Z_MEM_ERROR:
+    compressdev_set_last_error( dev, DeviceVMError );
+    return -1;
+  default:
+    return compressdev_ioerror( dev );
+  }
+
+  (void)compressdev_noerror( dev );
+  return len;
+}
+
+/**
+ * \brief Return the compressed band over the original band data.
+ *
+ * Returns the size of the compressed band, or -1 without an error set if
+ * the band could not be compressed.
+ */
+static int32 RIPCALL compressdev_read_file
+  ( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor, uint8 *buff, int32 len )
+{
+  CompressDeviceState *pDeviceState = (CompressDeviceState*) dev->private_data;
+
+  if ( descriptor != COMPRESS_FD || !pDeviceState->fOpen )
+    return compressdev_ioerror( dev );
+
+  (void)compressdev_noerror( dev );
+
+  if ( pDeviceState->cbCompressed < 0 )
+    return -1;
+
+  HQASSERT((uint32)pDeviceState->cbCompressed <
+           (uint32)len * (uint32)pDeviceState->colorFactor,
+           "Compressed band larger than the original");
+  HqMemCpy( buff, pDeviceState->pScratch, pDeviceState->cbCompressed );
+
+  return pDeviceState->cbCompressed;
+}
+
+static int32 RIPCALL compressdev_close_file( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor )
+{
+  CompressDeviceState *pDeviceState = (CompressDeviceState*) dev->private_data;
+
+  if ( descriptor != COMPRESS_FD || !pDeviceState->fOpen )
+    return compressdev_ioerror( dev );
+
+  pDeviceState->fOpen = FALSE;
+  pDeviceState->cbCompressed = -1;
+
+  return compressdev_noerror( dev );
+}
+
+static int32 RIPCALL compressdev_seek_file
+  ( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor, Hq32x2 *destination, int32 flags )
+{
+  UNUSED_PARAM( DEVICE_FILEDESCRIPTOR, descriptor );
+  UNUSED_PARAM( Hq32x2 *, destination );
+  UNUSED_PARAM( int32, flags );
+
+  compressdev_set_last_error( dev, DeviceIOError );
+  return FALSE;
+}
+
+static int32 RIPCALL compressdev_bytes_file
+  ( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR descriptor, Hq32x2 *bytes, int32 reason )
+{
+  UNUSED_PARAM( DEVICE_FILEDESCRIPTOR, descriptor );
+  UNUSED_PARAM( Hq32x2 *, bytes );
+  UNUSED_PARAM( int32, reason );
+
+  compressdev_set_last_error( dev, DeviceIOError );
+  return FALSE;
+}
+
+static int32 RIPCALL compressdev_status_file
+  ( DEVICELIST *dev, uint8 *filename, STAT *statbuff )
+{
+  UNUSED_PARAM( uint8 *, filename );
+  UNUSED_PARAM( STAT *, statbuff );
+
+  return compressdev_ioerror( dev );
+}
+
+static void* RIPCALL compressdev_start_file_list( DEVICELIST *dev, uint8 *pattern )
+{
+  UNUSED_PARAM( uint8 *, pattern );
+
+  (void)compressdev_noerror( dev );
+  return NULL;
+}
+
+static int32 RIPCALL compressdev_next_file
+  ( DEVICELIST *dev, void **handle, uint8 *pattern, FILEENTRY *entry )
+{
+  UNUSED_PARAM( DEVICELIST *, dev );
+  UNUSED_PARAM( void **, handle );
+  UNUSED_PARAM( uint8 *, pattern );
+  UNUSED_PARAM( FILEENTRY *, entry );
+
+  return FileNameNoMatch;
+}
+
+static int32 RIPCALL compressdev_end_file_list( DEVICELIST *dev, void *handle )
+{
+  UNUSED_PARAM( void *, handle );
+
+  return compressdev_noerror( dev );
+}
+
+static int32 RIPCALL compressdev_rename_file
+  ( DEVICELIST *dev, uint8 *file1, uint8 *file2 )
+{
+  UNUSED_PARAM( uint8 *, file1 );
+  UNUSED_PARAM( uint8 *, file2 );
+
+  return compressdev_ioerror( dev );
+}
+
+static int32 RIPCALL compressdev_delete_file( DEVICELIST *dev, uint8 *filename )
+{
+  UNUSED_PARAM( uint8 *, filename );
+
+  return compressdev_ioerror( dev );
+}
+
+/** \brief Test a device parameter name against a C string. */
+#define PARAM_NAME_IS(param_, name_) \
+  ((param_)->paramnamelen == (int32)sizeof("" name_ "") - 1 && \
+   strncmp((char *)(param_)->paramname, name_, sizeof("" name_ "") - 1) == 0)
+
+/**
+ * \brief Set the parameters the RIP passes from the pagebuffer device.
+ *
+ * \c CompressBands and \c BandWidth are accepted but not needed; the codec
+ * works on the band bytes whatever their layout.
+ */
+static int32 RIPCALL compressdev_set_param( DEVICELIST *dev, DEVICEPARAM *param )
+{
+  CompressDeviceState *pDeviceState = (CompressDeviceState*) dev->private_data;
+
+  compressdev_set_last_error( dev, DeviceNoError );
+
+  if ( param->paramname == NULL )
+    return ParamIgnored;
+
+  if ( PARAM_NAME_IS(param, "MinBandCompressRatio") ) {
+    if ( param->type != ParamFloat )
+      return ParamTypeCheck;
+    if ( param->paramval.floatval < 0.0f || param->paramval.floatval > 1.0f )
+      return ParamRangeCheck;
+    pDeviceState->minCompressRatio = param->paramval.floatval;
+  } else if ( PARAM_NAME_IS(param, "ColorFactor") ) {
+    if ( param->type != ParamInteger )
+      return ParamTypeCheck;
+    if ( param->paramval.intval < 1 )
+      return ParamRangeCheck;
+    pDeviceState->colorFactor = param->paramval.intval;
+  } else if ( PARAM_NAME_IS(param, "ScratchSize") ) {
+    if ( param->type != ParamInteger )
+      return ParamTypeCheck;
+    if ( param->paramval.intval < 0 )
+      return ParamRangeCheck;
+    pDeviceState->scratchSize = param->paramval.intval;
+  } else if ( PARAM_NAME_IS(param, "CompressBands") ||
+              PARAM_NAME_IS(param, "BandWidth") ) {
+    if ( param->type != ParamInteger )
+      return ParamTypeCheck;
+  } else {
+    return ParamIgnored;
+  }
+
+  return ParamAccepted;
+}
+
+static int32 RIPCALL compressdev_start_param( DEVICELIST *dev )
+{
+  compressdev_set_last_error( dev, DeviceNoError );
+  return 0;
+}
+
+static int32 RIPCALL compressdev_get_param( DEVICELIST *dev, DEVICEPARAM *param )
+{
+  UNUSED_PARAM( DEVICELIST *, dev );
+  UNUSED_PARAM( DEVICEPARAM *, param );
+
+  return ParamIgnored;
+}
+
+static int32 RIPCALL compressdev_status_device( DEVICELIST *dev, DEVSTAT *devstat )
+{
+  UNUSED_PARAM( DEVSTAT *, devstat );
+
+  return compressdev_ioerror( dev );
+}
+
+static int32 RIPCALL compressdev_spare( void )
+{
+  return 0;
+}
+
@@ -188,10 +188,16 @@ typedef struct FileDeviceState
 
   /** @brief Semaphore to protect concurrent calls. */
   void *pSema;
+
+  /** @brief Serve reads of files opened read-only from memory mappings
+      (the /MapFiles device parameter). Only for files nobody else writes
+      while the RIP reads them; see PKMapFile(). */
+  HqBool fMapFiles;
 } FileDeviceState;
 
 static const uint8 * fs_prefix_parameter = (uint8 *) "Prefix";
 static const uint8 * fs_type_parameter = (uint8 *) "Type";
+static const uint8 * fs_mapfiles_parameter = (uint8 *) "MapFiles";
 
 /*
  * This buffer holds an explicitly-provided path to the SW folder, as stored
@@ -380,6 +386,7 @@ static int32 initialiseDeviceState (DEVICELIST *dev)
     pDeviceState->psSWDir[0] = '\0';
     skindevices_set_last_error(DeviceNoError);
     pDeviceState->pSema = pSema;
+    pDeviceState->fMapFiles = FALSE;
 
     return TRUE;
   }
@@ -485,6 +492,12 @@ static DEVICE_FILEDESCRIPTOR RIPCALL fs_open_file( DEVICELIST *dev,
     return -1;
   }
 
+  /* Files that can't be mapped (pipes, sockets, empty files) carry on
+   * using plain reads. */
+  if ( pDeviceState->fMapFiles &&
+       (openflags & (SW_RDONLY | SW_WRONLY | SW_RDWR)) == SW_RDONLY )
+    (void)PKMapFile(pFileState->pDescriptor);
+
   result = VOIDPTR_TO_DEVICE_FILEDESCRIPTOR(pFileState) ;
 
   skindevices_set_last_error( DeviceNoError );
@@ -1219,6 +1232,17 @@ static int32 RIPCALL fs_set_param( DEVICELIST *dev, DEVICEPARAM *param )
     if ( length >= LONGESTFILENAME )
       length = LONGESTFILENAME - 1;
     pDeviceState->psSWDir[ length ] = '\0';
+  } else if ( param->paramnamelen == strlen_int32((char *)fs_mapfiles_parameter) &&
+              strncmp((char *)param->paramname, (char *)fs_mapfiles_parameter,
+                      (size_t)param->paramnamelen) == 0 ) {
+    FileDeviceState* pDeviceState = (FileDeviceState*) dev->private_data;
+
+    if ( param->type != ParamBoolean ) {
+      skindevices_set_last_error( DeviceIOError );
+      return ParamTypeCheck;
+    }
+    /* Only affects files opened after the change. */
+    pDeviceState->fMapFiles = theIDevParamBoolean(param);
   } else {
     skindevices_set_last_error( DeviceNoError );
     return ParamIgnored;
@@ -1248,7 +1272,7 @@ static int32 RIPCALL fs_start_param( DEVICELIST *dev )
   UNUSED_PARAM(DEVICELIST *, dev);
   skindevices_set_last_error( DeviceNoError );
   fs_param_count = 0;
-  return 2; /* number of device specific parameters: only two */
+  return 3; /* number of device specific parameters */
 }
 
 /* ---------------------------------------------------------------------- */
@@ -1286,6 +1310,12 @@ static int32 RIPCALL fs_get_param( DEVICELIST *dev, DEVICEPARAM *param )
       param->paramval.strval = ( uint8* ) "FileSystem" ;
       param->strvallen = sizeof("FileSystem") - 1 ;
       return ParamAccepted;
+    case 2 :
+      param->paramname = (uint8*) fs_mapfiles_parameter;
+      param->paramnamelen = strlen_int32 ( (char *) fs_mapfiles_parameter );
+      param->type = ParamBoolean;
+      theIDevParamBoolean(param) = pDeviceState->fMapFiles;
+      return ParamAccepted;
     default:
       return ParamIgnored;
     }
@@ -1303,6 +1333,12 @@ static int32 RIPCALL fs_get_param( DEVICELIST *dev, DEVICEPARAM *param )
     param->paramval.strval = ( uint8* ) "FileSystem" ;
     param->strvallen = sizeof("FileSystem") - 1 ;
     return ParamAccepted;
+  } else if ( strncmp ((char *)param->paramname, (char *)fs_mapfiles_parameter,
+                       (size_t)param->paramnamelen ) == 0 )
+  {
+    param->type = ParamBoolean;
+    theIDevParamBoolean(param) = pDeviceState->fMapFiles;
+    return ParamAccepted;
   } else {
     return ParamIgnored;
   }
@@ -23,6 +23,7 @@
 #include "memfs.h"
 #include "mem.h"
 #include "swdevice.h"
+#include "sync.h"  /* PKCreateSemaphore */
 #include "zlibutil.h"
 
 /**
@@ -42,6 +43,25 @@
  */
 #define BUFFER_GROWTH_FACTOR 2
 
+/**
+ * \brief The size (in bytes) by which file data buffers are grown instead,
+ * when doubling them would take the filesystem over its memory budget.
+ */
+#define BUDGET_GROWTH_CHUNK  (1024 * 1024)
+
+/**
+ * \brief The number of slots allocated for holes in the backing file when
+ * the first one appears.
+ */
+#define INITIAL_SPILL_HOLES  16
+
+/**
+ * \brief The zlib level at which file data is compressed at runtime. Files
+ * are compressed every time they are closed, so speed matters more here
+ * than the last few percent of compression.
+ */
+#define RUNTIME_COMPRESSION_LEVEL Z_BEST_SPEED
+
 /**
  * \brief The default number of slots allocated for child nodes when a
  * new directory node is added.
@@ -77,6 +97,92 @@ struct _MFSFILEDESC
   z_stream             zlibStream;
 };
 
+/**
+ * \brief A range of bytes within the backing file.
+ */
+typedef struct _MFSEXTENT
+{
+  /** \brief Offset of the range within the backing file. */
+  uint32               offset;
+
+  /** \brief Length of the range in bytes. */
+  uint32               cbSize;
+} MFSEXTENT;
+
+/**
+ * \brief The memory budget, shared by all trees.
+ *
+ * All fields are protected by \c pSema, once it has been created, except
+ * that reads and writes of the backing file are made under \c pSpillSema
+ * alone, so that moving one file's data does not hold up every other
+ * file.
+ */
+typedef struct _MFSBUDGET
+{
+  /** \brief Lock protecting this structure, or NULL if
+      <code>MFSStartBudget()</code> has not been called. */
+  void                *pSema;
+
+  /** \brief Lock serializing seeks, reads and writes on the backing
+      file. Never waited on while \c pSema is held. */
+  void                *pSpillSema;
+
+  /** \brief Signalled once for each waiter when a file's data has
+      finished moving out to the backing file. */
+  void                *pMoveDone;
+
+  /** \brief The number of threads waiting on \c pMoveDone. */
+  uint32               nMoveWaiters;
+
+  /** \brief The number of bytes of RAM file data may use, or zero. */
+  uint32               cbBudget;
+
+  /** \brief The number of bytes of RAM file data is currently using. */
+  uint32               cbInUse;
+
+  /** \brief The number of bytes of <code>cbInUse</code> which belong to
+      files whose data is being written to the backing file, and will be
+      freed once it has been. */
+  uint32               cbLeaving;
+
+  /** \brief The least-recently closed file holding RAM. */
+  MFSFILE             *pColdest;
+
+  /** \brief The most-recently closed file holding RAM. */
+  MFSFILE             *pWarmest;
+
+  /** \brief Platform filename of the backing file, or empty. */
+  uint8                szSpillFile[ LONGESTFILENAME ];
+
+  /** \brief The open backing file, or NULL. */
+  FileDesc            *pSpill;
+
+  /** \brief The end of the data written to the backing file. */
+  uint32               cbSpillEnd;
+
+  /** \brief The number of files with data in, or being written to, the
+      backing file. The backing file is deleted when this drops to zero. */
+  uint32               nSpilled;
+
+  /** \brief Holes left in the backing file by files read back from it,
+      sorted by offset, none of them touching another or the end. There
+      is at most one more hole than there are files in the backing file. */
+  MFSEXTENT           *pHoles;
+
+  /** \brief The number of entries in <code>pHoles</code>. */
+  uint32               nHoles;
+
+  /** \brief The number of entries allocated for <code>pHoles</code>. */
+  uint32               nHoleSlots;
+
+  /** \brief Incremented each time the backing file is abandoned by
+      <code>MFSEndBudget()</code> with files still in it, so that those
+      files can tell their data is gone. */
+  uint32               spillGeneration;
+} MFSBUDGET;
+
+static MFSBUDGET budget;
+
 /**
  * @brief Find or create a file node within the tree.
  *
@@ -301,10 +407,679 @@ static int32 deflateData( MFSFILE *pFile );
  */
 static void countOpenFiles( MFSNODE *pNode, uint32 *pnReaders, uint32 *pnWriters );
 
+/**
+ * @brief Take the budget lock, if it exists.
+ */
+static void lockBudget( void )
+{
+  if ( budget.pSema != NULL )
+    (void) PKWaitOnSemaphore( budget.pSema );
+}
+
+/**
+ * @brief Release the budget lock, if it exists.
+ */
+static void unlockBudget( void )
+{
+  if ( budget.pSema != NULL )
+    (void) PKSignalSemaphore( budget.pSema );
+}
+
+/**
+ * @brief Take the backing file lock, if it exists. Never called with the
+ * budget lock held.
+ */
+static void lockSpill( void )
+{
+  if ( budget.pSpillSema != NULL )
+    (void) PKWaitOnSemaphore( budget.pSpillSema );
+}
+
+/**
+ * @brief Release the backing file lock, if it exists.
+ */
+static void unlockSpill( void )
+{
+  if ( budget.pSpillSema != NULL )
+    (void) PKSignalSemaphore( budget.pSpillSema );
+}
+
+/**
+ * @brief Wait until a file's data is no longer being moved out to the
+ * backing file by another thread. Called with the budget lock held, which
+ * is released while waiting.
+ */
+static void waitForMove( MFSFILE *pFile )
+{
+  while ( pFile->fMoving )
+  {
+    budget.nMoveWaiters++;
+    unlockBudget();
+    (void) PKWaitOnSemaphore( budget.pMoveDone );
+    lockBudget();
+  }
+}
+
+/**
+ * @brief Wake every thread in <code>waitForMove()</code>, so that each
+ * can check whether the file it is waiting for has finished moving. Called
+ * with the budget lock held.
+ */
+static void wakeMoveWaiters( void )
+{
+  while ( budget.nMoveWaiters > 0 )
+  {
+    (void) PKSignalSemaphore( budget.pMoveDone );
+    budget.nMoveWaiters--;
+  }
+}
+
+/**
+ * @brief Add a closed file to the warm end of the idle list. Called with
+ * the budget lock held.
+ */
+static void linkIdleFile( MFSFILE *pFile )
+{
+  pFile->pColder = budget.pWarmest;
+  pFile->pWarmer = NULL;
+
+  if ( budget.pWarmest != NULL )
+    budget.pWarmest->pWarmer = pFile;
+  else
+    budget.pColdest = pFile;
+
+  budget.pWarmest = pFile;
+  pFile->fIdle = TRUE;
+}
+
+/**
+ * @brief Remove a file from the idle list, if it is on it. Called with
+ * the budget lock held.
+ */
+static void unlinkIdleFile( MFSFILE *pFile )
+{
+  if ( !pFile->fIdle )
+    return;
+
+  if ( pFile->pColder != NULL )
+    pFile->pColder->pWarmer = pFile->pWarmer;
+  else
+    budget.pColdest = pFile->pWarmer;
+
+  if ( pFile->pWarmer != NULL )
+    pFile->pWarmer->pColder = pFile->pColder;
+  else
+    budget.pWarmest = pFile->pColder;
+
+  pFile->pColder = NULL;
+  pFile->pWarmer = NULL;
+  pFile->fIdle = FALSE;
+}
+
+/**
+ * @brief Close and delete the backing file. Called with the budget lock
+ * held, once no file data remains in it.
+ */
+static void closeSpillFile( void )
+{
+  int32 error;
+
+  if ( budget.pSpill != NULL )
+  {
+    (void) PKCloseFile( budget.pSpill, &error );
+    (void) PKDeleteFile( budget.szSpillFile, &error );
+    budget.pSpill = NULL;
+  }
+
+  budget.cbSpillEnd = 0;
+  budget.nHoles = 0;
+}
+
+/**
+ * @brief Find room for <code>cbData</code> bytes in the backing file,
+ * re-using the first hole big enough before growing the file. Called with
+ * the budget lock held.
+ *
+ * @return TRUE with the offset of the room in <code>*pOffset</code>, or
+ * FALSE if the backing file cannot grow any further.
+ */
+static int32 takeSpillExtent( uint32 cbData, uint32 *pOffset )
+{
+  uint32 i;
+
+  if ( cbData > 0 )
+  {
+    for ( i = 0; i < budget.nHoles; i++ )
+    {
+      MFSEXTENT *pHole = &budget.pHoles[ i ];
+
+      if ( pHole->cbSize >= cbData )
+      {
+        *pOffset = pHole->offset;
+        pHole->offset += cbData;
+        pHole->cbSize -= cbData;
+
+        if ( pHole->cbSize == 0 )
+        {
+          budget.nHoles--;
+          memmove( pHole, pHole + 1,
+                   ( budget.nHoles - i ) * sizeof( MFSEXTENT ) );
+        }
+        return TRUE;
+      }
+    }
+  }
+
+  /* Offsets are 32-bit, so stop using the backing file once it is full. */
+  if ( budget.cbSpillEnd + cbData < budget.cbSpillEnd )
+    return FALSE;
+
+  *pOffset = budget.cbSpillEnd;
+  budget.cbSpillEnd += cbData;
+
+  return TRUE;
+}
+
+/**
+ * @brief Make sure there is a free slot in the list of holes in the backing
+ * file. Called with the budget lock held.
+ */
+static int32 growSpillHoles( void )
+{
+  MFSEXTENT *pNewHoles;
+  uint32 nNewSlots;
+
+  if ( budget.nHoles < budget.nHoleSlots )
+    return TRUE;
+
+  nNewSlots = ( budget.nHoleSlots == 0 ) ? INITIAL_SPILL_HOLES :
+              budget.nHoleSlots * LIST_GROWTH_FACTOR;
+  pNewHoles = (MFSEXTENT*) MemAlloc( nNewSlots * sizeof( MFSEXTENT ),
+                                     FALSE, FALSE );
+  if ( pNewHoles == NULL )
+    return FALSE;
+
+  if ( budget.pHoles != NULL )
+  {
+    memcpy( pNewHoles, budget.pHoles, budget.nHoles * sizeof( MFSEXTENT ) );
+    MemFree( (void*) budget.pHoles );
+  }
+
+  budget.pHoles = pNewHoles;
+  budget.nHoleSlots = nNewSlots;
+
+  return TRUE;
+}
+
+/**
+ * @brief Give back room in the backing file taken by
+ * <code>takeSpillExtent()</code>, merging it with the holes either side of
+ * it. Called with the budget lock held.
+ */
+static void returnSpillExtent( uint32 offset, uint32 cbData )
+{
+  uint32 i;
+  MFSEXTENT *pHole;
+
+  if ( cbData == 0 )
+    return;
+
+  /* Find the first hole after the range. */
+  for ( i = 0; i < budget.nHoles; i++ )
+  {
+    if ( budget.pHoles[ i ].offset > offset )
+      break;
+  }
+
+  /* Merge with the hole before. */
+  if ( i > 0 )
+  {
+    pHole = &budget.pHoles[ i - 1 ];
+    if ( pHole->offset + pHole->cbSize == offset )
+    {
+      offset = pHole->offset;
+      cbData += pHole->cbSize;
+      budget.nHoles--;
+      i--;
+      memmove( pHole, pHole + 1, ( budget.nHoles - i ) * sizeof( MFSEXTENT ) );
+    }
+  }
+
+  /* Merge with the hole after. */
+  if ( i < budget.nHoles )
+  {
+    pHole = &budget.pHoles[ i ];
+    if ( offset + cbData == pHole->offset )
+    {
+      cbData += pHole->cbSize;
+      budget.nHoles--;
+      memmove( pHole, pHole + 1, ( budget.nHoles - i ) * sizeof( MFSEXTENT ) );
+    }
+  }
+
+  if ( offset + cbData == budget.cbSpillEnd )
+  {
+    /* The range is at the end, so the next file written can go there. */
+    budget.cbSpillEnd = offset;
+  }
+  else if ( growSpillHoles() )
+  {
+    pHole = &budget.pHoles[ i ];
+    memmove( pHole + 1, pHole, ( budget.nHoles - i ) * sizeof( MFSEXTENT ) );
+    pHole->offset = offset;
+    pHole->cbSize = cbData;
+    budget.nHoles++;
+  }
+  /* Otherwise there is no memory to record the hole, and the range is lost
+     until the backing file is deleted. */
+}
+
+/**
+ * @brief Write data to the backing file, opening it if need be. Takes the
+ * backing file lock, and must be called without the budget lock held.
+ */
+static int32 writeSpillData( uint8 *pBuf, uint32 cbData, uint32 spillOffset )
+{
+  uint32 cbDone;
+  Hq32x2 offset;
+  int32 error;
+  int32 fOK = TRUE;
+
+  lockSpill();
+
+  if ( budget.pSpill == NULL )
+    budget.pSpill = PKOpenFile( budget.szSpillFile,
+                                SW_RDWR | SW_CREAT | SW_TRUNC, &error );
+
+  Hq32x2FromUint32( &offset, spillOffset );
+  if ( budget.pSpill == NULL ||
+       !PKSeekFile( budget.pSpill, &offset, SW_SET, &error ) )
+    fOK = FALSE;
+
+  for ( cbDone = 0; fOK && cbDone < cbData; )
+  {
+    int32 cbWritten = PKWriteFile( budget.pSpill, pBuf + cbDone,
+                                   (int32) (cbData - cbDone), &error );
+    if ( cbWritten <= 0 )
+      fOK = FALSE;
+    else
+      cbDone += (uint32) cbWritten;
+  }
+
+  unlockSpill();
+
+  return fOK;
+}
+
+/**
+ * @brief Read data back from the backing file. Takes the backing file lock,
+ * and must be called without the budget lock held.
+ */
+static int32 readSpillData( uint8 *pBuf, uint32 cbData, uint32 spillOffset )
+{
+  uint32 cbDone;
+  Hq32x2 offset;
+  int32 error;
+  int32 fOK = TRUE;
+
+  lockSpill();
+
+  Hq32x2FromUint32( &offset, spillOffset );
+  if ( budget.pSpill == NULL ||
+       !PKSeekFile( budget.pSpill, &offset, SW_SET, &error ) )
+    fOK = FALSE;
+
+  for ( cbDone = 0; fOK && cbDone < cbData; )
+  {
+    int32 cbRead = PKReadFile( budget.pSpill, pBuf + cbDone,
+                               (int32) (cbData - cbDone), &error );
+    if ( cbRead <= 0 )
+      fOK = FALSE;
+    else
+      cbDone += (uint32) cbRead;
+  }
+
+  unlockSpill();
+
+  return fOK;
+}
+
+/**
+ * @brief Move the data of a closed file out to the backing file, and free
+ * its RAM. Called with the budget lock held, which is released while the
+ * data is written.
+ *
+ * <p>Only files holding a single, runtime-allocated buffer are moved:
+ * either their uncompressed or their compressed data, but not both. The
+ * file must already be off the idle list.
+ *
+ * @return TRUE if the file's data was moved, FALSE otherwise.
+ */
+static int32 spillFile( MFSFILE *pFile )
+{
+  uint8 *pBuf;
+  uint32 cbData, cbHeld, spillOffset;
+  uint32 spillType;
+  int32 fOK;
+
+  if ( pFile->pData != NULL && pFile->fDynamicBuffer &&
+       pFile->pCompressedData == NULL )
+  {
+    pBuf = pFile->pData;
+    cbData = pFile->cbSize;
+    cbHeld = pFile->cbCapacity;
+    spillType = MFS_SPILL_DATA;
+  }
+  else if ( pFile->pData == NULL && pFile->pCompressedData != NULL &&
+            pFile->fDynamicCompressedBuffer )
+  {
+    pBuf = pFile->pCompressedData;
+    cbData = pFile->cbCompressedSize;
+    cbHeld = pFile->cbCompressedSize;
+    spillType = MFS_SPILL_COMPRESSED;
+  }
+  else
+  {
+    return FALSE;
+  }
+
+  if ( !takeSpillExtent( cbData, &spillOffset ) )
+    return FALSE;
+
+  /* Counting the file now stops the backing file being deleted while it
+     is written, and marking it keeps its owner off the buffer. */
+  budget.nSpilled++;
+  budget.cbLeaving += cbHeld;
+  pFile->fMoving = TRUE;
+  unlockBudget();
+
+  fOK = writeSpillData( pBuf, cbData, spillOffset );
+
+  lockBudget();
+  budget.cbLeaving -= cbHeld;
+  pFile->fMoving = FALSE;
+  wakeMoveWaiters();
+
+  if ( !fOK )
+  {
+    returnSpillExtent( spillOffset, cbData );
+    if ( --budget.nSpilled == 0 )
+      closeSpillFile();
+    return FALSE;
+  }
+
+  /* The data is safely on disk, so commit to freeing the RAM. */
+  MemFree( (void*) pBuf );
+  budget.cbInUse -= cbHeld;
+
+  if ( spillType == MFS_SPILL_DATA )
+  {
+    pFile->pData = NULL;
+    pFile->fDynamicBuffer = FALSE;
+    pFile->cbCapacity = 0;
+  }
+  else
+  {
+    pFile->pCompressedData = NULL;
+    pFile->fDynamicCompressedBuffer = FALSE;
+  }
+
+  pFile->fSpilled = spillType;
+  pFile->spillOffset = spillOffset;
+  pFile->cbSpilled = cbData;
+  pFile->spillGeneration = budget.spillGeneration;
+
+  return TRUE;
+}
+
+/**
+ * @brief Forget a file's data in the backing file, leaving a hole for
+ * another file to use, and deleting the backing file once it holds no
+ * data. Called with the budget lock held.
+ */
+static void dropSpilledData( MFSFILE *pFile )
+{
+  if ( pFile->fSpilled != MFS_SPILL_NONE )
+  {
+    /* Files left behind by MFSEndBudget() have nothing to give back. */
+    if ( pFile->spillGeneration == budget.spillGeneration )
+    {
+      returnSpillExtent( pFile->spillOffset, pFile->cbSpilled );
+      if ( --budget.nSpilled == 0 )
+        closeSpillFile();
+    }
+
+    pFile->fSpilled = MFS_SPILL_NONE;
+    pFile->spillOffset = 0;
+    pFile->cbSpilled = 0;
+  }
+}
+
+/**
+ * @brief Move the coldest closed files out to the backing file until
+ * <code>cbNeeded</code> more bytes fit in the budget, or there are no more
+ * candidates. Called with the budget lock held, which is released while
+ * each file is written.
+ */
+static void reclaimMemory( uint32 cbNeeded )
+{
+  if ( budget.cbBudget == 0 || budget.szSpillFile[ 0 ] == '\0' )
+    return;
+
+  /* RAM already on its way out on other threads is not counted, so they
+     do not all move out extra files for the same shortfall. */
+  while ( budget.pColdest != NULL &&
+          ( budget.cbInUse - budget.cbLeaving > budget.cbBudget ||
+            cbNeeded > budget.cbBudget - ( budget.cbInUse - budget.cbLeaving ) ) )
+  {
+    MFSFILE *pFile = budget.pColdest;
+
+    /* If the file cannot be moved out, it stays in RAM until it is next
+       opened and closed, rather than being retried here. */
+    unlinkIdleFile( pFile );
+    (void) spillFile( pFile );
+  }
+}
+
+/**
+ * @brief Read a file's data back from the backing file into a fresh
+ * runtime-allocated buffer. Called with the budget lock held, which is
+ * released while the data is read.
+ *
+ * @return TRUE on success, FALSE on failure, in which case the file's
+ * data remains in the backing file.
+ */
+static int32 reloadFile( MFSFILE *pFile )
+{
+  uint8 *pBuf;
+  uint32 cbData, cbAlloc;
+  int32 fOK = FALSE;
+
+  /* The backing file this data was in has been deleted. */
+  if ( pFile->spillGeneration != budget.spillGeneration )
+    return FALSE;
+
+  if ( pFile->fSpilled == MFS_SPILL_DATA )
+  {
+    cbData = pFile->cbSize;
+    cbAlloc = ( cbData > 0 ) ? cbData : INITIAL_BUFFER_SIZE;
+  }
+  else
+  {
+    cbData = pFile->cbCompressedSize;
+    cbAlloc = cbData;
+  }
+
+  reclaimMemory( cbAlloc );
+  budget.cbInUse += cbAlloc;
+
+  /* The file is off the idle list and still counted in nSpilled, so
+     neither it nor the backing file changes while the lock is released. */
+  unlockBudget();
+  pBuf = (uint8*) MemAlloc( cbAlloc, FALSE, FALSE );
+  if ( pBuf != NULL )
+    fOK = readSpillData( pBuf, cbData, pFile->spillOffset );
+  lockBudget();
+
+  if ( !fOK )
+  {
+    if ( pBuf != NULL )
+      MemFree( (void*) pBuf );
+    budget.cbInUse -= cbAlloc;
+    return FALSE;
+  }
+
+  if ( pFile->fSpilled == MFS_SPILL_DATA )
+  {
+    pFile->pData = pBuf;
+    pFile->fDynamicBuffer = TRUE;
+    pFile->cbCapacity = cbAlloc;
+  }
+  else
+  {
+    pFile->pCompressedData = pBuf;
+    pFile->fDynamicCompressedBuffer = TRUE;
+  }
+
+  dropSpilledData( pFile );
+
+  return TRUE;
+}
+
+/**
+ * @brief Allocate a file data buffer, charging it to the memory budget.
+ *
+ * <p>If the allocation would take the filesystem over budget, closed files
+ * are moved out to the backing file first. Open files are never moved out,
+ * so the allocation is still attempted if that does not free enough.
+ */
+static uint8 *allocFileData( uint32 cbSize, uint32 fZero )
+{
+  uint8 *pBuf;
+
+  lockBudget();
+  reclaimMemory( cbSize );
+  budget.cbInUse += cbSize;
+  unlockBudget();
+
+  pBuf = (uint8*) MemAlloc( cbSize, fZero, FALSE );
+
+  if ( pBuf == NULL )
+  {
+    lockBudget();
+    budget.cbInUse -= cbSize;
+    unlockBudget();
+  }
+
+  return pBuf;
+}
+
+/**
+ * @brief Change the number of bytes of file data charged to the memory
+ * budget, for buffers which are re-used at a different size.
+ */
+static void chargeFileData( uint32 cbAdded, uint32 cbRemoved )
+{
+  lockBudget();
+  budget.cbInUse = budget.cbInUse + cbAdded - cbRemoved;
+  unlockBudget();
+}
+
+/**
+ * @brief Free a file data buffer allocated by <code>allocFileData()</code>.
+ */
+static void freeFileData( uint8 *pBuf, uint32 cbSize )
+{
+  MemFree( (void*) pBuf );
+  chargeFileData( 0, cbSize );
+}
+
+/**
+ * @brief Decide how much to grow a writable file's buffer by, given that
+ * doubling it would add <code>cbGrowth</code> bytes.
+ */
+static uint32 budgetedGrowth( uint32 cbGrowth )
+{
+  lockBudget();
+  if ( budget.cbBudget != 0 && cbGrowth > BUDGET_GROWTH_CHUNK &&
+       ( budget.cbInUse > budget.cbBudget ||
+         cbGrowth > budget.cbBudget - budget.cbInUse ) )
+    cbGrowth = BUDGET_GROWTH_CHUNK;
+  unlockBudget();
+
+  return cbGrowth;
+}
+
+/**
+ * @brief Prepare a file to be opened: take it off the idle list, so it is
+ * not moved out while open, and read back any data in the backing file.
+ */
+static int32 claimFile( MFSFILE *pFile )
+{
+  int32 fOK = TRUE;
+
+  lockBudget();
+  waitForMove( pFile );
+  unlinkIdleFile( pFile );
+  if ( pFile->fSpilled != MFS_SPILL_NONE )
+    fOK = reloadFile( pFile );
+  unlockBudget();
+
+  return fOK;
+}
+
+/**
+ * @brief Put a file which has just been closed by its last descriptor on
+ * the idle list, if it holds any RAM, and bring the filesystem back within
+ * its budget.
+ */
+static void retireFile( MFSFILE *pFile )
+{
+  lockBudget();
+  if ( ( pFile->pData != NULL && pFile->fDynamicBuffer ) ||
+       ( pFile->pCompressedData != NULL && pFile->fDynamicCompressedBuffer ) )
+    linkIdleFile( pFile );
+  reclaimMemory( 0 );
+  unlockBudget();
+}
+
+/**
+ * @brief Copy a file's fields into a new file structure, moving its place
+ * on the idle list across with them.
+ */
+static void copyFile( MFSFILE *pTo, MFSFILE *pFrom )
+{
+  lockBudget();
+  waitForMove( pFrom );
+  (*pTo) = (*pFrom);
+  pTo->fIdle = FALSE;
+  pTo->pColder = NULL;
+  pTo->pWarmer = NULL;
+  if ( pFrom->fIdle )
+  {
+    unlinkIdleFile( pFrom );
+    linkIdleFile( pTo );
+  }
+  unlockBudget();
+}
+
+/**
+ * @brief Detach a file which is being destroyed from the idle list and
+ * the backing file.
+ */
+static void forgetFile( MFSFILE *pFile )
+{
+  lockBudget();
+  waitForMove( pFile );
+  unlinkIdleFile( pFile );
+  dropSpilledData( pFile );
+  unlockBudget();
+}
+
 static void shedFileBuffer( MFSFILE *pFile )
 {
   if ( pFile->fDynamicBuffer )
-    MemFree( (void*) pFile->pData );
+    freeFileData( pFile->pData, pFile->cbCapacity );
 
   pFile->pData = NULL;
   pFile->fDynamicBuffer = FALSE;
@@ -326,7 +1101,7 @@ static int32 inflateData( MFSFILE *pFile )
   if ( !pFile->fCompressed )
     return FALSE;
 
-  pBuf = (uint8*) MemAlloc( pFile->cbSize, FALSE, FALSE );
+  pBuf = allocFileData( pFile->cbSize, FALSE );
 
   if ( pBuf == NULL )
     return FALSE;
@@ -341,7 +1116,7 @@ static int32 inflateData( MFSFILE *pFile )
 
   if ( result != Z_OK )
   {
-    MemFree( (void*) pBuf );
+    freeFileData( pBuf, pFile->cbSize );
     return FALSE;
   }
   else
@@ -355,7 +1130,7 @@ static int32 inflateData( MFSFILE *pFile )
        time. We can re-allocate the compressed stream again later. */
     if ( pFile->fDynamicCompressedBuffer )
     {
-      MemFree( (void*) pFile->pCompressedData );
+      freeFileData( pFile->pCompressedData, pFile->cbCompressedSize );
       pFile->fDynamicCompressedBuffer = FALSE;
       pFile->pCompressedData = NULL;
     }
@@ -399,16 +1174,21 @@ static int32 deflateData( MFSFILE *pFile )
 
   if ( pFile->pCompressedData != NULL )
   {
-    zresult = gg_compress
+    uint32 cbOldCompressedSize = pFile->cbCompressedSize;
+
+    zresult = gg_compress2
       (
         pFile->pCompressedData,
         &pFile->cbCompressedSize,
         pFile->pData,
-        pFile->cbSize
+        pFile->cbSize,
+        RUNTIME_COMPRESSION_LEVEL
       );
 
     if ( zresult == Z_OK )
     {
+      if ( pFile->fDynamicCompressedBuffer )
+        chargeFileData( pFile->cbCompressedSize, cbOldCompressedSize );
       shedFileBuffer( pFile );
       return TRUE;
     }
@@ -417,7 +1197,7 @@ static int32 deflateData( MFSFILE *pFile )
       /* The existing compression buffer is not big enough. Free it off, if
          it's dynamic. */
       if ( pFile->fDynamicCompressedBuffer )
-        MemFree( (void*) pFile->pCompressedData );
+        freeFileData( pFile->pCompressedData, cbOldCompressedSize );
 
       pFile->pCompressedData = NULL;
       pFile->fDynamicCompressedBuffer = FALSE;
@@ -429,22 +1209,24 @@ static int32 deflateData( MFSFILE *pFile )
      buffer size. If this fails, then we abort compression altogether. If
      it succeeds, then we allocate a precisely-sized buffer. */
 
-  pBuf = (uint8*) MemAlloc( pFile->cbSize, FALSE, FALSE );
+  pBuf = allocFileData( pFile->cbSize, FALSE );
   if ( pBuf == NULL )
     return FALSE;
 
   pFile->cbCompressedSize = pFile->cbSize;
 
-  zresult = gg_compress
+  zresult = gg_compress2
     (
       pBuf,
       &pFile->cbCompressedSize,
       pFile->pData,
-      pFile->cbSize
+      pFile->cbSize,
+      RUNTIME_COMPRESSION_LEVEL
     );
 
   if ( zresult == Z_OK )
   {
+    uint32 cbBuf = pFile->cbSize;
     uint8 *pPrecise;
 
     /* We have a compressed array, so we can commit to freeing off the
@@ -452,7 +1234,7 @@ static int32 deflateData( MFSFILE *pFile )
     shedFileBuffer( pFile );
 
     /* Now try to slim down to a precisely-sized buffer. */
-    pPrecise = (uint8*) MemAlloc( pFile->cbCompressedSize, FALSE, FALSE );
+    pPrecise = allocFileData( pFile->cbCompressedSize, FALSE );
 
     /* Since we've just freed a buffer >cbCompressedSize, the above alloc
        really ought to succeed. If it doesn't, then just install pBuf
@@ -461,9 +1243,14 @@ static int32 deflateData( MFSFILE *pFile )
     if ( pPrecise != NULL )
     {
       memcpy( pPrecise, pBuf, CAST_UNSIGNED_TO_SIZET(pFile->cbCompressedSize) );
-      MemFree( (void*) pBuf );
+      freeFileData( pBuf, cbBuf );
       pBuf = pPrecise;
     }
+    else
+    {
+      /* The budget charges compressed buffers at their compressed size. */
+      chargeFileData( pFile->cbCompressedSize, cbBuf );
+    }
 
     pFile->pCompressedData = pBuf;
     pFile->fDynamicCompressedBuffer = TRUE;
@@ -472,7 +1259,7 @@ static int32 deflateData( MFSFILE *pFile )
   else
   {
     /* No more strategies. Leave the file in an uncompressed state. */
-    MemFree( (void*) pBuf );
+    freeFileData( pBuf, pFile->cbSize );
     return FALSE;
   }
 }
@@ -520,7 +1307,7 @@ static MFSNODE *makeNode
     if ( pExistingFile == NULL )
     {
       /* No existing file, so allocate a fresh initial data buffer. */
-      pBuf = (uint8*) MemAlloc( INITIAL_BUFFER_SIZE, TRUE, FALSE );
+      pBuf = allocFileData( INITIAL_BUFFER_SIZE, TRUE );
     }
 
     /* Either: the above allocation succeeded, OR there is an existing file
@@ -548,11 +1335,19 @@ static MFSNODE *makeNode
         pNewFile->fDynamicCompressedBuffer = FALSE;
         pNewFile->pCompressedData = NULL;
         pNewFile->fModified = FALSE;
+        pNewFile->fSpilled = MFS_SPILL_NONE;
+        pNewFile->spillOffset = 0;
+        pNewFile->cbSpilled = 0;
+        pNewFile->spillGeneration = 0;
+        pNewFile->fMoving = FALSE;
+        pNewFile->fIdle = FALSE;
+        pNewFile->pColder = NULL;
+        pNewFile->pWarmer = NULL;
       }
       else
       {
         /* We are copying all fields across from the existing file. */
-        (*pNewFile) = (*pExistingFile);
+        copyFile( pNewFile, pExistingFile );
       }
 
       pNew->type = MFS_File;
@@ -571,7 +1366,7 @@ static MFSNODE *makeNode
     if ( pNewDir != NULL ) MemFree( (void*) pNewDir );
     if ( entries != NULL ) MemFree( (void*) entries );
     if ( pNewFile != NULL ) MemFree( (void*) pNewFile );
-    if ( pBuf != NULL ) MemFree( (void*) pBuf );
+    if ( pBuf != NULL ) freeFileData( pBuf, INITIAL_BUFFER_SIZE );
   }
 
   return pNew;
@@ -762,12 +1557,13 @@ static uint8* growFileBuffer( MFSFILE *pFile )
 
   for (i = 4; i > 0; i--)
   {
-    /* We gradually reduce our attempt by a quarter of requested growth */
-    cbNewCapacity = pFile->cbCapacity +
-                    pFile->cbCapacity * (BUFFER_GROWTH_FACTOR - 1) * i / 4 ;
+    /* We gradually reduce our attempt by a quarter of requested growth,
+       and grow a chunk at a time if doubling would break the budget. */
+    cbNewCapacity = pFile->cbCapacity + budgetedGrowth(
+                      pFile->cbCapacity * (BUFFER_GROWTH_FACTOR - 1) * i / 4 );
     /* If empty file, set new capacity to default size */
     cbNewCapacity = cbNewCapacity ? cbNewCapacity : INITIAL_BUFFER_SIZE ;
-    pNewBuffer = (uint8*) MemAlloc( cbNewCapacity, TRUE, FALSE );
+    pNewBuffer = allocFileData( cbNewCapacity, TRUE );
     if (pNewBuffer != NULL)
       break;
   }
@@ -780,7 +1576,7 @@ static uint8* growFileBuffer( MFSFILE *pFile )
     /* If the old buffer was dynamically-allocated, free it now. */
     if ( pFile->fDynamicBuffer )
     {
-      MemFree( (void*) pFile->pData );
+      freeFileData( pFile->pData, pFile->cbCapacity );
     }
 
     /* Update for new dynamic buffer. */
@@ -794,6 +1590,11 @@ static uint8* growFileBuffer( MFSFILE *pFile )
 
 static int32 prepareForAccess( MFSFILEDESC *pDesc )
 {
+  /* Bring back any data that was moved out to the backing file, and keep
+     it in RAM while the file is open. */
+  if ( !claimFile( pDesc->pFile ) )
+    return FALSE;
+
   if ( pDesc->pFile->pData != NULL )
   {
     /* No preparations needed, because the uncompressed data buffer is
@@ -843,11 +1644,14 @@ static void destroyNode( MFSNODE *pNode, uint32 fDestroyBuffer )
       /* Destroy file-specific data. */
       MFSFILE *pFile = pNode->pFile;
 
+      if ( fDestroyBuffer )
+        forgetFile( pFile );
+
       if ( pFile->fDynamicBuffer && fDestroyBuffer )
-        MemFree( (void*) pFile->pData );
+        freeFileData( pFile->pData, pFile->cbCapacity );
 
       if ( pFile->fDynamicCompressedBuffer && fDestroyBuffer )
-        MemFree( (void*) pFile->pCompressedData );
+        freeFileData( pFile->pCompressedData, pFile->cbCompressedSize );
 
       if ( pNode->fDynamic )
         MemFree( (void*) pFile );
@@ -1218,6 +2022,7 @@ int32 MFSClose( MFSFILEDESC *pDesc )
     if ( pFile->pData != NULL )
       deflateData( pFile );
     pFile->fModified = FALSE;
+    retireFile( pFile );
   }
 
   return TRUE;
@@ -1635,3 +2440,114 @@ void MFSMemUsage( MFSNODE *pNode, uint32 *pROMSize, uint32 *pRAMSize )
   }
 }
 
+/**
+ * @brief Destroy whichever budget semaphores exist.
+ */
+static void destroyBudgetSemaphores( void )
+{
+  if ( budget.pSema != NULL )
+    PKDestroySemaphore( budget.pSema );
+  if ( budget.pSpillSema != NULL )
+    PKDestroySemaphore( budget.pSpillSema );
+  if ( budget.pMoveDone != NULL )
+    PKDestroySemaphore( budget.pMoveDone );
+
+  budget.pSema = NULL;
+  budget.pSpillSema = NULL;
+  budget.pMoveDone = NULL;
+}
+
+int32 MFSStartBudget( void )
+{
+  if ( budget.pSema != NULL )
+    return TRUE;
+
+  budget.pSema = PKCreateSemaphore( 1 );
+  budget.pSpillSema = PKCreateSemaphore( 1 );
+  budget.pMoveDone = PKCreateSemaphore( 0 );
+
+  if ( budget.pSema == NULL || budget.pSpillSema == NULL ||
+       budget.pMoveDone == NULL )
+  {
+    destroyBudgetSemaphores();
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void MFSEndBudget( void )
+{
+  if ( budget.pSema == NULL )
+    return;
+
+  lockBudget();
+  budget.cbBudget = 0;
+  /* Files still in the backing file lose their data, and fail to open. */
+  if ( budget.nSpilled != 0 )
+  {
+    budget.nSpilled = 0;
+    budget.spillGeneration++;
+  }
+  closeSpillFile();
+  if ( budget.pHoles != NULL )
+  {
+    MemFree( (void*) budget.pHoles );
+    budget.pHoles = NULL;
+    budget.nHoleSlots = 0;
+  }
+  unlockBudget();
+
+  destroyBudgetSemaphores();
+}
+
+void MFSSetMemoryBudget( uint32 cbBudget )
+{
+  if ( budget.pSema == NULL )
+    return;
+
+  lockBudget();
+  budget.cbBudget = cbBudget;
+  reclaimMemory( 0 );
+  unlockBudget();
+}
+
+int32 MFSSetSpillFile( uint8 *pszFilename )
+{
+  int32 fOK = FALSE;
+
+  if ( pszFilename == NULL )
+    pszFilename = (uint8*) "";
+
+  if ( budget.pSema == NULL ||
+       strlen_uint32( (char*) pszFilename ) >= LONGESTFILENAME )
+    return FALSE;
+
+  lockBudget();
+  /* The backing file is named when it is deleted, so keep the old name
+     until it has been, or until the file being written to it is. */
+  if ( budget.nSpilled == 0 )
+  {
+    strcpy( (char*) budget.szSpillFile, (char*) pszFilename );
+    reclaimMemory( 0 );
+    fOK = TRUE;
+  }
+  unlockBudget();
+
+  return fOK;
+}
+
+void MFSGetMemoryBudget( uint32 *pcbBudget, uint32 *pcbInUse )
+{
+  lockBudget();
+  *pcbBudget = budget.cbBudget;
+  *pcbInUse = budget.cbInUse;
+  unlockBudget();
+}
+
+void init_C_globals_memfs(void)
+{
+  MFSBUDGET init = { 0 };
+
+  budget = init;
+}
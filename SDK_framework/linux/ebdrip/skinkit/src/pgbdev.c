@@ -445,7 +445,8 @@ static void deleteDiskCacheFile(void);
 static void closeDiskCacheFile(void);
 static HqBool storeBandInCache( PGBDeviceState * pDeviceState,
                                 PGBDescription * pPGB,
-                                uint8 * pBuffer, uint32 length );
+                                uint8 * pBuffer, uint32 length,
+                                HqBool fCompressed );
 static HqBool getBand( PGBDescription *pPGB,
                        uint8 *pBuffer, uint32 *pExpectedLength );
 static HqBool initDiskCacheFileName( const char * pszLeafDiskCacheFileName );
@@ -764,6 +765,10 @@ typedef struct
   int32 BandLines ; /**< Number of lines in this band */
   int32 SeparationId ; /**< Omission-independent separation id. */
   uint8 PGBSysmem;     /**< PGB device uses system memory. */
+  float MinBandCompressRatio; /**< Largest compressed/uncompressed size
+                                   ratio worth keeping for RIP-compressed
+                                   bands. */
+  int32 BandIsCompressed; /**< Next band written was compressed by the RIP. */
 } PageBufferInParameters;
 
 typedef struct
@@ -781,6 +786,8 @@ typedef struct
                              printer back to PostScript */
   uint8 PrinterMessage[32]; /**< message to communicate condition of printer
                                 back to PostScript */
+  int32 RIPCanCompress;   /**< Whether the RIP may compress bands for us
+                             using the %compress% device. */
   /* MaxBandSize omitted: let the rip choose for itself */
 
 } PageBufferOutParameters;
@@ -866,6 +873,8 @@ static PageBufferInParameters pgbinparams =
   0,                      /* BandLines */
   0,                      /* SeparationId */
   FALSE,                  /* PGBSysmem */
+  0.9f,                   /* MinBandCompressRatio */
+  FALSE,                  /* BandIsCompressed */
 };
 
 static PGBDescription *g_pgb = NULL;
@@ -876,7 +885,8 @@ static PageBufferOutParameters pgboutparams =
   FALSE,                  /**< WriteAllOutput */
   FALSE,                  /**< MultipleCopies */
   0x7FFFFF80,             /**< PrinterStatus */
-  "Unknown Error"         /**< Printer Message */
+  "Unknown Error",        /**< Printer Message */
+  FALSE,                  /**< RIPCanCompress */
 };
 
 /* Colorant dictionary keys */
@@ -1369,6 +1379,24 @@ static PARAM devparams[] =
     "PGBSysmem",   0, PARAM_WRITEABLE,
     ParamBoolean, & pgbinparams.PGBSysmem, 0, 0
   },
+
+#define MINBANDCOMPRESSRATIO_INDEX (PGB_SYSMEM + 1)
+  {
+    "MinBandCompressRatio", 0, PARAM_WRITEABLE | PARAM_SET | PARAM_RANGE,
+    ParamFloat, & pgbinparams.MinBandCompressRatio, 0, 1
+  },
+
+#define BANDISCOMPRESSED_INDEX (MINBANDCOMPRESSRATIO_INDEX + 1)
+  {
+    "BandIsCompressed", 0, PARAM_WRITEABLE,
+    ParamBoolean, & pgbinparams.BandIsCompressed, 0, 0
+  },
+
+#define RIPCANCOMPRESS_INDEX (BANDISCOMPRESSED_INDEX + 1)
+  {
+    "RIPCanCompress", 0, PARAM_READONLY | PARAM_SET,
+    ParamBoolean, & pgboutparams.RIPCanCompress, 0, 0
+  },
 };
 
 /** \brief Number of parameters in devparams array */
@@ -1647,6 +1675,19 @@ static DEVICE_FILEDESCRIPTOR RIPCALL pgb_open_file( DEVICELIST *dev ,
     }
   }
 
+  /* Bands stored in the band cache are deflated, so let the render threads
+     do that with the %compress% device rather than doing it serially here.
+     Bands passed straight to the raster callback must stay uncompressed. */
+  pgboutparams.RIPCanCompress = ( pgbinparams.fAllowBandCompression &&
+                                  g_pgb->partial_painting &&
+                                  !skin_has_framebuffer &&
+                                  !g_pgb->discard_data
+#ifdef HAS_RLE
+                                  && !g_pgb->rd.runLength
+#endif
+                                  );
+  pgbinparams.BandIsCompressed = FALSE;
+
   if ( (pgb_tl = SwTimelineStart(SWTLT_PGB, SW_TL_REF_INVALID,
                                  0 /*start*/,
                                  SW_TL_EXTENT_INDETERMINATE,
@@ -1769,13 +1810,17 @@ static int32 RIPCALL pgb_write_file( DEVICELIST *dev, DEVICE_FILEDESCRIPTOR desc
         p_band_directory[(pgb->rd.separation - 1) * pgb->n_bands_in_page
                          + pgb->seek_band]
           = TRUE;
-      else if ( !storeBandInCache(pDeviceState, pgb, buff, CAST_SIGNED_TO_UINT32(len)) )
+      else if ( !storeBandInCache(pDeviceState, pgb, buff, CAST_SIGNED_TO_UINT32(len),
+                                  pgbinparams.BandIsCompressed) )
         {
           pgb_set_last_error( dev, DeviceIOError );
           return -1;
         }
     } else {
-      if ( pgb->seek_line != pgb->output_line ||
+      HQASSERT(!pgbinparams.BandIsCompressed,
+               "RIP compressed a band for direct output");
+      if ( pgbinparams.BandIsCompressed ||
+           pgb->seek_line != pgb->output_line ||
            !KCallRasterCallback(&pgb->rd, buff) ) {
         pgb_set_last_error( dev, DeviceIOError );
         return -1;
@@ -3776,12 +3821,14 @@ static uint8 * getMemoryForBand( uint32 len )
  * \param[in] pPGB         The PGB containing the store that will be accessed.
  * \param[in] pBuff        The buffer containing the bytes to be stored.
  * \param[in] length       The number of bytes to read from pBuff.
+ * \param[in] fCompressed  TRUE if the RIP has already deflated the bytes.
  *
  * \return TRUE if store succeeded; FALSE otherwise.
  */
 static HqBool storeBandInCache( PGBDeviceState *pDeviceState,
                                 PGBDescription *pPGB,
-                                uint8 *pBuff, uint32 length )
+                                uint8 *pBuff, uint32 length,
+                                HqBool fCompressed )
 {
   HqBool fResult = FALSE;
   uint32 destinationLen = 0 /* pacify compiler */;
@@ -3795,7 +3842,14 @@ static HqBool storeBandInCache( PGBDeviceState *pDeviceState,
 
   HQASSERT(gBandMemory.bandSize >= length, "Band size too small");
 
-  if ( pgbinparams.fAllowBandCompression ) {
+  if ( fCompressed ) {
+    /* The RIP has already deflated this band with the %compress% device. */
+    HQASSERT(pgbinparams.fAllowBandCompression,
+             "RIP compressed a band when band compression is off");
+    destinationLen = length;
+    pDestination = pBuff;
+  }
+  else if ( pgbinparams.fAllowBandCompression ) {
     /* Compress data into a buffer which has already been allocated to be large enough */
     destinationLen = gg_compressBound( length );
     HQASSERT(gBandMemory.pCompressionBuffer != NULL, "No compression buffer");
@@ -32,15 +32,28 @@
 #include "file.h"      /* LONGESTFILENAME */
 #include "sync.h"      /* PKCreateSemaphore, PKDestroySemaphore */
 
-#define RAMDEV_PARAM_TYPE   0
-#define RAMDEV_PARAM_PREFIX 1
-#define RAMDEV_PARAM_COUNT  2
+#define RAMDEV_PARAM_TYPE         0
+#define RAMDEV_PARAM_PREFIX       1
+#define RAMDEV_PARAM_MEMORYBUDGET 2
+#define RAMDEV_PARAM_SPILLFILE    3
+#define RAMDEV_PARAM_COUNT        4
 
 /**
  * @brief Name of the single, read-only device parameter for this device.
  */
 static uint8* szParamType =   (uint8*) "Type";
 static uint8* szParamPrefix = (uint8*) "Prefix";
+static uint8* szParamMemoryBudget = (uint8*) "MemoryBudget";
+static uint8* szParamSpillFile = (uint8*) "SpillFile";
+
+/**
+ * @brief Value of the <code>/SpillFile</code> device parameter: the platform
+ * filename to which closed RAM files are moved once the
+ * <code>/MemoryBudget</code> is exceeded. These parameters control the
+ * Memory File System as a whole, so they are shared by all instances of the
+ * device.
+ */
+static uint8 szSpillFile[ LONGESTFILENAME ];
 
 /**
  * @brief Constant value of the <code>/Type</code> device parameter. This allows
@@ -316,6 +329,11 @@ static int32 RIPCALL ramdev_init_device( DEVICELIST *dev )
        cause ramdev_dismount_device() to make the corresponding
        MFSReleaseRoot(). */
     pState->fReleaseRootOnDismount = TRUE;
+
+    /* Mounting the first instance is the last point at which the Memory File
+       System is used by a single thread, so create its budget lock here. A
+       missing lock just means there will be no budget. */
+    (void) MFSStartBudget();
   }
   else
   {
@@ -343,7 +361,10 @@ static int32 RIPCALL ramdev_dismount_device( DEVICELIST *dev )
   (void) ramdev_noerror(dev) ; /* clear error flag first */
 
   if ( pState->fReleaseRootOnDismount )
+  {
     MFSReleaseRoot( pState->pMFSRoot );
+    MFSEndBudget();
+  }
 
   if (pState->pSema)
   {
@@ -729,6 +750,49 @@ static int32 RIPCALL ramdev_set_param( DEVICELIST *dev, DEVICEPARAM *param )
       pState->prefix[ param->strvallen ] = '\0';
     }
   } 
+  else if ( param->paramnamelen == strlen_int32( (char *) szParamMemoryBudget ) &&
+            strncmp((char *)param->paramname, (char *)szParamMemoryBudget,
+                    CAST_SIGNED_TO_SIZET(param->paramnamelen)) == 0 )
+  {
+    /* Zero removes the budget. */
+    if ( param->type != ParamInteger ) {
+      ramdev_set_lasterror(dev, DeviceIOError) ;
+      return ParamTypeCheck;
+    }
+    if ( param->paramval.intval < 0 ) {
+      ramdev_set_lasterror(dev, DeviceIOError) ;
+      return ParamRangeCheck;
+    }
+
+    MFSSetMemoryBudget( (uint32) param->paramval.intval );
+  }
+  else if ( param->paramnamelen == strlen_int32( (char *) szParamSpillFile ) &&
+            strncmp((char *)param->paramname, (char *)szParamSpillFile,
+                    CAST_SIGNED_TO_SIZET(param->paramnamelen)) == 0 )
+  {
+    uint8 szName[ LONGESTFILENAME ];
+
+    /* An empty string keeps all files in RAM. */
+    if ( param->type != ParamString ) {
+      ramdev_set_lasterror(dev, DeviceIOError) ;
+      return ParamTypeCheck;
+    }
+    if ( param->strvallen >= LONGESTFILENAME ) {
+      ramdev_set_lasterror(dev, DeviceIOError) ;
+      return ParamRangeCheck;
+    }
+
+    memcpy(szName, param->paramval.strval, CAST_SIGNED_TO_SIZET(param->strvallen));
+    szName[ param->strvallen ] = '\0';
+
+    /* The name cannot change while files are held in the old spill file. */
+    if ( !MFSSetSpillFile( szName ) ) {
+      ramdev_set_lasterror(dev, DeviceIOError) ;
+      return ParamConfigError;
+    }
+
+    strcpy((char *)szSpillFile, (char *)szName);
+  }
   else
   {
     ramdev_set_lasterror(dev, DeviceNoError) ;
@@ -746,6 +810,16 @@ static int32 RIPCALL ramdev_start_param(DEVICELIST *dev)
   return RAMDEV_PARAM_COUNT ;
 }
 
+/** @brief Fill in the value of the <code>/MemoryBudget</code> parameter. */
+static void ramdev_get_memory_budget( DEVICEPARAM *param )
+{
+  uint32 cbBudget, cbInUse;
+
+  MFSGetMemoryBudget( &cbBudget, &cbInUse );
+  param->type = ParamInteger;
+  param->paramval.intval = (int32) cbBudget;
+}
+
 static int32 RIPCALL ramdev_get_param( DEVICELIST *dev, DEVICEPARAM *param )
 {
   RAMDeviceState *pState = (RAMDeviceState*) dev->private_data;
@@ -772,6 +846,20 @@ static int32 RIPCALL ramdev_get_param( DEVICELIST *dev, DEVICEPARAM *param )
         param->strvallen = strlen_int32( (char*) pState->prefix );
         return ParamAccepted;
 
+      case RAMDEV_PARAM_MEMORYBUDGET:
+        param->paramname = szParamMemoryBudget;
+        param->paramnamelen = strlen_int32( (char*) szParamMemoryBudget );
+        ramdev_get_memory_budget( param );
+        return ParamAccepted;
+
+      case RAMDEV_PARAM_SPILLFILE:
+        param->paramname = szParamSpillFile;
+        param->paramnamelen = strlen_int32( (char*) szParamSpillFile );
+        param->type = ParamString;
+        param->paramval.strval = szSpillFile;
+        param->strvallen = strlen_int32( (char*) szSpillFile );
+        return ParamAccepted;
+
       default:
         /* Out of range. */
         return ParamIgnored;
@@ -795,6 +883,20 @@ static int32 RIPCALL ramdev_get_param( DEVICELIST *dev, DEVICEPARAM *param )
     param->strvallen = strlen_int32( (char*) pState->prefix );
     return ParamAccepted;
   }
+  else if ( strncmp( (char*) param->paramname, (char*) szParamMemoryBudget,
+                     CAST_SIGNED_TO_SIZET(param->paramnamelen) ) == 0 )
+  {
+    ramdev_get_memory_budget( param );
+    return ParamAccepted;
+  }
+  else if ( strncmp( (char*) param->paramname, (char*) szParamSpillFile,
+                     CAST_SIGNED_TO_SIZET(param->paramnamelen) ) == 0 )
+  {
+    param->type = ParamString;
+    param->paramval.strval = szSpillFile;
+    param->strvallen = strlen_int32( (char*) szSpillFile );
+    return ParamAccepted;
+  }
   else
   {
     /* The RIP is asking for a parameter not defined by this device. */
@@ -808,6 +910,7 @@ static int32 RIPCALL ramdev_status_device( DEVICELIST *dev, DEVSTAT *devstat )
   uint32 cbRAM = 0;
   uint32 cbROM = 0;
   uint32 cbTotal = 0;
+  uint32 cbBudget, cbInUse;
 
   /* Ask MFS to sum the memory usage for the root node of the tree. */
   MFSMemUsage( pState->pMFSRoot, &cbROM, &cbRAM );
@@ -817,8 +920,10 @@ static int32 RIPCALL ramdev_status_device( DEVICELIST *dev, DEVSTAT *devstat )
   devstat->start = NULL;
   HqU32x2FromUint32( &(devstat->size), cbTotal );
 
-  /* Currently no way to determine free memory for RAM device. */
-  HqU32x2FromInt32( &(devstat->free), 0 );
+  /* Free memory is only known when the device has a memory budget. */
+  MFSGetMemoryBudget( &cbBudget, &cbInUse );
+  HqU32x2FromUint32( &(devstat->free),
+                     cbBudget > cbInUse ? cbBudget - cbInUse : 0 );
 
   return ramdev_noerror( dev );
 }
@@ -871,5 +976,6 @@ void init_C_globals_ramdev(void)
 #endif
 
   pMFSRoot = NULL ;
+  szSpillFile[ 0 ] = '\0' ;
 }
 
@@ -214,6 +214,7 @@ extern DEVICETYPE
   Fs_Device_Type,
   Monitor_Device_Type,
   PageBuffer_Device_Type,
+  Compress_Device_Type,
 #ifndef EMBEDDED
   Screening_Device_Type,
 #endif
@@ -245,6 +246,7 @@ static DEVICETYPE *Device_Type_List[] = {
   &Fs_Device_Type,   /* %os% etc */
   &Monitor_Device_Type,
   &PageBuffer_Device_Type,
+  &Compress_Device_Type,   /* %compress% instances for band compression */
 #ifndef EMBEDDED
   &Screening_Device_Type,
 #endif
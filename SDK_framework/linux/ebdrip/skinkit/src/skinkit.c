@@ -1310,6 +1310,7 @@ static HqBool SwStartupCommon( SwLeMONITORCALLBACK *pfnMonitor )
 /* Declare global init functions here to avoid header inclusion
    nightmare. */
 void init_C_globals_filedev(void) ;
+void init_C_globals_memfs(void) ;
 void init_C_globals_pgbdev(void) ;
 void init_C_globals_ramdev(void) ;
 void init_C_globals_ripthread(void) ;
@@ -1327,6 +1328,7 @@ static void init_C_runtime_skinkit(void)
   rip_exit_status = 0 ;
 
   init_C_globals_filedev() ;
+  init_C_globals_memfs() ;
   init_C_globals_pgbdev() ;
   init_C_globals_ramdev() ;
   init_C_globals_ripthread() ;
@@ -34,12 +34,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 #include <glob.h>
 
 #define DIRMODE  0777
 #define FILEMODE 0666
 
+/* Files modified more recently than this many seconds ago may still be
+ * being written, so are not mapped. */
+#define MAP_SETTLE_SECONDS 5
+
 
 #if defined linux && !defined(LIBuClibc)
 /* Explicitly use the 64-bit types and APIs */
@@ -69,6 +75,10 @@ static int make_subdirectories(char * filename);
 struct FileDesc
 {
   int fd;
+  uint8 * pMap;     /* Read-only mapping of the file, or NULL */
+  OFF_T mapLength;  /* Length of the mapping */
+  OFF_T position;   /* Read position, when the file is mapped */
+  HqBool fRandom;   /* Mapping has been advised for random access */
 };
 
 
@@ -77,7 +87,13 @@ static FileDesc* createFileDescriptorFromHandle( int fd )
   FileDesc* pDescriptor = (FileDesc*) MemAlloc (sizeof (FileDesc), FALSE, FALSE);
 
   if (pDescriptor)
+  {
     pDescriptor->fd = fd;
+    pDescriptor->pMap = NULL;
+    pDescriptor->mapLength = 0;
+    pDescriptor->position = 0;
+    pDescriptor->fRandom = FALSE;
+  }
 
   return pDescriptor;
 }
@@ -237,11 +253,95 @@ FileDesc* PKOpenFile(uint8 *filename, int32 openflags, int32 * pError)
 }
 
 
+HqBool PKMapFile(FileDesc* pDescriptor)
+{
+  STATSTRUCT status;
+  OFF_T pos;
+  void * pMap;
+
+  HQASSERT(pDescriptor != NULL, "No file descriptor");
+
+  if ( pDescriptor->pMap != NULL )
+    return TRUE;
+
+  /* Pipes, sockets and devices keep using read(). */
+  if ( FSTATFN(pDescriptor->fd, &status) != 0 ||
+       !S_ISREG(status.st_mode) || status.st_size <= 0 ||
+       (OFF_T)(size_t)status.st_size != status.st_size )
+    return FALSE;
+
+  /* Touching a page of the mapping beyond the end of the file raises
+   * SIGBUS, so a file that is truncated while mapped would kill the RIP.
+   * Files that have changed recently, such as those still arriving in a hot
+   * folder, keep using read(). */
+  if ( status.st_mtime + MAP_SETTLE_SECONDS > time(NULL) )
+    return FALSE;
+
+  pos = LSEEKFN(pDescriptor->fd, 0, SEEK_CUR);
+  if ( pos < 0 )
+    return FALSE;
+
+  pMap = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED,
+              pDescriptor->fd, 0);
+  if ( pMap == MAP_FAILED )
+    return FALSE;
+
+  /* If the file changed while it was being mapped, someone else is writing
+   * it; don't rely on the mapping. */
+  {
+    STATSTRUCT mapped;
+
+    if ( FSTATFN(pDescriptor->fd, &mapped) != 0 ||
+         mapped.st_size != status.st_size ||
+         mapped.st_mtime != status.st_mtime )
+    {
+      (void)munmap(pMap, (size_t)status.st_size);
+      return FALSE;
+    }
+  }
+
+  /* Most jobs are read straight through; PDF seeks around, and switches the
+     advice to random access on its first seek. */
+  (void)madvise(pMap, (size_t)status.st_size, MADV_SEQUENTIAL);
+
+  pDescriptor->pMap = pMap;
+  pDescriptor->mapLength = status.st_size;
+  pDescriptor->position = pos;
+  pDescriptor->fRandom = FALSE;
+  return TRUE;
+}
+
+
 int32 PKReadFile(FileDesc* pDescriptor, uint8 * buff, int32 len, int32 * pError)
 {
   int32 bytes;
 
   HQASSERT(pDescriptor != NULL, "No file descriptor");
+
+  if ( pDescriptor->pMap != NULL )
+  {
+    if ( pDescriptor->position < pDescriptor->mapLength )
+    {
+      OFF_T avail = pDescriptor->mapLength - pDescriptor->position;
+
+      if ( (OFF_T)len > avail )
+        len = (int32)avail;
+      memcpy(buff, pDescriptor->pMap + pDescriptor->position, (size_t)len);
+      pDescriptor->position += len;
+      return len;
+    }
+
+    /* Past the end of the mapping; the file may have grown since it was
+       mapped, so read the rest from the file position. */
+    if ( LSEEKFN(pDescriptor->fd, pDescriptor->position, SEEK_SET) < 0 )
+    {
+      int32 errcode = errno;
+      PKRecordSystemError(errcode, __LINE__, __FILE__, TRUE);
+      *pError = map_errno(errcode);
+      return -1;
+    }
+  }
+
   for (;;)
   {
     bytes = read( pDescriptor->fd, buff, len );
@@ -260,6 +360,8 @@ int32 PKReadFile(FileDesc* pDescriptor, uint8 * buff, int32 len, int32 * pError)
     }
     else
     {
+      if ( pDescriptor->pMap != NULL )
+        pDescriptor->position += bytes;
       return bytes;
     }
   }
@@ -304,6 +406,12 @@ int32 PKCloseFile(FileDesc* pDescriptor, int32 * pError)
   int rv;
   HQASSERT(pDescriptor != NULL, "No file descriptor");
 
+  if ( pDescriptor->pMap != NULL )
+  {
+    (void)munmap(pDescriptor->pMap, (size_t)pDescriptor->mapLength);
+    pDescriptor->pMap = NULL;
+  }
+
   rv = close(pDescriptor->fd);
   if (rv < 0)
   {
@@ -337,6 +445,13 @@ int32 PKSeekFile(FileDesc* pDescriptor, Hq32x2 * destination, int32 flags,
     return FALSE;
   }
 
+  /* Reads from a mapping don't move the file position. */
+  if ( pDescriptor->pMap != NULL && flags == SEEK_CUR )
+  {
+    destn += pDescriptor->position;
+    flags = SEEK_SET;
+  }
+
   code = LSEEKFN(pDescriptor->fd, destn, flags);
   if (code < 0)
   {
@@ -346,6 +461,17 @@ int32 PKSeekFile(FileDesc* pDescriptor, Hq32x2 * destination, int32 flags,
     return FALSE;
   }
 
+  if ( pDescriptor->pMap != NULL )
+  {
+    if ( code != pDescriptor->position && !pDescriptor->fRandom )
+    {
+      (void)madvise(pDescriptor->pMap, (size_t)pDescriptor->mapLength,
+                    MADV_RANDOM);
+      pDescriptor->fRandom = TRUE;
+    }
+    pDescriptor->position = code;
+  }
+
   Hq32x2FromOff_t(destination, code);
   return TRUE;
 }
@@ -372,7 +498,8 @@ int32 PKBytesFile(FileDesc* pDescriptor, Hq32x2 * bytes, int32 reason,
     length = status.st_size;
     if (reason == SW_BYTES_AVAIL_REL)
     {
-      OFF_T pos = LSEEKFN(pDescriptor->fd, 0, SEEK_CUR);
+      OFF_T pos = pDescriptor->pMap != NULL ? pDescriptor->position
+                                            : LSEEKFN(pDescriptor->fd, 0, SEEK_CUR);
       if (pos < 0)
         length = 0; /* ? */
       else